@@ -1,21 +1,29 @@
 
 LOCAL_PATH := $(call my-dir)
 
-include $(CLEAR_VARS)
-LOCAL_MODULE := libaac
-LOCAL_CATEGORY_PATH := libs
-LOCAL_DESCRIPTION := AAC bitstream reader/writer library
-LOCAL_EXPORT_C_INCLUDES := $(LOCAL_PATH)/include
-LOCAL_CFLAGS := -DAAC_API_EXPORTS -fvisibility=hidden -std=gnu99 -D_GNU_SOURCE
-LOCAL_SRC_FILES := \
+# Sources of libaac and of its static build (libaac-internal)
+LIBAAC_SRC_FILES := \
 	src/aac_bitstream.c \
+	src/aac_columns.c \
 	src/aac_ctx.c \
 	src/aac_dump.c \
+	src/aac_gen.c \
+	src/aac_histogram.c \
+	src/aac_mp4.c \
 	src/aac_reader.c \
+	src/aac_shm.c \
 	src/aac_types.c \
 	src/aac_writer.c \
 	src/aac.c
 
+include $(CLEAR_VARS)
+LOCAL_MODULE := libaac
+LOCAL_CATEGORY_PATH := libs
+LOCAL_DESCRIPTION := AAC bitstream reader/writer library
+LOCAL_EXPORT_C_INCLUDES := $(LOCAL_PATH)/include
+LOCAL_CFLAGS := -DAAC_API_EXPORTS -fvisibility=hidden -std=gnu11 -D_GNU_SOURCE
+LOCAL_SRC_FILES := $(LIBAAC_SRC_FILES)
+
 LOCAL_PRIVATE_LIBRARIES := \
 	json \
 	libaudio-defs \
@@ -23,10 +31,65 @@ LOCAL_PRIVATE_LIBRARIES := \
 
 ifeq ("$(TARGET_OS)","windows")
   LOCAL_LDLIBS += -lws2_32
+else ifeq ("$(TARGET_OS)","linux")
+  ifneq ("$(TARGET_OS_FLAVOUR)","android")
+    # shm_open (glibc < 2.34)
+    LOCAL_LDLIBS += -lrt
+  endif
 endif
 
 include $(BUILD_LIBRARY)
 
+# Static build with the internal functions of src/aac_huffman.h, which the
+# shared library does not export: for the micro-benchmark and the tests
+include $(CLEAR_VARS)
+LOCAL_MODULE := libaac-internal
+LOCAL_CATEGORY_PATH := libs/aac
+LOCAL_DESCRIPTION := AAC bitstream reader/writer library (static, internals)
+LOCAL_EXPORT_C_INCLUDES := $(LOCAL_PATH)/include $(LOCAL_PATH)/src
+LOCAL_CFLAGS := -std=gnu11 -D_GNU_SOURCE
+LOCAL_SRC_FILES := $(LIBAAC_SRC_FILES)
+
+LOCAL_LIBRARIES := \
+	json \
+	libaudio-defs \
+	libulog
+
+ifeq ("$(TARGET_OS)","windows")
+  LOCAL_EXPORT_LDLIBS += -lws2_32
+else ifeq ("$(TARGET_OS)","linux")
+  ifneq ("$(TARGET_OS_FLAVOUR)","android")
+    LOCAL_EXPORT_LDLIBS += -lrt
+  endif
+endif
+
+include $(BUILD_STATIC_LIBRARY)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := aac-bench
+LOCAL_DESCRIPTION := AAC benchmark tool
+LOCAL_CATEGORY_PATH := libs/aac
+LOCAL_CFLAGS := -std=gnu99
+LOCAL_SRC_FILES := \
+	tools/aac_bench.c
+LOCAL_LIBRARIES := \
+	libaac \
+	libaudio-defs \
+	libulog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := aac-bench-micro
+LOCAL_DESCRIPTION := AAC bitstream micro-benchmark tool
+LOCAL_CATEGORY_PATH := libs/aac
+LOCAL_CFLAGS := -std=gnu99
+LOCAL_SRC_FILES := \
+	tools/aac_bench_micro.c
+LOCAL_LIBRARIES := \
+	libaac-internal \
+	libulog
+include $(BUILD_EXECUTABLE)
+
 include $(CLEAR_VARS)
 LOCAL_MODULE := aac-dump
 LOCAL_DESCRIPTION := AAC bitstream dump tool
@@ -40,22 +103,82 @@ LOCAL_LIBRARIES := \
 	libulog
 include $(BUILD_EXECUTABLE)
 
+include $(CLEAR_VARS)
+LOCAL_MODULE := aac-gen
+LOCAL_DESCRIPTION := AAC synthetic stream generator
+LOCAL_CATEGORY_PATH := libs/aac
+LOCAL_CFLAGS := -std=gnu99
+LOCAL_SRC_FILES := \
+	tools/aac_gen.c
+LOCAL_LIBRARIES := \
+	libaac \
+	libulog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := aac-scan
+LOCAL_DESCRIPTION := AAC batch integrity scanner
+LOCAL_CATEGORY_PATH := libs/aac
+LOCAL_CFLAGS := -std=gnu99 -D_GNU_SOURCE
+LOCAL_SRC_FILES := \
+	tools/aac_scan.c
+LOCAL_LIBRARIES := \
+	libaac \
+	libulog
+ifneq ("$(TARGET_OS_FLAVOUR)","android")
+  LOCAL_LDLIBS += -lpthread
+endif
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := aac-stat
+LOCAL_DESCRIPTION := AAC stream health monitoring tool
+LOCAL_CATEGORY_PATH := libs/aac
+LOCAL_CFLAGS := -std=gnu99
+LOCAL_SRC_FILES := \
+	tools/aac_stat.c
+LOCAL_LIBRARIES := \
+	libaac \
+	libulog
+include $(BUILD_EXECUTABLE)
+
 ifdef TARGET_TEST
 
 include $(CLEAR_VARS)
 
 LOCAL_MODULE := tst-libaac
 LOCAL_LIBRARIES := \
-	libaac \
+	libaac-internal \
 	libaudio-defs \
 	libcunit\
 	libulog
 LOCAL_CFLAGS := -std=gnu11
 LOCAL_SRC_FILES := \
+	tests/aac_test_adif.c \
 	tests/aac_test_asc_adts.c \
+	tests/aac_test_bitstream.c \
+	tests/aac_test_columns.c \
+	tests/aac_test_dump.c \
+	tests/aac_test_gen.c \
+	tests/aac_test_loas.c \
+	tests/aac_test_mp4.c \
+	tests/aac_test_probe.c \
+	tests/aac_test_shm.c \
 	tests/aac_test_str.c \
 	tests/aac_test.c
 
 include $(BUILD_EXECUTABLE)
 
+include $(CLEAR_VARS)
+LOCAL_MODULE := aac-bench-cmp
+LOCAL_DESCRIPTION := AAC benchmark baseline comparison tool
+LOCAL_CATEGORY_PATH := libs/aac
+LOCAL_CFLAGS := -std=gnu99
+LOCAL_SRC_FILES := \
+	tools/aac_bench_cmp.c
+LOCAL_LIBRARIES := \
+	json \
+	libulog
+include $(BUILD_EXECUTABLE)
+
 endif
@@ -29,6 +29,7 @@
 
 #include <errno.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -54,8 +55,12 @@ extern "C" {
 
 #include "aac/aac_ctx.h"
 
+#include "aac/aac_columns.h"
 #include "aac/aac_dump.h"
+#include "aac/aac_gen.h"
+#include "aac/aac_mp4.h"
 #include "aac/aac_reader.h"
+#include "aac/aac_shm.h"
 #include "aac/aac_writer.h"
 
 
@@ -75,6 +80,44 @@ AAC_API int aac_asc_from_adef_format(const struct adef_format *format,
 				     struct aac_asc *asc);
 
 
+/**
+ * Get the timing of the frames of an ADTS stream.
+ * The frame duration takes number_of_raw_data_blocks_in_frame into account;
+ * the position is set to 0.
+ * @param adts: ADTS header
+ * @param timing: pointer to the timing (output)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API int aac_adts_get_timing(const struct aac_adts *adts,
+				struct aac_timing *timing);
+
+
+/**
+ * Get the timing of the raw_data_blocks of a stream described by an
+ * AudioSpecificConfig; the position is set to 0.
+ * @param asc: AudioSpecificConfig
+ * @param timing: pointer to the timing (output)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API int aac_asc_get_timing(const struct aac_asc *asc,
+			       struct aac_timing *timing);
+
+
+/**
+ * Convert a duration or position in samples to another time scale, without
+ * intermediate overflow nor floating point drift (the result is rounded
+ * down).
+ * @param samples: duration or position in samples
+ * @param sample_rate: sampling frequency in Hz
+ * @param timescale: target time scale in ticks per second (eg. 1000000
+ *                   for microseconds, 90000 for MPEG-TS)
+ * @return the duration or position in ticks of the target time scale,
+ *         or 0 if sample_rate is 0
+ */
+AAC_API uint64_t aac_samples_to_timescale(uint64_t samples,
+					  uint32_t sample_rate,
+					  uint32_t timescale);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -130,6 +130,49 @@ static inline size_t aac_bs_rem_raw_bits(const struct aac_bitstream *bs)
 }
 
 
+/* Current read position in bits */
+static inline size_t aac_bs_read_bit_off(const struct aac_bitstream *bs)
+{
+	return bs->off * 8 - bs->cachebits;
+}
+
+
+/**
+ * Overwrite 'n' bits at bit offset 'bitoff' in the bitstream data, without
+ * changing the current read/write position. The data length is not changed
+ * (the bits must already be present in the buffer).
+ */
+static inline int aac_bs_patch_bits(struct aac_bitstream *bs,
+				    size_t bitoff,
+				    uint32_t v,
+				    uint32_t n)
+{
+	size_t off = bitoff / 8;
+	uint32_t shift = bitoff % 8;
+	uint32_t bits = 0;
+	uint8_t mask = 0;
+	uint8_t part = 0;
+
+	if (n > 32 || bitoff + n > bs->len * 8)
+		return -EINVAL;
+
+	while (n > 0) {
+		/* Patch as many bits in current byte */
+		bits = 8 - shift;
+		if (bits >= n)
+			bits = n;
+		mask = ((1 << bits) - 1) << (8 - shift - bits);
+		part = ((v >> (n - bits)) << (8 - shift - bits)) & mask;
+		bs->data[off] = (bs->data[off] & ~mask) | part;
+		n -= bits;
+		shift = 0;
+		off++;
+	}
+
+	return 0;
+}
+
+
 static inline int aac_bs_fetch(struct aac_bitstream *bs)
 {
 	if (bs->off < bs->len) {
@@ -144,6 +187,34 @@ static inline int aac_bs_fetch(struct aac_bitstream *bs)
 }
 
 
+/* Skip 'n' bits in read mode */
+static inline int aac_bs_skip_bits(struct aac_bitstream *bs, size_t n)
+{
+	size_t bytes;
+
+	if (n <= bs->cachebits) {
+		bs->cachebits -= n;
+		return 0;
+	}
+	n -= bs->cachebits;
+	bs->cachebits = 0;
+
+	/* Skip whole bytes without going through the cache */
+	bytes = n / 8;
+	if (bytes > bs->len - bs->off)
+		return -EIO;
+	bs->off += bytes;
+
+	n %= 8;
+	if (n > 0) {
+		if (aac_bs_fetch(bs) < 0)
+			return -EIO;
+		bs->cachebits -= n;
+	}
+	return 0;
+}
+
+
 static inline int
 aac_bs_read_bits(struct aac_bitstream *bs, uint32_t *v, uint32_t n)
 {
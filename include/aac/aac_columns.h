@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _AAC_COLUMNS_H_
+#define _AAC_COLUMNS_H_
+
+
+/* Per-frame metrics file with fixed-width typed columns, meant to be
+ * memory-mapped: a header, column_count column descriptors, then blocks of
+ * block_size bytes. Each block starts with a block header and holds the
+ * values of block_rows rows, one contiguous array per column at the offset
+ * of its descriptor; the last block is zero-padded. Integers are in the
+ * native byte order of the writer (see the magic). Absent values (eg. the
+ * global_gain of a channel missing in the frame) are -1 for signed columns
+ * and the maximum value for unsigned ones. */
+
+
+#define AAC_COLUMNS_MAGIC 0x43434141 /* "AACC" */
+#define AAC_COLUMNS_VERSION 1
+#define AAC_COLUMNS_NAME_MAX 32
+#define AAC_COLUMNS_BLOCK_ROWS 4096
+
+/* Channels with per-channel columns (global_gain_<n>, window_sequence_<n>),
+ * in the order of the SCE, CPE and LFE elements of the first
+ * raw_data_block */
+#define AAC_COLUMNS_MAX_CHANNELS 8
+
+
+struct aac_columns;
+
+
+enum aac_columns_type {
+	AAC_COLUMNS_TYPE_U8 = 0,
+	AAC_COLUMNS_TYPE_U16,
+	AAC_COLUMNS_TYPE_U32,
+	AAC_COLUMNS_TYPE_U64,
+	AAC_COLUMNS_TYPE_I16,
+};
+
+
+struct aac_columns_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t column_count;
+	uint32_t block_rows;
+	/* Size of each block, the first one is right after the column
+	 * descriptors */
+	uint64_t block_size;
+};
+
+
+struct aac_columns_column {
+	/* Null-terminated name */
+	char name[AAC_COLUMNS_NAME_MAX];
+	/* enum aac_columns_type */
+	uint32_t type;
+	/* Offset of the values from the start of a block */
+	uint32_t offset;
+};
+
+
+struct aac_columns_block {
+	/* Index of the first row of the block */
+	uint64_t first_row;
+	/* Number of valid rows in the block */
+	uint32_t row_count;
+	uint32_t reserved;
+};
+
+
+/**
+ * Create a columns writer. The header is written immediately, the rows are
+ * written by blocks.
+ * @param file: output file, opened in binary mode
+ * @param ret_obj: pointer to the new writer (output)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_columns_new(FILE *file, struct aac_columns **ret_obj);
+
+
+/**
+ * Write the last (partial) block and destroy a columns writer; the file
+ * is not closed.
+ * @param columns: writer instance
+ * @return 0 on success, negative errno value in case of error (the writer
+ *         is destroyed anyway)
+ */
+AAC_API
+int aac_columns_destroy(struct aac_columns *columns);
+
+
+/**
+ * Add a row for the last parsed frame of a context: to be called from the
+ * adts_frame_end, loas_frame_end or raw_data_block callback of a reader
+ * parsing with AAC_READER_FLAGS_FRAME_DATA.
+ * @param columns: writer instance
+ * @param ctx: context of the reader
+ * @param offset: offset of the frame in the input
+ * @param len: frame length in bytes
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_columns_add_frame(struct aac_columns *columns,
+			  struct aac_ctx *ctx,
+			  uint64_t offset,
+			  size_t len);
+
+
+#endif /* !_AAC_COLUMNS_H_ */
@@ -43,6 +43,32 @@ struct aac_ctx_cbs {
 			       size_t len,
 			       const struct aac_adts *adts,
 			       void *userdata);
+
+	/* Called once the StreamMuxConfig of the frame is known */
+	void (*loas_frame_begin)(struct aac_ctx *ctx,
+				 const uint8_t *buf,
+				 size_t len,
+				 const struct aac_StreamMuxConfig *smc,
+				 void *userdata);
+
+	void (*loas_frame_end)(struct aac_ctx *ctx,
+			       const uint8_t *buf,
+			       size_t len,
+			       const struct aac_StreamMuxConfig *smc,
+			       void *userdata);
+
+	void (*adif_header)(struct aac_ctx *ctx,
+			    const uint8_t *buf,
+			    size_t len,
+			    const struct aac_adif_header *adif,
+			    void *userdata);
+
+	/* Raw data format only (including ADIF), after each raw_data_block */
+	void (*raw_data_block)(struct aac_ctx *ctx,
+			       const uint8_t *buf,
+			       size_t len,
+			       const struct aac_raw_data_block *block,
+			       void *userdata);
 };
 
 
@@ -78,4 +104,97 @@ AAC_API
 int aac_ctx_set_asc(struct aac_ctx *ctx, const struct aac_asc *asc);
 
 
+AAC_API
+enum aac_transport aac_ctx_get_transport(struct aac_ctx *ctx);
+
+
+/**
+ * Get the current StreamMuxConfig of a LOAS stream.
+ * @param ctx: context
+ * @return a pointer to the StreamMuxConfig or NULL if the transport is not
+ *         LOAS or no StreamMuxConfig has been read yet
+ */
+AAC_API
+const struct aac_StreamMuxConfig *
+aac_ctx_get_stream_mux_config(struct aac_ctx *ctx);
+
+
+/**
+ * Set the context up for a LOAS stream.
+ * The data format is set to raw with the given AudioSpecificConfig; the
+ * next written LOAS frame carries the StreamMuxConfig, the following ones
+ * reuse it (useSameStreamMux). Calling this function again forces the
+ * StreamMuxConfig to be sent again.
+ * @param ctx: context
+ * @param smc: StreamMuxConfig
+ * @param asc: AudioSpecificConfig
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_ctx_set_loas(struct aac_ctx *ctx,
+		     const struct aac_StreamMuxConfig *smc,
+		     const struct aac_asc *asc);
+
+
+/**
+ * Get the header of an ADIF stream.
+ * @param ctx: context
+ * @return a pointer to the ADIF header or NULL if the transport is not ADIF
+ *         or the header has not been read yet
+ */
+AAC_API
+const struct aac_adif_header *aac_ctx_get_adif_header(struct aac_ctx *ctx);
+
+
+/**
+ * Get the timing of the current frame.
+ * The position is the cumulated duration of the frames parsed by the reader
+ * (or set with aac_ctx_set_position()): from the frame callbacks it is the
+ * position of the first sample of the frame being parsed, otherwise the
+ * position of the next frame.
+ * @param ctx: context
+ * @param timing: pointer to the timing (output)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_ctx_get_timing(struct aac_ctx *ctx, struct aac_timing *timing);
+
+
+/**
+ * Set the position of the next frame, eg. after seeking.
+ * @param ctx: context
+ * @param position: position in samples (see struct aac_timing)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_ctx_set_position(struct aac_ctx *ctx, uint64_t position);
+
+
+/**
+ * Get the field offsets of the last parsed frame.
+ * Offsets are only recorded when parsing with AAC_READER_FLAGS_FIELD_OFFSETS;
+ * they are relative to the start of the frame (the buffer given to the frame
+ * callbacks) and can be used with aac_bs_patch_bits() to edit a field in
+ * place. Note: patching a protected frame (protection_absent == 0)
+ * invalidates its CRC.
+ * @param ctx: context
+ * @return a pointer to the field offsets or NULL in case of error
+ */
+AAC_API
+const struct aac_field_offsets *aac_ctx_get_field_offsets(struct aac_ctx *ctx);
+
+
+/**
+ * Get the bit accounting of the parsed frames.
+ * Bits are only counted when parsing with AAC_READER_FLAGS_BIT_STATS; the
+ * frame data must also be parsed (AAC_READER_FLAGS_FRAME_DATA) to split the
+ * frames further than the header. From the frame end callbacks, the frame
+ * counts are not complete yet.
+ * @param ctx: context
+ * @return a pointer to the bit accounting or NULL in case of error
+ */
+AAC_API
+const struct aac_bit_stats *aac_ctx_get_bit_stats(struct aac_ctx *ctx);
+
+
 #endif /* !_AAC_CTX_H_ */
@@ -36,13 +36,94 @@ struct aac_dump;
 #define AAC_DUMP_FLAGS_FRAME_DATA 0x01
 
 
+/* Maximum number of include or exclude paths of a dump */
+#define AAC_DUMP_MAX_FILTER_PATHS 64
+
+
 enum aac_dump_type {
+	/* json-c object tree (see aac_dump_get_json_object()) */
 	AAC_DUMP_TYPE_JSON,
+
+	/* JSON text written while walking the syntax, without building an
+	 * object tree; the text is laid out as json_object_to_json_string()
+	 * of the JSON type, but repeated member names (e.g. the elements of
+	 * a raw_data_block) are all kept where the tree only keeps the last
+	 * value */
+	AAC_DUMP_TYPE_JSON_STREAM,
+
+	/* CBOR (RFC 8949) encoding of the JSON_STREAM dump: each frame is a
+	 * stringref namespace (tag 256) holding the root map; structures are
+	 * indefinite-length maps, arrays are indefinite-length arrays and
+	 * fields are integers. The keys of a frame are sent once, then
+	 * referenced (stringref tag 25). See aac_dump_from_cbor() to convert
+	 * back to JSON */
+	AAC_DUMP_TYPE_CBOR,
+
+	/* Syntax walk through the callbacks of a visitor (see struct
+	 * aac_dump_visitor), nothing is built */
+	AAC_DUMP_TYPE_VISITOR,
+};
+
+
+/* Visitor callbacks, all optional: the syntax of the dumped frame is
+ * walked in bitstream order. Field keys are not null-terminated; they are
+ * the member names without the last subscript (e.g. "sect_cb[g]" for
+ * sect_cb[g][i]). A negative return value stops the walk and is returned
+ * by the dump function */
+struct aac_dump_visitor {
+	int (*begin_struct)(struct aac_dump *dump,
+			    const char *name,
+			    void *userdata);
+
+	int (*end_struct)(struct aac_dump *dump,
+			  const char *name,
+			  void *userdata);
+
+	int (*begin_array)(struct aac_dump *dump,
+			   const char *name,
+			   void *userdata);
+
+	int (*end_array)(struct aac_dump *dump,
+			 const char *name,
+			 void *userdata);
+
+	int (*begin_array_item)(struct aac_dump *dump, void *userdata);
+
+	int (*end_array_item)(struct aac_dump *dump, void *userdata);
+
+	int (*field)(struct aac_dump *dump,
+		     const char *key,
+		     size_t len,
+		     int64_t val,
+		     void *userdata);
 };
 
 
 struct aac_dump_cfg {
 	enum aac_dump_type type;
+
+	/* VISITOR only: callbacks and their user data */
+	const struct aac_dump_visitor *visitor;
+	void *userdata;
+
+	/* JSON_STREAM and CBOR only: if not NULL, each dump is written to
+	 * this file (followed by a newline in JSON) instead of being kept for
+	 * aac_dump_get_json_str() or aac_dump_get_data() */
+	FILE *file;
+
+	/* Field path filters: a path is a list of structure, array and field
+	 * names separated by dots, array items are not part of the path; a
+	 * '*' component matches any name (e.g. "aac_adts.*" or
+	 * "raw_data_block.*.individual_channel_stream.global_gain"). A path
+	 * selects the member it designates and all its contents. If include
+	 * paths are given, only the selected members (and the containers
+	 * leading to them) are dumped; the members selected by an exclude
+	 * path are never dumped. The paths are compiled by aac_dump_new(),
+	 * the strings do not need to outlive it */
+	const char *const *include_paths;
+	unsigned int include_count;
+	const char *const *exclude_paths;
+	unsigned int exclude_count;
 };
 
 
@@ -66,10 +147,100 @@ AAC_API
 int aac_dump_get_json_str(struct aac_dump *dump, const char **str);
 
 
+/**
+ * Get the output of a JSON_STREAM or CBOR dump.
+ * The data is valid until the next dump; it is not available if the dump
+ * is written to a file.
+ * @param dump: dump object
+ * @param data: pointer to the data (output)
+ * @param len: data length in bytes (output)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_dump_get_data(struct aac_dump *dump,
+		      const uint8_t **data,
+		      size_t *len);
+
+
 AAC_API
 int aac_dump_adts_frame(struct aac_dump *dump,
 			struct aac_ctx *ctx,
 			uint32_t flags);
 
 
+/**
+ * Dump a LOAS frame, e.g. from the loas_frame_end callback of a reader.
+ * The AudioMuxElement fields are dumped in the root object after the
+ * "aac_loas" header, with the StreamMuxConfig when the frame carries one.
+ * @param dump: dump object
+ * @param ctx: context the frame has been parsed with
+ * @param flags: dump flags (AAC_DUMP_FLAGS_xxx)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_dump_loas_frame(struct aac_dump *dump,
+			struct aac_ctx *ctx,
+			uint32_t flags);
+
+
+/**
+ * Dump an AudioSpecificConfig, e.g. the config of a raw stream (see
+ * aac_parse_asc() and aac_ctx_set_asc()).
+ * The config is dumped as the "AudioSpecificConfig" member of the root
+ * object.
+ * @param dump: dump object
+ * @param asc: AudioSpecificConfig
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_dump_asc(struct aac_dump *dump, const struct aac_asc *asc);
+
+
+/**
+ * Dump an ADIF header, e.g. from the adif_header callback of a reader.
+ * The header is dumped as the "adif_header" member of the root object.
+ * @param dump: dump object
+ * @param adif: ADIF header
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_dump_adif_header(struct aac_dump *dump,
+			 const struct aac_adif_header *adif);
+
+
+/**
+ * Dump a raw_data_block, e.g. from the raw_data_block callback of a reader
+ * parsing a raw stream: each access unit of the stream is then dumped as
+ * the frames of an ADTS stream are with aac_dump_adts_frame().
+ * The block is dumped as the "raw_data_block" member of the root object.
+ * @param dump: dump object
+ * @param ctx: context the block has been parsed with
+ * @param block: raw_data_block
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_dump_raw_data_block(struct aac_dump *dump,
+			    struct aac_ctx *ctx,
+			    const struct aac_raw_data_block *block);
+
+
+/**
+ * Convert a frame of a CBOR dump.
+ * The frame is dumped again with the dump object, which must not be of the
+ * CBOR type, as if it had been dumped from the bitstream (a visitor walks
+ * the converted frame).
+ * @param dump: dump object
+ * @param buf: CBOR data
+ * @param len: CBOR data length in bytes
+ * @param off: offset of the frame in buf, updated past the frame on success
+ * @return 0 on success, -EAGAIN if the frame is incomplete, -EPROTO if the
+ *         data is not a CBOR dump, negative errno value in case of error
+ */
+AAC_API
+int aac_dump_from_cbor(struct aac_dump *dump,
+		       const uint8_t *buf,
+		       size_t len,
+		       size_t *off);
+
+
 #endif /* !_AAC_DUMP_H_ */
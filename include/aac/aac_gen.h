@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _AAC_GEN_H_
+#define _AAC_GEN_H_
+
+
+/* Synthetic stream generator: writes valid (but not meaningful) AAC-LC
+ * frames with a controlled mix of syntax elements. The output only depends
+ * on the configuration, including the seed. */
+
+
+/* Switch between window sequences (including EIGHT_SHORT_SEQUENCE) */
+#define AAC_GEN_FLAGS_WINDOWS 0x01
+
+/* Add tns_data() to the channel streams */
+#define AAC_GEN_FLAGS_TNS 0x02
+
+/* Add pulse_data() to the long window channel streams */
+#define AAC_GEN_FLAGS_PULSE 0x04
+
+/* Use the escape codebook with large values for all the spectral data */
+#define AAC_GEN_FLAGS_ESCAPES 0x08
+
+/* Use M/S stereo masks in the channel pair elements */
+#define AAC_GEN_FLAGS_MS 0x10
+
+
+struct aac_gen;
+
+
+/* Section layout of the channel streams */
+enum aac_gen_sections {
+	/* Random section lengths */
+	AAC_GEN_SECTIONS_RANDOM = 0,
+
+	/* A single section covering all the bands */
+	AAC_GEN_SECTIONS_SINGLE,
+
+	/* A section per band */
+	AAC_GEN_SECTIONS_PER_BAND,
+
+	/* A single ZERO_HCB section (no spectral data) */
+	AAC_GEN_SECTIONS_ZERO,
+};
+
+
+struct aac_gen_cfg {
+	/* Seed of the pseudo-random generator */
+	uint32_t seed;
+
+	/* ADEF_AAC_DATA_FORMAT_ADTS or ADEF_AAC_DATA_FORMAT_RAW */
+	enum adef_aac_data_format data_format;
+
+	/* Sampling frequency index (Table 1.18, 0 to 11) */
+	unsigned int sampling_frequency_index;
+
+	/* Number of syntax elements of each type in a raw data block; there
+	 * must be at least one SCE or CPE and at most AAC_MAX_SYN_ELE - 1
+	 * elements in total */
+	unsigned int sce_count;
+	unsigned int cpe_count;
+	unsigned int cce_count;
+	unsigned int dse_count;
+	unsigned int pce_count;
+	unsigned int fil_count;
+
+	enum aac_gen_sections sections;
+
+	/* Combination of AAC_GEN_FLAGS_xxx */
+	uint32_t flags;
+};
+
+
+/**
+ * Create a stream generator.
+ * The channel configuration is derived from the number of SCE and CPE
+ * when they match a standard one (1 to 5 channels), otherwise it is 0.
+ * @param cfg: generator configuration
+ * @param ret_obj: generator handle (output)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_gen_new(const struct aac_gen_cfg *cfg, struct aac_gen **ret_obj);
+
+
+AAC_API
+int aac_gen_destroy(struct aac_gen *gen);
+
+
+/**
+ * Get the AudioSpecificConfig of a raw stream generator, to be given to
+ * the reader (see aac_ctx_set_asc()) or written with aac_write_asc().
+ * @param gen: generator handle
+ * @param asc: AudioSpecificConfig (output)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_gen_get_asc(struct aac_gen *gen, struct aac_asc *asc);
+
+
+/**
+ * Generate and write the next frame: an ADTS frame or a raw data block
+ * (byte aligned) depending on the data format.
+ * @param gen: generator handle
+ * @param bs: bitstream to write to
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_gen_write_frame(struct aac_gen *gen, struct aac_bitstream *bs);
+
+
+#endif /* !_AAC_GEN_H_ */
@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _AAC_MP4_H_
+#define _AAC_MP4_H_
+
+
+/* Minimal MP4 (ISO base media file format) reader: the first audio track
+ * with an 'mp4a' sample entry and an 'esds' box is selected; its
+ * DecoderSpecificInfo is the AudioSpecificConfig of the raw stream and its
+ * samples are the raw access units, located with the sample size (stsz),
+ * sample-to-chunk (stsc) and chunk offset (stco or co64) tables. The file
+ * is not copied: it must be entirely in memory (eg. mapped) and remain
+ * valid during the lifetime of the reader. Fragmented files are not
+ * supported. */
+
+
+struct aac_mp4;
+
+
+struct aac_mp4_sample {
+	/* Index of the sample in the track */
+	uint32_t index;
+	/* Offset of the sample in the file */
+	uint64_t offset;
+	/* Sample data (in the file buffer) and size in bytes */
+	const uint8_t *data;
+	size_t size;
+};
+
+
+/**
+ * Create an MP4 reader.
+ * @param buf: pointer to the start of the file
+ * @param len: file length
+ * @param ret_obj: pointer to the new reader (output)
+ * @return 0 on success, -EPROTO if the file is invalid, -ENOENT if there
+ *         is no AAC audio track, -ENOSYS if the file (eg. fragmented) or
+ *         the track is not supported, negative errno value in case of
+ *         error
+ */
+AAC_API
+int aac_mp4_new(const uint8_t *buf, size_t len, struct aac_mp4 **ret_obj);
+
+
+AAC_API
+int aac_mp4_destroy(struct aac_mp4 *mp4);
+
+
+/**
+ * Get the AudioSpecificConfig of the track, to be parsed with
+ * aac_parse_asc().
+ * @param mp4: reader instance
+ * @param asc: pointer to the AudioSpecificConfig (in the file buffer)
+ *             (output)
+ * @param len: AudioSpecificConfig length in bytes (output)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_mp4_get_asc(struct aac_mp4 *mp4, const uint8_t **asc, size_t *len);
+
+
+AAC_API
+uint32_t aac_mp4_get_sample_count(struct aac_mp4 *mp4);
+
+
+/**
+ * Get the next sample of the track (the first one after aac_mp4_new() or
+ * aac_mp4_rewind()), ie. the next access unit to give to
+ * aac_reader_parse().
+ * @param mp4: reader instance
+ * @param sample: pointer to the sample (output)
+ * @return 0 on success, -ENOENT after the last sample, -EPROTO if the
+ *         sample tables are inconsistent or the sample is past the end of
+ *         the file, negative errno value in case of error
+ */
+AAC_API
+int aac_mp4_next_sample(struct aac_mp4 *mp4, struct aac_mp4_sample *sample);
+
+
+AAC_API
+int aac_mp4_rewind(struct aac_mp4 *mp4);
+
+
+#endif /* !_AAC_MP4_H_ */
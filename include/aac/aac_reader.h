@@ -34,6 +34,64 @@ struct aac_reader;
 /* Parse frame data */
 #define AAC_READER_FLAGS_FRAME_DATA 0x01
 
+/* Record field offsets (see aac_ctx_get_field_offsets()) */
+#define AAC_READER_FLAGS_FIELD_OFFSETS 0x02
+
+/* Count the bits of each syntax structure (see aac_ctx_get_bit_stats()) */
+#define AAC_READER_FLAGS_BIT_STATS 0x04
+
+/* Record frame, element and extension events in the trace ring buffer (see
+ * aac_reader_get_trace()); errors are always recorded */
+#define AAC_READER_FLAGS_TRACE 0x08
+
+/* Measure the parsing time of each frame (see aac_reader_get_latency()) */
+#define AAC_READER_FLAGS_LATENCY 0x10
+
+/* ADTS and LOAS only: the buffer may end with an incomplete frame (e.g. a
+ * file being written), which is left for the next call instead of being
+ * parsed as a truncated frame (see aac_reader_parse()) */
+#define AAC_READER_FLAGS_PARTIAL 0x20
+
+/* Size of the trace ring buffer (number of events) */
+#define AAC_TRACE_MAX_EVENTS 256
+
+
+/**
+ * Reader statistics (see aac_reader_get_stats())
+ */
+struct aac_reader_stats {
+	/* Parsed frames (ADTS or LOAS frames, or raw_data_blocks) */
+	uint64_t frames;
+	/* Bytes consumed by the parsed frames and headers */
+	uint64_t bytes;
+	/* Frames skipped, eg. LOAS frames before the first StreamMuxConfig */
+	uint64_t frames_skipped;
+	uint64_t bytes_skipped;
+	/* Parsing errors: truncated data (-EIO), invalid syntax (-EINVAL,
+	 * -EPROTO), unsupported syntax elements (-ENOSYS) and others */
+	uint64_t errors_truncated;
+	uint64_t errors_invalid;
+	uint64_t errors_unsupported;
+	uint64_t errors_other;
+};
+
+
+/**
+ * Frame parsing latency (see aac_reader_get_latency()); values are in
+ * nanoseconds, percentiles have a 6% precision
+ */
+struct aac_latency_stats {
+	/* Number of measured frames */
+	uint64_t count;
+	uint64_t min;
+	uint64_t max;
+	uint64_t mean;
+	uint64_t p50;
+	uint64_t p90;
+	uint64_t p99;
+	uint64_t p999;
+};
+
 
 AAC_API
 int aac_reader_new(const struct aac_ctx_cbs *cbs,
@@ -53,6 +111,21 @@ AAC_API
 int aac_reader_stop(struct aac_reader *reader);
 
 
+/**
+ * Parse a buffer.
+ * The buffer is parsed from its start, frame by frame, until its end, an
+ * error or a call to aac_reader_stop() from a callback. With
+ * AAC_READER_FLAGS_PARTIAL, parsing also stops at the start of an ADTS or
+ * LOAS frame that does not fit in the buffer: *off is then less than len,
+ * and the parsing is resumed by calling again with the frame at the start
+ * of the buffer once more data is available.
+ * @param reader: reader instance
+ * @param flags: AAC_READER_FLAGS_* flags
+ * @param buf: pointer to the data
+ * @param len: buffer length
+ * @param off: offset of the end of the parsed data (output)
+ * @return 0 on success, negative errno value in case of error
+ */
 AAC_API
 int aac_reader_parse(struct aac_reader *reader,
 		     uint32_t flags,
@@ -61,6 +134,66 @@ int aac_reader_parse(struct aac_reader *reader,
 		     size_t *off);
 
 
+/**
+ * Get the statistics of a reader.
+ * The counters can be read from any thread while another thread is
+ * parsing, without locking; each counter is consistent but the set of
+ * counters is not a snapshot taken at a single point in time. The reader
+ * must not be destroyed during the call.
+ * @param reader: reader instance
+ * @param stats: pointer to the statistics (output)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_reader_get_stats(struct aac_reader *reader,
+			 struct aac_reader_stats *stats);
+
+
+/**
+ * Get the last events of the trace ring buffer of a reader.
+ * Parsing errors are recorded by each syntax function on the way up (the
+ * syntax path of the error), instead of being logged: only the first
+ * parsing error of a reader is logged, with this context. The other events
+ * are only recorded when parsing with AAC_READER_FLAGS_TRACE. When the
+ * library is built with AAC_NO_TRACE defined, no events are recorded.
+ * @param reader: reader instance
+ * @param events: array of events (output), from the oldest to the newest
+ * @param count: size of the events array on input, number of events
+ *               copied on output (at most AAC_TRACE_MAX_EVENTS)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_reader_get_trace(struct aac_reader *reader,
+			 struct aac_trace_event *events,
+			 size_t *count);
+
+
+/**
+ * Get the frame parsing latency of a reader.
+ * The parsing time of each frame is measured when parsing with
+ * AAC_READER_FLAGS_LATENCY, including the time spent in the frame
+ * callbacks, and recorded in a histogram per data format and per
+ * AAC_READER_FLAGS_FRAME_DATA flag value. LOAS frames and the raw data
+ * blocks of an ADIF stream are recorded under ADEF_AAC_DATA_FORMAT_RAW;
+ * the ADIF header and the frames that could not be parsed are not
+ * recorded. This function must not be called during parsing from another
+ * thread.
+ * @param reader: reader instance
+ * @param data_format: data format of the frames (ADEF_AAC_DATA_FORMAT_RAW
+ *                     or ADEF_AAC_DATA_FORMAT_ADTS), or
+ *                     ADEF_AAC_DATA_FORMAT_UNKNOWN for all frames
+ * @param frame_data: 1 for frames parsed with AAC_READER_FLAGS_FRAME_DATA,
+ *                    0 for frames parsed without, -1 for all frames
+ * @param stats: pointer to the latency statistics (output)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_reader_get_latency(struct aac_reader *reader,
+			   enum adef_aac_data_format data_format,
+			   int frame_data,
+			   struct aac_latency_stats *stats);
+
+
 AAC_API
 int aac_parse_asc(const uint8_t *buf, size_t len, struct aac_asc *asc);
 
@@ -69,4 +202,48 @@ AAC_API
 int aac_parse_adts(const uint8_t *buf, size_t len, struct aac_adts *adts);
 
 
+/**
+ * Get the size of the ADTS or LOAS frame at the start of a buffer from its
+ * header (aac_frame_length or audioMuxLengthBytes), eg. to split a stream
+ * into frames. Only the header needs to be in the buffer. The header is
+ * only sanity checked (syncword, sampling_frequency_index, minimum size):
+ * after invalid data, a header found by scanning byte by byte should be
+ * confirmed by the next one at the returned size.
+ * @param buf: pointer to the start of the frame
+ * @param len: buffer length
+ * @param size: frame size in bytes (output)
+ * @return 0 on success, -EAGAIN if the buffer is too short for the header,
+ *         -EPROTO if the buffer does not start with an ADTS or LOAS frame
+ *         header (no error is logged), negative errno value in case of
+ *         error
+ */
+AAC_API
+int aac_frame_size(const uint8_t *buf, size_t len, size_t *size);
+
+
+/* Maximum number of bytes examined by aac_probe() after the tags */
+#define AAC_PROBE_MAX_SIZE 4096
+
+
+/**
+ * Probe the format of a stream.
+ * ID3v2 and APE tags at the start of the buffer are skipped, then at most
+ * AAC_PROBE_MAX_SIZE bytes are examined to classify the stream as ADTS,
+ * LOAS/LATM, ADIF or raw with an AudioSpecificConfig (the buffer only holds
+ * an ASC). ADTS and LOAS guesses are confirmed with consecutive frame
+ * headers: the confidence grows with the number of headers found. An
+ * unknown format is not an error: the data format in the result is set to
+ * ADEF_AAC_DATA_FORMAT_UNKNOWN with a zero confidence.
+ * @param buf: pointer to the start of the stream
+ * @param len: buffer length
+ * @param result: pointer to the probing result (output)
+ * @return 0 on success, -EAGAIN if the tags extend past the end of the
+ *         buffer (result->offset is then the offset of the end of the tags),
+ *         negative errno value in case of error
+ */
+AAC_API
+int aac_probe(const uint8_t *buf,
+	      size_t len,
+	      struct aac_probe_result *result);
+
 #endif /* !_AAC_READER_H_ */
@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _AAC_SHM_H_
+#define _AAC_SHM_H_
+
+
+/* Stream health shared memory segment: a header followed by slot_count
+ * slots with a fixed layout. Each slot is written by a single publisher and
+ * can be read by any process; the seq field works as a sequence lock (odd
+ * while the slot is being updated). */
+
+
+#define AAC_SHM_MAGIC 0x53434141 /* "AACS" */
+#define AAC_SHM_VERSION 1
+#define AAC_SHM_NAME_MAX 32
+
+
+struct aac_shm;
+
+
+struct aac_shm_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slot_count;
+	/* sizeof(struct aac_shm_slot) */
+	uint32_t slot_size;
+};
+
+
+struct aac_shm_slot {
+	/* Sequence lock */
+	uint32_t seq;
+	/* Non-zero once the slot has been published */
+	uint32_t used;
+	/* Stream name (null-terminated) */
+	char name[AAC_SHM_NAME_MAX];
+	/* Publication time (monotonic clock, microseconds) */
+	uint64_t timestamp;
+	/* Reader statistics */
+	struct aac_reader_stats stats;
+	/* Stream position in samples (see struct aac_timing) */
+	uint64_t position;
+	/* Last header: enum adef_aac_data_format, enum aac_transport and
+	 * enum aac_audioObjectType values, timing and channels */
+	uint32_t data_format;
+	uint32_t transport;
+	uint32_t audio_object_type;
+	uint32_t sample_rate;
+	uint32_t frame_length;
+	uint32_t channel_configuration;
+};
+
+
+/**
+ * Create (or truncate) a stream health shared memory segment for
+ * publishing.
+ * @param name: POSIX shared memory object name (eg. "/aac-stats")
+ * @param slot_count: number of stream slots
+ * @param ret_obj: pointer to the new segment handle (output)
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_shm_create(const char *name,
+		   unsigned int slot_count,
+		   struct aac_shm **ret_obj);
+
+
+/**
+ * Open an existing stream health shared memory segment for reading.
+ * @param name: POSIX shared memory object name
+ * @param ret_obj: pointer to the new segment handle (output)
+ * @return 0 on success, -EPROTO if the segment layout is not supported,
+ *         negative errno value in case of error
+ */
+AAC_API
+int aac_shm_open(const char *name, struct aac_shm **ret_obj);
+
+
+/**
+ * Unmap a segment; the shared memory object itself is not removed (see
+ * aac_shm_unlink()).
+ * @param shm: segment handle
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_shm_destroy(struct aac_shm *shm);
+
+
+/**
+ * Remove a shared memory object.
+ * @param name: POSIX shared memory object name
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_shm_unlink(const char *name);
+
+
+AAC_API
+unsigned int aac_shm_get_slot_count(struct aac_shm *shm);
+
+
+/**
+ * Publish the statistics and last header of a reader into a slot.
+ * No system call is made (apart from the vDSO monotonic clock read on most
+ * platforms); this function must be called from the thread parsing with the
+ * reader, or with the reader otherwise not in use.
+ * @param shm: segment handle (created with aac_shm_create())
+ * @param slot: slot index
+ * @param name: stream name (truncated to AAC_SHM_NAME_MAX - 1 characters)
+ * @param reader: reader instance
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_shm_publish(struct aac_shm *shm,
+		    unsigned int slot,
+		    const char *name,
+		    struct aac_reader *reader);
+
+
+/**
+ * Read a consistent copy of a slot.
+ * @param shm: segment handle
+ * @param slot: slot index
+ * @param data: pointer to the slot copy (output)
+ * @return 0 on success, -EAGAIN if the slot is being updated too often to
+ *         get a consistent copy, negative errno value in case of error
+ */
+AAC_API
+int aac_shm_read(struct aac_shm *shm,
+		 unsigned int slot,
+		 struct aac_shm_slot *data);
+
+
+#endif /* !_AAC_SHM_H_ */
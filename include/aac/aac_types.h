@@ -564,6 +564,7 @@ struct aac_fill_element {
 struct aac_syntactic_element {
 	enum aac_syntactic_element_id id_syn_ele;
 	union {
+		/* SCE and LFE (same syntax) */
 		struct aac_single_channel_element sce;
 		struct aac_channel_pair_element cpe;
 		struct aac_coupling_channel_element cce;
@@ -609,6 +610,28 @@ struct aac_adts_raw_data_block_error_check {
 };
 
 
+#define AAC_MAX_ADIF_PCE 16
+
+
+/**
+ * Table 1.A.2 – Syntax of adif_header()
+ */
+struct aac_adif_header {
+	uint32_t adif_id;
+	uint8_t copyright_id_present;
+	uint8_t copyright_id[9];
+	uint8_t original_copy;
+	uint8_t home;
+	uint8_t bitstream_type;
+	uint32_t bitrate;
+	uint8_t num_program_config_elements;
+	/* Only for bitstream_type 0 */
+	uint32_t adif_buffer_fullness[AAC_MAX_ADIF_PCE];
+	struct aac_program_config_element
+		program_config_element[AAC_MAX_ADIF_PCE];
+};
+
+
 /**
  * Table 1.A.5 – Syntax of adts_frame()
  */
@@ -624,6 +647,71 @@ struct aac_adts_frame {
 };
 
 
+/**
+ * Transport syntax carrying the raw data blocks, on top of the data format
+ */
+enum aac_transport {
+	/* No transport syntax: raw data blocks or ADTS frames */
+	AAC_TRANSPORT_NONE = 0,
+
+	/* LOAS AudioSyncStream() with LATM AudioMuxElement(1); the data
+	 * format is ADEF_AAC_DATA_FORMAT_RAW and the AudioSpecificConfig is
+	 * carried in the StreamMuxConfig */
+	AAC_TRANSPORT_LOAS,
+
+	/* ADIF header followed by raw data blocks; the data format is
+	 * ADEF_AAC_DATA_FORMAT_RAW and the raw data blocks are described by
+	 * the first program_config_element of the header */
+	AAC_TRANSPORT_ADIF,
+};
+
+
+/**
+ * 1.7.3 – Syntax of StreamMuxConfig()
+ * Note: only a single program with a single layer, with all streams having
+ * the same time framing and a variable frame length (frameLengthType 0) is
+ * supported. The AudioSpecificConfig is stored in the context.
+ */
+struct aac_StreamMuxConfig {
+	uint8_t audioMuxVersion;
+	uint8_t audioMuxVersionA;
+	/* Only for audioMuxVersion 1 */
+	uint32_t taraBufferFullness;
+	uint8_t allStreamsSameTimeFraming;
+	uint8_t numSubFrames;
+	uint8_t numProgram;
+	uint8_t numLayer;
+	/* Only for audioMuxVersion 1 */
+	uint32_t ascLen;
+	uint8_t frameLengthType;
+	uint8_t latmBufferFullness;
+	uint8_t otherDataPresent;
+	uint32_t otherDataLenBits;
+	uint8_t crcCheckPresent;
+	uint8_t crcCheckSum;
+};
+
+
+/**
+ * 1.7.3 – Syntax of AudioMuxElement()
+ */
+struct aac_AudioMuxElement {
+	uint8_t useSameStreamMux;
+	uint32_t MuxSlotLengthBytes[AAC_MAX_RAW_DATA_BLOCKS];
+};
+
+
+/**
+ * 1.7.2 – Syntax of AudioSyncStream() (one LOAS frame)
+ */
+struct aac_loas_frame {
+	uint16_t syncword;
+	uint16_t audioMuxLengthBytes;
+	struct aac_AudioMuxElement AudioMuxElement;
+	struct aac_raw_data_block raw_data_block[AAC_MAX_RAW_DATA_BLOCKS];
+};
+
+
 /**
  * Scalefactor bands and grouping
  */
@@ -637,6 +725,167 @@ struct aac_scalefactor_bands_and_grouping {
 };
 
 
+#define AAC_MAX_FIELD_OFFSETS 128
+
+
+/**
+ * Fields whose bit offsets can be recorded while reading
+ */
+enum aac_field_id {
+	/* ADTS fixed header */
+	AAC_FIELD_ID_PRIVATE_BIT = 0,
+	AAC_FIELD_ID_ORIGINAL_COPY,
+	AAC_FIELD_ID_HOME,
+
+	/* ADTS variable header */
+	AAC_FIELD_ID_COPYRIGHT_IDENTIFICATION_BIT,
+	AAC_FIELD_ID_COPYRIGHT_IDENTIFICATION_START,
+	AAC_FIELD_ID_AAC_FRAME_LENGTH,
+	AAC_FIELD_ID_ADTS_BUFFER_FULLNESS,
+
+	/* Syntactic elements (SCE, CPE, CCE, DSE, PCE) */
+	AAC_FIELD_ID_ELEMENT_INSTANCE_TAG,
+
+	/* Individual channel streams */
+	AAC_FIELD_ID_GLOBAL_GAIN,
+
+	/* Enum values count (invalid value) */
+	AAC_FIELD_ID_MAX,
+};
+
+
+/**
+ * Bit offset of a field in a frame
+ */
+struct aac_field_offset {
+	enum aac_field_id id;
+	/* Field length in bits */
+	uint8_t bits;
+	/* Offset in bits from the start of the frame */
+	uint32_t bit_offset;
+};
+
+
+/**
+ * Field offsets of a frame, in bitstream order
+ */
+struct aac_field_offsets {
+	struct aac_field_offset fields[AAC_MAX_FIELD_OFFSETS];
+	size_t count;
+};
+
+
+/**
+ * Syntax structures for the bit accounting
+ */
+enum aac_bit_stats_id {
+	/* ADTS header and error check, LOAS header and AudioMuxElement */
+	AAC_BIT_STATS_ID_HEADER = 0,
+	AAC_BIT_STATS_ID_ICS_INFO,
+	AAC_BIT_STATS_ID_SECTION_DATA,
+	AAC_BIT_STATS_ID_SCALE_FACTOR_DATA,
+	AAC_BIT_STATS_ID_PULSE_DATA,
+	AAC_BIT_STATS_ID_TNS_DATA,
+	AAC_BIT_STATS_ID_GAIN_CONTROL_DATA,
+	AAC_BIT_STATS_ID_SPECTRAL_DATA,
+	AAC_BIT_STATS_ID_FILL,
+	/* Everything else: element headers, flags, global_gain, other
+	 * elements, alignment and unparsed frame data */
+	AAC_BIT_STATS_ID_OTHER,
+
+	/* Enum values count (invalid value) */
+	AAC_BIT_STATS_ID_MAX,
+};
+
+
+/**
+ * Bits spent on each syntax structure
+ */
+struct aac_bit_stats {
+	/* Last parsed frame */
+	uint32_t frame[AAC_BIT_STATS_ID_MAX];
+	/* Running totals since the reader creation */
+	uint64_t total[AAC_BIT_STATS_ID_MAX];
+	/* Number of frames in the totals */
+	uint64_t frame_count;
+};
+
+
+/**
+ * Trace event types
+ */
+enum aac_trace_type {
+	/* Start of a frame (or header) */
+	AAC_TRACE_TYPE_FRAME = 0,
+	/* Syntactic element, id is the enum aac_syn_ele_id value */
+	AAC_TRACE_TYPE_ELEMENT,
+	/* Extension payload, id is the enum aac_extension_type value */
+	AAC_TRACE_TYPE_EXTENSION,
+	/* Error returned by a syntax function, err is the errno value; the
+	 * error is recorded again by each caller on its way up */
+	AAC_TRACE_TYPE_ERROR,
+};
+
+
+/**
+ * Trace event (see aac_reader_get_trace())
+ */
+struct aac_trace_event {
+	/* Name of the syntax function that recorded the event */
+	const char *func;
+	/* Bit offset from the start of the frame */
+	uint32_t bit_off;
+	/* enum aac_trace_type */
+	uint8_t type;
+	/* Element or extension identifier */
+	uint8_t id;
+	/* Positive errno value (errors only) */
+	int16_t err;
+};
+
+
+/**
+ * Frame timing; durations and positions are in samples at the AAC core
+ * sampling frequency, ie. with a 1/sample_rate time base (with SBR, the
+ * output has twice as many samples at twice the rate over the same
+ * duration).
+ */
+struct aac_timing {
+	/* Sampling frequency in Hz */
+	uint32_t sample_rate;
+	/* Duration of a raw_data_block: 1024 or 960 (frameLengthFlag) */
+	uint32_t frame_length;
+	/* Duration of a frame (all raw_data_blocks of the frame) */
+	uint32_t frame_duration;
+	/* Position of the first sample of the frame */
+	uint64_t position;
+};
+
+
+/**
+ * Stream format probing result (see aac_probe())
+ */
+struct aac_probe_result {
+	/* Detected data format (ADEF_AAC_DATA_FORMAT_UNKNOWN if not found) */
+	enum adef_aac_data_format data_format;
+	/* Transport of raw streams (LOAS, ADIF or none for a bare ASC) */
+	enum aac_transport transport;
+	/* Confidence in the detection, from 0 (unknown) to 100 */
+	unsigned int confidence;
+	/* Offset of the first frame (after ID3v2/APE tags and garbage) */
+	size_t offset;
+	/* Number of consecutive frame headers found */
+	unsigned int frame_count;
+	/* ADTS only: header of the first frame */
+	struct aac_adts adts;
+	/* Raw only: AudioSpecificConfig; for LOAS it is only set if a
+	 * StreamMuxConfig was found and for ADIF it is built from the first
+	 * program_config_element */
+	int asc_valid;
+	struct aac_asc asc;
+};
+
+
 /**
  * Get an enum aac_audioObjectType value from a string.
  * Valid strings are only the suffix of the audio object type name (eg.
@@ -655,4 +904,35 @@ AAC_API enum aac_audioObjectType aac_aot_from_str(const char *str);
 AAC_API const char *aac_aot_to_str(enum aac_audioObjectType aot);
 
 
+/**
+ * Find a field in a field offset map.
+ * As fields are stored in bitstream order, the index selects the n-th
+ * occurrence of the field (eg. the global_gain of the second channel).
+ * @param offsets: field offset map
+ * @param id: field identifier
+ * @param index: occurrence index of the field
+ * @return a pointer to the field offset or NULL if not found
+ */
+AAC_API const struct aac_field_offset *
+aac_field_offsets_find(const struct aac_field_offsets *offsets,
+		       enum aac_field_id id,
+		       unsigned int index);
+
+
+/**
+ * Get a string from an enum aac_bit_stats_id value.
+ * @param id: syntax structure identifier to convert
+ * @return a string description of the syntax structure
+ */
+AAC_API const char *aac_bit_stats_id_to_str(enum aac_bit_stats_id id);
+
+
+/**
+ * Get a string from an enum aac_trace_type value.
+ * @param type: trace event type to convert
+ * @return a string description of the trace event type
+ */
+AAC_API const char *aac_trace_type_to_str(enum aac_trace_type type);
+
+
 #endif /* !_AAC_TYPES_H_ */
@@ -39,6 +39,39 @@ AAC_API
 int aac_write_adts(struct aac_adts *adts, uint8_t **buf, size_t *len);
 
 
+/**
+ * Write a LOAS frame (AudioSyncStream() with AudioMuxElement(1)) carrying
+ * a raw data block already encoded.
+ * The context must be set up with aac_ctx_set_loas(); the StreamMuxConfig
+ * is only written in the first frame (useSameStreamMux is set afterwards).
+ * @param bs: bitstream to write to
+ * @param ctx: context
+ * @param buf: encoded raw data block
+ * @param len: encoded raw data block length in bytes
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_write_loas_frame(struct aac_bitstream *bs,
+			 struct aac_ctx *ctx,
+			 const uint8_t *buf,
+			 size_t len);
+
+
+/**
+ * Write an ADIF header, to be followed by the raw data blocks of the
+ * stream (e.g. with aac_write_silent_frame() on a context set up with
+ * aac_ctx_set_asc()).
+ * The adif_id must be set to "ADIF"; the byte_alignment() following the
+ * header is written.
+ * @param bs: bitstream to write to
+ * @param adif: ADIF header
+ * @return 0 on success, negative errno value in case of error
+ */
+AAC_API
+int aac_write_adif_header(struct aac_bitstream *bs,
+			  struct aac_adif_header *adif);
+
+
 AAC_API
 int aac_write_silent_frame(struct aac_bitstream *bs,
 			   struct aac_ctx *ctx,
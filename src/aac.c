@@ -154,3 +154,55 @@ int aac_asc_from_adef_format(const struct adef_format *format,
 
 	return 0;
 }
+
+
+int aac_adts_get_timing(const struct aac_adts *adts,
+			struct aac_timing *timing)
+{
+	ULOG_ERRNO_RETURN_ERR_IF(adts == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(timing == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(adts->sampling_frequency_index >= 13, EINVAL);
+
+	memset(timing, 0, sizeof(*timing));
+	timing->sample_rate =
+		sampling_frequency_table[adts->sampling_frequency_index];
+	/* No frameLengthFlag in ADTS: always 1024 */
+	timing->frame_length = 1024;
+	timing->frame_duration = timing->frame_length *
+				 (adts->number_of_raw_data_blocks_in_frame + 1);
+
+	return 0;
+}
+
+
+int aac_asc_get_timing(const struct aac_asc *asc, struct aac_timing *timing)
+{
+	ULOG_ERRNO_RETURN_ERR_IF(asc == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(timing == NULL, EINVAL);
+
+	memset(timing, 0, sizeof(*timing));
+	if (asc->samplingFrequencyIndex == 0xF)
+		timing->sample_rate = asc->samplingFrequency;
+	else
+		timing->sample_rate =
+			sampling_frequency_table[asc->samplingFrequencyIndex];
+	ULOG_ERRNO_RETURN_ERR_IF(timing->sample_rate == 0, EINVAL);
+	timing->frame_length =
+		asc->GASpecificConfig.frameLengthFlag ? 960 : 1024;
+	timing->frame_duration = timing->frame_length;
+
+	return 0;
+}
+
+
+uint64_t aac_samples_to_timescale(uint64_t samples,
+				  uint32_t sample_rate,
+				  uint32_t timescale)
+{
+	if (sample_rate == 0)
+		return 0;
+
+	/* Split the whole seconds to avoid overflowing samples * timescale */
+	return (samples / sample_rate) * timescale +
+	       (samples % sample_rate) * timescale / sample_rate;
+}
@@ -0,0 +1,372 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "aac_priv.h"
+
+
+/* Columns; the per-channel and per-element columns are consecutive */
+enum column_id {
+	COLUMN_OFFSET = 0,
+	COLUMN_LENGTH,
+	COLUMN_AOT,
+	COLUMN_SAMPLING_FREQUENCY_INDEX,
+	COLUMN_CHANNEL_CONFIGURATION,
+	COLUMN_RAW_DATA_BLOCKS,
+	COLUMN_BUFFER_FULLNESS,
+	COLUMN_CRC_PRESENT,
+	COLUMN_CRC_CHECK,
+	COLUMN_GLOBAL_GAIN,
+	COLUMN_WINDOW_SEQUENCE = COLUMN_GLOBAL_GAIN + AAC_COLUMNS_MAX_CHANNELS,
+	/* Bits by element type (id_syn_ele), END excluded */
+	COLUMN_BITS = COLUMN_WINDOW_SEQUENCE + AAC_COLUMNS_MAX_CHANNELS,
+	COLUMN_COUNT = COLUMN_BITS + AAC_SYN_ELE_ID_END,
+};
+
+
+static const struct {
+	const char *name;
+	enum aac_columns_type type;
+	unsigned int count;
+} column_defs[] = {
+	{"offset", AAC_COLUMNS_TYPE_U64, 1},
+	{"length", AAC_COLUMNS_TYPE_U32, 1},
+	{"aot", AAC_COLUMNS_TYPE_U8, 1},
+	{"sampling_frequency_index", AAC_COLUMNS_TYPE_U8, 1},
+	{"channel_configuration", AAC_COLUMNS_TYPE_U8, 1},
+	{"raw_data_blocks", AAC_COLUMNS_TYPE_U8, 1},
+	{"buffer_fullness", AAC_COLUMNS_TYPE_U16, 1},
+	{"crc_present", AAC_COLUMNS_TYPE_U8, 1},
+	{"crc_check", AAC_COLUMNS_TYPE_U16, 1},
+	{"global_gain", AAC_COLUMNS_TYPE_I16, AAC_COLUMNS_MAX_CHANNELS},
+	{"window_sequence", AAC_COLUMNS_TYPE_U8, AAC_COLUMNS_MAX_CHANNELS},
+	{"bits", AAC_COLUMNS_TYPE_U32, AAC_SYN_ELE_ID_END},
+};
+
+
+static const char *const element_names[AAC_SYN_ELE_ID_END] = {
+	"sce",
+	"cpe",
+	"cce",
+	"lfe",
+	"dse",
+	"pce",
+	"fil",
+};
+
+
+static const uint8_t type_widths[] = {
+	[AAC_COLUMNS_TYPE_U8] = 1,
+	[AAC_COLUMNS_TYPE_U16] = 2,
+	[AAC_COLUMNS_TYPE_U32] = 4,
+	[AAC_COLUMNS_TYPE_U64] = 8,
+	[AAC_COLUMNS_TYPE_I16] = 2,
+};
+
+
+/* Absent value of each type */
+static const int64_t type_absent[] = {
+	[AAC_COLUMNS_TYPE_U8] = UINT8_MAX,
+	[AAC_COLUMNS_TYPE_U16] = UINT16_MAX,
+	[AAC_COLUMNS_TYPE_U32] = UINT32_MAX,
+	[AAC_COLUMNS_TYPE_U64] = -1,
+	[AAC_COLUMNS_TYPE_I16] = -1,
+};
+
+
+struct aac_columns {
+	FILE *file;
+	struct aac_columns_column columns[COLUMN_COUNT];
+	/* Current block, written once full */
+	uint8_t *block;
+	size_t block_size;
+	uint64_t rows;
+};
+
+
+static int columns_write(struct aac_columns *columns,
+			 const void *data,
+			 size_t size)
+{
+	int res;
+
+	if (fwrite(data, size, 1, columns->file) != 1) {
+		res = -EIO;
+		ULOG_ERRNO("fwrite", -res);
+		return res;
+	}
+	return 0;
+}
+
+
+int aac_columns_new(FILE *file, struct aac_columns **ret_obj)
+{
+	int res;
+	struct aac_columns *columns;
+	struct aac_columns_column *column;
+	struct aac_columns_header header;
+	uint32_t offset = sizeof(struct aac_columns_block);
+	unsigned int id = 0;
+
+	ULOG_ERRNO_RETURN_ERR_IF(ret_obj == NULL, EINVAL);
+	*ret_obj = NULL;
+	ULOG_ERRNO_RETURN_ERR_IF(file == NULL, EINVAL);
+
+	columns = calloc(1, sizeof(*columns));
+	if (columns == NULL)
+		return -ENOMEM;
+	columns->file = file;
+
+	/* Column descriptors; the values of each column are 8-byte aligned
+	 * as AAC_COLUMNS_BLOCK_ROWS is a multiple of 8 */
+	for (size_t i = 0; i < ARRAY_SIZE(column_defs); i++) {
+		for (unsigned int n = 0; n < column_defs[i].count; n++) {
+			column = &columns->columns[id++];
+			if (column_defs[i].count == 1) {
+				snprintf(column->name,
+					 sizeof(column->name),
+					 "%s",
+					 column_defs[i].name);
+			} else if (id > COLUMN_BITS) {
+				snprintf(column->name,
+					 sizeof(column->name),
+					 "%s_%s",
+					 column_defs[i].name,
+					 element_names[n]);
+			} else {
+				snprintf(column->name,
+					 sizeof(column->name),
+					 "%s_%u",
+					 column_defs[i].name,
+					 n);
+			}
+			column->type = column_defs[i].type;
+			column->offset = offset;
+			offset += type_widths[column->type] *
+				  AAC_COLUMNS_BLOCK_ROWS;
+		}
+	}
+	columns->block_size = offset;
+	columns->block = calloc(1, columns->block_size);
+	if (columns->block == NULL) {
+		res = -ENOMEM;
+		goto error;
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.magic = AAC_COLUMNS_MAGIC;
+	header.version = AAC_COLUMNS_VERSION;
+	header.column_count = COLUMN_COUNT;
+	header.block_rows = AAC_COLUMNS_BLOCK_ROWS;
+	header.block_size = columns->block_size;
+	res = columns_write(columns, &header, sizeof(header));
+	if (res < 0)
+		goto error;
+	res = columns_write(
+		columns, columns->columns, sizeof(columns->columns));
+	if (res < 0)
+		goto error;
+
+	*ret_obj = columns;
+	return 0;
+
+error:
+	free(columns->block);
+	free(columns);
+	return res;
+}
+
+
+/* Write the current block (padded if partial) */
+static int columns_flush(struct aac_columns *columns)
+{
+	int res;
+	struct aac_columns_block *block = (void *)columns->block;
+	uint32_t row_count = columns->rows % AAC_COLUMNS_BLOCK_ROWS;
+
+	if (row_count == 0 && columns->rows > 0)
+		row_count = AAC_COLUMNS_BLOCK_ROWS;
+	block->first_row = columns->rows - row_count;
+	block->row_count = row_count;
+	res = columns_write(columns, columns->block, columns->block_size);
+	memset(columns->block, 0, columns->block_size);
+	return res;
+}
+
+
+int aac_columns_destroy(struct aac_columns *columns)
+{
+	int res = 0;
+
+	if (columns == NULL)
+		return 0;
+	if (columns->rows % AAC_COLUMNS_BLOCK_ROWS != 0)
+		res = columns_flush(columns);
+	free(columns->block);
+	free(columns);
+	return res;
+}
+
+
+static void
+set_value(struct aac_columns *columns, enum column_id id, int64_t value)
+{
+	const struct aac_columns_column *column = &columns->columns[id];
+	size_t row = columns->rows % AAC_COLUMNS_BLOCK_ROWS;
+	uint8_t *p = columns->block + column->offset +
+		     row * type_widths[column->type];
+
+	switch (column->type) {
+	case AAC_COLUMNS_TYPE_U8:
+		*p = value;
+		break;
+	case AAC_COLUMNS_TYPE_U16:
+		*(uint16_t *)p = value;
+		break;
+	case AAC_COLUMNS_TYPE_U32:
+		*(uint32_t *)p = value;
+		break;
+	case AAC_COLUMNS_TYPE_U64:
+		*(uint64_t *)p = value;
+		break;
+	case AAC_COLUMNS_TYPE_I16:
+		*(int16_t *)p = value;
+		break;
+	}
+}
+
+
+static void set_channel(struct aac_columns *columns,
+			unsigned int *channel,
+			const struct aac_individual_channel_stream *ics)
+{
+	if (*channel >= AAC_COLUMNS_MAX_CHANNELS)
+		return;
+	set_value(columns, COLUMN_GLOBAL_GAIN + *channel, ics->global_gain);
+	set_value(columns,
+		  COLUMN_WINDOW_SEQUENCE + *channel,
+		  ics->ics_info.window_sequence);
+	(*channel)++;
+}
+
+
+int aac_columns_add_frame(struct aac_columns *columns,
+			  struct aac_ctx *ctx,
+			  uint64_t offset,
+			  size_t len)
+{
+	int res;
+	const struct aac_raw_data_block *blocks;
+	const struct aac_syntactic_element *element;
+	unsigned int block_count = 1, channel = 0;
+	uint32_t bits[AAC_SYN_ELE_ID_END];
+
+	ULOG_ERRNO_RETURN_ERR_IF(columns == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(ctx == NULL, EINVAL);
+
+	for (unsigned int i = 0; i < COLUMN_COUNT; i++)
+		set_value(columns, i, type_absent[columns->columns[i].type]);
+	set_value(columns, COLUMN_OFFSET, offset);
+	set_value(columns, COLUMN_LENGTH, len);
+
+	/* Header fields */
+	if (ctx->data_format == ADEF_AAC_DATA_FORMAT_ADTS) {
+		block_count =
+			ctx->adts.number_of_raw_data_blocks_in_frame + 1;
+		blocks = ctx->adts_frame.raw_data_block;
+		set_value(columns,
+			  COLUMN_AOT,
+			  ctx->adts.profile_ObjectType + 1);
+		set_value(columns,
+			  COLUMN_SAMPLING_FREQUENCY_INDEX,
+			  ctx->adts.sampling_frequency_index);
+		set_value(columns,
+			  COLUMN_CHANNEL_CONFIGURATION,
+			  ctx->adts.channel_configuration);
+		set_value(columns,
+			  COLUMN_BUFFER_FULLNESS,
+			  ctx->adts.adts_buffer_fullness);
+		set_value(columns,
+			  COLUMN_CRC_PRESENT,
+			  !ctx->adts.protection_absent);
+		if (!ctx->adts.protection_absent) {
+			set_value(columns,
+				  COLUMN_CRC_CHECK,
+				  ctx->adts_frame.adts_error_check.crc_check);
+		}
+	} else if (ctx->data_format == ADEF_AAC_DATA_FORMAT_RAW) {
+		if (ctx->transport == AAC_TRANSPORT_LOAS) {
+			block_count = ctx->smc.numSubFrames + 1;
+			blocks = ctx->loas_frame.raw_data_block;
+		} else {
+			blocks = &ctx->raw_data_block;
+		}
+		set_value(columns, COLUMN_AOT, ctx->asc.audioObjectType);
+		set_value(columns,
+			  COLUMN_SAMPLING_FREQUENCY_INDEX,
+			  ctx->asc.samplingFrequencyIndex);
+		set_value(columns,
+			  COLUMN_CHANNEL_CONFIGURATION,
+			  ctx->asc.channelConfiguration);
+		set_value(columns, COLUMN_CRC_PRESENT, 0);
+	} else {
+		ULOG_ERRNO("unknown data format", EPROTO);
+		return -EPROTO;
+	}
+	set_value(columns, COLUMN_RAW_DATA_BLOCKS, block_count);
+
+	/* Channels of the first raw_data_block, bits of all the elements */
+	memset(bits, 0, sizeof(bits));
+	for (unsigned int b = 0; b < block_count; b++) {
+		for (size_t i = 0; i < blocks[b].elements_count; i++) {
+			element = &blocks[b].elements[i];
+			if (element->id_syn_ele >= AAC_SYN_ELE_ID_END)
+				continue;
+			bits[element->id_syn_ele] += ctx->element_bits[b][i];
+			if (b > 0)
+				continue;
+			if (element->id_syn_ele == AAC_SYN_ELE_ID_SCE ||
+			    element->id_syn_ele == AAC_SYN_ELE_ID_LFE) {
+				set_channel(
+					columns, &channel, &element->sce.ics);
+			} else if (element->id_syn_ele == AAC_SYN_ELE_ID_CPE) {
+				set_channel(
+					columns, &channel, &element->cpe.ics1);
+				set_channel(
+					columns, &channel, &element->cpe.ics2);
+			}
+		}
+	}
+	for (unsigned int i = 0; i < AAC_SYN_ELE_ID_END; i++)
+		set_value(columns, COLUMN_BITS + i, bits[i]);
+
+	columns->rows++;
+	if (columns->rows % AAC_COLUMNS_BLOCK_ROWS == 0) {
+		res = columns_flush(columns);
+		if (res < 0)
+			return res;
+	}
+	return 0;
+}
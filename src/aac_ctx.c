@@ -84,6 +84,7 @@ int aac_ctx_set_adts(struct aac_ctx *ctx, const struct aac_adts *adts)
 	ULOG_ERRNO_RETURN_ERR_IF(adts == NULL, EINVAL);
 
 	ctx->data_format = ADEF_AAC_DATA_FORMAT_ADTS;
+	ctx->transport = AAC_TRANSPORT_NONE;
 	ctx->adts = *adts;
 	return 0;
 }
@@ -104,6 +105,104 @@ int aac_ctx_set_asc(struct aac_ctx *ctx, const struct aac_asc *asc)
 	ULOG_ERRNO_RETURN_ERR_IF(asc == NULL, EINVAL);
 
 	ctx->data_format = ADEF_AAC_DATA_FORMAT_RAW;
+	ctx->transport = AAC_TRANSPORT_NONE;
 	ctx->asc = *asc;
 	return 0;
 }
+
+
+enum aac_transport aac_ctx_get_transport(struct aac_ctx *ctx)
+{
+	ULOG_ERRNO_RETURN_VAL_IF(ctx == NULL, EINVAL, AAC_TRANSPORT_NONE);
+	return ctx->transport;
+}
+
+
+const struct aac_StreamMuxConfig *
+aac_ctx_get_stream_mux_config(struct aac_ctx *ctx)
+{
+	ULOG_ERRNO_RETURN_VAL_IF(ctx == NULL, EINVAL, NULL);
+	ULOG_ERRNO_RETURN_VAL_IF(
+		ctx->transport != AAC_TRANSPORT_LOAS, EINVAL, NULL);
+	return ctx->smc_valid ? &ctx->smc : NULL;
+}
+
+
+int aac_ctx_set_loas(struct aac_ctx *ctx,
+		     const struct aac_StreamMuxConfig *smc,
+		     const struct aac_asc *asc)
+{
+	ULOG_ERRNO_RETURN_ERR_IF(ctx == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(smc == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(asc == NULL, EINVAL);
+
+	ctx->data_format = ADEF_AAC_DATA_FORMAT_RAW;
+	ctx->transport = AAC_TRANSPORT_LOAS;
+	ctx->asc = *asc;
+	ctx->smc = *smc;
+	ctx->smc_valid = 1;
+	ctx->smc_sent = 0;
+	return 0;
+}
+
+
+const struct aac_adif_header *aac_ctx_get_adif_header(struct aac_ctx *ctx)
+{
+	ULOG_ERRNO_RETURN_VAL_IF(ctx == NULL, EINVAL, NULL);
+	ULOG_ERRNO_RETURN_VAL_IF(
+		ctx->transport != AAC_TRANSPORT_ADIF, EINVAL, NULL);
+	return ctx->adif_valid ? &ctx->adif : NULL;
+}
+
+
+const struct aac_field_offsets *aac_ctx_get_field_offsets(struct aac_ctx *ctx)
+{
+	ULOG_ERRNO_RETURN_VAL_IF(ctx == NULL, EINVAL, NULL);
+	return &ctx->field_offsets;
+}
+
+
+int aac_ctx_get_timing(struct aac_ctx *ctx, struct aac_timing *timing)
+{
+	int res;
+
+	ULOG_ERRNO_RETURN_ERR_IF(ctx == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(timing == NULL, EINVAL);
+
+	switch (ctx->data_format) {
+	case ADEF_AAC_DATA_FORMAT_ADTS:
+		res = aac_adts_get_timing(&ctx->adts, timing);
+		break;
+	case ADEF_AAC_DATA_FORMAT_RAW:
+		res = aac_asc_get_timing(&ctx->asc, timing);
+		/* LOAS: one raw_data_block per subframe */
+		if (res == 0 && ctx->transport == AAC_TRANSPORT_LOAS &&
+		    ctx->smc_valid)
+			timing->frame_duration *= ctx->smc.numSubFrames + 1;
+		break;
+	default:
+		res = -EINVAL;
+		break;
+	}
+	if (res < 0)
+		return res;
+
+	timing->position = ctx->position;
+	return 0;
+}
+
+
+int aac_ctx_set_position(struct aac_ctx *ctx, uint64_t position)
+{
+	ULOG_ERRNO_RETURN_ERR_IF(ctx == NULL, EINVAL);
+
+	ctx->position = position;
+	return 0;
+}
+
+
+const struct aac_bit_stats *aac_ctx_get_bit_stats(struct aac_ctx *ctx)
+{
+	ULOG_ERRNO_RETURN_VAL_IF(ctx == NULL, EINVAL, NULL);
+	return &ctx->bit_stats;
+}
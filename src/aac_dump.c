@@ -31,28 +31,126 @@
 
 #define AAC_DUMP_MAX_STACK_SIZE 16
 
+/* CBOR (RFC 8949) major types and initial bytes */
+#define AAC_CBOR_MAJOR_UINT 0
+#define AAC_CBOR_MAJOR_NINT 1
+#define AAC_CBOR_MAJOR_TEXT 3
+#define AAC_CBOR_MAJOR_ARRAY 4
+#define AAC_CBOR_MAJOR_MAP 5
+#define AAC_CBOR_MAJOR_TAG 6
+#define AAC_CBOR_INDEFINITE 31
+#define AAC_CBOR_ARRAY_INDEFINITE 0x9f
+#define AAC_CBOR_MAP_INDEFINITE 0xbf
+#define AAC_CBOR_BREAK 0xff
+
+/* Stringref extension tags (http://cbor.schmorp.de/stringref) */
+#define AAC_CBOR_TAG_STRINGREF 25
+#define AAC_CBOR_TAG_STRINGREF_NAMESPACE 256
+
+#define AAC_DUMP_CBOR_MAX_REFS 512
+#define AAC_DUMP_CBOR_REF_SLOTS 1024
+
+
+/* Minimum length of a string to be added to a stringref namespace holding
+ * count strings (the reference must be shorter than the string) */
+static inline size_t aac_cbor_stringref_min_len(uint32_t count)
+{
+	if (count < 24)
+		return 3;
+	else if (count < 256)
+		return 4;
+	else if (count < 65536)
+		return 5;
+	else
+		return 7;
+}
+
+
+struct aac_dump_cbs {
+	int (*begin_struct)(struct aac_dump *dump, const char *name);
+	int (*end_struct)(struct aac_dump *dump, const char *name);
+	int (*begin_array)(struct aac_dump *dump, const char *name);
+	int (*end_array)(struct aac_dump *dump, const char *name);
+	int (*begin_array_item)(struct aac_dump *dump);
+	int (*end_array_item)(struct aac_dump *dump);
+	int (*field)(struct aac_dump *dump,
+		     const char *key,
+		     size_t len,
+		     int64_t val);
+};
+
+
+/* Compiled filter path: components (not null-terminated) of a copy of the
+ * path string */
+struct aac_dump_filter_path {
+	char *str;
+	struct {
+		const char *name;
+		size_t len;
+	} components[AAC_DUMP_MAX_STACK_SIZE];
+	unsigned int count;
+};
+
+
+/* Filter state of an open container: include and exclude paths matching
+ * up to the container (bit i for path i), depth of the container in the
+ * paths and whether it is selected by an include path */
+struct aac_dump_filter_state {
+	uint64_t include;
+	uint64_t exclude;
+	unsigned int depth;
+	int selected;
+};
+
 
 struct aac_dump {
 	struct aac_dump_cfg cfg;
 	uint32_t flags;
+	struct aac_dump_cbs cbs;
+
+	/* Field path filters: include paths followed by exclude paths, states
+	 * of the open containers, depth of the dropped containers and
+	 * callbacks of the dump type */
 	struct {
-		int (*begin_struct)(struct aac_dump *dump, const char *name);
-		int (*end_struct)(struct aac_dump *dump, const char *name);
-		int (*begin_array)(struct aac_dump *dump, const char *name);
-		int (*end_array)(struct aac_dump *dump, const char *name);
-		int (*begin_array_item)(struct aac_dump *dump);
-		int (*end_array_item)(struct aac_dump *dump);
-		int (*field)(struct aac_dump *dump,
-			     const char *field,
-			     int64_t val);
-	} cbs;
+		struct aac_dump_filter_path *paths;
+		struct aac_dump_filter_state stack[AAC_DUMP_MAX_STACK_SIZE + 1];
+		uint32_t stacksize;
+		uint32_t skip;
+		struct aac_dump_cbs cbs;
+	} filter;
 
 	json_object *jcurrent;
 	json_object *jstack[AAC_DUMP_MAX_STACK_SIZE];
 	uint32_t jstacksize;
+
+	/* JSON_STREAM and CBOR: output data, flags of the open containers and
+	 * depth of the dropped containers (see aac_dump_stream_open()) */
+	struct {
+		char *buf;
+		size_t len;
+		size_t size;
+		uint8_t stack[AAC_DUMP_MAX_STACK_SIZE];
+		uint32_t stacksize;
+		uint32_t skip;
+	} stream;
+
+	/* CBOR: keys of the stringref namespace of the current frame and
+	 * hash table of their indices (plus one, 0 for empty slots) */
+	struct {
+		struct {
+			const char *key;
+			size_t len;
+		} refs[AAC_DUMP_CBOR_MAX_REFS];
+		uint16_t slots[AAC_DUMP_CBOR_REF_SLOTS];
+		uint32_t count;
+	} cbor;
 };
 
 
+#define AAC_DUMP_STREAM_ARRAY 0x01
+#define AAC_DUMP_STREAM_NOT_EMPTY 0x02
+
+
 #define AAC_SYNTAX_OP_NAME dump
 #define AAC_SYNTAX_OP_KIND AAC_SYNTAX_OP_KIND_DUMP
 
@@ -146,73 +244,696 @@ static int aac_dump_json_end_array_item(struct aac_dump *dump)
 }
 
 
-static void extract_key(const char *field, char *key, size_t maxkey)
+static int aac_dump_json_field(struct aac_dump *dump,
+			       const char *key,
+			       size_t len,
+			       int64_t val)
 {
-	const char *start1 = NULL;
-	const char *start2 = NULL;
-	const char *end = NULL;
+	char str[256];
+#if defined(JSON_C_MAJOR_VERSION) && defined(JSON_C_MINOR_VERSION) &&          \
+	((JSON_C_MAJOR_VERSION == 0 && JSON_C_MINOR_VERSION >= 10) ||          \
+	 (JSON_C_MAJOR_VERSION > 0))
+	json_object *jval = json_object_new_int64(val);
+#else
+	json_object *jval = json_object_new_int(val);
+#endif
+	if (json_object_get_type(dump->jcurrent) == json_type_array) {
+		json_object_array_add(dump->jcurrent, jval);
+	} else {
+		len = Min(len, sizeof(str) - 1);
+		memcpy(str, key, len);
+		str[len] = '\0';
+		json_object_object_add(dump->jcurrent, str, jval);
+	}
+	return 0;
+}
 
-	/* Start after last '.' */
-	start1 = strrchr(field, '.');
-	if (start1 == NULL)
-		start1 = field;
-	else
-		start1++;
 
-	/* Start after last '>' */
-	start2 = strrchr(start1, '>');
-	if (start2 == NULL)
-		start2 = start1;
-	else
-		start2++;
+static int aac_dump_stream_append(struct aac_dump *dump,
+				  const void *data,
+				  size_t len)
+{
+	char *buf;
+	size_t size;
 
-	/* Skip spaces */
-	while (*start2 == ' ')
-		start2++;
+	/* Keep room for the null terminator */
+	if (dump->stream.len + len >= dump->stream.size) {
+		size = Max(dump->stream.size * 2, dump->stream.len + len + 1);
+		buf = realloc(dump->stream.buf, size);
+		if (buf == NULL)
+			return -ENOMEM;
+		dump->stream.buf = buf;
+		dump->stream.size = size;
+	}
+	memcpy(dump->stream.buf + dump->stream.len, data, len);
+	dump->stream.len += len;
+	return 0;
+}
 
-	/* Go up to last '[' */
-	end = strrchr(start2, '[');
-	if (end == NULL)
-		end = start2 + strlen(start2);
 
-	/* Copy key */
-	if ((size_t)(end - start2) < maxkey) {
-		memcpy(key, start2, end - start2);
-		key[end - start2] = '\0';
+/* CBOR data item head: major type and argument (RFC 8949 3.) */
+static int
+aac_dump_cbor_head(struct aac_dump *dump, uint8_t major, uint64_t val)
+{
+	uint8_t head[9];
+	size_t len;
+
+	if (val < 24) {
+		head[0] = (major << 5) | val;
+		len = 1;
+	} else if (val <= UINT8_MAX) {
+		head[0] = (major << 5) | 24;
+		len = 2;
+	} else if (val <= UINT16_MAX) {
+		head[0] = (major << 5) | 25;
+		len = 3;
+	} else if (val <= UINT32_MAX) {
+		head[0] = (major << 5) | 26;
+		len = 5;
 	} else {
-		memcpy(key, start2, maxkey - 1);
-		key[maxkey - 1] = '\0';
+		head[0] = (major << 5) | 27;
+		len = 9;
 	}
+	for (size_t i = len - 1; i > 0; i--) {
+		head[i] = val & 0xff;
+		val >>= 8;
+	}
+	return aac_dump_stream_append(dump, head, len);
+}
+
+
+static uint32_t aac_dump_cbor_hash(const char *key, size_t len)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < len; i++)
+		hash = (hash ^ (uint8_t)key[i]) * 16777619u;
+	return hash;
 }
 
 
+/* Map key: a reference to the same key earlier in the frame if any,
+ * otherwise the key itself, added to the references if long enough */
 static int
-aac_dump_json_field(struct aac_dump *dump, const char *field, int64_t val)
+aac_dump_cbor_key(struct aac_dump *dump, const char *key, size_t len)
 {
-	char key[256] = "";
-#if defined(JSON_C_MAJOR_VERSION) && defined(JSON_C_MINOR_VERSION) &&          \
-	((JSON_C_MAJOR_VERSION == 0 && JSON_C_MINOR_VERSION >= 10) ||          \
-	 (JSON_C_MAJOR_VERSION > 0))
-	json_object *jval = json_object_new_int64(val);
-#else
-	json_object *jval = json_object_new_int(val);
-#endif
-	extract_key(field, key, sizeof(key));
-	if (json_object_get_type(dump->jcurrent) == json_type_array)
-		json_object_array_add(dump->jcurrent, jval);
+	int res;
+	uint32_t slot, ref;
+
+	slot = aac_dump_cbor_hash(key, len) & (AAC_DUMP_CBOR_REF_SLOTS - 1);
+	while ((ref = dump->cbor.slots[slot]) != 0) {
+		ref--;
+		if (dump->cbor.refs[ref].len == len &&
+		    memcmp(dump->cbor.refs[ref].key, key, len) == 0) {
+			res = aac_dump_cbor_head(dump,
+						 AAC_CBOR_MAJOR_TAG,
+						 AAC_CBOR_TAG_STRINGREF);
+			if (res < 0)
+				return res;
+			return aac_dump_cbor_head(
+				dump, AAC_CBOR_MAJOR_UINT, ref);
+		}
+		slot = (slot + 1) & (AAC_DUMP_CBOR_REF_SLOTS - 1);
+	}
+
+	if (dump->cbor.count < AAC_DUMP_CBOR_MAX_REFS &&
+	    len >= aac_cbor_stringref_min_len(dump->cbor.count)) {
+		dump->cbor.refs[dump->cbor.count].key = key;
+		dump->cbor.refs[dump->cbor.count].len = len;
+		dump->cbor.slots[slot] = ++dump->cbor.count;
+	}
+	res = aac_dump_cbor_head(dump, AAC_CBOR_MAJOR_TEXT, len);
+	if (res < 0)
+		return res;
+	return aac_dump_stream_append(dump, key, len);
+}
+
+
+/* Separator and key of a new member of the current container; the JSON
+ * text is laid out as json_object_to_json_string() does */
+static int
+aac_dump_stream_member(struct aac_dump *dump, const char *key, size_t len)
+{
+	int res;
+	uint8_t *flags = &dump->stream.stack[dump->stream.stacksize - 1];
+
+	if (dump->cfg.type == AAC_DUMP_TYPE_CBOR) {
+		if (*flags & AAC_DUMP_STREAM_ARRAY)
+			return 0;
+		return aac_dump_cbor_key(dump, key, len);
+	}
+
+	if (*flags & AAC_DUMP_STREAM_NOT_EMPTY)
+		res = aac_dump_stream_append(dump, ", ", 2);
 	else
-		json_object_object_add(dump->jcurrent, key, jval);
+		res = aac_dump_stream_append(dump, " ", 1);
+	if (res < 0)
+		return res;
+	*flags |= AAC_DUMP_STREAM_NOT_EMPTY;
+	if (*flags & AAC_DUMP_STREAM_ARRAY)
+		return 0;
+
+	res = aac_dump_stream_append(dump, "\"", 1);
+	if (res < 0)
+		return res;
+	res = aac_dump_stream_append(dump, key, len);
+	if (res < 0)
+		return res;
+	return aac_dump_stream_append(dump, "\": ", 3);
+}
+
+
+/* Containers are only attached to the same parents as in the json-c tree
+ * (e.g. a structure in an array is dropped), the other ones are skipped
+ * along with their contents */
+static int aac_dump_stream_open(struct aac_dump *dump,
+				const char *key,
+				size_t len,
+				int array,
+				int attach)
+{
+	int res;
+	uint8_t open;
+
+	if (dump->stream.skip > 0 || !attach) {
+		dump->stream.skip++;
+		return 0;
+	}
+	if (dump->stream.stacksize >= AAC_DUMP_MAX_STACK_SIZE)
+		return -EOVERFLOW;
+	res = aac_dump_stream_member(dump, key, len);
+	if (res < 0)
+		return res;
+	if (dump->cfg.type == AAC_DUMP_TYPE_CBOR) {
+		open = array ? AAC_CBOR_ARRAY_INDEFINITE
+			     : AAC_CBOR_MAP_INDEFINITE;
+	} else {
+		open = array ? '[' : '{';
+	}
+	res = aac_dump_stream_append(dump, &open, 1);
+	if (res < 0)
+		return res;
+	dump->stream.stack[dump->stream.stacksize++] =
+		array ? AAC_DUMP_STREAM_ARRAY : 0;
+	return 0;
+}
+
+
+static int aac_dump_stream_close(struct aac_dump *dump)
+{
+	uint8_t flags;
+	uint8_t brk = AAC_CBOR_BREAK;
+
+	if (dump->stream.skip > 0) {
+		dump->stream.skip--;
+		return 0;
+	}
+	assert(dump->stream.stacksize > 0);
+	flags = dump->stream.stack[--dump->stream.stacksize];
+	if (dump->cfg.type == AAC_DUMP_TYPE_CBOR)
+		return aac_dump_stream_append(dump, &brk, 1);
+	else if (flags & AAC_DUMP_STREAM_ARRAY)
+		return aac_dump_stream_append(dump, " ]", 2);
+	else
+		return aac_dump_stream_append(dump, " }", 2);
+}
+
+
+static int aac_dump_stream_in_array(struct aac_dump *dump)
+{
+	return (dump->stream.stack[dump->stream.stacksize - 1] &
+		AAC_DUMP_STREAM_ARRAY) != 0;
+}
+
+
+static int aac_dump_stream_begin_struct(struct aac_dump *dump,
+					const char *name)
+{
+	return aac_dump_stream_open(
+		dump, name, strlen(name), 0, !aac_dump_stream_in_array(dump));
+}
+
+
+static int aac_dump_stream_end_struct(struct aac_dump *dump, const char *name)
+{
+	return aac_dump_stream_close(dump);
+}
+
+
+static int aac_dump_stream_begin_array(struct aac_dump *dump, const char *name)
+{
+	return aac_dump_stream_open(dump, name, strlen(name), 1, 1);
+}
+
+
+static int aac_dump_stream_end_array(struct aac_dump *dump, const char *name)
+{
+	return aac_dump_stream_close(dump);
+}
+
+
+static int aac_dump_stream_begin_array_item(struct aac_dump *dump)
+{
+	return aac_dump_stream_open(
+		dump, "", 0, 0, aac_dump_stream_in_array(dump));
+}
+
+
+static int aac_dump_stream_end_array_item(struct aac_dump *dump)
+{
+	return aac_dump_stream_close(dump);
+}
+
+
+static int aac_dump_stream_field(struct aac_dump *dump,
+				 const char *key,
+				 size_t len,
+				 int64_t val)
+{
+	int res;
+	char str[24];
+	size_t off = sizeof(str);
+	uint64_t v = (val < 0) ? -(uint64_t)val : (uint64_t)val;
+
+	if (dump->stream.skip > 0)
+		return 0;
+	res = aac_dump_stream_member(dump, key, len);
+	if (res < 0)
+		return res;
+
+	if (dump->cfg.type == AAC_DUMP_TYPE_CBOR) {
+		if (val < 0)
+			return aac_dump_cbor_head(
+				dump, AAC_CBOR_MAJOR_NINT, v - 1);
+		return aac_dump_cbor_head(dump, AAC_CBOR_MAJOR_UINT, v);
+	}
+
+	do {
+		str[--off] = '0' + v % 10;
+		v /= 10;
+	} while (v != 0);
+	if (val < 0)
+		str[--off] = '-';
+	return aac_dump_stream_append(dump, str + off, sizeof(str) - off);
+}
+
+
+static int aac_dump_stream_begin(struct aac_dump *dump)
+{
+	int res;
+	uint8_t open = AAC_CBOR_MAP_INDEFINITE;
+
+	dump->stream.len = 0;
+	dump->stream.skip = 0;
+	dump->stream.stack[0] = 0;
+	dump->stream.stacksize = 1;
+	if (dump->cfg.type != AAC_DUMP_TYPE_CBOR)
+		return aac_dump_stream_append(dump, "{", 1);
+
+	/* Each frame is a stringref namespace */
+	dump->cbor.count = 0;
+	memset(dump->cbor.slots, 0, sizeof(dump->cbor.slots));
+	res = aac_dump_cbor_head(
+		dump, AAC_CBOR_MAJOR_TAG, AAC_CBOR_TAG_STRINGREF_NAMESPACE);
+	if (res < 0)
+		return res;
+	return aac_dump_stream_append(dump, &open, 1);
+}
+
+
+/* Close the root object and write it to the output file (if any) */
+static int aac_dump_stream_end(struct aac_dump *dump)
+{
+	int res;
+
+	assert(dump->stream.stacksize == 1 && dump->stream.skip == 0);
+	res = aac_dump_stream_close(dump);
+	if (res < 0)
+		return res;
+	dump->stream.buf[dump->stream.len] = '\0';
+	if (dump->cfg.file == NULL)
+		return 0;
+
+	if (dump->cfg.type != AAC_DUMP_TYPE_CBOR) {
+		res = aac_dump_stream_append(dump, "\n", 1);
+		if (res < 0)
+			return res;
+	}
+	if (fwrite(dump->stream.buf, dump->stream.len, 1, dump->cfg.file) !=
+	    1) {
+		res = -EIO;
+		ULOG_ERRNO("fwrite", -res);
+		return res;
+	}
+	return aac_dump_stream_begin(dump);
+}
+
+
+static int aac_dump_visitor_begin_struct(struct aac_dump *dump,
+					 const char *name)
+{
+	const struct aac_dump_visitor *visitor = dump->cfg.visitor;
+	if (visitor->begin_struct == NULL)
+		return 0;
+	return (*visitor->begin_struct)(dump, name, dump->cfg.userdata);
+}
+
+
+static int aac_dump_visitor_end_struct(struct aac_dump *dump, const char *name)
+{
+	const struct aac_dump_visitor *visitor = dump->cfg.visitor;
+	if (visitor->end_struct == NULL)
+		return 0;
+	return (*visitor->end_struct)(dump, name, dump->cfg.userdata);
+}
+
+
+static int aac_dump_visitor_begin_array(struct aac_dump *dump,
+					const char *name)
+{
+	const struct aac_dump_visitor *visitor = dump->cfg.visitor;
+	if (visitor->begin_array == NULL)
+		return 0;
+	return (*visitor->begin_array)(dump, name, dump->cfg.userdata);
+}
+
+
+static int aac_dump_visitor_end_array(struct aac_dump *dump, const char *name)
+{
+	const struct aac_dump_visitor *visitor = dump->cfg.visitor;
+	if (visitor->end_array == NULL)
+		return 0;
+	return (*visitor->end_array)(dump, name, dump->cfg.userdata);
+}
+
+
+static int aac_dump_visitor_begin_array_item(struct aac_dump *dump)
+{
+	const struct aac_dump_visitor *visitor = dump->cfg.visitor;
+	if (visitor->begin_array_item == NULL)
+		return 0;
+	return (*visitor->begin_array_item)(dump, dump->cfg.userdata);
+}
+
+
+static int aac_dump_visitor_end_array_item(struct aac_dump *dump)
+{
+	const struct aac_dump_visitor *visitor = dump->cfg.visitor;
+	if (visitor->end_array_item == NULL)
+		return 0;
+	return (*visitor->end_array_item)(dump, dump->cfg.userdata);
+}
+
+
+static int aac_dump_visitor_field(struct aac_dump *dump,
+				  const char *key,
+				  size_t len,
+				  int64_t val)
+{
+	const struct aac_dump_visitor *visitor = dump->cfg.visitor;
+	if (visitor->field == NULL)
+		return 0;
+	return (*visitor->field)(dump, key, len, val, dump->cfg.userdata);
+}
+
+
+static int aac_dump_filter_compile(struct aac_dump_filter_path *path,
+				   const char *str)
+{
+	const char *name, *end;
+
+	if (str == NULL || *str == '\0')
+		return -EINVAL;
+	path->str = strdup(str);
+	if (path->str == NULL)
+		return -ENOMEM;
+
+	name = path->str;
+	do {
+		if (path->count >= AAC_DUMP_MAX_STACK_SIZE)
+			return -EINVAL;
+		end = strchr(name, '.');
+		if (end == NULL)
+			end = name + strlen(name);
+		if (end == name)
+			return -EINVAL;
+		path->components[path->count].name = name;
+		path->components[path->count].len = end - name;
+		path->count++;
+		name = end + 1;
+	} while (*end != '\0');
+	return 0;
+}
+
+
+static void aac_dump_filter_reset(struct aac_dump *dump)
+{
+	struct aac_dump_filter_state *root = &dump->filter.stack[0];
+	unsigned int include_count = dump->cfg.include_count;
+	unsigned int exclude_count = dump->cfg.exclude_count;
+
+	root->include = (include_count < 64) ? (1ULL << include_count) - 1
+					     : UINT64_MAX;
+	root->exclude = (exclude_count < 64) ? (1ULL << exclude_count) - 1
+					     : UINT64_MAX;
+	root->depth = 0;
+	root->selected = (include_count == 0);
+	dump->filter.stacksize = 1;
+	dump->filter.skip = 0;
+}
+
+
+static inline int
+aac_dump_filter_match(const struct aac_dump_filter_path *path,
+		      unsigned int depth,
+		      const char *name,
+		      size_t len)
+{
+	const char *component = path->components[depth].name;
+	size_t component_len = path->components[depth].len;
+
+	return (component_len == 1 && component[0] == '*') ||
+	       (component_len == len && memcmp(component, name, len) == 0);
+}
+
+
+/* Filter state of a member of the current container; returns 1 if the
+ * member is dumped, 0 otherwise (fields are only dumped if selected,
+ * containers also if an include path may select some of their contents) */
+static int aac_dump_filter_member(struct aac_dump *dump,
+				  const char *name,
+				  size_t len,
+				  int container,
+				  struct aac_dump_filter_state *state)
+{
+	const struct aac_dump_filter_state *parent =
+		&dump->filter.stack[dump->filter.stacksize - 1];
+	const struct aac_dump_filter_path *path;
+	unsigned int depth = parent->depth;
+
+	state->include = 0;
+	state->exclude = 0;
+	state->depth = depth + 1;
+	state->selected = parent->selected;
+
+	for (unsigned int i = 0; i < dump->cfg.exclude_count; i++) {
+		if ((parent->exclude & (1ULL << i)) == 0)
+			continue;
+		path = &dump->filter.paths[dump->cfg.include_count + i];
+		if (!aac_dump_filter_match(path, depth, name, len))
+			continue;
+		if (depth + 1 == path->count)
+			return 0;
+		state->exclude |= 1ULL << i;
+	}
+
+	for (unsigned int i = 0; i < dump->cfg.include_count &&
+				 !state->selected;
+	     i++) {
+		if ((parent->include & (1ULL << i)) == 0)
+			continue;
+		path = &dump->filter.paths[i];
+		if (!aac_dump_filter_match(path, depth, name, len))
+			continue;
+		if (depth + 1 == path->count)
+			state->selected = 1;
+		else
+			state->include |= 1ULL << i;
+	}
+	if (state->selected)
+		state->include = 0;
+
+	return state->selected || (container && state->include != 0);
+}
+
+
+/* Open a container; returns 1 if it is dumped, 0 if it is dropped along
+ * with its contents (array items are dumped with their array) */
+static int
+aac_dump_filter_open(struct aac_dump *dump, const char *name, int item)
+{
+	struct aac_dump_filter_state *state;
+
+	if (dump->filter.skip > 0) {
+		dump->filter.skip++;
+		return 0;
+	}
+	if (dump->filter.stacksize >= ARRAY_SIZE(dump->filter.stack))
+		return -EOVERFLOW;
+	state = &dump->filter.stack[dump->filter.stacksize];
+	if (item) {
+		*state = dump->filter.stack[dump->filter.stacksize - 1];
+	} else if (!aac_dump_filter_member(
+			   dump, name, strlen(name), 1, state)) {
+		dump->filter.skip++;
+		return 0;
+	}
+	dump->filter.stacksize++;
+	return 1;
+}
+
+
+/* Close a container; returns 1 if it was dumped */
+static int aac_dump_filter_close(struct aac_dump *dump)
+{
+	if (dump->filter.skip > 0) {
+		dump->filter.skip--;
+		return 0;
+	}
+	assert(dump->filter.stacksize > 1);
+	dump->filter.stacksize--;
+	return 1;
+}
+
+
+static int aac_dump_filter_begin_struct(struct aac_dump *dump,
+					const char *name)
+{
+	int res = aac_dump_filter_open(dump, name, 0);
+	if (res <= 0)
+		return res;
+	return (*dump->filter.cbs.begin_struct)(dump, name);
+}
+
+
+static int aac_dump_filter_end_struct(struct aac_dump *dump, const char *name)
+{
+	if (!aac_dump_filter_close(dump))
+		return 0;
+	return (*dump->filter.cbs.end_struct)(dump, name);
+}
+
+
+static int aac_dump_filter_begin_array(struct aac_dump *dump,
+				       const char *name)
+{
+	int res = aac_dump_filter_open(dump, name, 0);
+	if (res <= 0)
+		return res;
+	return (*dump->filter.cbs.begin_array)(dump, name);
+}
+
+
+static int aac_dump_filter_end_array(struct aac_dump *dump, const char *name)
+{
+	if (!aac_dump_filter_close(dump))
+		return 0;
+	return (*dump->filter.cbs.end_array)(dump, name);
+}
+
+
+static int aac_dump_filter_begin_array_item(struct aac_dump *dump)
+{
+	int res = aac_dump_filter_open(dump, NULL, 1);
+	if (res <= 0)
+		return res;
+	return (*dump->filter.cbs.begin_array_item)(dump);
+}
+
+
+static int aac_dump_filter_end_array_item(struct aac_dump *dump)
+{
+	if (!aac_dump_filter_close(dump))
+		return 0;
+	return (*dump->filter.cbs.end_array_item)(dump);
+}
+
+
+static int aac_dump_filter_field(struct aac_dump *dump,
+				 const char *key,
+				 size_t len,
+				 int64_t val)
+{
+	struct aac_dump_filter_state state;
+
+	if (dump->filter.skip > 0 ||
+	    !aac_dump_filter_member(dump, key, len, 0, &state))
+		return 0;
+	return (*dump->filter.cbs.field)(dump, key, len, val);
+}
+
+
+/* Compile the filter paths and insert the filter before the callbacks of
+ * the dump type */
+static int aac_dump_filter_setup(struct aac_dump *dump)
+{
+	int res;
+	unsigned int count = dump->cfg.include_count + dump->cfg.exclude_count;
+	const char *str;
+
+	dump->filter.paths = calloc(count, sizeof(*dump->filter.paths));
+	if (dump->filter.paths == NULL)
+		return -ENOMEM;
+	for (unsigned int i = 0; i < count; i++) {
+		str = (i < dump->cfg.include_count)
+			      ? dump->cfg.include_paths[i]
+			      : dump->cfg.exclude_paths
+					[i - dump->cfg.include_count];
+		res = aac_dump_filter_compile(&dump->filter.paths[i], str);
+		if (res < 0) {
+			ULOG_ERRNO("invalid filter path: '%s'",
+				   -res,
+				   str != NULL ? str : "");
+			return res;
+		}
+	}
+	/* The strings belong to the caller */
+	dump->cfg.include_paths = NULL;
+	dump->cfg.exclude_paths = NULL;
+
+	dump->filter.cbs = dump->cbs;
+	dump->cbs.begin_struct = &aac_dump_filter_begin_struct;
+	dump->cbs.end_struct = &aac_dump_filter_end_struct;
+	dump->cbs.begin_array = &aac_dump_filter_begin_array;
+	dump->cbs.end_array = &aac_dump_filter_end_array;
+	dump->cbs.begin_array_item = &aac_dump_filter_begin_array_item;
+	dump->cbs.end_array_item = &aac_dump_filter_end_array_item;
+	dump->cbs.field = &aac_dump_filter_field;
+	aac_dump_filter_reset(dump);
 	return 0;
 }
 
 
 int aac_dump_new(const struct aac_dump_cfg *cfg, struct aac_dump **ret_obj)
 {
+	int res;
 	struct aac_dump *dump = NULL;
 
 	ULOG_ERRNO_RETURN_ERR_IF(ret_obj == NULL, EINVAL);
 	*ret_obj = NULL;
 	ULOG_ERRNO_RETURN_ERR_IF(cfg == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(
+		cfg->type == AAC_DUMP_TYPE_VISITOR && cfg->visitor == NULL,
+		EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(
+		cfg->include_count > AAC_DUMP_MAX_FILTER_PATHS ||
+			(cfg->include_count > 0 && cfg->include_paths == NULL),
+		EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(
+		cfg->exclude_count > AAC_DUMP_MAX_FILTER_PATHS ||
+			(cfg->exclude_count > 0 && cfg->exclude_paths == NULL),
+		EINVAL);
 
 	/* Allocate structure */
 	dump = calloc(1, sizeof(*dump));
@@ -232,6 +953,41 @@ int aac_dump_new(const struct aac_dump_cfg *cfg, struct aac_dump **ret_obj)
 		dump->cbs.field = &aac_dump_json_field;
 		aac_dump_json_push(dump, json_object_new_object());
 		break;
+	case AAC_DUMP_TYPE_JSON_STREAM:
+	case AAC_DUMP_TYPE_CBOR:
+		dump->cbs.begin_struct = &aac_dump_stream_begin_struct;
+		dump->cbs.end_struct = &aac_dump_stream_end_struct;
+		dump->cbs.begin_array = &aac_dump_stream_begin_array;
+		dump->cbs.end_array = &aac_dump_stream_end_array;
+		dump->cbs.begin_array_item = &aac_dump_stream_begin_array_item;
+		dump->cbs.end_array_item = &aac_dump_stream_end_array_item;
+		dump->cbs.field = &aac_dump_stream_field;
+		if (aac_dump_stream_begin(dump) < 0) {
+			free(dump);
+			return -ENOMEM;
+		}
+		break;
+	case AAC_DUMP_TYPE_VISITOR:
+		dump->cbs.begin_struct = &aac_dump_visitor_begin_struct;
+		dump->cbs.end_struct = &aac_dump_visitor_end_struct;
+		dump->cbs.begin_array = &aac_dump_visitor_begin_array;
+		dump->cbs.end_array = &aac_dump_visitor_end_array;
+		dump->cbs.begin_array_item = &aac_dump_visitor_begin_array_item;
+		dump->cbs.end_array_item = &aac_dump_visitor_end_array_item;
+		dump->cbs.field = &aac_dump_visitor_field;
+		break;
+	default:
+		ULOGE("unsupported dump type: %d", dump->cfg.type);
+		free(dump);
+		return -EINVAL;
+	}
+
+	if (cfg->include_count > 0 || cfg->exclude_count > 0) {
+		res = aac_dump_filter_setup(dump);
+		if (res < 0) {
+			aac_dump_destroy(dump);
+			return res;
+		}
 	}
 
 	/* Success */
@@ -246,6 +1002,14 @@ int aac_dump_destroy(struct aac_dump *dump)
 		return 0;
 	for (uint32_t i = 0; i < dump->jstacksize; i++)
 		json_object_put(dump->jstack[i]);
+	free(dump->stream.buf);
+	if (dump->filter.paths != NULL) {
+		for (uint32_t i = 0;
+		     i < dump->cfg.include_count + dump->cfg.exclude_count;
+		     i++)
+			free(dump->filter.paths[i].str);
+		free(dump->filter.paths);
+	}
 	free(dump);
 	return 0;
 }
@@ -254,6 +1018,8 @@ int aac_dump_destroy(struct aac_dump *dump)
 int aac_dump_clear(struct aac_dump *dump)
 {
 	ULOG_ERRNO_RETURN_ERR_IF(dump == NULL, EINVAL);
+	if (dump->filter.paths != NULL)
+		aac_dump_filter_reset(dump);
 	switch (dump->cfg.type) {
 	case AAC_DUMP_TYPE_JSON:
 		for (uint32_t i = 0; i < dump->jstacksize; i++)
@@ -262,6 +1028,11 @@ int aac_dump_clear(struct aac_dump *dump)
 		dump->jstacksize = 0;
 		aac_dump_json_push(dump, json_object_new_object());
 		break;
+	case AAC_DUMP_TYPE_JSON_STREAM:
+	case AAC_DUMP_TYPE_CBOR:
+		return aac_dump_stream_begin(dump);
+	case AAC_DUMP_TYPE_VISITOR:
+		break;
 	}
 	return 0;
 }
@@ -281,12 +1052,47 @@ int aac_dump_get_json_str(struct aac_dump *dump, const char **str)
 {
 	ULOG_ERRNO_RETURN_ERR_IF(dump == NULL, EINVAL);
 	ULOG_ERRNO_RETURN_ERR_IF(str == NULL, EINVAL);
-	ULOG_ERRNO_RETURN_ERR_IF(dump->cfg.type != AAC_DUMP_TYPE_JSON, EINVAL);
-	*str = json_object_to_json_string(dump->jcurrent);
+	switch (dump->cfg.type) {
+	case AAC_DUMP_TYPE_JSON:
+		*str = json_object_to_json_string(dump->jcurrent);
+		return 0;
+	case AAC_DUMP_TYPE_JSON_STREAM:
+		ULOG_ERRNO_RETURN_ERR_IF(dump->cfg.file != NULL, EINVAL);
+		*str = dump->stream.buf;
+		return 0;
+	default:
+		ULOG_ERRNO_RETURN_ERR_IF(1, EINVAL);
+	}
+}
+
+
+int aac_dump_get_data(struct aac_dump *dump,
+		      const uint8_t **data,
+		      size_t *len)
+{
+	ULOG_ERRNO_RETURN_ERR_IF(dump == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(data == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(len == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(dump->cfg.type != AAC_DUMP_TYPE_JSON_STREAM &&
+					 dump->cfg.type != AAC_DUMP_TYPE_CBOR,
+				 EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(dump->cfg.file != NULL, EINVAL);
+	*data = (const uint8_t *)dump->stream.buf;
+	*len = dump->stream.len;
 	return 0;
 }
 
 
+/* Write the dump to the output file of the streaming types (if any) */
+static int aac_dump_finish(struct aac_dump *dump)
+{
+	if (dump->cfg.type != AAC_DUMP_TYPE_JSON_STREAM &&
+	    dump->cfg.type != AAC_DUMP_TYPE_CBOR)
+		return 0;
+	return aac_dump_stream_end(dump);
+}
+
+
 int aac_dump_adts_frame(struct aac_dump *dump,
 			struct aac_ctx *ctx,
 			uint32_t flags)
@@ -307,7 +1113,372 @@ int aac_dump_adts_frame(struct aac_dump *dump,
 	res = aac_dump_clear(dump);
 	if (res >= 0)
 		res = _aac_dump_adts_frame(&bs, ctx, NULL, NULL);
+	if (res >= 0)
+		res = aac_dump_finish(dump);
 
 	aac_bs_clear(&bs);
 	return res;
 }
+
+
+int aac_dump_loas_frame(struct aac_dump *dump,
+			struct aac_ctx *ctx,
+			uint32_t flags)
+{
+	int res = 0;
+	struct aac_bitstream bs;
+	ULOG_ERRNO_RETURN_ERR_IF(dump == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(ctx == NULL, EINVAL);
+
+	/* Save flags */
+	dump->flags = flags;
+
+	/* Setup a fake bitstream */
+	aac_bs_cinit(&bs, NULL, 0);
+	bs.priv = dump;
+
+	/* Clear current contents and dump */
+	res = aac_dump_clear(dump);
+	if (res >= 0)
+		res = _aac_dump_loas_frame(&bs, ctx, NULL, NULL, NULL, 0);
+	if (res >= 0)
+		res = aac_dump_finish(dump);
+
+	aac_bs_clear(&bs);
+	return res;
+}
+
+
+int aac_dump_asc(struct aac_dump *dump, const struct aac_asc *asc)
+{
+	int res = 0;
+	struct aac_bitstream bs;
+	ULOG_ERRNO_RETURN_ERR_IF(dump == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(asc == NULL, EINVAL);
+
+	dump->flags = 0;
+	aac_bs_cinit(&bs, NULL, 0);
+	bs.priv = dump;
+
+	res = aac_dump_clear(dump);
+	if (res < 0)
+		goto out;
+	res = (*dump->cbs.begin_struct)(dump, "AudioSpecificConfig");
+	if (res < 0)
+		goto out;
+	res = _aac_dump_AudioSpecificConfig(&bs, asc, 1);
+	if (res < 0)
+		goto out;
+	res = (*dump->cbs.end_struct)(dump, "AudioSpecificConfig");
+	if (res < 0)
+		goto out;
+	res = aac_dump_finish(dump);
+
+out:
+	aac_bs_clear(&bs);
+	return res;
+}
+
+
+int aac_dump_adif_header(struct aac_dump *dump,
+			 const struct aac_adif_header *adif)
+{
+	int res = 0;
+	struct aac_bitstream bs;
+	ULOG_ERRNO_RETURN_ERR_IF(dump == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(adif == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(
+		adif->num_program_config_elements >= AAC_MAX_ADIF_PCE, EINVAL);
+
+	dump->flags = 0;
+	aac_bs_cinit(&bs, NULL, 0);
+	bs.priv = dump;
+
+	res = aac_dump_clear(dump);
+	if (res < 0)
+		goto out;
+	res = (*dump->cbs.begin_struct)(dump, "adif_header");
+	if (res < 0)
+		goto out;
+	/* The context is only needed when reading */
+	res = _aac_dump_adif_header(
+		&bs, NULL, (struct aac_adif_header *)adif);
+	if (res < 0)
+		goto out;
+	res = (*dump->cbs.end_struct)(dump, "adif_header");
+	if (res < 0)
+		goto out;
+	res = aac_dump_finish(dump);
+
+out:
+	aac_bs_clear(&bs);
+	return res;
+}
+
+
+int aac_dump_raw_data_block(struct aac_dump *dump,
+			    struct aac_ctx *ctx,
+			    const struct aac_raw_data_block *block)
+{
+	int res = 0;
+	struct aac_bitstream bs;
+	ULOG_ERRNO_RETURN_ERR_IF(dump == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(ctx == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(block == NULL, EINVAL);
+
+	dump->flags = AAC_DUMP_FLAGS_FRAME_DATA;
+	aac_bs_cinit(&bs, NULL, 0);
+	bs.priv = dump;
+
+	/* The syntax functions of the dump do not modify the block */
+	res = aac_dump_clear(dump);
+	if (res < 0)
+		goto out;
+	res = (*dump->cbs.begin_struct)(dump, "raw_data_block");
+	if (res < 0)
+		goto out;
+	res = _aac_dump_raw_data_block(
+		&bs, ctx, (struct aac_raw_data_block *)block);
+	if (res < 0)
+		goto out;
+	res = (*dump->cbs.end_struct)(dump, "raw_data_block");
+	if (res < 0)
+		goto out;
+	res = aac_dump_finish(dump);
+
+out:
+	aac_bs_clear(&bs);
+	return res;
+}
+
+
+struct aac_cbor_reader {
+	const uint8_t *buf;
+	size_t len;
+	size_t off;
+	/* Stringref namespace */
+	struct {
+		const uint8_t *str;
+		size_t len;
+	} refs[AAC_DUMP_CBOR_MAX_REFS];
+	uint32_t count;
+};
+
+
+static int aac_cbor_read_head(struct aac_cbor_reader *r,
+			      uint8_t *major,
+			      uint8_t *info,
+			      uint64_t *val)
+{
+	size_t n;
+
+	if (r->off >= r->len)
+		return -EAGAIN;
+	*major = r->buf[r->off] >> 5;
+	*info = r->buf[r->off] & 0x1f;
+	r->off++;
+
+	if (*info < 24) {
+		*val = *info;
+		return 0;
+	} else if (*info == AAC_CBOR_INDEFINITE) {
+		*val = 0;
+		return 0;
+	} else if (*info > 27) {
+		return -EPROTO;
+	}
+	n = 1 << (*info - 24);
+	if (r->len - r->off < n)
+		return -EAGAIN;
+	*val = 0;
+	for (size_t i = 0; i < n; i++)
+		*val = (*val << 8) | r->buf[r->off++];
+	return 0;
+}
+
+
+/* Map key: a text string or a reference to a previous one */
+static int aac_cbor_read_key(struct aac_cbor_reader *r,
+			     const uint8_t **key,
+			     size_t *len)
+{
+	int res;
+	uint8_t major, info;
+	uint64_t val;
+
+	res = aac_cbor_read_head(r, &major, &info, &val);
+	if (res < 0)
+		return res;
+	if (major == AAC_CBOR_MAJOR_TAG && val == AAC_CBOR_TAG_STRINGREF) {
+		res = aac_cbor_read_head(r, &major, &info, &val);
+		if (res < 0)
+			return res;
+		if (major != AAC_CBOR_MAJOR_UINT || val >= r->count)
+			return -EPROTO;
+		*key = r->refs[val].str;
+		*len = r->refs[val].len;
+		return 0;
+	}
+	if (major != AAC_CBOR_MAJOR_TEXT || info == AAC_CBOR_INDEFINITE)
+		return -EPROTO;
+	if (r->len - r->off < val)
+		return -EAGAIN;
+	*key = r->buf + r->off;
+	*len = val;
+	r->off += val;
+	if (r->count < AAC_DUMP_CBOR_MAX_REFS &&
+	    *len >= aac_cbor_stringref_min_len(r->count)) {
+		r->refs[r->count].str = *key;
+		r->refs[r->count].len = *len;
+		r->count++;
+	}
+	return 0;
+}
+
+
+/* Replay the members of a map or the items of an array as dump callbacks,
+ * up to the break */
+static int aac_cbor_replay(struct aac_dump *dump,
+			   struct aac_cbor_reader *r,
+			   int map,
+			   unsigned int depth)
+{
+	int res;
+	uint8_t major, info;
+	uint64_t val;
+	const uint8_t *key;
+	size_t len;
+	char name[256];
+
+	while (1) {
+		if (r->off >= r->len)
+			return -EAGAIN;
+		if (r->buf[r->off] == AAC_CBOR_BREAK) {
+			r->off++;
+			return 0;
+		}
+		key = NULL;
+		len = 0;
+		if (map) {
+			res = aac_cbor_read_key(r, &key, &len);
+			if (res < 0)
+				return res;
+		}
+		len = Min(len, sizeof(name) - 1);
+		if (len > 0)
+			memcpy(name, key, len);
+		name[len] = '\0';
+
+		res = aac_cbor_read_head(r, &major, &info, &val);
+		if (res < 0)
+			return res;
+		if ((major == AAC_CBOR_MAJOR_MAP ||
+		     major == AAC_CBOR_MAJOR_ARRAY) &&
+		    (info != AAC_CBOR_INDEFINITE ||
+		     depth + 1 >= AAC_DUMP_MAX_STACK_SIZE))
+			return -EPROTO;
+
+		switch (major) {
+		case AAC_CBOR_MAJOR_UINT:
+		case AAC_CBOR_MAJOR_NINT:
+			if (val > INT64_MAX)
+				return -ERANGE;
+			res = (*dump->cbs.field)(
+				dump,
+				name,
+				len,
+				(major == AAC_CBOR_MAJOR_UINT)
+					? (int64_t)val
+					: -1 - (int64_t)val);
+			break;
+
+		case AAC_CBOR_MAJOR_MAP:
+			res = map ? (*dump->cbs.begin_struct)(dump, name)
+				  : (*dump->cbs.begin_array_item)(dump);
+			if (res < 0)
+				return res;
+			res = aac_cbor_replay(dump, r, 1, depth + 1);
+			if (res < 0)
+				return res;
+			res = map ? (*dump->cbs.end_struct)(dump, name)
+				  : (*dump->cbs.end_array_item)(dump);
+			break;
+
+		case AAC_CBOR_MAJOR_ARRAY:
+			res = (*dump->cbs.begin_array)(dump, name);
+			if (res < 0)
+				return res;
+			res = aac_cbor_replay(dump, r, 0, depth + 1);
+			if (res < 0)
+				return res;
+			res = (*dump->cbs.end_array)(dump, name);
+			break;
+
+		default:
+			return -EPROTO;
+		}
+		if (res < 0)
+			return res;
+	}
+}
+
+
+int aac_dump_from_cbor(struct aac_dump *dump,
+		       const uint8_t *buf,
+		       size_t len,
+		       size_t *off)
+{
+	int res;
+	uint8_t major, info;
+	uint64_t val;
+	struct aac_cbor_reader *r;
+
+	ULOG_ERRNO_RETURN_ERR_IF(dump == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(buf == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(off == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(*off > len, EINVAL);
+	/* The keys of a CBOR dump must outlive the frame */
+	ULOG_ERRNO_RETURN_ERR_IF(dump->cfg.type == AAC_DUMP_TYPE_CBOR, EINVAL);
+
+	r = calloc(1, sizeof(*r));
+	if (r == NULL)
+		return -ENOMEM;
+	r->buf = buf;
+	r->len = len;
+	r->off = *off;
+
+	res = aac_dump_clear(dump);
+	if (res < 0)
+		goto out;
+
+	/* Stringref namespace and root map */
+	res = aac_cbor_read_head(r, &major, &info, &val);
+	if (res < 0)
+		goto out;
+	if (major != AAC_CBOR_MAJOR_TAG ||
+	    val != AAC_CBOR_TAG_STRINGREF_NAMESPACE) {
+		res = -EPROTO;
+		goto out;
+	}
+	res = aac_cbor_read_head(r, &major, &info, &val);
+	if (res < 0)
+		goto out;
+	if (major != AAC_CBOR_MAJOR_MAP || info != AAC_CBOR_INDEFINITE) {
+		res = -EPROTO;
+		goto out;
+	}
+	res = aac_cbor_replay(dump, r, 1, 1);
+	if (res < 0)
+		goto out;
+
+	if (dump->cfg.type == AAC_DUMP_TYPE_JSON_STREAM) {
+		res = aac_dump_stream_end(dump);
+		if (res < 0)
+			goto out;
+	}
+	*off = r->off;
+
+out:
+	free(r);
+	return res;
+}
@@ -0,0 +1,690 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "aac_priv.h"
+
+
+/* An SCE or CCE has one individual_channel_stream(), a CPE two */
+#define GEN_MAX_ICS (2 * (AAC_MAX_SYN_ELE - 1))
+
+
+/* Largest absolute value of the spectrum codebooks (Table 4.151) */
+static const int codebook_lav[ESC_HCB + 1] = {
+	0, 1, 1, 2, 2, 4, 4, 7, 7, 12, 12, 16};
+
+
+struct aac_gen {
+	struct aac_gen_cfg cfg;
+	struct aac_ctx *ctx;
+	/* xorshift64* state */
+	uint64_t state;
+	uint8_t window_sequence;
+	unsigned int num_swb_long;
+	unsigned int num_swb_short;
+	/* Upper bound of max_sfb for the frame being generated */
+	unsigned int max_sfb_limit;
+	/* Spectral lines of the individual_channel_streams of the frame
+	 * being generated, in bitstream order (see
+	 * aac_write_set_spectral_lines()) */
+	int16_t x_quant[GEN_MAX_ICS][AAC_MAX_SPECTRAL_LINES];
+	unsigned int ics_count;
+};
+
+
+static uint32_t gen_rand(struct aac_gen *gen)
+{
+	uint64_t x = gen->state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	gen->state = x;
+	return (x * UINT64_C(0x2545F4914F6CDD1D)) >> 32;
+}
+
+
+/* Uniform value in [min, max] */
+static int gen_rand_range(struct aac_gen *gen, int min, int max)
+{
+	return min + (int)(gen_rand(gen) % (uint32_t)(max - min + 1));
+}
+
+
+/* Window sequence of the next frame, following the allowed transitions
+ * (ONLY_LONG -> LONG_START -> EIGHT_SHORT -> LONG_STOP -> ONLY_LONG) */
+static uint8_t gen_window_sequence(struct aac_gen *gen)
+{
+	int change = gen_rand_range(gen, 0, 3) == 0;
+
+	if ((gen->cfg.flags & AAC_GEN_FLAGS_WINDOWS) == 0)
+		return ONLY_LONG_SEQUENCE;
+
+	switch (gen->window_sequence) {
+	case ONLY_LONG_SEQUENCE:
+	case LONG_STOP_SEQUENCE:
+		return change ? LONG_START_SEQUENCE : ONLY_LONG_SEQUENCE;
+	case LONG_START_SEQUENCE:
+		return EIGHT_SHORT_SEQUENCE;
+	case EIGHT_SHORT_SEQUENCE:
+	default:
+		return change ? LONG_STOP_SEQUENCE : EIGHT_SHORT_SEQUENCE;
+	}
+}
+
+
+static void gen_ics_info(struct aac_gen *gen, struct aac_ics_info *ics_info)
+{
+	unsigned int num_swb;
+
+	memset(ics_info, 0, sizeof(*ics_info));
+	ics_info->window_sequence = gen->window_sequence;
+	ics_info->window_shape = gen_rand_range(gen, 0, 1);
+	if (ics_info->window_sequence == EIGHT_SHORT_SEQUENCE) {
+		num_swb = gen->num_swb_short;
+		ics_info->scale_factor_grouping = gen_rand_range(gen, 0, 127);
+	} else {
+		num_swb = gen->num_swb_long;
+	}
+	/* Mostly full bandwidth */
+	ics_info->max_sfb = num_swb - gen_rand_range(gen, 0, num_swb / 4);
+	if (ics_info->max_sfb > gen->max_sfb_limit)
+		ics_info->max_sfb = gen->max_sfb_limit;
+}
+
+
+static void gen_section_data(struct aac_gen *gen,
+			     struct aac_individual_channel_stream *ics)
+{
+	struct aac_section_data *section_data = &ics->section_data;
+	int max_sfb = ics->ics_info.max_sfb;
+
+	for (int g = 0; g < gen->ctx->info.num_window_groups; g++) {
+		int k = 0;
+		int i = 0;
+		while (k < max_sfb) {
+			int sect_len;
+			int sect_cb;
+			switch (gen->cfg.sections) {
+			case AAC_GEN_SECTIONS_SINGLE:
+			case AAC_GEN_SECTIONS_ZERO:
+				sect_len = max_sfb - k;
+				break;
+			case AAC_GEN_SECTIONS_PER_BAND:
+				sect_len = 1;
+				break;
+			case AAC_GEN_SECTIONS_RANDOM:
+			default:
+				sect_len = gen_rand_range(gen, 1, max_sfb - k);
+				break;
+			}
+			if (gen->cfg.sections == AAC_GEN_SECTIONS_ZERO)
+				sect_cb = ZERO_HCB;
+			else if (gen->cfg.flags & AAC_GEN_FLAGS_ESCAPES)
+				sect_cb = ESC_HCB;
+			else
+				sect_cb = gen_rand_range(
+					gen, ZERO_HCB, ESC_HCB);
+			section_data->sect_cb[g][i] = sect_cb;
+			section_data->sect_start[g][i] = k;
+			section_data->sect_end[g][i] = k + sect_len;
+			for (int sfb = k; sfb < k + sect_len; sfb++)
+				section_data->sfb_cb[g][sfb] = sect_cb;
+			k += sect_len;
+			i++;
+		}
+		section_data->num_sec[g] = i;
+	}
+}
+
+
+static void gen_scale_factor_data(struct aac_gen *gen,
+				  struct aac_individual_channel_stream *ics)
+{
+	int sf = ics->global_gain;
+
+	for (int g = 0; g < gen->ctx->info.num_window_groups; g++) {
+		for (int sfb = 0; sfb < ics->ics_info.max_sfb; sfb++) {
+			if (ics->section_data.sfb_cb[g][sfb] == ZERO_HCB)
+				continue;
+			/* Keep the scale factors in the [0, 255] range */
+			int diff = gen_rand_range(gen,
+						  Max(-4, -sf),
+						  Min(4, 255 - sf));
+			sf += diff;
+			ics->scale_factor_data.dpcm_sf[g][sfb] = diff + 60;
+		}
+	}
+}
+
+
+static void gen_pulse_data(struct aac_gen *gen,
+			   struct aac_individual_channel_stream *ics)
+{
+	struct aac_pulse_data *pulse_data = &ics->pulse_data;
+
+	pulse_data->number_pulse = gen_rand_range(gen, 0, 3);
+	pulse_data->pulse_start_sfb =
+		gen_rand_range(gen, 0, ics->ics_info.max_sfb - 1);
+	for (int i = 0; i < pulse_data->number_pulse + 1; i++) {
+		pulse_data->pulse_offset[i] = gen_rand_range(gen, 0, 31);
+		pulse_data->pulse_amp[i] = gen_rand_range(gen, 0, 15);
+	}
+}
+
+
+static void gen_tns_data(struct aac_gen *gen,
+			 struct aac_individual_channel_stream *ics)
+{
+	struct aac_tns_data *tns_data = &ics->tns_data;
+	int eight_short =
+		ics->ics_info.window_sequence == EIGHT_SHORT_SEQUENCE;
+	int max_filt = eight_short ? 1 : 3;
+	int max_length = eight_short ? 15 : 63;
+	/* TNS_MAX_ORDER for AAC-LC */
+	int max_order = eight_short ? 7 : 12;
+
+	for (int w = 0; w < gen->ctx->info.num_windows; w++) {
+		tns_data->n_filt[w] = gen_rand_range(gen, 0, max_filt);
+		if (tns_data->n_filt[w] == 0)
+			continue;
+		tns_data->coef_res[w] = gen_rand_range(gen, 0, 1);
+		for (int filt = 0; filt < tns_data->n_filt[w]; filt++) {
+			tns_data->length[w][filt] =
+				gen_rand_range(gen, 1, max_length);
+			tns_data->order[w][filt] =
+				gen_rand_range(gen, 0, max_order);
+			if (tns_data->order[w][filt] == 0)
+				continue;
+			tns_data->direction[w][filt] =
+				gen_rand_range(gen, 0, 1);
+			tns_data->coef_compress[w][filt] =
+				gen_rand_range(gen, 0, 1);
+			int coef_bits = 3 + tns_data->coef_res[w] -
+					tns_data->coef_compress[w][filt];
+			for (int i = 0; i < tns_data->order[w][filt]; i++) {
+				tns_data->coef[w][filt][i] = gen_rand_range(
+					gen, 0, (1 << coef_bits) - 1);
+			}
+		}
+	}
+}
+
+
+static int16_t gen_spectral_value(struct aac_gen *gen, int cb)
+{
+	int value;
+	int escapes = (gen->cfg.flags & AAC_GEN_FLAGS_ESCAPES) != 0;
+
+	if (cb == ESC_HCB && (escapes || gen_rand_range(gen, 0, 15) == 0)) {
+		/* Escape sequence: 16 to 8191 */
+		int n = gen_rand_range(gen, 4, 12);
+		value = (1 << n) + gen_rand_range(gen, 0, (1 << n) - 1);
+		value = Min(value, 8191);
+	} else {
+		value = gen_rand_range(gen, 0, Min(codebook_lav[cb], 15));
+	}
+	return gen_rand_range(gen, 0, 1) ? -value : value;
+}
+
+
+static void gen_spectral_data(struct aac_gen *gen,
+			      struct aac_individual_channel_stream *ics,
+			      int16_t *lines)
+{
+	struct aac_scalefactor_bands_and_grouping *info = &gen->ctx->info;
+	int group_off = 0;
+
+	memset(lines, 0, AAC_MAX_SPECTRAL_LINES * sizeof(*lines));
+	for (int g = 0; g < info->num_window_groups; g++) {
+		int16_t *x_quant = &lines[group_off];
+		group_off += info->window_group_length[g] *
+			     (AAC_MAX_SPECTRAL_LINES / info->num_windows);
+		for (int i = 0; i < ics->section_data.num_sec[g]; i++) {
+			int cb = ics->section_data.sect_cb[g][i];
+			if (cb == ZERO_HCB)
+				continue;
+			for (int k = info->sect_sfb_offset
+					     [g][ics->section_data
+							 .sect_start[g][i]];
+			     k < info->sect_sfb_offset
+					 [g][ics->section_data.sect_end[g][i]];
+			     k++)
+				x_quant[k] = gen_spectral_value(gen, cb);
+		}
+	}
+}
+
+
+/* The ics_info() (and ctx->info) must be set first */
+static void gen_ics(struct aac_gen *gen,
+		    struct aac_individual_channel_stream *ics)
+{
+	ics->global_gain = gen_rand_range(gen, 100, 160);
+	gen_section_data(gen, ics);
+	gen_scale_factor_data(gen, ics);
+	if ((gen->cfg.flags & AAC_GEN_FLAGS_PULSE) != 0 &&
+	    ics->ics_info.window_sequence != EIGHT_SHORT_SEQUENCE &&
+	    ics->ics_info.max_sfb > 0) {
+		ics->pulse_data_present = 1;
+		gen_pulse_data(gen, ics);
+	}
+	if ((gen->cfg.flags & AAC_GEN_FLAGS_TNS) != 0) {
+		ics->tns_data_present = 1;
+		gen_tns_data(gen, ics);
+	}
+	gen_spectral_data(gen, ics, gen->x_quant[gen->ics_count++]);
+}
+
+
+static int gen_sce(struct aac_gen *gen,
+		   struct aac_single_channel_element *sce,
+		   unsigned int tag)
+{
+	int res;
+
+	sce->element_instance_tag = tag & 0xF;
+	gen_ics_info(gen, &sce->ics.ics_info);
+	res = aac_write_set_dec_info(gen->ctx, &sce->ics.ics_info);
+	if (res < 0)
+		return res;
+	gen_ics(gen, &sce->ics);
+	return 0;
+}
+
+
+static int gen_cpe(struct aac_gen *gen,
+		   struct aac_channel_pair_element *cpe,
+		   unsigned int tag)
+{
+	int res;
+	int ms = (gen->cfg.flags & AAC_GEN_FLAGS_MS) != 0;
+
+	cpe->element_instance_tag = tag & 0xF;
+	cpe->common_window = ms ? 1 : gen_rand_range(gen, 0, 1);
+	if (!cpe->common_window) {
+		gen_ics_info(gen, &cpe->ics1.ics_info);
+		res = aac_write_set_dec_info(gen->ctx, &cpe->ics1.ics_info);
+		if (res < 0)
+			return res;
+		gen_ics(gen, &cpe->ics1);
+		gen_ics_info(gen, &cpe->ics2.ics_info);
+		res = aac_write_set_dec_info(gen->ctx, &cpe->ics2.ics_info);
+		if (res < 0)
+			return res;
+		gen_ics(gen, &cpe->ics2);
+		return 0;
+	}
+
+	gen_ics_info(gen, &cpe->ics_info);
+	res = aac_write_set_dec_info(gen->ctx, &cpe->ics_info);
+	if (res < 0)
+		return res;
+	cpe->ics1.ics_info = cpe->ics_info;
+	cpe->ics2.ics_info = cpe->ics_info;
+	if (ms) {
+		/* 0: no M/S, 1: per band, 2: all bands */
+		cpe->ms_mask_present = gen_rand_range(gen, 0, 2);
+		for (int g = 0; g < gen->ctx->info.num_window_groups; g++) {
+			for (int sfb = 0; sfb < cpe->ics_info.max_sfb; sfb++) {
+				cpe->ms_used[g][sfb] =
+					gen_rand_range(gen, 0, 1);
+			}
+		}
+	}
+	gen_ics(gen, &cpe->ics1);
+	gen_ics(gen, &cpe->ics2);
+	return 0;
+}
+
+
+static int gen_cce(struct aac_gen *gen,
+		   struct aac_coupling_channel_element *cce,
+		   unsigned int tag)
+{
+	int res;
+	int num_gain_element_lists = 0;
+
+	cce->element_instance_tag = tag & 0xF;
+	cce->ind_sw_cce_flag = gen_rand_range(gen, 0, 1);
+	cce->num_coupled_element = gen_rand_range(gen, 0, 2);
+	for (int c = 0; c < cce->num_coupled_element + 1; c++) {
+		num_gain_element_lists++;
+		cce->cc_target_is_cpe[c] = gen_rand_range(gen, 0, 1);
+		cce->cc_target_tag_select[c] = gen_rand_range(gen, 0, 15);
+		if (cce->cc_target_is_cpe[c]) {
+			cce->cc_l[c] = gen_rand_range(gen, 0, 1);
+			cce->cc_r[c] = gen_rand_range(gen, 0, 1);
+			if (cce->cc_l[c] && cce->cc_r[c])
+				num_gain_element_lists++;
+		}
+	}
+	cce->cc_domain = gen_rand_range(gen, 0, 1);
+	cce->gain_element_sign = gen_rand_range(gen, 0, 1);
+	cce->gain_element_scale = gen_rand_range(gen, 0, 3);
+
+	gen_ics_info(gen, &cce->ics.ics_info);
+	res = aac_write_set_dec_info(gen->ctx, &cce->ics.ics_info);
+	if (res < 0)
+		return res;
+	gen_ics(gen, &cce->ics);
+
+	/* Gain elements: small differences around 0 (index 60) */
+	for (int c = 1; c < num_gain_element_lists; c++) {
+		int cge = 1;
+		if (!cce->ind_sw_cce_flag) {
+			cce->common_gain_element_present[c] =
+				gen_rand_range(gen, 0, 1);
+			cge = cce->common_gain_element_present[c];
+		}
+		if (cge) {
+			cce->common_gain_element[c] =
+				gen_rand_range(gen, 58, 62);
+			continue;
+		}
+		for (int g = 0; g < gen->ctx->info.num_window_groups; g++) {
+			for (int sfb = 0; sfb < cce->ics.ics_info.max_sfb;
+			     sfb++) {
+				cce->dpcm_gain_element[c][g][sfb] =
+					gen_rand_range(gen, 58, 62);
+			}
+		}
+	}
+	return 0;
+}
+
+
+static void gen_dse(struct aac_gen *gen,
+		    struct aac_data_stream_element *dse,
+		    unsigned int tag)
+{
+	int count = gen_rand_range(gen, 0, 300);
+
+	dse->element_instance_tag = tag & 0xF;
+	/* The data_stream_byte values are written as zeros */
+	if (count >= 255) {
+		dse->count = 255;
+		dse->esc_count = count - 255;
+	} else {
+		dse->count = count;
+	}
+}
+
+
+static void gen_pce(struct aac_gen *gen,
+		    struct aac_program_config_element *pce,
+		    unsigned int tag)
+{
+	pce->element_instance_tag = tag & 0xF;
+	pce->object_type = AAC_AOT_AAC_LC - 1;
+	pce->sampling_frequency_index = gen->cfg.sampling_frequency_index;
+	pce->num_front_channel_elements = gen_rand_range(gen, 1, 3);
+	pce->num_side_channel_elements = gen_rand_range(gen, 0, 2);
+	pce->num_back_channel_elements = gen_rand_range(gen, 0, 2);
+	pce->num_lfe_channel_elements = gen_rand_range(gen, 0, 1);
+	pce->num_assoc_data_elements = gen_rand_range(gen, 0, 1);
+	pce->num_valid_cc_elements = gen_rand_range(gen, 0, 1);
+	pce->mono_mixdown_present = gen_rand_range(gen, 0, 1);
+	pce->mono_mixdown_element_number = gen_rand_range(gen, 0, 15);
+	pce->stereo_mixdown_present = gen_rand_range(gen, 0, 1);
+	pce->stereo_mixdown_element_number = gen_rand_range(gen, 0, 15);
+	pce->matrix_mixdown_idx_present = gen_rand_range(gen, 0, 1);
+	pce->matrix_mixdown_idx = gen_rand_range(gen, 0, 3);
+	pce->pseudo_surround_enable = gen_rand_range(gen, 0, 1);
+	for (int i = 0; i < pce->num_front_channel_elements; i++) {
+		pce->front_element_is_cpe[i] = gen_rand_range(gen, 0, 1);
+		pce->front_element_tag_select[i] = i;
+	}
+	for (int i = 0; i < pce->num_side_channel_elements; i++) {
+		pce->side_element_is_cpe[i] = gen_rand_range(gen, 0, 1);
+		pce->side_element_tag_select[i] = i;
+	}
+	for (int i = 0; i < pce->num_back_channel_elements; i++) {
+		pce->back_element_is_cpe[i] = gen_rand_range(gen, 0, 1);
+		pce->back_element_tag_select[i] = i;
+	}
+	for (int i = 0; i < pce->num_lfe_channel_elements; i++)
+		pce->lfe_element_tag_select[i] = i;
+	for (int i = 0; i < pce->num_assoc_data_elements; i++)
+		pce->assoc_data_element_tag_select[i] = i;
+	for (int i = 0; i < pce->num_valid_cc_elements; i++) {
+		pce->cc_element_is_ind_sw[i] = gen_rand_range(gen, 0, 1);
+		pce->valid_cc_element_tag_select[i] = i;
+	}
+	pce->comment_field_bytes = gen_rand_range(gen, 0, 16);
+	for (int i = 0; i < pce->comment_field_bytes; i++)
+		pce->comment_field_data[i] = gen_rand_range(gen, 0x20, 0x7E);
+}
+
+
+static int gen_raw_data_block(struct aac_gen *gen,
+			      struct aac_raw_data_block *block)
+{
+	int res;
+	size_t i = 0;
+	struct aac_syntactic_element *element;
+
+	memset(block, 0, sizeof(*block));
+	gen->ics_count = 0;
+
+	/* Element order: PCE, SCE, CPE, CCE, DSE, FIL, END */
+	for (unsigned int n = 0; n < gen->cfg.pce_count; n++) {
+		element = &block->elements[i++];
+		element->id_syn_ele = AAC_SYN_ELE_ID_PCE;
+		gen_pce(gen, &element->pce, n);
+	}
+	for (unsigned int n = 0; n < gen->cfg.sce_count; n++) {
+		element = &block->elements[i++];
+		element->id_syn_ele = AAC_SYN_ELE_ID_SCE;
+		res = gen_sce(gen, &element->sce, n);
+		if (res < 0)
+			return res;
+	}
+	for (unsigned int n = 0; n < gen->cfg.cpe_count; n++) {
+		element = &block->elements[i++];
+		element->id_syn_ele = AAC_SYN_ELE_ID_CPE;
+		res = gen_cpe(gen, &element->cpe, n);
+		if (res < 0)
+			return res;
+	}
+	for (unsigned int n = 0; n < gen->cfg.cce_count; n++) {
+		element = &block->elements[i++];
+		element->id_syn_ele = AAC_SYN_ELE_ID_CCE;
+		res = gen_cce(gen, &element->cce, n);
+		if (res < 0)
+			return res;
+	}
+	for (unsigned int n = 0; n < gen->cfg.dse_count; n++) {
+		element = &block->elements[i++];
+		element->id_syn_ele = AAC_SYN_ELE_ID_DSE;
+		gen_dse(gen, &element->dse, n);
+	}
+	for (unsigned int n = 0; n < gen->cfg.fil_count; n++) {
+		element = &block->elements[i++];
+		element->id_syn_ele = AAC_SYN_ELE_ID_FIL;
+		element->fil.extension_payload.extension_type =
+			AAC_EXT_TYPE_FILL;
+		element->fil.count = gen_rand_range(gen, 0, 269);
+	}
+	block->elements[i].id_syn_ele = AAC_SYN_ELE_ID_END;
+	block->elements_count = i + 1;
+
+	return 0;
+}
+
+
+/* Channel configuration matching the SCE/CPE counts (Table 1.19) */
+static uint8_t gen_channel_configuration(const struct aac_gen_cfg *cfg)
+{
+	static const struct {
+		unsigned int sce_count;
+		unsigned int cpe_count;
+	} configurations[] = {
+		{0, 0},
+		{1, 0},
+		{0, 1},
+		{1, 1},
+		{2, 1},
+		{1, 2},
+	};
+
+	if (cfg->pce_count > 0)
+		return 0;
+	for (size_t i = 1; i < ARRAY_SIZE(configurations); i++) {
+		if (configurations[i].sce_count == cfg->sce_count &&
+		    configurations[i].cpe_count == cfg->cpe_count)
+			return i;
+	}
+	return 0;
+}
+
+
+int aac_gen_new(const struct aac_gen_cfg *cfg, struct aac_gen **ret_obj)
+{
+	int res;
+	struct aac_gen *gen = NULL;
+	unsigned int count;
+	uint64_t z;
+
+	ULOG_ERRNO_RETURN_ERR_IF(cfg == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(ret_obj == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(
+		cfg->data_format != ADEF_AAC_DATA_FORMAT_ADTS &&
+			cfg->data_format != ADEF_AAC_DATA_FORMAT_RAW,
+		EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(
+		aac_write_get_num_swb(cfg->sampling_frequency_index, 1) == 0,
+		EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(cfg->sections > AAC_GEN_SECTIONS_ZERO,
+				 EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(cfg->sce_count + cfg->cpe_count == 0,
+				 EINVAL);
+	count = cfg->sce_count + cfg->cpe_count + cfg->cce_count +
+		cfg->dse_count + cfg->pce_count + cfg->fil_count;
+	ULOG_ERRNO_RETURN_ERR_IF(count > AAC_MAX_SYN_ELE - 1, EINVAL);
+
+	gen = calloc(1, sizeof(*gen));
+	if (gen == NULL)
+		return -ENOMEM;
+	gen->cfg = *cfg;
+	gen->num_swb_long =
+		aac_write_get_num_swb(cfg->sampling_frequency_index, 0);
+	gen->num_swb_short =
+		aac_write_get_num_swb(cfg->sampling_frequency_index, 1);
+
+	/* splitmix64 of the seed (xorshift needs a non-zero state) */
+	z = cfg->seed + UINT64_C(0x9E3779B97F4A7C15);
+	z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+	gen->state = (z ^ (z >> 31)) | 1;
+
+	res = aac_ctx_new(&gen->ctx);
+	if (res < 0)
+		goto error;
+
+	if (cfg->data_format == ADEF_AAC_DATA_FORMAT_ADTS) {
+		struct aac_adts adts = {
+			.syncword = 0xFFF,
+			.protection_absent = 1,
+			.profile_ObjectType = AAC_AOT_AAC_LC - 1,
+			.sampling_frequency_index =
+				cfg->sampling_frequency_index,
+			.channel_configuration =
+				gen_channel_configuration(cfg),
+			.adts_buffer_fullness = 0x7FF, /* VBR */
+		};
+		res = aac_ctx_set_adts(gen->ctx, &adts);
+	} else {
+		struct aac_asc asc = {
+			.audioObjectType = AAC_AOT_AAC_LC,
+			.samplingFrequencyIndex = cfg->sampling_frequency_index,
+			.channelConfiguration = gen_channel_configuration(cfg),
+		};
+		res = aac_ctx_set_asc(gen->ctx, &asc);
+	}
+	if (res < 0)
+		goto error;
+
+	*ret_obj = gen;
+	return 0;
+
+error:
+	aac_gen_destroy(gen);
+	return res;
+}
+
+
+int aac_gen_destroy(struct aac_gen *gen)
+{
+	if (gen == NULL)
+		return 0;
+	aac_ctx_destroy(gen->ctx);
+	free(gen);
+	return 0;
+}
+
+
+int aac_gen_get_asc(struct aac_gen *gen, struct aac_asc *asc)
+{
+	ULOG_ERRNO_RETURN_ERR_IF(gen == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(asc == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(
+		gen->cfg.data_format != ADEF_AAC_DATA_FORMAT_RAW, EINVAL);
+
+	*asc = gen->ctx->asc;
+	return 0;
+}
+
+
+int aac_gen_write_frame(struct aac_gen *gen, struct aac_bitstream *bs)
+{
+	int res;
+	struct aac_raw_data_block *block;
+
+	ULOG_ERRNO_RETURN_ERR_IF(gen == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(bs == NULL, EINVAL);
+
+	block = aac_write_get_block(gen->ctx);
+	gen->window_sequence = gen_window_sequence(gen);
+	gen->max_sfb_limit = AAC_MAX_SFB;
+	do {
+		res = gen_raw_data_block(gen, block);
+		if (res < 0)
+			break;
+		aac_write_set_spectral_lines(
+			gen->ctx, gen->x_quant, gen->ics_count);
+		res = aac_write_block(bs, gen->ctx);
+		/* ADTS frames are limited to 8191 bytes: retry with less
+		 * bands (eg. escape-heavy spectra with several channels) */
+		if (res == -E2BIG && gen->max_sfb_limit > 0)
+			gen->max_sfb_limit /= 2;
+		else
+			break;
+	} while (1);
+
+	if (res < 0)
+		ULOG_ERRNO("aac_write_block", -res);
+	return res;
+}
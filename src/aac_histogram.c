@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "aac_priv.h"
+
+
+/* Bucket index of a value: values below 2 * AAC_HISTOGRAM_SUB_COUNT have
+ * their own bucket, then each power of 2 is split in AAC_HISTOGRAM_SUB_COUNT
+ * linear buckets */
+static unsigned int bucket_index(uint64_t value)
+{
+	unsigned int msb;
+	unsigned int shift;
+
+	if (value < 2 * AAC_HISTOGRAM_SUB_COUNT)
+		return value;
+	if (value >= UINT64_C(1) << AAC_HISTOGRAM_MAX_BITS)
+		value = (UINT64_C(1) << AAC_HISTOGRAM_MAX_BITS) - 1;
+	msb = 63 - __builtin_clzll(value);
+	shift = msb - AAC_HISTOGRAM_SUB_BITS;
+	return ((shift + 1) << AAC_HISTOGRAM_SUB_BITS) +
+	       (value >> shift) - AAC_HISTOGRAM_SUB_COUNT;
+}
+
+
+/* Highest value of a bucket */
+static uint64_t bucket_value(unsigned int index)
+{
+	unsigned int shift;
+	uint64_t sub;
+
+	if (index < 2 * AAC_HISTOGRAM_SUB_COUNT)
+		return index;
+	shift = (index >> AAC_HISTOGRAM_SUB_BITS) - 1;
+	sub = (index & (AAC_HISTOGRAM_SUB_COUNT - 1)) + AAC_HISTOGRAM_SUB_COUNT;
+	return ((sub + 1) << shift) - 1;
+}
+
+
+void aac_histogram_record(struct aac_histogram *hist, uint64_t value)
+{
+	hist->buckets[bucket_index(value)]++;
+	if (hist->count == 0 || value < hist->min)
+		hist->min = value;
+	if (value > hist->max)
+		hist->max = value;
+	hist->sum += value;
+	hist->count++;
+}
+
+
+void aac_histogram_merge(struct aac_histogram *dst,
+			 const struct aac_histogram *src)
+{
+	if (src->count == 0)
+		return;
+	for (unsigned int i = 0; i < AAC_HISTOGRAM_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+	if (dst->count == 0 || src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+	dst->sum += src->sum;
+	dst->count += src->count;
+}
+
+
+uint64_t aac_histogram_percentile(const struct aac_histogram *hist,
+				  double percentile)
+{
+	double pos;
+	uint64_t rank;
+	uint64_t n = 0;
+
+	if (hist->count == 0)
+		return 0;
+	/* Rank of the value (1-based), rounded up */
+	pos = percentile / 100. * hist->count;
+	rank = (uint64_t)pos;
+	if (rank < pos)
+		rank++;
+	if (rank < 1)
+		rank = 1;
+	for (unsigned int i = 0; i < AAC_HISTOGRAM_BUCKETS; i++) {
+		n += hist->buckets[i];
+		if (n < rank)
+			continue;
+		/* The last bucket holds the clamped values */
+		if (i == AAC_HISTOGRAM_BUCKETS - 1)
+			return hist->max;
+		return Min(bucket_value(i), hist->max);
+	}
+	return hist->max;
+}
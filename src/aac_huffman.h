@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _AAC_HUFFMAN_H_
+#define _AAC_HUFFMAN_H_
+
+#include <aac/aac.h>
+
+
+/* Huffman decoding internals, not part of the API: they are only linked
+ * in the static build of the library (libaac-internal), for the
+ * micro-benchmark and the tests. The bitstream must not belong to a
+ * reader (bs->priv NULL). */
+
+
+/* Read a scale factor Huffman codeword (Table 4.A.1); returns the decoded
+ * index (the scale factor difference + 60) */
+int aac_bs_read_huffman_sf(struct aac_bitstream *bs);
+
+
+/* Read a spectral Huffman codeword (Tables 4.A.2 to 4.A.12) and its sign
+ * bits into values (w, x, y and z; w and x are 0 for the 2-dimensional
+ * codebooks); the escape sequences of codebook 11 are not read */
+int aac_bs_read_huffman_spectral(struct aac_bitstream *bs,
+				 unsigned int cb,
+				 int values[4]);
+
+
+#endif /* !_AAC_HUFFMAN_H_ */
@@ -0,0 +1,526 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "aac_priv.h"
+
+
+#define BOX_TYPE(a, b, c, d)                                                   \
+	(((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) |                       \
+	 ((uint32_t)(c) << 8) | (uint32_t)(d))
+
+#define BOX_MOOV BOX_TYPE('m', 'o', 'o', 'v')
+#define BOX_MVEX BOX_TYPE('m', 'v', 'e', 'x')
+#define BOX_MOOF BOX_TYPE('m', 'o', 'o', 'f')
+#define BOX_TRAK BOX_TYPE('t', 'r', 'a', 'k')
+#define BOX_MDIA BOX_TYPE('m', 'd', 'i', 'a')
+#define BOX_HDLR BOX_TYPE('h', 'd', 'l', 'r')
+#define BOX_MINF BOX_TYPE('m', 'i', 'n', 'f')
+#define BOX_STBL BOX_TYPE('s', 't', 'b', 'l')
+#define BOX_STSD BOX_TYPE('s', 't', 's', 'd')
+#define BOX_STSZ BOX_TYPE('s', 't', 's', 'z')
+#define BOX_STSC BOX_TYPE('s', 't', 's', 'c')
+#define BOX_STCO BOX_TYPE('s', 't', 'c', 'o')
+#define BOX_CO64 BOX_TYPE('c', 'o', '6', '4')
+#define BOX_MP4A BOX_TYPE('m', 'p', '4', 'a')
+#define BOX_WAVE BOX_TYPE('w', 'a', 'v', 'e')
+#define BOX_ESDS BOX_TYPE('e', 's', 'd', 's')
+#define HANDLER_SOUN BOX_TYPE('s', 'o', 'u', 'n')
+
+/* ISO/IEC 14496-1 descriptor tags */
+#define ES_DESCR_TAG 0x03
+#define DECODER_CONFIG_DESCR_TAG 0x04
+#define DEC_SPECIFIC_INFO_TAG 0x05
+
+/* Size of a full box version and flags */
+#define FULL_BOX_SIZE 4
+
+/* Size of the AudioSampleEntry fields before its boxes; QuickTime sound
+ * sample description versions 1 and 2 have more fields */
+#define AUDIO_SAMPLE_ENTRY_SIZE 28
+#define AUDIO_SAMPLE_ENTRY_V1_SIZE (AUDIO_SAMPLE_ENTRY_SIZE + 16)
+#define AUDIO_SAMPLE_ENTRY_V2_SIZE (AUDIO_SAMPLE_ENTRY_SIZE + 36)
+
+
+struct box {
+	uint32_t type;
+	/* Payload (after the header) */
+	const uint8_t *data;
+	size_t size;
+};
+
+
+struct aac_mp4 {
+	const uint8_t *buf;
+	size_t len;
+
+	const uint8_t *asc;
+	size_t asc_len;
+
+	/* Sample tables (in the file buffer) */
+	uint32_t sample_size;
+	uint32_t sample_count;
+	const uint8_t *sample_sizes;
+	uint32_t stsc_count;
+	const uint8_t *stsc;
+	uint32_t chunk_count;
+	const uint8_t *chunk_offsets;
+	int co64;
+
+	/* Iteration */
+	uint32_t sample;
+	uint32_t next_chunk;
+	uint32_t stsc_index;
+	uint32_t chunk_samples_left;
+	uint64_t offset;
+};
+
+
+static inline uint32_t read_u32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+	       ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+
+static inline uint64_t read_u64(const uint8_t *p)
+{
+	return ((uint64_t)read_u32(p) << 32) | read_u32(p + 4);
+}
+
+
+/* Get the box at *off in a buffer and move past it; returns -ENOENT at the
+ * end of the buffer */
+static int
+box_next(const uint8_t *buf, size_t len, size_t *off, struct box *box)
+{
+	size_t header = 8;
+	uint64_t size;
+
+	if (*off == len)
+		return -ENOENT;
+	if (len - *off < header)
+		return -EPROTO;
+	size = read_u32(buf + *off);
+	box->type = read_u32(buf + *off + 4);
+	if (size == 1) {
+		/* 64-bit largesize */
+		header += 8;
+		if (len - *off < header)
+			return -EPROTO;
+		size = read_u64(buf + *off + 8);
+	} else if (size == 0) {
+		/* Up to the end of the file */
+		size = len - *off;
+	}
+	if (size < header || size > len - *off)
+		return -EPROTO;
+	box->data = buf + *off + header;
+	box->size = size - header;
+	*off += size;
+	return 0;
+}
+
+
+/* Find the first child box of a given type */
+static int
+box_find(const uint8_t *buf, size_t len, uint32_t type, struct box *box)
+{
+	int res;
+	size_t off = 0;
+
+	do {
+		res = box_next(buf, len, &off, box);
+	} while (res == 0 && box->type != type);
+	return res;
+}
+
+
+/* Read an expandable descriptor size (ISO/IEC 14496-1 8.3.3) */
+static int descr_size(const uint8_t *buf, size_t len, size_t *off, size_t *size)
+{
+	*size = 0;
+	for (int i = 0; i < 4; i++) {
+		if (*off >= len)
+			return -EPROTO;
+		*size = (*size << 7) | (buf[*off] & 0x7F);
+		if ((buf[(*off)++] & 0x80) == 0)
+			return (*size <= len - *off) ? 0 : -EPROTO;
+	}
+	return -EPROTO;
+}
+
+
+/* Get the DecoderSpecificInfo of an 'esds' box */
+static int parse_esds(struct aac_mp4 *mp4, const struct box *esds)
+{
+	int res;
+	const uint8_t *buf = esds->data;
+	size_t len = esds->size, off = FULL_BOX_SIZE, size;
+	uint8_t flags, oti;
+
+	/* ES_Descriptor */
+	if (len < off + 1 || buf[off++] != ES_DESCR_TAG)
+		goto invalid;
+	res = descr_size(buf, len, &off, &size);
+	if (res < 0 || size < 3)
+		goto invalid;
+	len = off + size;
+	/* ES_ID */
+	off += 2;
+	flags = buf[off++];
+	if (flags & 0x80) {
+		/* dependsOn_ES_ID */
+		off += 2;
+	}
+	if ((flags & 0x40) && off < len) {
+		/* URLstring */
+		off += 1 + buf[off];
+	}
+	if (flags & 0x20) {
+		/* OCR_ES_Id */
+		off += 2;
+	}
+
+	/* DecoderConfigDescriptor */
+	if (len < off + 1 || buf[off++] != DECODER_CONFIG_DESCR_TAG)
+		goto invalid;
+	res = descr_size(buf, len, &off, &size);
+	if (res < 0 || size < 13)
+		goto invalid;
+	len = off + size;
+	/* MPEG-4 audio or MPEG-2 AAC (main, LC, SSR) */
+	oti = buf[off];
+	if (oti != 0x40 && (oti < 0x66 || oti > 0x68)) {
+		ULOG_ERRNO("unsupported objectTypeIndication 0x%02x",
+			   ENOSYS,
+			   oti);
+		return -ENOSYS;
+	}
+	off += 13;
+
+	/* DecoderSpecificInfo */
+	if (len < off + 1 || buf[off++] != DEC_SPECIFIC_INFO_TAG)
+		goto invalid;
+	res = descr_size(buf, len, &off, &size);
+	if (res < 0 || size == 0)
+		goto invalid;
+	mp4->asc = buf + off;
+	mp4->asc_len = size;
+	return 0;
+
+invalid:
+	ULOG_ERRNO("invalid esds box", EPROTO);
+	return -EPROTO;
+}
+
+
+/* Get the 'esds' box of the first sample entry of an 'stsd' box; returns
+ * -ENOENT if it is not an 'mp4a' entry */
+static int parse_stsd(struct aac_mp4 *mp4, const struct box *stsd)
+{
+	int res;
+	size_t off = FULL_BOX_SIZE + 4, skip;
+	struct box entry, esds, wave;
+
+	if (stsd->size < off || read_u32(stsd->data + FULL_BOX_SIZE) == 0)
+		return -EPROTO;
+	res = box_next(stsd->data, stsd->size, &off, &entry);
+	if (res < 0)
+		return -EPROTO;
+	if (entry.type != BOX_MP4A)
+		return -ENOENT;
+
+	if (entry.size < AUDIO_SAMPLE_ENTRY_SIZE)
+		return -EPROTO;
+	/* Sound sample description version (QuickTime) */
+	switch ((entry.data[8] << 8) | entry.data[9]) {
+	case 0:
+		skip = AUDIO_SAMPLE_ENTRY_SIZE;
+		break;
+	case 1:
+		skip = AUDIO_SAMPLE_ENTRY_V1_SIZE;
+		break;
+	case 2:
+		skip = AUDIO_SAMPLE_ENTRY_V2_SIZE;
+		break;
+	default:
+		return -ENOSYS;
+	}
+	if (entry.size < skip)
+		return -EPROTO;
+
+	/* The 'esds' box can be in a 'wave' box (QuickTime) */
+	res = box_find(entry.data + skip, entry.size - skip, BOX_ESDS, &esds);
+	if (res == -ENOENT) {
+		res = box_find(
+			entry.data + skip, entry.size - skip, BOX_WAVE, &wave);
+		if (res == 0)
+			res = box_find(wave.data, wave.size, BOX_ESDS, &esds);
+	}
+	if (res < 0)
+		return res;
+	return parse_esds(mp4, &esds);
+}
+
+
+static int parse_stbl(struct aac_mp4 *mp4, const struct box *stbl)
+{
+	int res;
+	struct box box;
+	uint64_t entry_size;
+
+	/* Sample sizes */
+	res = box_find(stbl->data, stbl->size, BOX_STSZ, &box);
+	if (res < 0)
+		goto invalid;
+	if (box.size < FULL_BOX_SIZE + 8)
+		goto invalid;
+	mp4->sample_size = read_u32(box.data + FULL_BOX_SIZE);
+	mp4->sample_count = read_u32(box.data + FULL_BOX_SIZE + 4);
+	if (mp4->sample_size == 0) {
+		mp4->sample_sizes = box.data + FULL_BOX_SIZE + 8;
+		if ((uint64_t)mp4->sample_count * 4 >
+		    box.size - FULL_BOX_SIZE - 8)
+			goto invalid;
+	}
+
+	/* Sample to chunk, the first entry is the first chunk */
+	res = box_find(stbl->data, stbl->size, BOX_STSC, &box);
+	if (res < 0)
+		goto invalid;
+	if (box.size < FULL_BOX_SIZE + 4)
+		goto invalid;
+	mp4->stsc_count = read_u32(box.data + FULL_BOX_SIZE);
+	mp4->stsc = box.data + FULL_BOX_SIZE + 4;
+	if ((uint64_t)mp4->stsc_count * 12 > box.size - FULL_BOX_SIZE - 4)
+		goto invalid;
+	if (mp4->sample_count > 0 &&
+	    (mp4->stsc_count == 0 || read_u32(mp4->stsc) != 1))
+		goto invalid;
+
+	/* Chunk offsets */
+	res = box_find(stbl->data, stbl->size, BOX_STCO, &box);
+	if (res == -ENOENT) {
+		res = box_find(stbl->data, stbl->size, BOX_CO64, &box);
+		mp4->co64 = 1;
+	}
+	if (res < 0)
+		goto invalid;
+	if (box.size < FULL_BOX_SIZE + 4)
+		goto invalid;
+	mp4->chunk_count = read_u32(box.data + FULL_BOX_SIZE);
+	mp4->chunk_offsets = box.data + FULL_BOX_SIZE + 4;
+	entry_size = mp4->co64 ? 8 : 4;
+	if (mp4->chunk_count * entry_size > box.size - FULL_BOX_SIZE - 4)
+		goto invalid;
+
+	return 0;
+
+invalid:
+	ULOG_ERRNO("invalid sample tables", EPROTO);
+	return -EPROTO;
+}
+
+
+/* Returns -ENOENT if the track is not an AAC audio track */
+static int parse_trak(struct aac_mp4 *mp4, const struct box *trak)
+{
+	int res;
+	struct box mdia, hdlr, minf, stbl, stsd;
+
+	res = box_find(trak->data, trak->size, BOX_MDIA, &mdia);
+	if (res < 0)
+		return res;
+	res = box_find(mdia.data, mdia.size, BOX_HDLR, &hdlr);
+	if (res < 0)
+		return res;
+	/* Version and flags, pre_defined, handler_type */
+	if (hdlr.size < FULL_BOX_SIZE + 8 ||
+	    read_u32(hdlr.data + FULL_BOX_SIZE + 4) != HANDLER_SOUN)
+		return -ENOENT;
+	res = box_find(mdia.data, mdia.size, BOX_MINF, &minf);
+	if (res < 0)
+		return res;
+	res = box_find(minf.data, minf.size, BOX_STBL, &stbl);
+	if (res < 0)
+		return res;
+	res = box_find(stbl.data, stbl.size, BOX_STSD, &stsd);
+	if (res < 0)
+		return res;
+	res = parse_stsd(mp4, &stsd);
+	if (res < 0)
+		return res;
+	return parse_stbl(mp4, &stbl);
+}
+
+
+int aac_mp4_new(const uint8_t *buf, size_t len, struct aac_mp4 **ret_obj)
+{
+	int res;
+	size_t off = 0;
+	struct aac_mp4 *mp4;
+	struct box moov, trak, box;
+
+	ULOG_ERRNO_RETURN_ERR_IF(buf == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(ret_obj == NULL, EINVAL);
+
+	mp4 = calloc(1, sizeof(*mp4));
+	if (mp4 == NULL)
+		return -ENOMEM;
+	mp4->buf = buf;
+	mp4->len = len;
+
+	res = box_find(buf, len, BOX_MOOV, &moov);
+	if (res < 0) {
+		res = -EPROTO;
+		ULOG_ERRNO("no moov box", -res);
+		goto error;
+	}
+
+	/* The sample tables of fragmented files are empty, the samples are
+	 * described in the movie fragments */
+	if (box_find(moov.data, moov.size, BOX_MVEX, &box) == 0 ||
+	    box_find(buf, len, BOX_MOOF, &box) == 0) {
+		res = -ENOSYS;
+		ULOG_ERRNO("fragmented files are not supported", -res);
+		goto error;
+	}
+
+	/* First AAC audio track */
+	do {
+		res = box_next(moov.data, moov.size, &off, &trak);
+		if (res == -ENOENT) {
+			ULOG_ERRNO("no AAC audio track", -res);
+			goto error;
+		} else if (res < 0) {
+			ULOG_ERRNO("invalid moov box", -res);
+			goto error;
+		}
+		if (trak.type != BOX_TRAK)
+			continue;
+		res = parse_trak(mp4, &trak);
+	} while (trak.type != BOX_TRAK || res == -ENOENT);
+	if (res < 0)
+		goto error;
+
+	*ret_obj = mp4;
+	return 0;
+
+error:
+	free(mp4);
+	return res;
+}
+
+
+int aac_mp4_destroy(struct aac_mp4 *mp4)
+{
+	free(mp4);
+	return 0;
+}
+
+
+int aac_mp4_get_asc(struct aac_mp4 *mp4, const uint8_t **asc, size_t *len)
+{
+	ULOG_ERRNO_RETURN_ERR_IF(mp4 == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(asc == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(len == NULL, EINVAL);
+
+	*asc = mp4->asc;
+	*len = mp4->asc_len;
+	return 0;
+}
+
+
+uint32_t aac_mp4_get_sample_count(struct aac_mp4 *mp4)
+{
+	ULOG_ERRNO_RETURN_VAL_IF(mp4 == NULL, EINVAL, 0);
+
+	return mp4->sample_count;
+}
+
+
+int aac_mp4_next_sample(struct aac_mp4 *mp4, struct aac_mp4_sample *sample)
+{
+	uint32_t size, chunk;
+
+	ULOG_ERRNO_RETURN_ERR_IF(mp4 == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(sample == NULL, EINVAL);
+
+	if (mp4->sample >= mp4->sample_count)
+		return -ENOENT;
+
+	/* Move to the next non-empty chunk; the stsc first_chunk values
+	 * start at 1 */
+	while (mp4->chunk_samples_left == 0) {
+		chunk = mp4->next_chunk++;
+		if (chunk >= mp4->chunk_count) {
+			ULOG_ERRNO("sample #%u: no chunk", EPROTO, mp4->sample);
+			return -EPROTO;
+		}
+		while (mp4->stsc_index + 1 < mp4->stsc_count &&
+		       read_u32(mp4->stsc + (mp4->stsc_index + 1) * 12) <=
+			       chunk + 1)
+			mp4->stsc_index++;
+		mp4->chunk_samples_left =
+			read_u32(mp4->stsc + mp4->stsc_index * 12 + 4);
+		if (mp4->co64)
+			mp4->offset = read_u64(mp4->chunk_offsets + chunk * 8);
+		else
+			mp4->offset = read_u32(mp4->chunk_offsets + chunk * 4);
+	}
+
+	size = mp4->sample_size > 0
+		       ? mp4->sample_size
+		       : read_u32(mp4->sample_sizes + mp4->sample * 4);
+	if (mp4->offset > mp4->len || size > mp4->len - mp4->offset) {
+		ULOG_ERRNO("sample #%u: past the end of the file",
+			   EPROTO,
+			   mp4->sample);
+		return -EPROTO;
+	}
+
+	sample->index = mp4->sample;
+	sample->offset = mp4->offset;
+	sample->data = mp4->buf + mp4->offset;
+	sample->size = size;
+	mp4->sample++;
+	mp4->chunk_samples_left--;
+	mp4->offset += size;
+	return 0;
+}
+
+
+int aac_mp4_rewind(struct aac_mp4 *mp4)
+{
+	ULOG_ERRNO_RETURN_ERR_IF(mp4 == NULL, EINVAL);
+
+	mp4->sample = 0;
+	mp4->next_chunk = 0;
+	mp4->stsc_index = 0;
+	mp4->chunk_samples_left = 0;
+	mp4->offset = 0;
+	return 0;
+}
@@ -57,6 +57,12 @@
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 
 
+/* Quantized spectral lines of an individual_channel_stream(); with short
+ * windows the lines of each window group follow the ones of the previous
+ * group */
+#define AAC_MAX_SPECTRAL_LINES 1024
+
+
 /**
  * Table 1.18 – Sampling Frequency Index
  */
@@ -108,16 +114,164 @@ static const uint8_t channel_configuration_table[16] = {
 
 struct aac_ctx {
 	enum adef_aac_data_format data_format;
+	enum aac_transport transport;
 	struct aac_scalefactor_bands_and_grouping info;
 	union {
 		struct aac_adts adts;
 		struct aac_asc asc;
 	};
+	/* LOAS only: cached StreamMuxConfig; smc_valid is set once a
+	 * StreamMuxConfig has been read (or set), smc_sent once it has been
+	 * written (subsequent frames then use useSameStreamMux) */
+	struct aac_StreamMuxConfig smc;
+	int smc_valid;
+	int smc_sent;
+	/* ADIF only: header, adif_valid is set once it has been read */
+	struct aac_adif_header adif;
+	int adif_valid;
 	union {
 		struct aac_adts_frame adts_frame;
 		struct aac_raw_data_block raw_data_block;
+		struct aac_loas_frame loas_frame;
 	};
+	struct aac_field_offsets field_offsets;
+	/* Reader only: size in bits of the elements of the raw_data_blocks
+	 * of the last frame (id_syn_ele included), raw_data_block_count
+	 * being the number of blocks read so far in the frame */
+	uint32_t element_bits[AAC_MAX_RAW_DATA_BLOCKS][AAC_MAX_SYN_ELE];
+	unsigned int raw_data_block_count;
+	/* Writer only: spectral lines taken from x_quant_write (owned by the
+	 * stream generator, zero if NULL), one array per
+	 * individual_channel_stream() in bitstream order; when reading, the
+	 * lines are decoded and not kept */
+	int16_t (*x_quant_write)[AAC_MAX_SPECTRAL_LINES];
+	unsigned int x_quant_count;
+	unsigned int x_quant_index;
+	/* Cumulated duration of the parsed frames (see aac_ctx_get_timing()) */
+	uint64_t position;
+	/* Bit accounting: bits are added to bit_stats_id from bit_stats_off
+	 * (in bits) up to the next mark */
+	struct aac_bit_stats bit_stats;
+	enum aac_bit_stats_id bit_stats_id;
+	size_t bit_stats_off;
+};
+
+
+static inline void aac_field_offsets_add(struct aac_field_offsets *offsets,
+					 enum aac_field_id id,
+					 size_t bit_offset,
+					 uint32_t bits)
+{
+	struct aac_field_offset *field;
+
+	if (offsets->count >= AAC_MAX_FIELD_OFFSETS)
+		return;
+	field = &offsets->fields[offsets->count++];
+	field->id = id;
+	field->bits = bits;
+	field->bit_offset = bit_offset;
+}
+
+
+/* Close the current bit accounting segment and open a new one */
+static inline void aac_bit_stats_mark(struct aac_ctx *ctx,
+				      enum aac_bit_stats_id id,
+				      size_t bit_off)
+{
+	ctx->bit_stats.frame[ctx->bit_stats_id] +=
+		bit_off - ctx->bit_stats_off;
+	ctx->bit_stats_id = id;
+	ctx->bit_stats_off = bit_off;
+}
+
+
+/* Trace ring buffer; count is the total number of recorded events, the
+ * ring size must be a power of 2 */
+struct aac_trace {
+	struct aac_trace_event events[AAC_TRACE_MAX_EVENTS];
+	uint32_t count;
+};
+
+
+static inline void aac_trace_push(struct aac_trace *trace,
+				  enum aac_trace_type type,
+				  uint8_t id,
+				  int err,
+				  size_t bit_off,
+				  const char *func)
+{
+	struct aac_trace_event *event =
+		&trace->events[trace->count++ & (AAC_TRACE_MAX_EVENTS - 1)];
+
+	event->func = func;
+	event->bit_off = bit_off;
+	event->type = type;
+	event->id = id;
+	event->err = err;
+}
+
+
+
+/* Log-linear (HDR-style) histogram: values below 2 * AAC_HISTOGRAM_SUB_COUNT
+ * are exact, above each power of 2 is split in AAC_HISTOGRAM_SUB_COUNT
+ * buckets (6% precision); values are clamped to 2^AAC_HISTOGRAM_MAX_BITS */
+#define AAC_HISTOGRAM_SUB_BITS 4
+#define AAC_HISTOGRAM_SUB_COUNT (1 << AAC_HISTOGRAM_SUB_BITS)
+#define AAC_HISTOGRAM_MAX_BITS 44
+#define AAC_HISTOGRAM_BUCKETS                                                  \
+	((AAC_HISTOGRAM_MAX_BITS - AAC_HISTOGRAM_SUB_BITS + 1)                 \
+	 << AAC_HISTOGRAM_SUB_BITS)
+
+
+struct aac_histogram {
+	uint64_t buckets[AAC_HISTOGRAM_BUCKETS];
+	uint64_t count;
+	uint64_t min;
+	uint64_t max;
+	uint64_t sum;
 };
 
 
+void aac_histogram_record(struct aac_histogram *hist, uint64_t value);
+
+
+void aac_histogram_merge(struct aac_histogram *dst,
+			 const struct aac_histogram *src);
+
+
+/* Highest value of the bucket holding the given percentile (0-100) */
+uint64_t aac_histogram_percentile(const struct aac_histogram *hist,
+				  double percentile);
+
+
+/* Writer internals used by the stream generator (see aac_writer.c) */
+
+/* Raw data block written by aac_write_block() (NULL if the data format of
+ * the context is unknown) */
+struct aac_raw_data_block *aac_write_get_block(struct aac_ctx *ctx);
+
+
+/* Write the raw data block of the context as a frame of its data format; in
+ * ADTS the frame length is computed (-E2BIG if it does not fit) */
+int aac_write_block(struct aac_bitstream *bs, struct aac_ctx *ctx);
+
+
+/* Set the spectral lines of the individual_channel_streams of the raw data
+ * blocks written next (see struct aac_ctx) */
+void aac_write_set_spectral_lines(
+	struct aac_ctx *ctx,
+	int16_t (*x_quant)[AAC_MAX_SPECTRAL_LINES],
+	unsigned int count);
+
+
+/* Set the window grouping and band offsets (ctx->info) of an ics_info() */
+int aac_write_set_dec_info(struct aac_ctx *ctx, struct aac_ics_info *ics_info);
+
+
+/* Number of scalefactor bands of the long or short windows (0 if the
+ * sampling frequency index is not supported) */
+unsigned int aac_write_get_num_swb(unsigned int sampling_frequency_index,
+				   int eight_short);
+
+
 #endif /* !_AAC_PRIV_H_ */
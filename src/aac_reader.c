@@ -25,6 +25,24 @@
  */
 
 #include "aac_priv.h"
+#include "aac_huffman.h"
+
+#include <stdatomic.h>
+#include <time.h>
+
+
+/* Counters of struct aac_reader_stats; they are only written by the parsing
+ * thread and can be read from other threads */
+struct aac_reader_counters {
+	_Atomic uint64_t frames;
+	_Atomic uint64_t bytes;
+	_Atomic uint64_t frames_skipped;
+	_Atomic uint64_t bytes_skipped;
+	_Atomic uint64_t errors_truncated;
+	_Atomic uint64_t errors_invalid;
+	_Atomic uint64_t errors_unsupported;
+	_Atomic uint64_t errors_other;
+};
 
 
 struct aac_reader {
@@ -33,9 +51,59 @@ struct aac_reader {
 	int stop;
 	struct aac_ctx *ctx;
 	uint32_t flags;
+	/* Offset of the current frame in the bitstream */
+	size_t frame_off;
+	struct aac_reader_counters counters;
+	struct aac_trace trace;
+	/* Trace count at the start of the current frame */
+	uint32_t trace_frame_start;
+	/* Set once the first parsing error has been logged */
+	int error_logged;
+	/* Frame parsing latency histograms, indexed by latency_index()
+	 * (allocated on first use) */
+	struct aac_histogram *latency;
 };
 
 
+/* One latency histogram per data format (raw or ADTS) and frame data flag */
+#define LATENCY_HISTOGRAM_COUNT 4
+
+
+/* Single writer: a relaxed load and store is enough and avoids a locked
+ * read-modify-write on the parsing path */
+static inline void counter_add(_Atomic uint64_t *counter, uint64_t n)
+{
+	atomic_store_explicit(
+		counter,
+		atomic_load_explicit(counter, memory_order_relaxed) + n,
+		memory_order_relaxed);
+}
+
+
+static inline uint64_t counter_get(_Atomic uint64_t *counter)
+{
+	return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+
+static inline unsigned int
+latency_index(enum adef_aac_data_format data_format, int frame_data)
+{
+	return (data_format == ADEF_AAC_DATA_FORMAT_ADTS ? 2 : 0) +
+	       (frame_data ? 1 : 0);
+}
+
+
+/* Monotonic time in nanoseconds */
+static inline uint64_t latency_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
 #define AAC_SYNTAX_OP_NAME read
 #define AAC_SYNTAX_OP_KIND AAC_SYNTAX_OP_KIND_READ
 
@@ -45,6 +113,191 @@ struct aac_reader {
 #include "aac_syntax.h"
 
 
+static int read_adif_header(struct aac_reader *reader,
+			    struct aac_bitstream *bs)
+{
+	int res = 0;
+	struct aac_ctx *ctx = reader->ctx;
+	const struct aac_program_config_element *pce;
+	size_t start_off = bs->off;
+
+	memset(&ctx->adif, 0, sizeof(ctx->adif));
+	res = _aac_read_adif_header(bs, ctx, &ctx->adif);
+	if (res < 0)
+		return res;
+
+	/* The raw data blocks are described by the first PCE */
+	pce = &ctx->adif.program_config_element[0];
+	memset(&ctx->asc, 0, sizeof(ctx->asc));
+	ctx->asc.audioObjectType = pce->object_type + 1;
+	ctx->asc.samplingFrequencyIndex = pce->sampling_frequency_index;
+	ctx->adif_valid = 1;
+
+	AAC_CB(ctx,
+	       &reader->cbs,
+	       reader->userdata,
+	       adif_header,
+	       bs->cdata + start_off,
+	       bs->off - start_off,
+	       &ctx->adif);
+	return 0;
+}
+
+
+static void frame_begin(struct aac_reader *reader, struct aac_bitstream *bs)
+{
+	struct aac_ctx *ctx = reader->ctx;
+
+	reader->frame_off = bs->off;
+	ctx->field_offsets.count = 0;
+	ctx->raw_data_block_count = 0;
+	reader->trace_frame_start = reader->trace.count;
+#ifndef AAC_NO_TRACE
+	if ((reader->flags & AAC_READER_FLAGS_TRACE) != 0) {
+		aac_trace_push(&reader->trace,
+			       AAC_TRACE_TYPE_FRAME,
+			       0,
+			       0,
+			       0,
+			       __func__);
+	}
+#endif /* !AAC_NO_TRACE */
+	if ((reader->flags & AAC_READER_FLAGS_BIT_STATS) != 0) {
+		memset(ctx->bit_stats.frame, 0, sizeof(ctx->bit_stats.frame));
+		ctx->bit_stats_id = AAC_BIT_STATS_ID_OTHER;
+		ctx->bit_stats_off = aac_bs_read_bit_off(bs);
+	}
+}
+
+
+/* Update the position and the bit accounting after a parsed frame */
+static void frame_end(struct aac_reader *reader, struct aac_bitstream *bs)
+{
+	struct aac_ctx *ctx = reader->ctx;
+	struct aac_bit_stats *stats = &ctx->bit_stats;
+	struct aac_timing timing;
+
+	counter_add(&reader->counters.frames, 1);
+	if (aac_ctx_get_timing(ctx, &timing) == 0)
+		ctx->position += timing.frame_duration;
+
+	if ((reader->flags & AAC_READER_FLAGS_BIT_STATS) != 0) {
+		aac_bit_stats_mark(
+			ctx, AAC_BIT_STATS_ID_OTHER, aac_bs_read_bit_off(bs));
+		for (int i = 0; i < AAC_BIT_STATS_ID_MAX; i++)
+			stats->total[i] += stats->frame[i];
+		stats->frame_count++;
+	}
+}
+
+
+/* Count the bytes consumed by a frame or header, or the error */
+static void update_stats(struct aac_reader *reader,
+			 struct aac_bitstream *bs,
+			 int res)
+{
+	struct aac_reader_counters *counters = &reader->counters;
+
+	switch (res) {
+	case 0:
+		counter_add(&counters->bytes, bs->off - reader->frame_off);
+		break;
+	case -EAGAIN:
+		counter_add(&counters->frames_skipped, 1);
+		counter_add(&counters->bytes_skipped,
+			    bs->off - reader->frame_off);
+		break;
+	case -EIO:
+		counter_add(&counters->errors_truncated, 1);
+		break;
+	case -EINVAL:
+	case -EPROTO:
+		counter_add(&counters->errors_invalid, 1);
+		break;
+	case -ENOSYS:
+		counter_add(&counters->errors_unsupported, 1);
+		break;
+	default:
+		counter_add(&counters->errors_other, 1);
+		break;
+	}
+}
+
+
+/* Log the first parsing error of the reader with its syntax path, ie. the
+ * error events recorded since the start of the frame (innermost function
+ * first) */
+static void log_error(struct aac_reader *reader, int res)
+{
+	struct aac_trace *trace = &reader->trace;
+	const struct aac_trace_event *event;
+	const struct aac_trace_event *first = NULL;
+	char path[256];
+	size_t len = 0;
+	uint32_t start = reader->trace_frame_start;
+
+	if (reader->error_logged)
+		return;
+	reader->error_logged = 1;
+
+	if (trace->count - start > AAC_TRACE_MAX_EVENTS)
+		start = trace->count - AAC_TRACE_MAX_EVENTS;
+	path[0] = '\0';
+	for (uint32_t i = start; i != trace->count; i++) {
+		event = &trace->events[i & (AAC_TRACE_MAX_EVENTS - 1)];
+		if (event->type != AAC_TRACE_TYPE_ERROR)
+			continue;
+		if (first == NULL)
+			first = event;
+		if (len >= sizeof(path))
+			continue;
+		len += snprintf(path + len,
+				sizeof(path) - len,
+				"%s%s",
+				len > 0 ? " < " : "",
+				event->func);
+	}
+
+	if (first == NULL) {
+		ULOG_ERRNO("frame %" PRIu64 " at offset %zu",
+			   -res,
+			   counter_get(&reader->counters.frames),
+			   reader->frame_off);
+	} else {
+		ULOG_ERRNO("frame %" PRIu64 " at offset %zu, bit %" PRIu32
+			   ": %s (further parsing errors are not logged)",
+			   first->err,
+			   counter_get(&reader->counters.frames),
+			   reader->frame_off,
+			   first->bit_off,
+			   path);
+	}
+}
+
+
+static int read_raw_data_block(struct aac_reader *reader,
+			       struct aac_bitstream *bs)
+{
+	int res = 0;
+	struct aac_ctx *ctx = reader->ctx;
+	size_t start_off = bs->off;
+
+	res = _aac_read_raw_data_block(bs, ctx, &ctx->raw_data_block);
+	if (res < 0)
+		return res;
+
+	AAC_CB(ctx,
+	       &reader->cbs,
+	       reader->userdata,
+	       raw_data_block,
+	       bs->cdata + start_off,
+	       bs->off - start_off,
+	       &ctx->raw_data_block);
+	frame_end(reader, bs);
+	return 0;
+}
+
+
 int aac_reader_new(const struct aac_ctx_cbs *cbs,
 		   void *userdata,
 		   struct aac_reader **ret_obj)
@@ -85,6 +338,7 @@ int aac_reader_destroy(struct aac_reader *reader)
 		return 0;
 	if (reader->ctx != NULL)
 		aac_ctx_destroy(reader->ctx);
+	free(reader->latency);
 	free(reader);
 	return 0;
 }
@@ -104,6 +358,20 @@ int aac_reader_stop(struct aac_reader *reader)
 }
 
 
+/* Whether the frame at the start of the buffer is complete (frames with an
+ * invalid header are left to the syntax functions) */
+static int frame_complete(const uint8_t *buf, size_t len)
+{
+	int res;
+	size_t size;
+
+	res = aac_frame_size(buf, len, &size);
+	if (res == -EAGAIN)
+		return 0;
+	return res < 0 || size <= len;
+}
+
+
 int aac_reader_parse(struct aac_reader *reader,
 		     uint32_t flags,
 		     const uint8_t *buf,
@@ -112,30 +380,76 @@ int aac_reader_parse(struct aac_reader *reader,
 {
 	int res = 0;
 	struct aac_bitstream bs;
+	enum adef_aac_data_format data_format;
+	uint64_t start = 0;
+	int timed = (flags & AAC_READER_FLAGS_LATENCY) != 0;
+	int header;
 
 	ULOG_ERRNO_RETURN_ERR_IF(reader == NULL, EINVAL);
 	ULOG_ERRNO_RETURN_ERR_IF(buf == NULL, EINVAL);
 	ULOG_ERRNO_RETURN_ERR_IF(off == NULL, EINVAL);
 
+	if (timed && reader->latency == NULL) {
+		reader->latency = calloc(LATENCY_HISTOGRAM_COUNT,
+					 sizeof(*reader->latency));
+		if (reader->latency == NULL)
+			return -ENOMEM;
+	}
+
 	reader->stop = 0;
 	reader->flags = flags;
 	aac_bs_cinit(&bs, buf, len);
 	bs.priv = reader;
 
 	if (reader->ctx->data_format == ADEF_AAC_DATA_FORMAT_UNKNOWN) {
-		/* Search for ADTS synword (0xFFF) */
-		if (len > 2 && buf[0] == 0xFF && (buf[1] >> 4) == 0xF)
+		/* Search for ADTS/LOAS synwords (0xFFF/0x2B7) or ADIF id */
+		if (len > 2 && buf[0] == 0xFF && (buf[1] >> 4) == 0xF) {
 			reader->ctx->data_format = ADEF_AAC_DATA_FORMAT_ADTS;
+		} else if (len > 2 && buf[0] == 0x56 && (buf[1] >> 5) == 0x7) {
+			reader->ctx->data_format = ADEF_AAC_DATA_FORMAT_RAW;
+			reader->ctx->transport = AAC_TRANSPORT_LOAS;
+		} else if (len >= 4 && memcmp(buf, "ADIF", 4) == 0) {
+			reader->ctx->data_format = ADEF_AAC_DATA_FORMAT_RAW;
+			reader->ctx->transport = AAC_TRANSPORT_ADIF;
+		}
 	}
 
 	while (*off < len && !reader->stop && bs.off < bs.len) {
-		switch (reader->ctx->data_format) {
+		data_format = reader->ctx->data_format;
+		header = 0;
+		if ((flags & AAC_READER_FLAGS_PARTIAL) != 0 &&
+		    (data_format == ADEF_AAC_DATA_FORMAT_ADTS ||
+		     reader->ctx->transport == AAC_TRANSPORT_LOAS) &&
+		    !frame_complete(bs.cdata + bs.off, bs.len - bs.off))
+			break;
+		if (timed)
+			start = latency_time();
+		frame_begin(reader, &bs);
+		switch (data_format) {
 		case ADEF_AAC_DATA_FORMAT_RAW:
-			res = _aac_read_raw_data_block(
-				&bs, reader->ctx, &reader->ctx->raw_data_block);
+			if (reader->ctx->transport == AAC_TRANSPORT_LOAS) {
+				res = _aac_read_loas_frame(&bs,
+							   reader->ctx,
+							   &reader->cbs,
+							   reader->userdata,
+							   NULL,
+							   0);
+				if (res == 0)
+					frame_end(reader, &bs);
+			} else if (reader->ctx->transport ==
+					   AAC_TRANSPORT_ADIF &&
+				   !reader->ctx->adif_valid) {
+				res = read_adif_header(reader, &bs);
+				header = 1;
+			} else {
+				res = read_raw_data_block(reader, &bs);
+			}
 			*off = bs.off;
-			if (res < 0 && res != -EAGAIN)
+			update_stats(reader, &bs, res);
+			if (res < 0 && res != -EAGAIN) {
+				log_error(reader, res);
 				goto out;
+			}
 			break;
 		case ADEF_AAC_DATA_FORMAT_ADTS:
 			res = _aac_read_adts_frame(&bs,
@@ -143,13 +457,26 @@ int aac_reader_parse(struct aac_reader *reader,
 						   &reader->cbs,
 						   reader->userdata);
 			*off = bs.off;
-			if (res < 0 && res != -EAGAIN)
+			update_stats(reader, &bs, res);
+			if (res < 0 && res != -EAGAIN) {
+				log_error(reader, res);
 				goto out;
+			}
+			if (res == 0)
+				frame_end(reader, &bs);
 			break;
 		default:
 			res = -EINVAL;
 			goto out;
 		}
+		/* Only the frames are timed, not the ADIF header */
+		if (timed && res == 0 && !header) {
+			unsigned int i = latency_index(
+				data_format,
+				flags & AAC_READER_FLAGS_FRAME_DATA);
+			aac_histogram_record(&reader->latency[i],
+					     latency_time() - start);
+		}
 	}
 	res = 0;
 
@@ -159,6 +486,119 @@ out:
 }
 
 
+int aac_reader_get_stats(struct aac_reader *reader,
+			 struct aac_reader_stats *stats)
+{
+	struct aac_reader_counters *counters;
+
+	ULOG_ERRNO_RETURN_ERR_IF(reader == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(stats == NULL, EINVAL);
+
+	counters = &reader->counters;
+	stats->frames = counter_get(&counters->frames);
+	stats->bytes = counter_get(&counters->bytes);
+	stats->frames_skipped = counter_get(&counters->frames_skipped);
+	stats->bytes_skipped = counter_get(&counters->bytes_skipped);
+	stats->errors_truncated = counter_get(&counters->errors_truncated);
+	stats->errors_invalid = counter_get(&counters->errors_invalid);
+	stats->errors_unsupported = counter_get(&counters->errors_unsupported);
+	stats->errors_other = counter_get(&counters->errors_other);
+	return 0;
+}
+
+
+int aac_reader_get_latency(struct aac_reader *reader,
+			   enum adef_aac_data_format data_format,
+			   int frame_data,
+			   struct aac_latency_stats *stats)
+{
+	struct aac_histogram hist;
+	unsigned int i;
+
+	ULOG_ERRNO_RETURN_ERR_IF(reader == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(
+		data_format != ADEF_AAC_DATA_FORMAT_UNKNOWN &&
+			data_format != ADEF_AAC_DATA_FORMAT_RAW &&
+			data_format != ADEF_AAC_DATA_FORMAT_ADTS,
+		EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(stats == NULL, EINVAL);
+
+	memset(stats, 0, sizeof(*stats));
+	if (reader->latency == NULL)
+		return 0;
+
+	/* Merge the selected histograms */
+	memset(&hist, 0, sizeof(hist));
+	for (i = 0; i < LATENCY_HISTOGRAM_COUNT; i++) {
+		if (data_format != ADEF_AAC_DATA_FORMAT_UNKNOWN &&
+		    latency_index(data_format, 0) != (i & ~1U))
+			continue;
+		if (frame_data >= 0 && (i & 1) != (frame_data ? 1U : 0U))
+			continue;
+		aac_histogram_merge(&hist, &reader->latency[i]);
+	}
+	if (hist.count == 0)
+		return 0;
+
+	stats->count = hist.count;
+	stats->min = hist.min;
+	stats->max = hist.max;
+	stats->mean = hist.sum / hist.count;
+	stats->p50 = aac_histogram_percentile(&hist, 50.);
+	stats->p90 = aac_histogram_percentile(&hist, 90.);
+	stats->p99 = aac_histogram_percentile(&hist, 99.);
+	stats->p999 = aac_histogram_percentile(&hist, 99.9);
+	return 0;
+}
+
+
+int aac_reader_get_trace(struct aac_reader *reader,
+			 struct aac_trace_event *events,
+			 size_t *count)
+{
+	struct aac_trace *trace;
+	size_t n;
+
+	ULOG_ERRNO_RETURN_ERR_IF(reader == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(events == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(count == NULL, EINVAL);
+
+	trace = &reader->trace;
+	n = Min(*count, Min(trace->count, AAC_TRACE_MAX_EVENTS));
+	for (size_t i = 0; i < n; i++) {
+		events[i] = trace->events[(trace->count - n + i) &
+					  (AAC_TRACE_MAX_EVENTS - 1)];
+	}
+	*count = n;
+	return 0;
+}
+
+
+int aac_bs_read_huffman_sf(struct aac_bitstream *bs)
+{
+	ULOG_ERRNO_RETURN_ERR_IF(bs == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(bs->priv != NULL, EINVAL);
+
+	return huffman_decode_scale_factor(bs);
+}
+
+
+int aac_bs_read_huffman_spectral(struct aac_bitstream *bs,
+				 unsigned int cb,
+				 int values[4])
+{
+	ULOG_ERRNO_RETURN_ERR_IF(bs == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(bs->priv != NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(cb < 1 || cb > 11, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(values == NULL, EINVAL);
+
+	values[0] = 0;
+	values[1] = 0;
+	return huffman_decode_spectral_data(
+		bs, cb, &values[0], &values[1], &values[2], &values[3]);
+}
+
+
 int aac_parse_asc(const uint8_t *buf, size_t len, struct aac_asc *asc)
 {
 	int res = 0;
@@ -170,7 +610,9 @@ int aac_parse_asc(const uint8_t *buf, size_t len, struct aac_asc *asc)
 	/* Setup bitstream */
 	aac_bs_cinit(&bs, buf, len);
 	/* Read ASC */
-	res = _aac_read_AudioSpecificConfig(&bs, asc);
+	res = _aac_read_AudioSpecificConfig(&bs, asc, 1);
+	if (res < 0)
+		ULOG_ERRNO("_aac_read_AudioSpecificConfig", -res);
 	aac_bs_clear(&bs);
 	return res;
 }
@@ -194,6 +636,295 @@ int aac_parse_adts(const uint8_t *buf, size_t len, struct aac_adts *adts)
 	if (res < 0)
 		goto out;
 out:
+	if (res < 0)
+		ULOG_ERRNO("_aac_read_adts_header", -res);
 	aac_bs_clear(&bs);
 	return res;
 }
+
+
+int aac_frame_size(const uint8_t *buf, size_t len, size_t *size)
+{
+	ULOG_ERRNO_RETURN_ERR_IF(buf == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(size == NULL, EINVAL);
+
+	if (len < 2)
+		return -EAGAIN;
+	if (buf[0] == 0xFF && (buf[1] & 0xF6) == 0xF0) {
+		/* ADTS: 13-bit aac_frame_length at bit 30 of the header */
+		if (len < 7)
+			return -EAGAIN;
+		/* Reserved or escape sampling_frequency_index: not a
+		 * header (eg. a syncword pattern in the frame data) */
+		if (((buf[2] >> 2) & 0xF) >= 13)
+			return -EPROTO;
+		*size = ((size_t)(buf[3] & 0x03) << 11) | (buf[4] << 3) |
+			(buf[5] >> 5);
+		/* The frame includes the header and its crc_check */
+		return *size < ((buf[1] & 0x01) ? 7 : 9) ? -EPROTO : 0;
+	} else if (buf[0] == 0x56 && (buf[1] & 0xE0) == 0xE0) {
+		/* LOAS: AudioSyncStream() 11-bit syncword and 13-bit
+		 * audioMuxLengthBytes */
+		if (len < 3)
+			return -EAGAIN;
+		*size = 3 + (((size_t)(buf[1] & 0x1F) << 8) | buf[2]);
+		return *size == 3 ? -EPROTO : 0;
+	}
+	return -EPROTO;
+}
+
+
+/* Number of consecutive frame headers for a full confidence */
+#define PROBE_FRAME_COUNT 4
+
+/* Maximum size of a bare AudioSpecificConfig */
+#define PROBE_ASC_MAX_SIZE 64
+
+
+/* Get the offset after the ID3v2 and APE tags found at 'off' */
+static size_t probe_skip_tags(const uint8_t *buf, size_t len, size_t off)
+{
+	const uint8_t *p;
+	uint32_t size;
+
+	while (off < len) {
+		p = buf + off;
+		if (len - off >= 10 && memcmp(p, "ID3", 3) == 0) {
+			/* ID3v2: 10-byte header, syncsafe size, optional
+			 * 10-byte footer */
+			size = ((uint32_t)(p[6] & 0x7F) << 21) |
+			       ((uint32_t)(p[7] & 0x7F) << 14) |
+			       ((uint32_t)(p[8] & 0x7F) << 7) | (p[9] & 0x7F);
+			off += 10 + size + ((p[5] & 0x10) ? 10 : 0);
+		} else if (len - off >= 32 && memcmp(p, "APETAGEX", 8) == 0) {
+			/* APEv2 header: the size includes the footer and
+			 * the items but not the header */
+			size = (uint32_t)p[12] | ((uint32_t)p[13] << 8) |
+			       ((uint32_t)p[14] << 16) |
+			       ((uint32_t)p[15] << 24);
+			off += 32 + (size_t)size;
+		} else {
+			break;
+		}
+	}
+
+	return off;
+}
+
+
+/* Count the consecutive ADTS frame headers with the same fixed header */
+static unsigned int
+probe_adts(const uint8_t *buf, size_t len, struct aac_adts *first)
+{
+	int res;
+	unsigned int count = 0;
+	size_t off = 0;
+	struct aac_adts adts;
+
+	while (count < PROBE_FRAME_COUNT && len - off >= 7) {
+		/* Syncword and layer 0 */
+		if (buf[off] != 0xFF || (buf[off + 1] & 0xF6) != 0xF0)
+			break;
+		res = aac_parse_adts(buf + off, len - off, &adts);
+		if (res < 0)
+			break;
+		if (adts.sampling_frequency_index >= 13 ||
+		    adts.aac_frame_length < 7)
+			break;
+		if (count == 0) {
+			*first = adts;
+		} else if (adts.ID != first->ID ||
+			   adts.profile_ObjectType !=
+				   first->profile_ObjectType ||
+			   adts.sampling_frequency_index !=
+				   first->sampling_frequency_index ||
+			   adts.channel_configuration !=
+				   first->channel_configuration) {
+			break;
+		}
+		count++;
+		off += adts.aac_frame_length;
+		if (off > len)
+			break;
+	}
+
+	return count;
+}
+
+
+/* Count the consecutive LOAS frame headers, reading the first
+ * StreamMuxConfig found */
+static unsigned int probe_loas(const uint8_t *buf,
+			       size_t len,
+			       struct aac_asc *asc,
+			       int *asc_valid)
+{
+	int res;
+	unsigned int count = 0;
+	size_t off = 0;
+	size_t frame_len;
+	uint32_t useSameStreamMux;
+	struct aac_bitstream bs;
+	struct aac_StreamMuxConfig smc;
+
+	while (count < PROBE_FRAME_COUNT && len - off >= 3) {
+		if (buf[off] != 0x56 || (buf[off + 1] & 0xE0) != 0xE0)
+			break;
+		frame_len = 3 + (((buf[off + 1] & 0x1F) << 8) | buf[off + 2]);
+		if (!*asc_valid && len - off > 3) {
+			aac_bs_cinit(&bs,
+				     buf + off + 3,
+				     Min(frame_len, len - off) - 3);
+			res = aac_bs_read_bits(&bs, &useSameStreamMux, 1);
+			if (res >= 0 && !useSameStreamMux) {
+				/* Unsupported configurations do not
+				 * prevent the detection */
+				res = _aac_read_StreamMuxConfig(&bs, &smc, asc);
+				*asc_valid = (res == 0);
+			}
+			aac_bs_clear(&bs);
+		}
+		count++;
+		off += frame_len;
+		if (off > len)
+			break;
+	}
+
+	return count;
+}
+
+
+static int probe_adif(const uint8_t *buf,
+		      size_t len,
+		      struct aac_probe_result *result)
+{
+	int res;
+	struct aac_bitstream bs;
+	struct aac_adif_header *adif;
+	const struct aac_program_config_element *pce;
+
+	adif = calloc(1, sizeof(*adif));
+	if (adif == NULL)
+		return -ENOMEM;
+
+	/* The header syntax does not use the context */
+	aac_bs_cinit(&bs, buf, len);
+	res = _aac_read_adif_header(&bs, NULL, adif);
+	aac_bs_clear(&bs);
+	if (res == 0) {
+		pce = &adif->program_config_element[0];
+		if (pce->sampling_frequency_index < 13) {
+			result->confidence = 100;
+			result->asc.audioObjectType = pce->object_type + 1;
+			result->asc.samplingFrequencyIndex =
+				pce->sampling_frequency_index;
+			result->asc_valid = 1;
+		}
+	} else if (res == -EIO) {
+		/* Header truncated by the end of the buffer */
+		result->confidence = 50;
+	}
+	if (result->confidence > 0) {
+		result->data_format = ADEF_AAC_DATA_FORMAT_RAW;
+		result->transport = AAC_TRANSPORT_ADIF;
+	}
+
+	free(adif);
+	return 0;
+}
+
+
+/* Check whether the buffer only holds a plausible AudioSpecificConfig */
+static void probe_asc(const uint8_t *buf,
+		      size_t len,
+		      struct aac_probe_result *result)
+{
+	int res;
+	uint32_t aot = buf[0] >> 3;
+	uint32_t sfi = ((buf[0] & 0x7) << 1) | (buf[1] >> 7);
+	uint32_t chcfg = (buf[1] >> 3) & 0xF;
+	struct aac_bitstream bs;
+	struct aac_asc asc;
+
+	/* Quick checks before a full read: AAC object types only, no
+	 * escaped values */
+	if (len > PROBE_ASC_MAX_SIZE || aot < AAC_AOT_AAC_MAIN ||
+	    (aot > AAC_AOT_AAC_LTP && aot != AAC_AOT_SBR &&
+	     aot != AAC_AOT_PS) ||
+	    sfi >= 13 || chcfg == 0)
+		return;
+
+	memset(&asc, 0, sizeof(asc));
+	aac_bs_cinit(&bs, buf, len);
+	res = _aac_read_AudioSpecificConfig(&bs, &asc, 1);
+	/* The ASC must span the whole buffer */
+	if (res == 0 && len - bs.off == 0) {
+		result->data_format = ADEF_AAC_DATA_FORMAT_RAW;
+		result->transport = AAC_TRANSPORT_NONE;
+		result->confidence = 50;
+		result->asc = asc;
+		result->asc_valid = 1;
+	}
+	aac_bs_clear(&bs);
+}
+
+
+int aac_probe(const uint8_t *buf, size_t len, struct aac_probe_result *result)
+{
+	size_t off, end;
+	unsigned int count;
+
+	ULOG_ERRNO_RETURN_ERR_IF(buf == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(len == 0, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(result == NULL, EINVAL);
+
+	memset(result, 0, sizeof(*result));
+	result->data_format = ADEF_AAC_DATA_FORMAT_UNKNOWN;
+
+	off = probe_skip_tags(buf, len, 0);
+	result->offset = off;
+	if (off >= len)
+		return -EAGAIN;
+	end = Min(len, off + AAC_PROBE_MAX_SIZE);
+
+	/* ADIF: only at the start of the stream */
+	if (end - off >= 4 && memcmp(buf + off, "ADIF", 4) == 0)
+		return probe_adif(buf + off, end - off, result);
+
+	/* ADTS and LOAS: look for a syncword; a sync found after some
+	 * garbage must be confirmed by at least one other header */
+	for (size_t i = off; i + 1 < end; i++) {
+		if (buf[i] == 0xFF) {
+			count = probe_adts(buf + i, end - i, &result->adts);
+			if (count == 0 || (i != off && count < 2))
+				continue;
+			result->data_format = ADEF_AAC_DATA_FORMAT_ADTS;
+		} else if (buf[i] == 0x56) {
+			count = probe_loas(buf + i,
+					   end - i,
+					   &result->asc,
+					   &result->asc_valid);
+			if (count == 0 || (i != off && count < 2)) {
+				memset(&result->asc, 0, sizeof(result->asc));
+				result->asc_valid = 0;
+				continue;
+			}
+			result->data_format = ADEF_AAC_DATA_FORMAT_RAW;
+			result->transport = AAC_TRANSPORT_LOAS;
+		} else {
+			continue;
+		}
+		result->offset = i;
+		result->frame_count = count;
+		result->confidence = 100 * count / PROBE_FRAME_COUNT;
+		return 0;
+	}
+	memset(&result->adts, 0, sizeof(result->adts));
+	memset(&result->asc, 0, sizeof(result->asc));
+
+	/* Bare AudioSpecificConfig */
+	if (end - off >= 2)
+		probe_asc(buf + off, end - off, result);
+
+	return 0;
+}
@@ -0,0 +1,347 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "aac_priv.h"
+
+#ifndef _WIN32
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <time.h>
+#	include <unistd.h>
+#endif
+
+
+/* Maximum number of attempts to get a consistent slot copy */
+#define AAC_SHM_READ_RETRIES 100
+
+
+struct aac_shm {
+	struct aac_shm_header *header;
+	struct aac_shm_slot *slots;
+	size_t size;
+	int writable;
+};
+
+
+#ifndef _WIN32
+
+
+static int shm_map(int fd, size_t size, int writable, struct aac_shm **ret_obj)
+{
+	struct aac_shm *shm;
+	void *data;
+
+	shm = calloc(1, sizeof(*shm));
+	if (shm == NULL)
+		return -ENOMEM;
+
+	data = mmap(NULL,
+		    size,
+		    writable ? PROT_READ | PROT_WRITE : PROT_READ,
+		    MAP_SHARED,
+		    fd,
+		    0);
+	if (data == MAP_FAILED) {
+		int res = -errno;
+		ULOG_ERRNO("mmap", -res);
+		free(shm);
+		return res;
+	}
+
+	shm->header = data;
+	shm->slots = (struct aac_shm_slot *)(shm->header + 1);
+	shm->size = size;
+	shm->writable = writable;
+	*ret_obj = shm;
+	return 0;
+}
+
+
+int aac_shm_create(const char *name,
+		   unsigned int slot_count,
+		   struct aac_shm **ret_obj)
+{
+	int res, fd;
+	size_t size;
+	struct aac_shm *shm = NULL;
+
+	ULOG_ERRNO_RETURN_ERR_IF(name == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(slot_count == 0, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(ret_obj == NULL, EINVAL);
+
+	size = sizeof(struct aac_shm_header) +
+	       slot_count * sizeof(struct aac_shm_slot);
+
+	fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+	if (fd < 0) {
+		res = -errno;
+		ULOG_ERRNO("shm_open('%s')", -res, name);
+		return res;
+	}
+	/* Truncate first so that the slots are zeroed */
+	if (ftruncate(fd, 0) < 0 || ftruncate(fd, size) < 0) {
+		res = -errno;
+		ULOG_ERRNO("ftruncate", -res);
+		goto out;
+	}
+
+	res = shm_map(fd, size, 1, &shm);
+	if (res < 0)
+		goto out;
+
+	shm->header->version = AAC_SHM_VERSION;
+	shm->header->slot_count = slot_count;
+	shm->header->slot_size = sizeof(struct aac_shm_slot);
+	/* The magic is written last: readers check it first */
+	__atomic_store_n(&shm->header->magic, AAC_SHM_MAGIC, __ATOMIC_RELEASE);
+	*ret_obj = shm;
+
+out:
+	close(fd);
+	return res;
+}
+
+
+int aac_shm_open(const char *name, struct aac_shm **ret_obj)
+{
+	int res, fd;
+	struct stat st;
+	struct aac_shm_header *header;
+	struct aac_shm *shm = NULL;
+
+	ULOG_ERRNO_RETURN_ERR_IF(name == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(ret_obj == NULL, EINVAL);
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		res = -errno;
+		ULOG_ERRNO("shm_open('%s')", -res, name);
+		return res;
+	}
+	if (fstat(fd, &st) < 0) {
+		res = -errno;
+		ULOG_ERRNO("fstat", -res);
+		goto out;
+	}
+	if ((size_t)st.st_size < sizeof(*header)) {
+		res = -EPROTO;
+		ULOG_ERRNO("segment too small", -res);
+		goto out;
+	}
+
+	res = shm_map(fd, st.st_size, 0, &shm);
+	if (res < 0)
+		goto out;
+
+	header = shm->header;
+	if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) !=
+		    AAC_SHM_MAGIC ||
+	    header->version != AAC_SHM_VERSION ||
+	    header->slot_size != sizeof(struct aac_shm_slot) ||
+	    sizeof(*header) + (size_t)header->slot_count * header->slot_size >
+		    shm->size) {
+		res = -EPROTO;
+		ULOG_ERRNO("unsupported segment layout", -res);
+		aac_shm_destroy(shm);
+		goto out;
+	}
+	*ret_obj = shm;
+
+out:
+	close(fd);
+	return res;
+}
+
+
+int aac_shm_destroy(struct aac_shm *shm)
+{
+	if (shm == NULL)
+		return 0;
+	munmap(shm->header, shm->size);
+	free(shm);
+	return 0;
+}
+
+
+int aac_shm_unlink(const char *name)
+{
+	int res;
+
+	ULOG_ERRNO_RETURN_ERR_IF(name == NULL, EINVAL);
+
+	if (shm_unlink(name) < 0) {
+		res = -errno;
+		ULOG_ERRNO("shm_unlink('%s')", -res, name);
+		return res;
+	}
+	return 0;
+}
+
+
+static uint64_t shm_timestamp(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+#else /* _WIN32 */
+
+
+int aac_shm_create(const char *name,
+		   unsigned int slot_count,
+		   struct aac_shm **ret_obj)
+{
+	return -ENOSYS;
+}
+
+
+int aac_shm_open(const char *name, struct aac_shm **ret_obj)
+{
+	return -ENOSYS;
+}
+
+
+int aac_shm_destroy(struct aac_shm *shm)
+{
+	return -ENOSYS;
+}
+
+
+int aac_shm_unlink(const char *name)
+{
+	return -ENOSYS;
+}
+
+
+static uint64_t shm_timestamp(void)
+{
+	return 0;
+}
+
+
+#endif /* _WIN32 */
+
+
+unsigned int aac_shm_get_slot_count(struct aac_shm *shm)
+{
+	ULOG_ERRNO_RETURN_VAL_IF(shm == NULL, EINVAL, 0);
+	return shm->header->slot_count;
+}
+
+
+/* Fill the last header fields of a slot from a reader context */
+static void shm_fill_header(struct aac_shm_slot *slot, struct aac_ctx *ctx)
+{
+	struct aac_timing timing;
+
+	slot->data_format = ctx->data_format;
+	slot->transport = ctx->transport;
+	switch (ctx->data_format) {
+	case ADEF_AAC_DATA_FORMAT_ADTS:
+		slot->audio_object_type = ctx->adts.profile_ObjectType + 1;
+		slot->channel_configuration = ctx->adts.channel_configuration;
+		break;
+	case ADEF_AAC_DATA_FORMAT_RAW:
+		slot->audio_object_type = ctx->asc.audioObjectType;
+		slot->channel_configuration = ctx->asc.channelConfiguration;
+		break;
+	default:
+		slot->audio_object_type = AAC_AOT_NULL;
+		slot->channel_configuration = 0;
+		break;
+	}
+	memset(&timing, 0, sizeof(timing));
+	if (ctx->data_format != ADEF_AAC_DATA_FORMAT_UNKNOWN)
+		(void)aac_ctx_get_timing(ctx, &timing);
+	slot->sample_rate = timing.sample_rate;
+	slot->frame_length = timing.frame_length;
+	slot->position = ctx->position;
+}
+
+
+int aac_shm_publish(struct aac_shm *shm,
+		    unsigned int slot,
+		    const char *name,
+		    struct aac_reader *reader)
+{
+	uint32_t seq;
+	struct aac_shm_slot *s;
+
+	ULOG_ERRNO_RETURN_ERR_IF(shm == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(!shm->writable, EPERM);
+	ULOG_ERRNO_RETURN_ERR_IF(slot >= shm->header->slot_count, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(name == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(reader == NULL, EINVAL);
+
+	s = &shm->slots[slot];
+
+	/* Enter the write section (odd sequence) */
+	seq = __atomic_load_n(&s->seq, __ATOMIC_RELAXED);
+	__atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	s->used = 1;
+	strncpy(s->name, name, sizeof(s->name) - 1);
+	s->name[sizeof(s->name) - 1] = '\0';
+	s->timestamp = shm_timestamp();
+	(void)aac_reader_get_stats(reader, &s->stats);
+	shm_fill_header(s, aac_reader_get_ctx(reader));
+
+	/* Leave the write section (even sequence) */
+	__atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE);
+	return 0;
+}
+
+
+int aac_shm_read(struct aac_shm *shm,
+		 unsigned int slot,
+		 struct aac_shm_slot *data)
+{
+	uint32_t seq1, seq2;
+	struct aac_shm_slot *s;
+
+	ULOG_ERRNO_RETURN_ERR_IF(shm == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(slot >= shm->header->slot_count, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(data == NULL, EINVAL);
+
+	s = &shm->slots[slot];
+	for (int i = 0; i < AAC_SHM_READ_RETRIES; i++) {
+		seq1 = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+		if (seq1 & 1)
+			continue;
+		memcpy(data, s, sizeof(*data));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		seq2 = __atomic_load_n(&s->seq, __ATOMIC_RELAXED);
+		if (seq1 == seq2)
+			return 0;
+	}
+
+	return -EAGAIN;
+}
@@ -32,17 +32,14 @@
 #include "aac_tables.h"
 
 
-/* TODO: for debug purpose only */
-#define LOG_OFFSET(str)                                                        \
-	ULOGD("at %zx: %zd (%zd*8 + %d): " str,                                \
-	      bs->off,                                                         \
-	      bs->off * 8 + (8 - bs->cachebits),                               \
-	      bs->off,                                                         \
-	      8 - bs->cachebits);
+#define MAX_QUANTIZED_VALUE 8191
 
 
-static int
-find_offset_in_bc(struct aac_bitstream *bs, uint32_t (*codebook)[3], int cb_len)
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+
+static int find_offset_in_bc(struct aac_bitstream *bs,
+			     const uint32_t (*codebook)[3],
+			     int cb_len)
 {
 	unsigned int len = 0;
 	unsigned int cw = 0;
@@ -118,16 +115,14 @@ static int huffman_decode_spectral_data(struct aac_bitstream *bs,
 		if (hcb_list[i].id == cb)
 			cb_index = i;
 	}
-	ULOG_ERRNO_RETURN_ERR_IF(cb_index == INT32_MAX, ENOENT);
-	uint32_t(*codebook)[3] = hcb_list[cb_index].codebook;
+	AAC_RETURN_ERR_IF(cb_index == INT32_MAX, ENOENT);
+	const uint32_t(*codebook)[3] = hcb_list[cb_index].codebook;
 	int cb_len = hcb_list[cb_index].cb_len;
 	int _unsigned = !(hcb_list[cb_index].is_signed);
 	int index = 0;
-#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
 	uint8_t bit = 0;
-#endif
 	int ret = find_offset_in_bc(bs, codebook, cb_len);
-	ULOG_ERRNO_RETURN_ERR_IF(ret < 0, -ret);
+	AAC_RETURN_ERR_IF(ret < 0, -ret);
 
 	index = ret;
 	ret = get_wxyz(_unsigned,
@@ -138,8 +133,7 @@ static int huffman_decode_spectral_data(struct aac_bitstream *bs,
 		       x,
 		       y,
 		       z);
-	ULOG_ERRNO_RETURN_ERR_IF(ret < 0, -ret);
-#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+	AAC_RETURN_ERR_IF(ret < 0, -ret);
 	if (_unsigned) {
 		if (hcb_list[cb_index].dimension == 4) {
 			if (*w != 0) {
@@ -164,17 +158,13 @@ static int huffman_decode_spectral_data(struct aac_bitstream *bs,
 				*z = -*z;
 		}
 	}
-#endif
 	return 0;
 }
 
 
-#define MAX_QUANTIZED_VALUE 8191
-
-
-static int get_escape(struct aac_bitstream *bs, bool minus)
+/* Escape sequence (4.6.3.3): value is the +/-16 read from the codeword */
+static int get_escape(struct aac_bitstream *bs, int *value)
 {
-#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
 	uint8_t bit = 0;
 	uint32_t off = 0;
 	int i;
@@ -184,16 +174,130 @@ static int get_escape(struct aac_bitstream *bs, bool minus)
 			break;
 	}
 
-	if (i == 13)
-		return MAX_QUANTIZED_VALUE + 1;
+	if (i == 13) {
+		*value = (*value < 0) ? -(MAX_QUANTIZED_VALUE + 1)
+				      : MAX_QUANTIZED_VALUE + 1;
+		return 0;
+	}
 
 	AAC_BITS(off, i);
 	i = off + (1 << i);
+	*value = (*value < 0) ? -i : i;
 
-	if (minus)
-		i = -i;
+	return 0;
+}
 
-	return i;
+#elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+
+static int huffman_encode(struct aac_bitstream *bs,
+			  const uint32_t (*codebook)[3],
+			  int cb_len,
+			  int index)
+{
+	for (int off = 0; off < cb_len; ++off) {
+		if ((int)codebook[off][2] != index)
+			continue;
+		AAC_BITS(codebook[off][0], codebook[off][1]);
+		return index;
+	}
+	return -ENOENT; /* Index not found in the table */
+}
+
+
+static int put_escape(struct aac_bitstream *bs, int value)
+{
+	int n = 4;
+	AAC_RETURN_ERR_IF(value < ESC_FLAG || value > MAX_QUANTIZED_VALUE,
+			  EINVAL);
+	while ((value >> (n + 1)) != 0)
+		n++;
+	for (int i = 4; i < n; i++)
+		AAC_BITS(1, 1);
+	AAC_BITS(0, 1);
+	AAC_BITS(value - (1 << n), n);
+	return 0;
+}
+
+#endif
+
+
+/* Scale factor codeword: the index (difference + 60) is decoded, encoded or
+ * only returned when dumping */
+static int huffman_scale_factor(struct aac_bitstream *bs, int index)
+{
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+	return huffman_decode_scale_factor(bs);
+#elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+	return huffman_encode(bs, hcb_sf, ARRAY_SIZE(hcb_sf), index);
+#else
+	return index;
+#endif
+}
+
+
+/* Spectral codeword with its sign bits and escape sequences: 4 or 2 values
+ * (depending on the codebook dimension) are encoded from x_quant, or
+ * decoded and discarded (x_quant is then not used) */
+static int huffman_spectral_values(struct aac_bitstream *bs,
+				   int cb,
+				   const int16_t *x_quant)
+{
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+	int res;
+	int v[4] = {0, 0, 0, 0};
+	res = huffman_decode_spectral_data(bs, cb, &v[0], &v[1], &v[2], &v[3]);
+	if (res < 0)
+		return res;
+	if (cb == ESC_HCB && Abs(v[2]) == ESC_FLAG) {
+		res = get_escape(bs, &v[2]);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+	}
+	if (cb == ESC_HCB && Abs(v[3]) == ESC_FLAG) {
+		res = get_escape(bs, &v[3]);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+	}
+	return 0;
+#elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+	int res;
+	int cb_index = INT32_MAX;
+	for (size_t i = 0; i < ARRAY_SIZE(hcb_list); i++) {
+		if (hcb_list[i].id == cb)
+			cb_index = i;
+	}
+	AAC_RETURN_ERR_IF(cb_index == INT32_MAX, ENOENT);
+	int dim = hcb_list[cb_index].dimension;
+	int lav = hcb_list[cb_index].lav;
+	int _unsigned = !(hcb_list[cb_index].is_signed);
+	int mod = _unsigned ? lav + 1 : 2 * lav + 1;
+	int off = _unsigned ? 0 : lav;
+	int index = 0;
+	for (int i = 0; i < dim; i++) {
+		int v = _unsigned ? Abs(x_quant[i]) : x_quant[i];
+		if (cb == ESC_HCB && v > ESC_FLAG)
+			v = ESC_FLAG;
+		AAC_RETURN_ERR_IF(Abs(v) > lav, ERANGE);
+		index = index * mod + v + off;
+	}
+	res = huffman_encode(bs,
+			     hcb_list[cb_index].codebook,
+			     hcb_list[cb_index].cb_len,
+			     index);
+	AAC_RETURN_ERR_IF(res < 0, -res);
+	if (_unsigned) {
+		for (int i = 0; i < dim; i++) {
+			if (x_quant[i] != 0)
+				AAC_BITS(x_quant[i] < 0, 1);
+		}
+	}
+	if (cb == ESC_HCB) {
+		for (int i = 0; i < dim; i++) {
+			if (Abs(x_quant[i]) < ESC_FLAG)
+				continue;
+			res = put_escape(bs, Abs(x_quant[i]));
+			AAC_RETURN_ERR_IF(res < 0, -res);
+		}
+	}
+	return 0;
 #else
 	return 0;
 #endif
@@ -324,7 +428,11 @@ static int AAC_SYNTAX_FCT(get_audioObjectType)(
 	AAC_SYNTAX_CONST enum aac_audioObjectType *audioObjectType)
 {
 	uint8_t _audioObjectType = 0;
-#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_DUMP
+	/* Dump the value rather than its escaped coding */
+	AAC_FIELD(audioObjectType, *audioObjectType);
+	return 0;
+#elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
 	_audioObjectType = *audioObjectType;
 #endif
 	AAC_BITS(_audioObjectType, 5);
@@ -391,15 +499,19 @@ static int AAC_SYNTAX_FCT(GASpecificConfig)(
 
 /**
  * Table 1.15 – Syntax of AudioSpecificConfig()
+ * syncExtension enables the backward compatible signaling extension at the
+ * end of the config; it must be disabled when the config is not the last
+ * element of the bitstream (eg. in a StreamMuxConfig).
  */
 static int AAC_SYNTAX_FCT(AudioSpecificConfig)(
 	struct aac_bitstream *bs,
-	AAC_SYNTAX_CONST struct aac_asc *asc)
+	AAC_SYNTAX_CONST struct aac_asc *asc,
+	int syncExtension)
 {
 	int res;
 
 	res = AAC_SYNTAX_FCT(get_audioObjectType)(bs, &asc->audioObjectType);
-	ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+	AAC_RETURN_ERR_IF(res < 0, -res);
 
 	AAC_BITS(asc->samplingFrequencyIndex, 4);
 	if (asc->samplingFrequencyIndex == 0xF)
@@ -420,7 +532,7 @@ static int AAC_SYNTAX_FCT(AudioSpecificConfig)(
 			AAC_BITS(asc->extensionSamplingFrequency, 24);
 		res = AAC_SYNTAX_FCT(get_audioObjectType)(
 			bs, &asc->audioObjectType);
-		ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+		AAC_RETURN_ERR_IF(res < 0, -res);
 		if (asc->audioObjectType == 22)
 			AAC_BITS(asc->extensionChannelConfiguration, 4);
 	}
@@ -444,7 +556,7 @@ static int AAC_SYNTAX_FCT(AudioSpecificConfig)(
 			asc->samplingFrequencyIndex,
 			asc->channelConfiguration,
 			asc->audioObjectType);
-		ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+		AAC_RETURN_ERR_IF(res < 0, -res);
 		break;
 	case 8:
 		/* CelpSpecificConfig(); */
@@ -530,13 +642,14 @@ static int AAC_SYNTAX_FCT(AudioSpecificConfig)(
 	default:
 		break;
 	}
-	if (extensionAudioObjectType == 5 || aac_bs_rem_raw_bits(bs) < 16)
+	if (!syncExtension || extensionAudioObjectType == 5 ||
+	    aac_bs_rem_raw_bits(bs) < 16)
 		return 0;
 	AAC_BITS(asc->syncExtensionType, 11);
 	if (asc->syncExtensionType == 0x2b7) {
 		res = AAC_SYNTAX_FCT(get_audioObjectType)(
 			bs, &extensionAudioObjectType);
-		ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+		AAC_RETURN_ERR_IF(res < 0, -res);
 		if (extensionAudioObjectType == 5) {
 			AAC_BITS(asc->sbrPresentFlag, 1);
 			if (asc->sbrPresentFlag == 1) {
@@ -582,15 +695,18 @@ static int AAC_SYNTAX_FCT(adts_fixed_header)(
 	AAC_SYNTAX_CONST struct aac_adts *adts)
 {
 	AAC_BITS(adts->syncword, 12);
-	ULOG_ERRNO_RETURN_ERR_IF((adts->syncword & 0xFFF) != 0xFFF, EINVAL);
+	AAC_RETURN_ERR_IF((adts->syncword & 0xFFF) != 0xFFF, EINVAL);
 	AAC_BITS(adts->ID, 1);
 	AAC_BITS(adts->layer, 2);
 	AAC_BITS(adts->protection_absent, 1);
 	AAC_BITS(adts->profile_ObjectType, 2);
 	AAC_BITS(adts->sampling_frequency_index, 4);
+	AAC_FIELD_OFFSET(AAC_FIELD_ID_PRIVATE_BIT, 1);
 	AAC_BITS(adts->private_bit, 1);
 	AAC_BITS(adts->channel_configuration, 3);
+	AAC_FIELD_OFFSET(AAC_FIELD_ID_ORIGINAL_COPY, 1);
 	AAC_BITS(adts->original_copy, 1);
+	AAC_FIELD_OFFSET(AAC_FIELD_ID_HOME, 1);
 	AAC_BITS(adts->home, 1);
 
 	return 0;
@@ -604,9 +720,13 @@ static int AAC_SYNTAX_FCT(adts_variable_header)(
 	struct aac_bitstream *bs,
 	AAC_SYNTAX_CONST struct aac_adts *adts)
 {
+	AAC_FIELD_OFFSET(AAC_FIELD_ID_COPYRIGHT_IDENTIFICATION_BIT, 1);
 	AAC_BITS(adts->copyright_identification_bit, 1);
+	AAC_FIELD_OFFSET(AAC_FIELD_ID_COPYRIGHT_IDENTIFICATION_START, 1);
 	AAC_BITS(adts->copyright_identification_start, 1);
+	AAC_FIELD_OFFSET(AAC_FIELD_ID_AAC_FRAME_LENGTH, 13);
 	AAC_BITS(adts->aac_frame_length, 13);
+	AAC_FIELD_OFFSET(AAC_FIELD_ID_ADTS_BUFFER_FULLNESS, 11);
 	AAC_BITS(adts->adts_buffer_fullness, 11);
 	AAC_BITS(adts->number_of_raw_data_blocks_in_frame, 2);
 
@@ -624,6 +744,9 @@ static int AAC_SYNTAX_FCT(adts_error_check)(struct aac_bitstream *bs,
 
 	if (ctx->adts.protection_absent == 0)
 		AAC_BITS(crc_check, 16);
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+	ctx->adts_frame.adts_error_check.crc_check = crc_check;
+#endif
 
 	return 0;
 }
@@ -678,7 +801,7 @@ static int AAC_SYNTAX_FCT(ics_info)(struct aac_bitstream *bs,
 				    struct aac_ics_info *ics_info,
 				    int common_window)
 {
-#if AAC_SYNTAX_OP_KIND != AAC_SYNTAX_OP_KIND_WRITE
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
 	memset(ics_info, 0, sizeof(*ics_info));
 #endif
 
@@ -757,6 +880,16 @@ static int
 			    section_data->sect_cb[g][i] < 11 ||
 			    (section_data->sect_cb[g][i] > 11 &&
 			     section_data->sect_cb[g][i] < 16)) {
+#if AAC_SYNTAX_OP_KIND != AAC_SYNTAX_OP_KIND_READ
+				/* Split the length in escape values */
+				sect_len_incr = section_data->sect_end[g][i] -
+						section_data->sect_start[g][i];
+				while (sect_len_incr >= sect_esc_val) {
+					AAC_BITS(sect_esc_val, sect_bits);
+					sect_len += sect_esc_val;
+					sect_len_incr -= sect_esc_val;
+				}
+#endif
 				AAC_BITS(sect_len_incr, sect_bits);
 #if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
 				while (sect_len_incr == sect_esc_val) {
@@ -768,6 +901,9 @@ static int
 				sect_len_incr = 1;
 			}
 			sect_len += sect_len_incr;
+			AAC_RETURN_ERR_IF(sect_len == 0, EINVAL);
+			AAC_RETURN_ERR_IF(k + sect_len > ics->ics_info.max_sfb,
+					  EINVAL);
 			section_data->sect_start[g][i] = k;
 			section_data->sect_end[g][i] = k + sect_len;
 			for (int sfb = k; sfb < k + sect_len; sfb++) {
@@ -804,8 +940,11 @@ static int AAC_SYNTAX_FCT(scale_factor_data)(
 			if (ics->section_data.sfb_cb[g][sfb] == ZERO_HCB)
 				continue;
 			if (is_intensity(ics->section_data.sfb_cb[g][sfb])) {
-				res = huffman_decode_scale_factor(bs);
-				ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+				res = huffman_scale_factor(
+					bs,
+					scale_factor_data
+						->dpcm_is_position[g][sfb]);
+				AAC_RETURN_ERR_IF(res < 0, -res);
 				scale_factor_data->dpcm_is_position[g][sfb] =
 					res;
 			} else if (is_noise(ics->section_data.sfb_cb[g][sfb])) {
@@ -816,14 +955,19 @@ static int AAC_SYNTAX_FCT(scale_factor_data)(
 									 [sfb],
 						 9);
 				} else {
-					res = huffman_decode_scale_factor(bs);
-					ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+					res = huffman_scale_factor(
+						bs,
+						scale_factor_data
+							->dpcm_noise_nrg[g]
+									[sfb]);
+					AAC_RETURN_ERR_IF(res < 0, -res);
 					scale_factor_data
 						->dpcm_noise_nrg[g][sfb] = res;
 				}
 			} else {
-				res = huffman_decode_scale_factor(bs);
-				ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+				res = huffman_scale_factor(
+					bs, scale_factor_data->dpcm_sf[g][sfb]);
+				AAC_RETURN_ERR_IF(res < 0, -res);
 				scale_factor_data->dpcm_sf[g][sfb] = res;
 			}
 		}
@@ -1019,12 +1163,30 @@ static int
 				      struct aac_spectral_data *spectral_data)
 {
 	int res;
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+	/* Without a stream generator, the lines are all zero */
+	static const int16_t zero_lines[AAC_MAX_SPECTRAL_LINES];
+	const int16_t *lines = zero_lines;
+	int group_off = 0;
+	if (ctx->x_quant_write != NULL) {
+		AAC_RETURN_ERR_IF(ctx->x_quant_index >= ctx->x_quant_count,
+				  ENOBUFS);
+		lines = ctx->x_quant_write[ctx->x_quant_index++];
+	}
+#endif
 	for (int g = 0; g < ctx->info.num_window_groups; g++) {
+		const int16_t *x_quant = NULL;
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+		/* The lines of the window groups are stored one after the
+		 * other */
+		x_quant = &lines[group_off];
+		group_off += ctx->info.window_group_length[g] *
+			     (AAC_MAX_SPECTRAL_LINES / ctx->info.num_windows);
+#endif
 		for (int i = 0; i < ics->section_data.num_sec[g]; i++) {
-			if (ics->section_data.sect_cb[g][i] == ZERO_HCB ||
-			    ics->section_data.sect_cb[g][i] == NOISE_HCB ||
-			    ics->section_data.sect_cb[g][i] == INTENSITY_HCB ||
-			    ics->section_data.sect_cb[g][i] == INTENSITY_HCB2)
+			int cb = ics->section_data.sect_cb[g][i];
+			if (cb == ZERO_HCB || cb == NOISE_HCB ||
+			    cb == INTENSITY_HCB || cb == INTENSITY_HCB2)
 				continue;
 			for (int k = ctx->info.sect_sfb_offset
 					     [g][ics->section_data
@@ -1032,37 +1194,13 @@ static int
 			     k <
 			     ctx->info.sect_sfb_offset
 				     [g][ics->section_data.sect_end[g][i]];) {
-				int w, x, y, z;
-				if (ics->section_data.sect_cb[g][i] <
-				    FIRST_PAIR_HCB) {
-					res = huffman_decode_spectral_data(
-						bs,
-						ics->section_data.sect_cb[g][i],
-						&w,
-						&x,
-						&y,
-						&z);
-					ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
-					k += QUAD_LEN;
-					continue;
-				}
-				/* else */
-				res = huffman_decode_spectral_data(
+				res = huffman_spectral_values(
 					bs,
-					ics->section_data.sect_cb[g][i],
-					NULL,
-					NULL,
-					&y,
-					&z);
-				ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
-				k += PAIR_LEN;
-				if (ics->section_data.sect_cb[g][i] ==
-				    ESC_HCB) {
-					if (Abs(y) == ESC_FLAG)
-						y = get_escape(bs, y);
-					if (Abs(z) == ESC_FLAG)
-						z = get_escape(bs, z);
-				}
+					cb,
+					x_quant != NULL ? &x_quant[k] : NULL);
+				AAC_RETURN_ERR_IF(res < 0, -res);
+				k += (cb < FIRST_PAIR_HCB) ? QUAD_LEN
+							   : PAIR_LEN;
 			}
 		}
 	}
@@ -1081,56 +1219,63 @@ static int AAC_SYNTAX_FCT(individual_channel_stream)(
 	int scale_flag)
 {
 	int res;
+	AAC_FIELD_OFFSET(AAC_FIELD_ID_GLOBAL_GAIN, 8);
 	AAC_BITS(ics->global_gain, 8);
 	if (!common_window && !scale_flag) {
+		AAC_BIT_STATS(AAC_BIT_STATS_ID_ICS_INFO);
 		res = AAC_SYNTAX_FCT(ics_info)(
 			bs, ctx, &ics->ics_info, common_window);
-		ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+		AAC_BIT_STATS(AAC_BIT_STATS_ID_OTHER);
 		res = set_dec_info(ctx, &ics->ics_info);
-		ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+		AAC_RETURN_ERR_IF(res < 0, -res);
 	}
-	LOG_OFFSET("section_data")
+	AAC_BIT_STATS(AAC_BIT_STATS_ID_SECTION_DATA);
 	res = AAC_SYNTAX_FCT(section_data)(bs, ctx, ics, &ics->section_data);
-	ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
-	LOG_OFFSET("scale_factor_data");
+	AAC_RETURN_ERR_IF(res < 0, -res);
+	AAC_BIT_STATS(AAC_BIT_STATS_ID_SCALE_FACTOR_DATA);
 	res = AAC_SYNTAX_FCT(scale_factor_data)(
 		bs, ctx, ics, &ics->scale_factor_data);
-	ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+	AAC_RETURN_ERR_IF(res < 0, -res);
+	AAC_BIT_STATS(AAC_BIT_STATS_ID_OTHER);
 
 	if (!scale_flag) {
 		AAC_BITS(ics->pulse_data_present, 1);
 		if (ics->pulse_data_present) {
-			LOG_OFFSET("pulse_data");
+			AAC_BIT_STATS(AAC_BIT_STATS_ID_PULSE_DATA);
 			res = AAC_SYNTAX_FCT(pulse_data)(
 				bs, ctx, ics, &ics->pulse_data);
-			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			AAC_RETURN_ERR_IF(res < 0, -res);
+			AAC_BIT_STATS(AAC_BIT_STATS_ID_OTHER);
 		}
 		AAC_BITS(ics->tns_data_present, 1);
 		if (ics->tns_data_present) {
-			LOG_OFFSET("tns_data");
+			AAC_BIT_STATS(AAC_BIT_STATS_ID_TNS_DATA);
 			res = AAC_SYNTAX_FCT(tns_data)(
 				bs, ctx, ics, &ics->tns_data);
-			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			AAC_RETURN_ERR_IF(res < 0, -res);
+			AAC_BIT_STATS(AAC_BIT_STATS_ID_OTHER);
 		}
 		AAC_BITS(ics->gain_control_data_present, 1);
 		if (ics->gain_control_data_present) {
-			LOG_OFFSET("gain_control_data");
+			AAC_BIT_STATS(AAC_BIT_STATS_ID_GAIN_CONTROL_DATA);
 			res = AAC_SYNTAX_FCT(gain_control_data)(
 				bs, ctx, ics, &ics->gain_control_data);
-			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			AAC_RETURN_ERR_IF(res < 0, -res);
+			AAC_BIT_STATS(AAC_BIT_STATS_ID_OTHER);
 		}
 	}
 	if (!has_aacSpectralDataResilienceFlag(ctx)) {
-		LOG_OFFSET("spectral_data");
+		AAC_BIT_STATS(AAC_BIT_STATS_ID_SPECTRAL_DATA);
 		res = AAC_SYNTAX_FCT(spectral_data)(
 			bs, ctx, ics, &ics->spectral_data);
-		ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+		AAC_BIT_STATS(AAC_BIT_STATS_ID_OTHER);
 	} else {
 		AAC_BITS(ics->length_of_reordered_spectral_data, 14);
 		AAC_BITS(ics->length_of_longest_codeword, 6);
 		/* reordered_spectral_data()*/
-		ULOGE("reordered_spectral_data");
-		return -ENOSYS;
+		AAC_RETURN_ERR(ENOSYS);
 	}
 	return 0;
 }
@@ -1145,11 +1290,12 @@ static int AAC_SYNTAX_FCT(single_channel_element)(
 	struct aac_single_channel_element *sce)
 {
 	int res;
+	AAC_FIELD_OFFSET(AAC_FIELD_ID_ELEMENT_INSTANCE_TAG, 4);
 	AAC_BITS(sce->element_instance_tag, 4);
 	AAC_BEGIN_STRUCT(individual_channel_stream);
 	res = AAC_SYNTAX_FCT(individual_channel_stream)(
 		bs, ctx, &sce->ics, 0, 0);
-	ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+	AAC_RETURN_ERR_IF(res < 0, -res);
 	AAC_END_STRUCT(individual_channel_stream);
 
 	return 0;
@@ -1165,14 +1311,17 @@ static int AAC_SYNTAX_FCT(channel_pair_element)(
 	struct aac_channel_pair_element *cpe)
 {
 	int res;
+	AAC_FIELD_OFFSET(AAC_FIELD_ID_ELEMENT_INSTANCE_TAG, 4);
 	AAC_BITS(cpe->element_instance_tag, 4);
 	AAC_BITS(cpe->common_window, 1);
 	if (cpe->common_window) {
+		AAC_BIT_STATS(AAC_BIT_STATS_ID_ICS_INFO);
 		res = AAC_SYNTAX_FCT(ics_info)(
 			bs, ctx, &cpe->ics_info, cpe->common_window);
-		ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+		AAC_BIT_STATS(AAC_BIT_STATS_ID_OTHER);
 		res = set_dec_info(ctx, &cpe->ics_info);
-		ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+		AAC_RETURN_ERR_IF(res < 0, -res);
 		cpe->ics1.ics_info = cpe->ics_info;
 		cpe->ics2.ics_info = cpe->ics_info;
 		AAC_BITS(cpe->ms_mask_present, 2);
@@ -1190,12 +1339,12 @@ static int AAC_SYNTAX_FCT(channel_pair_element)(
 	AAC_BEGIN_ARRAY_ITEM();
 	res = AAC_SYNTAX_FCT(individual_channel_stream)(
 		bs, ctx, &cpe->ics1, cpe->common_window, 0);
-	ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+	AAC_RETURN_ERR_IF(res < 0, -res);
 	AAC_END_ARRAY_ITEM();
 	AAC_BEGIN_ARRAY_ITEM();
 	res = AAC_SYNTAX_FCT(individual_channel_stream)(
 		bs, ctx, &cpe->ics2, cpe->common_window, 0);
-	ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+	AAC_RETURN_ERR_IF(res < 0, -res);
 	AAC_END_ARRAY_ITEM();
 	AAC_END_ARRAY(individual_channel_stream);
 
@@ -1212,6 +1361,7 @@ static int AAC_SYNTAX_FCT(coupling_channel_element)(
 	struct aac_coupling_channel_element *cce)
 {
 	int res;
+	AAC_FIELD_OFFSET(AAC_FIELD_ID_ELEMENT_INSTANCE_TAG, 4);
 	AAC_BITS(cce->element_instance_tag, 4);
 	AAC_BITS(cce->ind_sw_cce_flag, 1);
 	AAC_BITS(cce->num_coupled_element, 3);
@@ -1233,7 +1383,7 @@ static int AAC_SYNTAX_FCT(coupling_channel_element)(
 
 	res = AAC_SYNTAX_FCT(individual_channel_stream)(
 		bs, ctx, &cce->ics, 0, 0);
-	ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+	AAC_RETURN_ERR_IF(res < 0, -res);
 
 	int cge = 0;
 	for (int c = 1; c < num_gain_element_lists; c++) {
@@ -1244,8 +1394,9 @@ static int AAC_SYNTAX_FCT(coupling_channel_element)(
 			cge = cce->common_gain_element_present[c];
 		}
 		if (cge) {
-			res = huffman_decode_scale_factor(bs);
-			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			res = huffman_scale_factor(
+				bs, cce->common_gain_element[c]);
+			AAC_RETURN_ERR_IF(res < 0, -res);
 			cce->common_gain_element[c] = res;
 			continue;
 		}
@@ -1255,8 +1406,11 @@ static int AAC_SYNTAX_FCT(coupling_channel_element)(
 			     sfb++) {
 				if (cce->ics.section_data.sfb_cb[g][sfb] !=
 				    ZERO_HCB) {
-					res = huffman_decode_scale_factor(bs);
-					ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+					res = huffman_scale_factor(
+						bs,
+						cce->dpcm_gain_element[c][g]
+								      [sfb]);
+					AAC_RETURN_ERR_IF(res < 0, -res);
 					cce->dpcm_gain_element[c][g][sfb] = res;
 				}
 			}
@@ -1274,6 +1428,7 @@ static int
 					    struct aac_ctx *ctx,
 					    struct aac_data_stream_element *dse)
 {
+	AAC_FIELD_OFFSET(AAC_FIELD_ID_ELEMENT_INSTANCE_TAG, 4);
 	AAC_BITS(dse->element_instance_tag, 4);
 	AAC_BITS(dse->data_byte_align_flag, 1);
 	AAC_BITS(dse->count, 8);
@@ -1300,6 +1455,7 @@ static int AAC_SYNTAX_FCT(program_config_element)(
 	struct aac_ctx *ctx,
 	struct aac_program_config_element *pce)
 {
+	AAC_FIELD_OFFSET(AAC_FIELD_ID_ELEMENT_INSTANCE_TAG, 4);
 	AAC_BITS(pce->element_instance_tag, 4);
 	AAC_BITS(pce->object_type, 2);
 	AAC_BITS(pce->sampling_frequency_index, 4);
@@ -1351,6 +1507,8 @@ static int AAC_SYNTAX_FCT(program_config_element)(
 
 #if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
 	aac_bs_read_trailing_bits(bs);
+#elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+	aac_bs_write_trailing_bits(bs);
 #endif
 
 	AAC_BITS(pce->comment_field_bytes, 8);
@@ -1375,36 +1533,23 @@ static int AAC_SYNTAX_FCT(extension_payload)(
 	uint8_t other_bits = 0;
 	uint8_t fill_nibble = 0;
 	uint8_t fill_byte = 0;
+	AAC_TRACE(AAC_TRACE_TYPE_EXTENSION, extension_payload->extension_type);
 	switch (extension_payload->extension_type) {
 	case AAC_EXT_TYPE_FILL_DATA:
-		ULOGD("AAC_EXT_TYPE_FILL_DATA");
 		AAC_BITS(fill_nibble, 4); /* must be '0000' */
-		ULOG_ERRNO_RETURN_ERR_IF(fill_nibble != 0, EINVAL);
+		AAC_RETURN_ERR_IF(fill_nibble != 0, EINVAL);
 		for (int i = 0; i < count - 1; i++) {
 			AAC_BITS(fill_byte, 8); /* must be '10100101' */
-			ULOG_ERRNO_RETURN_ERR_IF(fill_byte != 0xA5, EINVAL);
+			AAC_RETURN_ERR_IF(fill_byte != 0xA5, EINVAL);
 		}
 		return count;
 
 	case AAC_EXT_DATA_ELEMENT:
-		ULOGD("AAC_EXT_DATA_ELEMENT");
-		return -ENOSYS;
-
 	case AAC_EXT_DYNAMIC_RANGE:
-		ULOGD("AAC_EXT_DYNAMIC_RANGE");
-		return -ENOSYS;
-
 	case AAC_EXT_SAC_DATA:
-		ULOGD("AAC_EXT_SAC_DATA");
-		return -ENOSYS;
-
 	case AAC_EXT_SBR_DATA:
-		ULOGD("AAC_EXT_SBR_DATA");
-		return -ENOSYS;
-
 	case AAC_EXT_SBR_DATA_CRC:
-		ULOGD("AAC_EXT_SBR_DATA_CRC");
-		return -ENOSYS;
+		AAC_RETURN_ERR(ENOSYS);
 
 	case AAC_EXT_TYPE_FILL:
 	default:
@@ -1437,7 +1582,7 @@ static int AAC_SYNTAX_FCT(fill_element)(struct aac_bitstream *bs,
 	while (cnt > 0) {
 		res = AAC_SYNTAX_FCT(extension_payload)(
 			bs, ctx, &fil->extension_payload, cnt);
-		ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+		AAC_RETURN_ERR_IF(res < 0, -res);
 		cnt -= res;
 	}
 #elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
@@ -1472,96 +1617,115 @@ static int AAC_SYNTAX_FCT(raw_data_block)(
 {
 	int res;
 #if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+	uint32_t *element_bits;
+	AAC_RETURN_ERR_IF(ctx->raw_data_block_count >= AAC_MAX_RAW_DATA_BLOCKS,
+			  EPROTO);
+	element_bits = ctx->element_bits[ctx->raw_data_block_count++];
 	memset(raw_data_block, 0, sizeof(*raw_data_block));
 	while (raw_data_block->elements_count < AAC_MAX_SYN_ELE) {
 		size_t i = raw_data_block->elements_count;
 #else
+#	if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+	/* The spectral lines are used from the first ics (the block can be
+	 * written twice, eg. to compute the ADTS frame length first) */
+	ctx->x_quant_index = 0;
+#	endif
 	for (size_t i = 0; i < raw_data_block->elements_count; i++) {
 #endif
 		struct aac_syntactic_element *element =
 			&raw_data_block->elements[i];
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+		size_t start_bit_off = aac_bs_read_bit_off(bs);
+#endif
 		AAC_BITS(element->id_syn_ele, 3);
+		AAC_TRACE(AAC_TRACE_TYPE_ELEMENT, element->id_syn_ele);
 		switch (element->id_syn_ele) {
 		case AAC_SYN_ELE_ID_SCE:
-			ULOGD("AAC_SYN_ELE_ID_SCE");
 			AAC_BEGIN_STRUCT(aac_single_channel_element);
 			res = AAC_SYNTAX_FCT(single_channel_element)(
 				bs, ctx, &element->sce);
-			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			AAC_RETURN_ERR_IF(res < 0, -res);
 			AAC_END_STRUCT(aac_single_channel_element);
 			raw_data_block->elements_count++;
 			break;
 
 		case AAC_SYN_ELE_ID_CPE:
-			ULOGD("AAC_SYN_ELE_ID_CPE");
 			AAC_BEGIN_STRUCT(channel_pair_element);
 			res = AAC_SYNTAX_FCT(channel_pair_element)(
 				bs, ctx, &element->cpe);
-			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			AAC_RETURN_ERR_IF(res < 0, -res);
 			AAC_END_STRUCT(channel_pair_element);
 			raw_data_block->elements_count++;
 			break;
 
 		case AAC_SYN_ELE_ID_CCE:
-			ULOGD("AAC_SYN_ELE_ID_CCE");
 			AAC_BEGIN_STRUCT(coupling_channel_element);
 			res = AAC_SYNTAX_FCT(coupling_channel_element)(
 				bs, ctx, &element->cce);
-			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			AAC_RETURN_ERR_IF(res < 0, -res);
 			AAC_END_STRUCT(coupling_channel_element);
 			raw_data_block->elements_count++;
 			break;
 
 		case AAC_SYN_ELE_ID_LFE:
-			ULOGD("AAC_SYN_ELE_ID_LFE");
-			return -ENOSYS;
+			/* Table 4.9: same syntax as single_channel_element() */
+			AAC_BEGIN_STRUCT(lfe_channel_element);
+			res = AAC_SYNTAX_FCT(single_channel_element)(
+				bs, ctx, &element->sce);
+			AAC_RETURN_ERR_IF(res < 0, -res);
+			AAC_END_STRUCT(lfe_channel_element);
+			raw_data_block->elements_count++;
+			break;
 
 		case AAC_SYN_ELE_ID_DSE:
-			ULOGD("AAC_SYN_ELE_ID_DSE");
 			AAC_BEGIN_STRUCT(data_stream_element);
 			res = AAC_SYNTAX_FCT(data_stream_element)(
 				bs, ctx, &element->dse);
-			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			AAC_RETURN_ERR_IF(res < 0, -res);
 			AAC_END_STRUCT(data_stream_element);
 			raw_data_block->elements_count++;
 			break;
 
 		case AAC_SYN_ELE_ID_PCE:
-			ULOGD("AAC_SYN_ELE_ID_PCE");
 			AAC_BEGIN_STRUCT(program_config_element);
 			res = AAC_SYNTAX_FCT(program_config_element)(
 				bs, ctx, &element->pce);
-			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			AAC_RETURN_ERR_IF(res < 0, -res);
 			AAC_END_STRUCT(program_config_element);
 			raw_data_block->elements_count++;
 			break;
 
 		case AAC_SYN_ELE_ID_FIL:
-			ULOGD("AAC_SYN_ELE_ID_FIL");
 			AAC_BEGIN_STRUCT(fill_element);
+			AAC_BIT_STATS(AAC_BIT_STATS_ID_FILL);
 			res = AAC_SYNTAX_FCT(fill_element)(
 				bs, ctx, &element->fil);
-			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			AAC_RETURN_ERR_IF(res < 0, -res);
+			AAC_BIT_STATS(AAC_BIT_STATS_ID_OTHER);
 			AAC_END_STRUCT(fill_element);
 			raw_data_block->elements_count++;
 			break;
 
 		case AAC_SYN_ELE_ID_END:
-			ULOGD("AAC_SYN_ELE_ID_END");
 			goto padding;
 
 		default:
-			ULOGE("unsupported code: %d", element->id_syn_ele);
-			return -EINVAL;
+			AAC_RETURN_ERR(EINVAL);
 		}
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+		element_bits[i] = aac_bs_read_bit_off(bs) - start_bit_off;
+#endif
 	}
 padding:
 #if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
-	res = aac_bs_read_trailing_bits(bs);
-	ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+	/* In LOAS, the end of the payload is handled by PayloadMux() */
+	if (ctx->transport != AAC_TRANSPORT_LOAS) {
+		res = aac_bs_read_trailing_bits(bs);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+	}
 #elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
 	res = aac_bs_write_trailing_bits(bs);
-	ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+	AAC_RETURN_ERR_IF(res < 0, -res);
 #endif
 
 	return 0;
@@ -1586,14 +1750,15 @@ static int AAC_SYNTAX_FCT(adts_frame)(struct aac_bitstream *bs,
 	buf = bs->cdata + bs->off;
 	len = bs->len;
 	res = aac_ctx_clear_adts(ctx);
-	ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+	AAC_RETURN_ERR_IF(res < 0, -res);
 #endif
 
+	AAC_BIT_STATS(AAC_BIT_STATS_ID_HEADER);
 	AAC_BEGIN_STRUCT(aac_adts);
 	res = AAC_SYNTAX_FCT(adts_fixed_header)(bs, &ctx->adts);
-	ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+	AAC_RETURN_ERR_IF(res < 0, -res);
 	res = AAC_SYNTAX_FCT(adts_variable_header)(bs, &ctx->adts);
-	ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+	AAC_RETURN_ERR_IF(res < 0, -res);
 	AAC_END_STRUCT(aac_adts);
 
 	end_off = start_off + ctx->adts.aac_frame_length;
@@ -1607,13 +1772,14 @@ static int AAC_SYNTAX_FCT(adts_frame)(struct aac_bitstream *bs,
 
 	if (ctx->adts.number_of_raw_data_blocks_in_frame == 0) {
 		res = AAC_SYNTAX_FCT(adts_error_check)(bs, ctx);
-		ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+		AAC_BIT_STATS(AAC_BIT_STATS_ID_OTHER);
 #if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
 		if ((AAC_READ_FLAGS() & AAC_READER_FLAGS_FRAME_DATA) != 0) {
 			AAC_BEGIN_STRUCT(raw_data_block);
 			res = AAC_SYNTAX_FCT(raw_data_block)(
 				bs, ctx, &ctx->adts_frame.raw_data_block[0]);
-			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			AAC_RETURN_ERR_IF(res < 0, -res);
 			AAC_END_STRUCT(raw_data_block);
 		} else {
 			/* Pad to the next byte */
@@ -1632,13 +1798,13 @@ static int AAC_SYNTAX_FCT(adts_frame)(struct aac_bitstream *bs,
 			AAC_BEGIN_STRUCT(raw_data_block);
 			res = AAC_SYNTAX_FCT(raw_data_block)(
 				bs, ctx, &ctx->adts_frame.raw_data_block[0]);
-			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			AAC_RETURN_ERR_IF(res < 0, -res);
 			AAC_END_STRUCT(raw_data_block);
 		}
 #elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
 		res = AAC_SYNTAX_FCT(raw_data_block)(
 			bs, ctx, &ctx->adts_frame.raw_data_block[0]);
-		ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+		AAC_RETURN_ERR_IF(res < 0, -res);
 #else
 #	error "Unsupported AAC_SYNTAX_OP_KIND"
 #endif
@@ -1652,6 +1818,7 @@ static int AAC_SYNTAX_FCT(adts_frame)(struct aac_bitstream *bs,
 		return 0;
 	} else {
 		res = AAC_SYNTAX_FCT(adts_error_check)(bs, ctx);
+		AAC_BIT_STATS(AAC_BIT_STATS_ID_OTHER);
 		for (int i = 0;
 		     i <= ctx->adts.number_of_raw_data_blocks_in_frame;
 		     i++) {
@@ -1662,7 +1829,7 @@ static int AAC_SYNTAX_FCT(adts_frame)(struct aac_bitstream *bs,
 					bs,
 					ctx,
 					&ctx->adts_frame.raw_data_block[i]);
-				ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+				AAC_RETURN_ERR_IF(res < 0, -res);
 			} else {
 				/* Pad to the next byte */
 				while (!aac_bs_byte_aligned(bs)) {
@@ -1682,12 +1849,12 @@ static int AAC_SYNTAX_FCT(adts_frame)(struct aac_bitstream *bs,
 					bs,
 					ctx,
 					&ctx->adts_frame.raw_data_block[i]);
-				ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+				AAC_RETURN_ERR_IF(res < 0, -res);
 			}
 #elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
 			res = AAC_SYNTAX_FCT(raw_data_block)(
 				bs, ctx, &ctx->adts_frame.raw_data_block[i]);
-			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			AAC_RETURN_ERR_IF(res < 0, -res);
 #else
 #	error "Unsupported AAC_SYNTAX_OP_KIND"
 #endif
@@ -1703,5 +1870,455 @@ static int AAC_SYNTAX_FCT(adts_frame)(struct aac_bitstream *bs,
 	return 0;
 }
 
+/**
+ * Table 1.A.2 – Syntax of adif_header()
+ * The byte_alignment() following the header (Table 1.A.1) is included.
+ */
+static int AAC_SYNTAX_FCT(adif_header)(struct aac_bitstream *bs,
+				       struct aac_ctx *ctx,
+				       struct aac_adif_header *adif)
+{
+	int res;
+
+	AAC_BITS(adif->adif_id, 32);
+	AAC_RETURN_ERR_IF(adif->adif_id != 0x41444946, EINVAL);
+	AAC_BITS(adif->copyright_id_present, 1);
+	if (adif->copyright_id_present) {
+		for (int i = 0; i < 9; i++)
+			AAC_BITS(adif->copyright_id[i], 8);
+	}
+	AAC_BITS(adif->original_copy, 1);
+	AAC_BITS(adif->home, 1);
+	AAC_BITS(adif->bitstream_type, 1);
+	AAC_BITS(adif->bitrate, 23);
+	AAC_BITS(adif->num_program_config_elements, 4);
+	AAC_BEGIN_ARRAY(program_config_element);
+	for (int i = 0; i < adif->num_program_config_elements + 1; i++) {
+		AAC_BEGIN_ARRAY_ITEM();
+		if (adif->bitstream_type == 0)
+			AAC_BITS(adif->adif_buffer_fullness[i], 20);
+		res = AAC_SYNTAX_FCT(program_config_element)(
+			bs, ctx, &adif->program_config_element[i]);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+		AAC_END_ARRAY_ITEM();
+	}
+	AAC_END_ARRAY(program_config_element);
+
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+	res = aac_bs_read_trailing_bits(bs);
+	AAC_RETURN_ERR_IF(res < 0, -res);
+#elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+	res = aac_bs_write_trailing_bits(bs);
+	AAC_RETURN_ERR_IF(res < 0, -res);
+#endif
+	return 0;
+}
+
+
+/**
+ * 1.7.3 – Syntax of LatmGetValue()
+ */
+static int AAC_SYNTAX_FCT(LatmGetValue)(struct aac_bitstream *bs,
+					AAC_SYNTAX_CONST uint32_t *value)
+{
+#if AAC_SYNTAX_OP_KIND != AAC_SYNTAX_OP_KIND_DUMP
+	uint8_t bytesForValue = 0;
+	uint8_t valueTmp = 0;
+
+#	if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+	while (bytesForValue < 3 && (*value >> (8 * (bytesForValue + 1))) != 0)
+		bytesForValue++;
+#	else
+	*value = 0;
+#	endif
+	AAC_BITS(bytesForValue, 2);
+	for (int i = bytesForValue; i >= 0; i--) {
+#	if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+		valueTmp = *value >> (8 * i);
+#	endif
+		AAC_BITS(valueTmp, 8);
+#	if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+		*value = (*value << 8) | valueTmp;
+#	endif
+	}
+#endif
+	return 0;
+}
+
+
+/**
+ * 1.7.3 – Syntax of StreamMuxConfig()
+ * The AudioSpecificConfig of the first layer is read into (or written from)
+ * asc.
+ */
+static int AAC_SYNTAX_FCT(StreamMuxConfig)(struct aac_bitstream *bs,
+					   struct aac_StreamMuxConfig *smc,
+					   struct aac_asc *asc)
+{
+	int res;
+
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+	memset(smc, 0, sizeof(*smc));
+	memset(asc, 0, sizeof(*asc));
+#endif
+
+	AAC_BITS(smc->audioMuxVersion, 1);
+	if (smc->audioMuxVersion == 1)
+		AAC_BITS(smc->audioMuxVersionA, 1);
+	if (smc->audioMuxVersionA != 0) {
+		/* tbd */
+		return -ENOSYS;
+	}
+
+	if (smc->audioMuxVersion == 1) {
+		res = AAC_SYNTAX_FCT(LatmGetValue)(bs,
+						   &smc->taraBufferFullness);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+		AAC_FIELD(taraBufferFullness, smc->taraBufferFullness);
+	}
+	AAC_BITS(smc->allStreamsSameTimeFraming, 1);
+	AAC_BITS(smc->numSubFrames, 6);
+	AAC_BITS(smc->numProgram, 4);
+	if (smc->numProgram != 0) {
+		/* Multiple programs, tbd */
+		return -ENOSYS;
+	}
+	AAC_BITS(smc->numLayer, 3);
+	if (smc->numLayer != 0) {
+		/* Multiple layers, tbd */
+		return -ENOSYS;
+	}
+	if (smc->numSubFrames >= AAC_MAX_RAW_DATA_BLOCKS)
+		return -ENOSYS;
+
+	/* First layer of the first program: useSameConfig = 0 */
+	AAC_BEGIN_STRUCT(AudioSpecificConfig);
+	if (smc->audioMuxVersion == 0) {
+		res = AAC_SYNTAX_FCT(AudioSpecificConfig)(bs, asc, 0);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+	} else {
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+		/* Compute the AudioSpecificConfig length */
+		struct aac_bitstream asc_bs;
+		aac_bs_init(&asc_bs, NULL, 0);
+		res = AAC_SYNTAX_FCT(AudioSpecificConfig)(
+			&asc_bs, asc, 0);
+		smc->ascLen = asc_bs.off * 8 + asc_bs.cachebits;
+		aac_bs_clear(&asc_bs);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+#endif
+		res = AAC_SYNTAX_FCT(LatmGetValue)(bs, &smc->ascLen);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+		AAC_FIELD(ascLen, smc->ascLen);
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+		size_t asc_start = aac_bs_read_bit_off(bs);
+		size_t asc_bits;
+		res = AAC_SYNTAX_FCT(AudioSpecificConfig)(bs, asc, 0);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+		asc_bits = aac_bs_read_bit_off(bs) - asc_start;
+		AAC_RETURN_ERR_IF(asc_bits > smc->ascLen, EPROTO);
+		/* fillBits */
+		res = aac_bs_skip_bits(bs, smc->ascLen - asc_bits);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+#else
+		res = AAC_SYNTAX_FCT(AudioSpecificConfig)(bs, asc, 0);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+#endif
+	}
+	AAC_END_STRUCT(AudioSpecificConfig);
+
+	AAC_BITS(smc->frameLengthType, 3);
+	if (smc->frameLengthType != 0) {
+		/* Fixed, CELP and HVXC frame lengths, tbd */
+		return -ENOSYS;
+	}
+	AAC_BITS(smc->latmBufferFullness, 8);
+	/* coreFrameOffset is only present for layers other than the first */
+
+	AAC_BITS(smc->otherDataPresent, 1);
+	if (smc->otherDataPresent) {
+		if (smc->audioMuxVersion == 1) {
+			res = AAC_SYNTAX_FCT(LatmGetValue)(
+				bs, &smc->otherDataLenBits);
+			AAC_RETURN_ERR_IF(res < 0, -res);
+		} else {
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+			uint8_t otherDataLenEsc = 0;
+			uint8_t otherDataLenTmp = 0;
+			do {
+				AAC_BITS(otherDataLenEsc, 1);
+				AAC_BITS(otherDataLenTmp, 8);
+				smc->otherDataLenBits =
+					(smc->otherDataLenBits << 8) +
+					otherDataLenTmp;
+			} while (otherDataLenEsc);
+#elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+			uint32_t bits = smc->otherDataLenBits;
+			int n = 0;
+			while (n < 3 && (bits >> (8 * (n + 1))) != 0)
+				n++;
+			for (int i = n; i >= 0; i--) {
+				AAC_BITS(i > 0, 1);
+				AAC_BITS(smc->otherDataLenBits >> (8 * i), 8);
+			}
+#endif
+		}
+		AAC_FIELD(otherDataLenBits, smc->otherDataLenBits);
+	}
+	AAC_BITS(smc->crcCheckPresent, 1);
+	if (smc->crcCheckPresent)
+		AAC_BITS(smc->crcCheckSum, 8);
+
+	return 0;
+}
+
+
+/**
+ * 1.7.3 – Syntax of PayloadLengthInfo()
+ */
+static int AAC_SYNTAX_FCT(PayloadLengthInfo)(struct aac_bitstream *bs,
+					     struct aac_ctx *ctx,
+					     int i)
+{
+	struct aac_AudioMuxElement *ame = &ctx->loas_frame.AudioMuxElement;
+
+	if (!ctx->smc.allStreamsSameTimeFraming) {
+		/* numChunk, tbd */
+		return -ENOSYS;
+	}
+
+	/* frameLengthType == 0 */
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+	uint8_t tmp = 0;
+	ame->MuxSlotLengthBytes[i] = 0;
+	do {
+		AAC_BITS(tmp, 8);
+		ame->MuxSlotLengthBytes[i] += tmp;
+	} while (tmp == 255);
+#elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+	uint8_t tmp = 0;
+	uint32_t rem = ame->MuxSlotLengthBytes[i];
+	do {
+		tmp = rem >= 255 ? 255 : rem;
+		AAC_BITS(tmp, 8);
+		rem -= tmp;
+	} while (tmp == 255);
+#else
+	AAC_BITS(ame->MuxSlotLengthBytes[i], 8);
+#endif
+	return 0;
+}
+
+
+/**
+ * 1.7.3 – Syntax of PayloadMux()
+ * In write mode, the payload is the encoded raw data block.
+ */
+static int AAC_SYNTAX_FCT(PayloadMux)(struct aac_bitstream *bs,
+				      struct aac_ctx *ctx,
+				      int i,
+				      const uint8_t *payload)
+{
+	struct aac_loas_frame *loas_frame = &ctx->loas_frame;
+
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+	int res;
+	uint32_t len = loas_frame->AudioMuxElement.MuxSlotLengthBytes[i];
+	size_t end = aac_bs_read_bit_off(bs) + 8 * (size_t)len;
+	AAC_BIT_STATS(AAC_BIT_STATS_ID_OTHER);
+	if ((AAC_READ_FLAGS() & AAC_READER_FLAGS_FRAME_DATA) != 0) {
+		res = AAC_SYNTAX_FCT(raw_data_block)(
+			bs, ctx, &loas_frame->raw_data_block[i]);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+		AAC_RETURN_ERR_IF(aac_bs_read_bit_off(bs) > end,
+					 EPROTO);
+	}
+	/* The payload is not byte aligned: skip up to its end */
+	res = aac_bs_skip_bits(bs, end - aac_bs_read_bit_off(bs));
+	AAC_RETURN_ERR_IF(res < 0, -res);
+#elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_DUMP
+	int res;
+	if ((AAC_DUMP_FLAGS() & AAC_DUMP_FLAGS_FRAME_DATA) != 0) {
+		AAC_BEGIN_STRUCT(raw_data_block);
+		res = AAC_SYNTAX_FCT(raw_data_block)(
+			bs, ctx, &loas_frame->raw_data_block[i]);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+		AAC_END_STRUCT(raw_data_block);
+	}
+#elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+	uint32_t len = loas_frame->AudioMuxElement.MuxSlotLengthBytes[i];
+	for (uint32_t j = 0; j < len; j++)
+		AAC_BITS(payload[j], 8);
+#else
+#	error "Unsupported AAC_SYNTAX_OP_KIND"
+#endif
+	return 0;
+}
+
+
+/**
+ * 1.7.3 – Syntax of AudioMuxElement()
+ * The loas_frame_begin callback is called once the StreamMuxConfig is known.
+ * Returns -EAGAIN if no StreamMuxConfig has been received yet.
+ */
+static int AAC_SYNTAX_FCT(AudioMuxElement)(struct aac_bitstream *bs,
+					   struct aac_ctx *ctx,
+					   int muxConfigPresent,
+					   const struct aac_ctx_cbs *cbs,
+					   void *userdata,
+					   const uint8_t *buf,
+					   size_t len,
+					   const uint8_t *payload)
+{
+	int res;
+	struct aac_AudioMuxElement *ame = &ctx->loas_frame.AudioMuxElement;
+
+	if (muxConfigPresent) {
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+		ame->useSameStreamMux = ctx->smc_sent;
+#endif
+		AAC_BITS(ame->useSameStreamMux, 1);
+		if (!ame->useSameStreamMux) {
+			AAC_BEGIN_STRUCT(StreamMuxConfig);
+			res = AAC_SYNTAX_FCT(StreamMuxConfig)(
+				bs, &ctx->smc, &ctx->asc);
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+			/* Cached until the next StreamMuxConfig */
+			ctx->smc_valid = (res == 0);
+#endif
+			AAC_RETURN_ERR_IF(res < 0, -res);
+			AAC_END_STRUCT(StreamMuxConfig);
+		}
+	}
+	if (!ctx->smc_valid)
+		return -EAGAIN;
+
+	AAC_CB(ctx, cbs, userdata, loas_frame_begin, buf, len, &ctx->smc);
+
+	if (ctx->smc.audioMuxVersionA != 0) {
+		/* tbd */
+		return -ENOSYS;
+	}
+	for (int i = 0; i <= ctx->smc.numSubFrames; i++) {
+		res = AAC_SYNTAX_FCT(PayloadLengthInfo)(bs, ctx, i);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+		res = AAC_SYNTAX_FCT(PayloadMux)(bs, ctx, i, payload);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+	}
+	if (ctx->smc.otherDataPresent) {
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+		res = aac_bs_skip_bits(bs, ctx->smc.otherDataLenBits);
+		AAC_RETURN_ERR_IF(res < 0, -res);
+#elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+		for (uint32_t i = 0; i < ctx->smc.otherDataLenBits; i++)
+			AAC_BITS(0, 1);
+#endif
+	}
+
+	/* ByteAlign() */
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+	while (!aac_bs_byte_aligned(bs)) {
+		uint8_t read;
+		AAC_BITS(read, 1);
+	}
+#elif AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+	res = aac_bs_write_trailing_bits(bs);
+	AAC_RETURN_ERR_IF(res < 0, -res);
+#endif
+	return 0;
+}
+
+
+/**
+ * 1.7.2 – Syntax of AudioSyncStream(), one LOAS frame
+ * In write mode, the frame carries a single raw data block, given already
+ * encoded in payload.
+ */
+static int AAC_SYNTAX_FCT(loas_frame)(struct aac_bitstream *bs,
+				      struct aac_ctx *ctx,
+				      const struct aac_ctx_cbs *cbs,
+				      void *userdata,
+				      const uint8_t *payload,
+				      size_t payload_len)
+{
+	int res = 0;
+	struct aac_loas_frame *loas_frame = &ctx->loas_frame;
+
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_WRITE
+	struct aac_bitstream ame_bs;
+
+	AAC_RETURN_ERR_IF(!ctx->smc_valid, EINVAL);
+	AAC_RETURN_ERR_IF(ctx->smc.numSubFrames != 0, ENOSYS);
+	loas_frame->syncword = 0x2B7;
+	loas_frame->AudioMuxElement.MuxSlotLengthBytes[0] = payload_len;
+
+	/* audioMuxLengthBytes comes first: write the AudioMuxElement in a
+	 * temporary bitstream */
+	aac_bs_init(&ame_bs, NULL, 0);
+	res = AAC_SYNTAX_FCT(AudioMuxElement)(
+		&ame_bs, ctx, 1, cbs, userdata, NULL, 0, payload);
+	if (res < 0)
+		goto out;
+	if (ame_bs.off > 0x1FFF) {
+		res = -E2BIG;
+		ULOG_ERRNO("audioMuxLengthBytes", -res);
+		goto out;
+	}
+	loas_frame->audioMuxLengthBytes = ame_bs.off;
+
+	res = aac_bs_write_bits(bs, loas_frame->syncword, 11);
+	if (res < 0)
+		goto out;
+	res = aac_bs_write_bits(bs, loas_frame->audioMuxLengthBytes, 13);
+	if (res < 0)
+		goto out;
+	res = aac_bs_write_raw_bytes(bs, ame_bs.data, ame_bs.off);
+	if (res < 0)
+		goto out;
+	ctx->smc_sent = 1;
+
+out:
+	aac_bs_clear(&ame_bs);
+	return res;
+#else
+	const uint8_t *buf = NULL;
+	size_t len = 0;
+	size_t end_off = 0;
+
+#	if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+	int err;
+	buf = bs->cdata + bs->off;
+#	endif
+	end_off = bs->off;
+
+	AAC_BIT_STATS(AAC_BIT_STATS_ID_HEADER);
+	AAC_BEGIN_STRUCT(aac_loas);
+	AAC_BITS(loas_frame->syncword, 11);
+	AAC_RETURN_ERR_IF(loas_frame->syncword != 0x2B7, EINVAL);
+	AAC_BITS(loas_frame->audioMuxLengthBytes, 13);
+	AAC_END_STRUCT(aac_loas);
+
+	len = 3 + loas_frame->audioMuxLengthBytes;
+	end_off += len;
+
+	res = AAC_SYNTAX_FCT(AudioMuxElement)(
+		bs, ctx, 1, cbs, userdata, buf, len, payload);
+	AAC_RETURN_ERR_IF(res < 0 && res != -EAGAIN, -res);
+
+#	if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+	/* Go to the next frame (also when the frame is skipped) */
+	AAC_RETURN_ERR_IF(aac_bs_read_bit_off(bs) > end_off * 8,
+				 EPROTO);
+	err = aac_bs_skip_bits(bs, end_off * 8 - aac_bs_read_bit_off(bs));
+	AAC_RETURN_ERR_IF(err < 0, -err);
+#	endif
+	if (res < 0)
+		return res;
+
+	AAC_CB(ctx, cbs, userdata, loas_frame_end, buf, len, &ctx->smc);
+	return 0;
+#endif
+}
+
 
 #endif /* _AAC_SYNTAX_H_ */
@@ -56,11 +56,52 @@
 #define AAC_SYNTAX_FCT(_name) _AAC_SYNTAX_FCT(AAC_SYNTAX_OP_NAME, _name)
 
 
+/* Errors are recorded in the trace of the reader (if any) instead of being
+ * logged; the reader only logs the first one */
+#ifdef AAC_NO_TRACE
+#	define AAC_READ_TRACE(_type, _id) do {} while (0)
+#	define AAC_READ_RETURN_ERR_IF(_cond, _err)                             \
+		do {                                                           \
+			if (_cond)                                             \
+				return -(_err);                                \
+		} while (0)
+#else /* !AAC_NO_TRACE */
+#	define _AAC_READ_TRACE(_reader, _type, _id, _err)                      \
+		aac_trace_push(&(_reader)->trace,                              \
+			       (_type),                                        \
+			       (_id),                                          \
+			       (_err),                                         \
+			       aac_bs_read_bit_off(bs) -                       \
+				       (_reader)->frame_off * 8,               \
+			       __func__)
+#	define AAC_READ_TRACE(_type, _id)                                      \
+		do {                                                           \
+			struct aac_reader *_reader = bs->priv;                 \
+			if (_reader != NULL &&                                 \
+			    (_reader->flags & AAC_READER_FLAGS_TRACE) != 0)    \
+				_AAC_READ_TRACE(_reader, (_type), (_id), 0);   \
+		} while (0)
+#	define AAC_READ_RETURN_ERR_IF(_cond, _err)                             \
+		do {                                                           \
+			if (_cond) {                                           \
+				int _e = (_err);                               \
+				struct aac_reader *_reader = bs->priv;         \
+				if (_reader != NULL)                           \
+					_AAC_READ_TRACE(_reader,               \
+							AAC_TRACE_TYPE_ERROR,  \
+							0,                     \
+							_e);                   \
+				return -_e;                                    \
+			}                                                      \
+		} while (0)
+#endif /* !AAC_NO_TRACE */
+
+
 #define _AAC_READ_BITS(_name, _type, _field, ...)                              \
 	do {                                                                   \
 		_type _v = 0;                                                  \
 		int _res = aac_bs_read_bits_##_name(bs, &_v, ##__VA_ARGS__);   \
-		ULOG_ERRNO_RETURN_ERR_IF(_res < 0, -_res);                     \
+		AAC_READ_RETURN_ERR_IF(_res < 0, -_res);                       \
 		(_field) = _v;                                                 \
 	} while (0)
 
@@ -70,6 +111,31 @@
 
 #define AAC_READ_FLAGS() (((struct aac_reader *)(bs->priv))->flags)
 
+#define AAC_READ_FIELD_OFFSET(_id, _n)                                         \
+	do {                                                                   \
+		struct aac_reader *_reader = bs->priv;                         \
+		if (_reader != NULL &&                                         \
+		    (_reader->flags & AAC_READER_FLAGS_FIELD_OFFSETS) != 0) {  \
+			size_t _off = aac_bs_read_bit_off(bs) -                \
+				      _reader->frame_off * 8;                  \
+			aac_field_offsets_add(&_reader->ctx->field_offsets,    \
+					      (_id),                           \
+					      _off,                            \
+					      (_n));                           \
+		}                                                              \
+	} while (0)
+
+#define AAC_READ_BIT_STATS(_id)                                                \
+	do {                                                                   \
+		struct aac_reader *_reader = bs->priv;                         \
+		if (_reader != NULL &&                                         \
+		    (_reader->flags & AAC_READER_FLAGS_BIT_STATS) != 0) {      \
+			aac_bit_stats_mark(_reader->ctx,                       \
+					   (_id),                              \
+					   aac_bs_read_bit_off(bs));           \
+		}                                                              \
+	} while (0)
+
 
 #define _AAC_WRITE_BITS(_name, _type, _field, ...)                             \
 	do {                                                                   \
@@ -90,9 +156,35 @@
 		ULOG_ERRNO_RETURN_ERR_IF(_res < 0, -_res);                     \
 	} while (0)
 
-#define AAC_DUMP_BITS(_f, _n) _AAC_DUMP_CALL(field, #_f, _f)
-#define AAC_DUMP_BITS_U(_f, _n) _AAC_DUMP_CALL(field, #_f, _f)
-#define AAC_DUMP_BITS_I(_f, _n) _AAC_DUMP_CALL(field, #_f, _f)
+/* Key of a dumped field expression: the member name without the structure
+ * and the last subscript ("cpe->ms_used[g]" for "cpe->ms_used[g][sfb]");
+ * the string functions are folded on literals so that the key is resolved
+ * at compile time */
+static inline const char *aac_dump_key(const char *field, size_t *len)
+{
+	const char *start, *end;
+
+	start = strrchr(field, '.');
+	start = (start != NULL) ? start + 1 : field;
+	end = strrchr(start, '>');
+	start = (end != NULL) ? end + 1 : start;
+	while (*start == ' ')
+		start++;
+	end = strrchr(start, '[');
+	*len = (end != NULL) ? (size_t)(end - start) : strlen(start);
+	return start;
+}
+
+#define _AAC_DUMP_FIELD(_field, _val)                                          \
+	do {                                                                   \
+		size_t _len;                                                   \
+		const char *_key = aac_dump_key((_field), &_len);              \
+		_AAC_DUMP_CALL(field, _key, _len, (_val));                     \
+	} while (0)
+
+#define AAC_DUMP_BITS(_f, _n) _AAC_DUMP_FIELD(#_f, _f)
+#define AAC_DUMP_BITS_U(_f, _n) _AAC_DUMP_FIELD(#_f, _f)
+#define AAC_DUMP_BITS_I(_f, _n) _AAC_DUMP_FIELD(#_f, _f)
 
 #define AAC_DUMP_FLAGS() (((struct aac_dump *)(bs->priv))->flags)
 
@@ -105,8 +197,10 @@
 #  define AAC_END_ARRAY(_name)      _AAC_DUMP_CALL(end_array, #_name)
 #  define AAC_BEGIN_ARRAY_ITEM()    _AAC_DUMP_CALL(begin_array_item)
 #  define AAC_END_ARRAY_ITEM()      _AAC_DUMP_CALL(end_array_item)
-#  define AAC_FIELD(_name, _val)    _AAC_DUMP_CALL(field, #_name, _val)
-#  define AAC_FIELD_S(_name, _val)  _AAC_DUMP_CALL(field, _name, _val)
+#  define AAC_FIELD(_name, _val)    \
+	_AAC_DUMP_CALL(field, #_name, sizeof(#_name) - 1, _val)
+#  define AAC_FIELD_S(_name, _val)  \
+	_AAC_DUMP_CALL(field, _name, strlen(_name), _val)
 #else
 #  define AAC_BEGIN_STRUCT(_name)   do {} while (0)
 #  define AAC_END_STRUCT(_name)     do {} while (0)
@@ -117,6 +211,18 @@
 #  define AAC_FIELD(_name, _val)    do {} while (0)
 #  define AAC_FIELD_S(_name, _val)  do {} while (0)
 #endif
+#if AAC_SYNTAX_OP_KIND == AAC_SYNTAX_OP_KIND_READ
+#  define AAC_FIELD_OFFSET(_id, _n) AAC_READ_FIELD_OFFSET(_id, _n)
+#  define AAC_BIT_STATS(_id)        AAC_READ_BIT_STATS(_id)
+#  define AAC_TRACE(_type, _id)     AAC_READ_TRACE(_type, _id)
+#  define AAC_RETURN_ERR_IF(_c, _e) AAC_READ_RETURN_ERR_IF(_c, _e)
+#else
+#  define AAC_FIELD_OFFSET(_id, _n) do {} while (0)
+#  define AAC_BIT_STATS(_id)        do {} while (0)
+#  define AAC_TRACE(_type, _id)     do {} while (0)
+#  define AAC_RETURN_ERR_IF(_c, _e) ULOG_ERRNO_RETURN_ERR_IF(_c, _e)
+#endif
+#define AAC_RETURN_ERR(_e)          AAC_RETURN_ERR_IF(1, _e)
 /* clang-format on */
 
 
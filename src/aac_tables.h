@@ -142,7 +142,7 @@ static uint16_t swb_offset_short_window[][16] = {
  * Table 4.A.1 – Scalefactor Huffman Codebook
  */
 /* cordword, length, index */
-static uint32_t hcb_sf[][3] = {
+static const uint32_t hcb_sf[][3] = {
 	{0x0, 1, 60},       {0x4, 3, 59},       {0xA, 4, 61},
 	{0xB, 4, 58},       {0xC, 4, 62},       {0x1A, 5, 57},
 	{0x1B, 5, 63},      {0x38, 6, 56},      {0x39, 6, 64},
@@ -191,7 +191,7 @@ static uint32_t hcb_sf[][3] = {
  * Table 4.A.2 – Spectrum Huffman Codebook 1
  */
 /* cordword, length, index */
-static uint32_t hcb_1[][3] = {
+static const uint32_t hcb_1[][3] = {
 	{0x0, 1, 40},    {0x11, 5, 13},   {0x17, 5, 31},   {0x15, 5, 37},
 	{0x12, 5, 39},   {0x14, 5, 41},   {0x16, 5, 43},   {0x13, 5, 49},
 	{0x10, 5, 67},   {0x68, 7, 4},    {0x72, 7, 10},   {0x74, 7, 12},
@@ -218,7 +218,7 @@ static uint32_t hcb_1[][3] = {
 /**
  * Table 4.A.3 – Spectrum Huffman Codebook 2
  */
-static uint32_t hcb_2[][3] = {
+static const uint32_t hcb_2[][3] = {
 	{0x0, 3, 40},   {0x2, 4, 67},   {0x6, 5, 13},   {0xA, 5, 31},
 	{0x8, 5, 37},   {0x9, 5, 39},   {0x7, 5, 41},   {0xB, 5, 43},
 	{0xC, 5, 49},   {0x23, 6, 4},   {0x2D, 6, 10},  {0x20, 6, 12},
@@ -246,7 +246,7 @@ static uint32_t hcb_2[][3] = {
 /**
  * Table 4.A.4 – Spectrum Huffman Codebook 3
  */
-static uint32_t hcb_3[][3] = {
+static const uint32_t hcb_3[][3] = {
 	{0x0, 1, 0},      {0x9, 4, 1},      {0xB, 4, 3},      {0xA, 4, 9},
 	{0x8, 4, 27},     {0x19, 5, 4},     {0x18, 5, 36},    {0x35, 6, 10},
 	{0x34, 6, 12},    {0x37, 6, 13},    {0x38, 6, 28},    {0x36, 6, 30},
@@ -274,7 +274,7 @@ static uint32_t hcb_3[][3] = {
 /**
  * Table 4.A.5 – Spectrum Huffman Codebook 4
  */
-static uint32_t hcb_4[][3] = {
+static const uint32_t hcb_4[][3] = {
 	{0x7, 4, 0},     {0x8, 4, 4},     {0x1, 4, 13},    {0x5, 4, 27},
 	{0x9, 4, 30},    {0x4, 4, 31},    {0x6, 4, 36},    {0x2, 4, 37},
 	{0x3, 4, 39},    {0x0, 4, 40},    {0x16, 5, 1},    {0x18, 5, 3},
@@ -302,7 +302,7 @@ static uint32_t hcb_4[][3] = {
 /**
  * Table 4.A.6 – Spectrum Huffman Codebook 5
  */
-static uint32_t hcb_5[][3] = {
+static const uint32_t hcb_5[][3] = {
 	{0x0, 1, 40},     {0x8, 4, 31},    {0xB, 4, 39},    {0xA, 4, 41},
 	{0x9, 4, 49},     {0x1A, 5, 30},   {0x19, 5, 32},   {0x18, 5, 48},
 	{0x1B, 5, 50},    {0x70, 7, 22},   {0x73, 7, 38},   {0x71, 7, 42},
@@ -330,7 +330,7 @@ static uint32_t hcb_5[][3] = {
 /**
  * Table 4.A.7 – Spectrum Huffman Codebook 6
  */
-static uint32_t hcb_6[][3] = {
+static const uint32_t hcb_6[][3] = {
 	{0x8, 4, 30},    {0x4, 4, 31},    {0x6, 4, 32},    {0x2, 4, 39},
 	{0x0, 4, 40},    {0x3, 4, 41},    {0x7, 4, 48},    {0x1, 4, 49},
 	{0x5, 4, 50},    {0x32, 6, 20},   {0x27, 6, 21},   {0x28, 6, 22},
@@ -358,7 +358,7 @@ static uint32_t hcb_6[][3] = {
 /**
  * Table 4.A.8 – Spectrum Huffman Codebook 7
  */
-static uint32_t hcb_7[][3] = {
+static const uint32_t hcb_7[][3] = {
 	{0x0, 1, 0},     {0x5, 3, 1},     {0x4, 3, 8},     {0xC, 4, 9},
 	{0x37, 6, 2},    {0x35, 6, 10},   {0x36, 6, 16},   {0x34, 6, 17},
 	{0x74, 7, 3},    {0x71, 7, 11},   {0x72, 7, 18},   {0x73, 7, 24},
@@ -381,7 +381,7 @@ static uint32_t hcb_7[][3] = {
 /**
  * Table 4.A.9 – Spectrum Huffman Codebook 8
  */
-static uint32_t hcb_8[][3] = {
+static const uint32_t hcb_8[][3] = {
 	{0x0, 3, 9},    {0x5, 4, 1},     {0x3, 4, 8},     {0x4, 4, 10},
 	{0x2, 4, 17},   {0x6, 4, 18},    {0xE, 5, 0},     {0x10, 5, 2},
 	{0x12, 5, 11},  {0xF, 5, 16},    {0x14, 5, 19},   {0x11, 5, 25},
@@ -404,7 +404,7 @@ static uint32_t hcb_8[][3] = {
 /**
  * Table 4.A.10 – Spectrum Huffman Codebook 9
  */
-static uint32_t hcb_9[][3] = {
+static const uint32_t hcb_9[][3] = {
 	{0x0, 1, 0},       {0x5, 3, 1},       {0x4, 3, 13},
 	{0xC, 4, 14},      {0x37, 6, 2},      {0x35, 6, 15},
 	{0x36, 6, 26},     {0x34, 6, 27},     {0x72, 7, 16},
@@ -468,7 +468,7 @@ static uint32_t hcb_9[][3] = {
 /**
  * Table 4.A.11 – Spectrum Huffman Codebook 10
  */
-static uint32_t hcb_10[][3] = {
+static const uint32_t hcb_10[][3] = {
 	{0x0, 4, 14},     {0x1, 4, 15},     {0x2, 4, 27},     {0x8, 5, 1},
 	{0x7, 5, 13},     {0x9, 5, 16},     {0x6, 5, 28},     {0xC, 5, 29},
 	{0xB, 5, 40},     {0xA, 5, 41},     {0xD, 5, 42},     {0x22, 6, 0},
@@ -518,7 +518,7 @@ static uint32_t hcb_10[][3] = {
 /**
  * Table 4.A.12 – Spectrum Huffman Codebook 11
  */
-static uint32_t hcb_11[][3] = {
+static const uint32_t hcb_11[][3] = {
 	{0x0, 4, 0},      {0x1, 4, 18},     {0x6, 5, 1},      {0x5, 5, 17},
 	{0x8, 5, 19},     {0x7, 5, 35},     {0x9, 5, 36},     {0x4, 5, 288},
 	{0x19, 6, 2},     {0x14, 6, 20},    {0x17, 6, 34},    {0x18, 6, 37},
@@ -598,12 +598,12 @@ static uint32_t hcb_11[][3] = {
 /**
  * Table 4.151 – Spectrum Huffman codebooks parameters
  */
-static struct {
+static const struct {
 	int id;
 	bool is_signed;
 	int dimension;
 	int lav; /* largest absolute value */
-	uint32_t (*codebook)[3];
+	const uint32_t (*codebook)[3];
 	int cb_len;
 } hcb_list[] = {
 	{1, true, 4, 1, hcb_1, 81},
@@ -107,3 +107,67 @@ const char *aac_aot_to_str(enum aac_audioObjectType aot)
 	}
 	return "UNKNOWN";
 }
+
+
+const struct aac_field_offset *
+aac_field_offsets_find(const struct aac_field_offsets *offsets,
+		       enum aac_field_id id,
+		       unsigned int index)
+{
+	ULOG_ERRNO_RETURN_VAL_IF(offsets == NULL, EINVAL, NULL);
+
+	for (size_t i = 0; i < offsets->count; i++) {
+		if (offsets->fields[i].id != id)
+			continue;
+		if (index == 0)
+			return &offsets->fields[i];
+		index--;
+	}
+	return NULL;
+}
+
+
+const char *aac_bit_stats_id_to_str(enum aac_bit_stats_id id)
+{
+	switch (id) {
+	case AAC_BIT_STATS_ID_HEADER:
+		return "header";
+	case AAC_BIT_STATS_ID_ICS_INFO:
+		return "ics_info";
+	case AAC_BIT_STATS_ID_SECTION_DATA:
+		return "section_data";
+	case AAC_BIT_STATS_ID_SCALE_FACTOR_DATA:
+		return "scale_factor_data";
+	case AAC_BIT_STATS_ID_PULSE_DATA:
+		return "pulse_data";
+	case AAC_BIT_STATS_ID_TNS_DATA:
+		return "tns_data";
+	case AAC_BIT_STATS_ID_GAIN_CONTROL_DATA:
+		return "gain_control_data";
+	case AAC_BIT_STATS_ID_SPECTRAL_DATA:
+		return "spectral_data";
+	case AAC_BIT_STATS_ID_FILL:
+		return "fill";
+	case AAC_BIT_STATS_ID_OTHER:
+		return "other";
+	default:
+		return "UNKNOWN";
+	}
+}
+
+
+const char *aac_trace_type_to_str(enum aac_trace_type type)
+{
+	switch (type) {
+	case AAC_TRACE_TYPE_FRAME:
+		return "frame";
+	case AAC_TRACE_TYPE_ELEMENT:
+		return "element";
+	case AAC_TRACE_TYPE_EXTENSION:
+		return "extension";
+	case AAC_TRACE_TYPE_ERROR:
+		return "error";
+	default:
+		return "UNKNOWN";
+	}
+}
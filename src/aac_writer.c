@@ -48,7 +48,7 @@ int aac_write_asc(struct aac_asc *asc, uint8_t **buf, size_t *len)
 	/* Setup bitstream */
 	aac_bs_init(&bs, NULL, 0);
 	/* Write ASC */
-	res = _aac_write_AudioSpecificConfig(&bs, asc);
+	res = _aac_write_AudioSpecificConfig(&bs, asc, 1);
 	if (res < 0)
 		goto out;
 	res = aac_bs_write_trailing_bits(&bs);
@@ -113,6 +113,151 @@ out:
 }
 
 
+int aac_write_loas_frame(struct aac_bitstream *bs,
+			 struct aac_ctx *ctx,
+			 const uint8_t *buf,
+			 size_t len)
+{
+	ULOG_ERRNO_RETURN_ERR_IF(bs == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(ctx == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(buf == NULL && len != 0, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(ctx->transport != AAC_TRANSPORT_LOAS, EINVAL);
+
+	return _aac_write_loas_frame(bs, ctx, NULL, NULL, buf, len);
+}
+
+
+int aac_write_adif_header(struct aac_bitstream *bs,
+			  struct aac_adif_header *adif)
+{
+	ULOG_ERRNO_RETURN_ERR_IF(bs == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(adif == NULL, EINVAL);
+	ULOG_ERRNO_RETURN_ERR_IF(
+		adif->num_program_config_elements >= AAC_MAX_ADIF_PCE, EINVAL);
+
+	/* The context is only needed when reading */
+	return _aac_write_adif_header(bs, NULL, adif);
+}
+
+
+static int write_loas_block(struct aac_bitstream *bs,
+			    struct aac_ctx *ctx,
+			    struct aac_raw_data_block *block)
+{
+	int res = 0;
+	struct aac_bitstream payload;
+
+	/* The payload length is needed first: write the raw data block in a
+	 * temporary bitstream */
+	aac_bs_init(&payload, NULL, 0);
+	res = _aac_write_raw_data_block(&payload, ctx, block);
+	if (res < 0)
+		goto out;
+	res = _aac_write_loas_frame(
+		bs, ctx, NULL, NULL, payload.data, payload.off);
+
+out:
+	aac_bs_clear(&payload);
+	return res;
+}
+
+
+struct aac_raw_data_block *aac_write_get_block(struct aac_ctx *ctx)
+{
+	switch (ctx->data_format) {
+	case ADEF_AAC_DATA_FORMAT_RAW:
+		if (ctx->transport == AAC_TRANSPORT_LOAS)
+			return &ctx->loas_frame.raw_data_block[0];
+		return &ctx->raw_data_block;
+	case ADEF_AAC_DATA_FORMAT_ADTS:
+		return &ctx->adts_frame.raw_data_block[0];
+	default:
+		return NULL;
+	}
+}
+
+
+int aac_write_block(struct aac_bitstream *bs, struct aac_ctx *ctx)
+{
+	int res = 0;
+	size_t header_len;
+	struct aac_bitstream payload;
+	struct aac_raw_data_block *block = aac_write_get_block(ctx);
+
+	ULOG_ERRNO_RETURN_ERR_IF(block == NULL, EINVAL);
+
+	switch (ctx->data_format) {
+	case ADEF_AAC_DATA_FORMAT_RAW:
+		if (ctx->transport == AAC_TRANSPORT_LOAS)
+			return write_loas_block(bs, ctx, block);
+		return _aac_write_raw_data_block(bs, ctx, block);
+	case ADEF_AAC_DATA_FORMAT_ADTS:
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* The frame length is needed first: write the raw data block in a
+	 * temporary bitstream */
+	aac_bs_init(&payload, NULL, 0);
+	res = _aac_write_raw_data_block(&payload, ctx, block);
+	if (res < 0)
+		goto out;
+	header_len = ctx->adts.protection_absent ? 7 : 9;
+	if (header_len + payload.off > 0x1FFF) {
+		/* aac_frame_length is 13 bits */
+		res = -E2BIG;
+		goto out;
+	}
+	/* Note: adts and asc share the same storage */
+	ctx->adts.aac_frame_length = header_len + payload.off;
+	res = _aac_write_adts_frame(bs, ctx, NULL, NULL);
+
+out:
+	aac_bs_clear(&payload);
+	return res;
+}
+
+
+void aac_write_set_spectral_lines(
+	struct aac_ctx *ctx,
+	int16_t (*x_quant)[AAC_MAX_SPECTRAL_LINES],
+	unsigned int count)
+{
+	ctx->x_quant_write = x_quant;
+	ctx->x_quant_count = count;
+	ctx->x_quant_index = 0;
+}
+
+
+int aac_write_set_dec_info(struct aac_ctx *ctx, struct aac_ics_info *ics_info)
+{
+	return set_dec_info(ctx, ics_info);
+}
+
+
+unsigned int aac_write_get_num_swb(unsigned int sampling_frequency_index,
+				   int eight_short)
+{
+	unsigned int n = 0;
+
+	if (sampling_frequency_index >= ARRAY_SIZE(swb_offset_short_window))
+		return 0;
+	if (eight_short) {
+		while (n + 1 < ARRAY_SIZE(swb_offset_short_window[0]) &&
+		       swb_offset_short_window[sampling_frequency_index][n] !=
+			       128)
+			n++;
+	} else {
+		while (n + 1 < AAC_MAX_SFB &&
+		       swb_offset_long_window[sampling_frequency_index][n] !=
+			       1024)
+			n++;
+	}
+	return n;
+}
+
+
 int aac_write_silent_frame(struct aac_bitstream *bs,
 			   struct aac_ctx *ctx,
 			   unsigned int channel_count,
@@ -127,16 +272,13 @@ int aac_write_silent_frame(struct aac_bitstream *bs,
 	ULOG_ERRNO_RETURN_ERR_IF(
 		ctx->data_format == ADEF_AAC_DATA_FORMAT_UNKNOWN, EINVAL);
 
-	switch (ctx->data_format) {
-	case ADEF_AAC_DATA_FORMAT_RAW:
-		block = &ctx->raw_data_block;
-		break;
-	case ADEF_AAC_DATA_FORMAT_ADTS:
-		block = &ctx->adts_frame.raw_data_block[0];
-		frame_min_size += 56; /* ADTS header length in bits */
-		break;
-	default:
+	block = aac_write_get_block(ctx);
+	if (block == NULL)
 		return -EINVAL;
+	if (ctx->data_format == ADEF_AAC_DATA_FORMAT_ADTS) {
+		frame_min_size += 56; /* ADTS header length in bits */
+		if (ctx->adts.protection_absent == 0)
+			frame_min_size += 16; /* crc_check length in bits */
 	}
 
 	switch (channel_count) {
@@ -208,10 +350,17 @@ int aac_write_silent_frame(struct aac_bitstream *bs,
 
 	block->elements_count = i + 1;
 
-	ctx->adts.aac_frame_length = frame_length;
+	/* Note: adts and asc share the same storage */
+	if (ctx->data_format == ADEF_AAC_DATA_FORMAT_ADTS)
+		ctx->adts.aac_frame_length = frame_length;
 
 	switch (ctx->data_format) {
 	case ADEF_AAC_DATA_FORMAT_RAW:
+		if (ctx->transport == AAC_TRANSPORT_LOAS) {
+			res = write_loas_block(bs, ctx, block);
+			ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
+			break;
+		}
 		res = _aac_write_raw_data_block(bs, ctx, block);
 		ULOG_ERRNO_RETURN_ERR_IF(res < 0, -res);
 		break;
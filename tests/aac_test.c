@@ -28,7 +28,16 @@
 
 
 static CU_SuiteInfo s_suites[] = {
+	{FN("adif"), NULL, NULL, g_aac_test_adif},
 	{FN("asc-adts"), NULL, NULL, g_aac_test_asc_adts},
+	{FN("bitstream"), NULL, NULL, g_aac_test_bitstream},
+	{FN("columns"), NULL, NULL, g_aac_test_columns},
+	{FN("dump"), NULL, NULL, g_aac_test_dump},
+	{FN("gen"), NULL, NULL, g_aac_test_gen},
+	{FN("loas"), NULL, NULL, g_aac_test_loas},
+	{FN("mp4"), NULL, NULL, g_aac_test_mp4},
+	{FN("probe"), NULL, NULL, g_aac_test_probe},
+	{FN("shm"), NULL, NULL, g_aac_test_shm},
 	{FN("str"), NULL, NULL, g_aac_test_str},
 
 	CU_SUITE_INFO_NULL,
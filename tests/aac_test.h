@@ -39,8 +39,19 @@
 
 #define FN(_name) (char *)_name
 
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 
+
+extern CU_TestInfo g_aac_test_adif[];
 extern CU_TestInfo g_aac_test_asc_adts[];
+extern CU_TestInfo g_aac_test_bitstream[];
+extern CU_TestInfo g_aac_test_columns[];
+extern CU_TestInfo g_aac_test_dump[];
+extern CU_TestInfo g_aac_test_gen[];
+extern CU_TestInfo g_aac_test_loas[];
+extern CU_TestInfo g_aac_test_mp4[];
+extern CU_TestInfo g_aac_test_probe[];
+extern CU_TestInfo g_aac_test_shm[];
 extern CU_TestInfo g_aac_test_str[];
 
 
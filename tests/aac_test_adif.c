@@ -0,0 +1,235 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "aac_test.h"
+
+
+struct adif_test_ctx {
+	unsigned int header_count;
+	unsigned int block_count;
+	size_t header_len;
+	size_t blocks_len;
+};
+
+
+static void adif_header_cb(struct aac_ctx *ctx,
+			   const uint8_t *buf,
+			   size_t len,
+			   const struct aac_adif_header *adif,
+			   void *userdata)
+{
+	struct adif_test_ctx *test = userdata;
+	test->header_count++;
+	test->header_len = len;
+	CU_ASSERT_EQUAL(memcmp(buf, "ADIF", 4), 0);
+}
+
+
+static void raw_data_block_cb(struct aac_ctx *ctx,
+			      const uint8_t *buf,
+			      size_t len,
+			      const struct aac_raw_data_block *block,
+			      void *userdata)
+{
+	struct adif_test_ctx *test = userdata;
+	test->block_count++;
+	test->blocks_len += len;
+	/* END is not counted */
+	CU_ASSERT_EQUAL(block->elements_count, 1);
+	CU_ASSERT_EQUAL(block->elements[0].id_syn_ele, AAC_SYN_ELE_ID_CPE);
+}
+
+
+static const struct aac_ctx_cbs adif_cbs = {
+	.adif_header = &adif_header_cb,
+	.raw_data_block = &raw_data_block_cb,
+};
+
+
+/* ADIF header with a single stereo AAC-LC 48kHz PCE (17 bytes) */
+static void setup_adif_header(struct aac_adif_header *adif)
+{
+	struct aac_program_config_element *pce =
+		&adif->program_config_element[0];
+
+	memset(adif, 0, sizeof(*adif));
+	adif->adif_id = 0x41444946;
+	adif->bitrate = 128000;
+	adif->adif_buffer_fullness[0] = 0x1800;
+	pce->object_type = 1;
+	pce->sampling_frequency_index = 3;
+	pce->num_front_channel_elements = 1;
+	pce->front_element_is_cpe[0] = 1;
+}
+
+
+static void test_adif_header(void)
+{
+	int ret;
+	struct aac_adif_header adif;
+	struct aac_bitstream bs;
+	struct aac_dump_cfg cfg;
+	struct aac_dump *dump = NULL;
+	const char *str = NULL;
+
+	setup_adif_header(&adif);
+	aac_bs_init(&bs, NULL, 0);
+	ret = aac_write_adif_header(NULL, &adif);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	ret = aac_write_adif_header(&bs, NULL);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	adif.num_program_config_elements = AAC_MAX_ADIF_PCE;
+	ret = aac_write_adif_header(&bs, &adif);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	adif.num_program_config_elements = 0;
+	adif.adif_id = 0;
+	ret = aac_write_adif_header(&bs, &adif);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	aac_bs_clear(&bs);
+
+	setup_adif_header(&adif);
+	aac_bs_init(&bs, NULL, 0);
+	ret = aac_write_adif_header(&bs, &adif);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(bs.off, 17);
+	CU_ASSERT_EQUAL(memcmp(bs.data, "ADIF", 4), 0);
+	aac_bs_clear(&bs);
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.type = AAC_DUMP_TYPE_JSON;
+	ret = aac_dump_new(&cfg, &dump);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_dump_adif_header(dump, NULL);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	ret = aac_dump_adif_header(dump, &adif);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_dump_get_json_str(dump, &str);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(str);
+	CU_ASSERT_PTR_NOT_NULL(strstr(str, "{ \"adif_header\": {"));
+	CU_ASSERT_PTR_NOT_NULL(strstr(str, "\"bitrate\": 128000,"));
+	CU_ASSERT_PTR_NOT_NULL(strstr(str, "\"front_element_is_cpe\": 1,"));
+	aac_dump_destroy(dump);
+}
+
+
+static void test_adif_parse(void)
+{
+	int ret;
+	size_t off = 0;
+	size_t header_len;
+	size_t half;
+	struct aac_ctx *ctx = NULL;
+	struct aac_asc asc;
+	struct aac_bitstream bs;
+	struct aac_reader *reader = NULL;
+	struct aac_ctx *rctx;
+	struct aac_latency_stats stats;
+	const struct aac_adif_header *adif;
+	const struct aac_asc *rasc;
+	struct aac_adif_header wadif;
+	struct adif_test_ctx test;
+
+	/* Header followed by 4 silent stereo raw data blocks */
+	setup_adif_header(&wadif);
+	aac_bs_init(&bs, NULL, 0);
+	ret = aac_write_adif_header(&bs, &wadif);
+	CU_ASSERT_EQUAL(ret, 0);
+	header_len = bs.off;
+	CU_ASSERT_EQUAL(header_len, 17);
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	memset(&asc, 0, sizeof(asc));
+	ret = aac_asc_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_raw,
+				       &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_ctx_set_asc(ctx, &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	for (int i = 0; i < 4; i++) {
+		ret = aac_write_silent_frame(&bs, ctx, 2, 0);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	half = header_len + (bs.off - header_len) / 2;
+
+	/* Parse in two buffers: the header is only in the first one */
+	memset(&test, 0, sizeof(test));
+	ret = aac_reader_new(&adif_cbs, &test, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_LATENCY, bs.data, half, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, half);
+	CU_ASSERT_EQUAL(test.header_count, 1);
+	CU_ASSERT_EQUAL(test.header_len, header_len);
+	CU_ASSERT_EQUAL(test.block_count, 2);
+	off = 0;
+	ret = aac_reader_parse(reader,
+			       AAC_READER_FLAGS_LATENCY,
+			       bs.data + half,
+			       bs.off - half,
+			       &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, bs.off - half);
+	CU_ASSERT_EQUAL(test.header_count, 1);
+	CU_ASSERT_EQUAL(test.block_count, 4);
+	CU_ASSERT_EQUAL(test.blocks_len, bs.off - header_len);
+
+	rctx = aac_reader_get_ctx(reader);
+	CU_ASSERT_EQUAL(aac_ctx_get_transport(rctx), AAC_TRANSPORT_ADIF);
+	adif = aac_ctx_get_adif_header(rctx);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(adif);
+	CU_ASSERT_EQUAL(adif->bitrate, 128000);
+	CU_ASSERT_EQUAL(adif->adif_buffer_fullness[0], 0x1800);
+	CU_ASSERT_EQUAL(adif->num_program_config_elements, 0);
+	CU_ASSERT_EQUAL(
+		adif->program_config_element[0].num_front_channel_elements, 1);
+	rasc = aac_ctx_get_asc(rctx);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(rasc);
+	CU_ASSERT_EQUAL(rasc->audioObjectType, AAC_AOT_AAC_LC);
+	CU_ASSERT_EQUAL(rasc->samplingFrequencyIndex, 3);
+
+	/* The header is not timed, only the raw data blocks */
+	ret = aac_reader_get_latency(
+		reader, ADEF_AAC_DATA_FORMAT_UNKNOWN, -1, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.count, 4);
+	ret = aac_reader_get_latency(
+		reader, ADEF_AAC_DATA_FORMAT_RAW, 0, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.count, 4);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+CU_TestInfo g_aac_test_adif[] = {
+	{FN("header"), &test_adif_header},
+	{FN("parse"), &test_adif_parse},
+
+	CU_TEST_INFO_NULL,
+};
@@ -411,11 +411,114 @@ static void test_write_adts(void)
 }
 
 
+static void timing_adts_frame_begin_cb(struct aac_ctx *ctx,
+				       const uint8_t *buf,
+				       size_t len,
+				       const struct aac_adts *adts,
+				       void *userdata)
+{
+	int ret;
+	uint64_t *positions = userdata;
+	struct aac_timing timing;
+
+	ret = aac_ctx_get_timing(ctx, &timing);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(timing.frame_duration, 2048);
+	positions[timing.position / 2048] = timing.position;
+}
+
+
+static void test_timing(void)
+{
+	int ret;
+	size_t off = 0;
+	struct aac_asc asc;
+	struct aac_adts adts;
+	struct aac_timing timing;
+	uint8_t *buf = NULL;
+	size_t buf_len = 0;
+	struct aac_reader *reader = NULL;
+	struct aac_ctx_cbs cbs = {
+		.adts_frame_begin = &timing_adts_frame_begin_cb,
+	};
+	uint64_t positions[3] = {1, 1, 1};
+	/* AAC_LC, 48KHz, stereo, 1024 then 960 samples */
+	uint8_t asc_buf[] = {0x11, 0x90};
+	/* 3 ADTS frames of 2 raw_data_blocks (not parsed) */
+	uint8_t adts_buf[3 * 16];
+
+	ret = aac_parse_asc(asc_buf, sizeof(asc_buf), &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_asc_get_timing(&asc, &timing);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(timing.sample_rate, 48000);
+	CU_ASSERT_EQUAL(timing.frame_length, 1024);
+	CU_ASSERT_EQUAL(timing.frame_duration, 1024);
+	asc_buf[1] |= 0x04; /* frameLengthFlag */
+	ret = aac_parse_asc(asc_buf, sizeof(asc_buf), &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_asc_get_timing(&asc, &timing);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(timing.frame_length, 960);
+	CU_ASSERT_EQUAL(timing.frame_duration, 960);
+
+	/* Exact conversions */
+	CU_ASSERT_EQUAL(aac_samples_to_timescale(1024, 48000, 1000000), 21333);
+	CU_ASSERT_EQUAL(aac_samples_to_timescale(960, 48000, 90000), 1800);
+	CU_ASSERT_EQUAL(
+		aac_samples_to_timescale(48000ULL * 86400 * 365 * 100 + 1,
+					 48000,
+					 90000),
+		90000ULL * 86400 * 365 * 100 + 1);
+	CU_ASSERT_EQUAL(aac_samples_to_timescale(1024, 0, 90000), 0);
+
+	/* ADTS frames with 2 raw_data_blocks */
+	memset(&adts, 0, sizeof(adts));
+	ret = aac_adts_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_adts,
+					&adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	adts.number_of_raw_data_blocks_in_frame = 1;
+	ret = aac_adts_get_timing(&adts, &timing);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(timing.sample_rate, 48000);
+	CU_ASSERT_EQUAL(timing.frame_length, 1024);
+	CU_ASSERT_EQUAL(timing.frame_duration, 2048);
+
+	/* Cumulated position while parsing */
+	memset(adts_buf, 0, sizeof(adts_buf));
+	adts.aac_frame_length = 16;
+	ret = aac_write_adts(&adts, &buf, &buf_len);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	CU_ASSERT_EQUAL_FATAL(buf_len, 7);
+	for (size_t i = 0; i < 3; i++)
+		memcpy(adts_buf + 16 * i, buf, buf_len);
+	free(buf);
+	ret = aac_reader_new(&cbs, positions, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_parse(reader, 0, adts_buf, sizeof(adts_buf), &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, sizeof(adts_buf));
+	CU_ASSERT_EQUAL(positions[0], 0);
+	CU_ASSERT_EQUAL(positions[1], 2048);
+	CU_ASSERT_EQUAL(positions[2], 4096);
+	ret = aac_ctx_get_timing(aac_reader_get_ctx(reader), &timing);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(timing.position, 6144);
+	ret = aac_ctx_set_position(aac_reader_get_ctx(reader), 0);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_ctx_get_timing(aac_reader_get_ctx(reader), &timing);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(timing.position, 0);
+	aac_reader_destroy(reader);
+}
+
+
 CU_TestInfo g_aac_test_asc_adts[] = {
 	{FN("parse-asc"), &test_reader_parse_asc},
 	{FN("write-asc"), &test_write_asc},
 	{FN("parse-adts"), &test_reader_parse_adts},
 	{FN("write-adts"), &test_write_adts},
+	{FN("timing"), &test_timing},
 
 	CU_TEST_INFO_NULL,
 };
@@ -0,0 +1,619 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "aac_test.h"
+
+/* Internal functions (static build of the library) */
+#include <aac_huffman.h>
+
+
+static void test_patch_bits(void)
+{
+	int ret;
+	uint32_t v;
+	struct aac_bitstream bs;
+	uint8_t buf[] = {0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff};
+
+	aac_bs_init(&bs, buf, sizeof(buf));
+
+	/* Out of bounds */
+	ret = aac_bs_patch_bits(&bs, 60, 0, 5);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	ret = aac_bs_patch_bits(&bs, 0, 0, 33);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+
+	/* Unaligned, across bytes */
+	ret = aac_bs_patch_bits(&bs, 5, 0x5a5, 11);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(buf[0], 0x05);
+	CU_ASSERT_EQUAL(buf[1], 0xa5);
+	CU_ASSERT_EQUAL(buf[2], 0x00);
+
+	/* Clear bits inside a single byte */
+	ret = aac_bs_patch_bits(&bs, 34, 0, 3);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(buf[4], 0xc7);
+
+	/* Full 32 bits, then read back */
+	ret = aac_bs_patch_bits(&bs, 28, 0x12345678, 32);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(bs.off, 0);
+	CU_ASSERT_EQUAL(bs.cachebits, 0);
+	aac_bs_cinit(&bs, buf, sizeof(buf));
+	ret = aac_bs_read_bits(&bs, &v, 28);
+	CU_ASSERT_EQUAL(ret, 28);
+	CU_ASSERT_EQUAL(v, 0x05a5000);
+	ret = aac_bs_read_bits(&bs, &v, 32);
+	CU_ASSERT_EQUAL(ret, 32);
+	CU_ASSERT_EQUAL(v, 0x12345678);
+	CU_ASSERT_EQUAL(aac_bs_read_bit_off(&bs), 60);
+	ret = aac_bs_read_bits(&bs, &v, 4);
+	CU_ASSERT_EQUAL(ret, 4);
+	CU_ASSERT_EQUAL(v, 0xf);
+}
+
+
+static void field_offsets_frame_end_cb(struct aac_ctx *ctx,
+				       const uint8_t *buf,
+				       size_t len,
+				       const struct aac_adts *adts,
+				       void *userdata)
+{
+	struct aac_field_offsets *offsets = userdata;
+	*offsets = *aac_ctx_get_field_offsets(ctx);
+}
+
+
+static void test_field_offsets(void)
+{
+	int ret;
+	uint32_t v;
+	size_t off = 0;
+	struct aac_ctx *ctx = NULL;
+	struct aac_adts adts;
+	const struct aac_adts *parsed;
+	struct aac_bitstream bs;
+	struct aac_bitstream check;
+	struct aac_reader *reader = NULL;
+	struct aac_field_offsets offsets;
+	const struct aac_field_offset *field;
+	struct aac_ctx_cbs cbs = {
+		.adts_frame_end = &field_offsets_frame_end_cb,
+	};
+
+	/* Write a silent stereo ADTS frame */
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_adts_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_adts,
+					&adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_ctx_set_adts(ctx, &adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_write_silent_frame(NULL, ctx, 2, 0);
+	CU_ASSERT_EQUAL(ret, 13);
+	aac_bs_init(&bs, NULL, 0);
+	ret = aac_write_silent_frame(&bs, ctx, 2, 13);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(bs.off, 13);
+
+	/* Parse it with field offsets */
+	memset(&offsets, 0, sizeof(offsets));
+	ret = aac_reader_new(&cbs, &offsets, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_parse(reader,
+			       AAC_READER_FLAGS_FRAME_DATA |
+				       AAC_READER_FLAGS_FIELD_OFFSETS,
+			       bs.data,
+			       bs.off,
+			       &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, 13);
+
+	/* 7 header fields, 1 element_instance_tag, 2 global_gain */
+	CU_ASSERT_EQUAL(offsets.count, 10);
+	field = aac_field_offsets_find(
+		&offsets, AAC_FIELD_ID_ADTS_BUFFER_FULLNESS, 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(field);
+	CU_ASSERT_EQUAL(field->bit_offset, 43);
+	CU_ASSERT_EQUAL(field->bits, 11);
+	field = aac_field_offsets_find(
+		&offsets, AAC_FIELD_ID_ELEMENT_INSTANCE_TAG, 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(field);
+	CU_ASSERT_EQUAL(field->bit_offset, 59);
+	CU_ASSERT_PTR_NULL(aac_field_offsets_find(
+		&offsets, AAC_FIELD_ID_ELEMENT_INSTANCE_TAG, 1));
+
+	/* Patch fields in place and parse again */
+	field = aac_field_offsets_find(
+		&offsets, AAC_FIELD_ID_ADTS_BUFFER_FULLNESS, 0);
+	ret = aac_bs_patch_bits(&bs, field->bit_offset, 0x123, field->bits);
+	CU_ASSERT_EQUAL(ret, 0);
+	field = aac_field_offsets_find(&offsets, AAC_FIELD_ID_GLOBAL_GAIN, 1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(field);
+	ret = aac_bs_patch_bits(&bs, field->bit_offset, 0x42, field->bits);
+	CU_ASSERT_EQUAL(ret, 0);
+
+	off = 0;
+	ret = aac_reader_parse(reader,
+			       AAC_READER_FLAGS_FRAME_DATA |
+				       AAC_READER_FLAGS_FIELD_OFFSETS,
+			       bs.data,
+			       bs.off,
+			       &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(offsets.count, 10);
+	parsed = aac_ctx_get_adts(aac_reader_get_ctx(reader));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(parsed);
+	CU_ASSERT_EQUAL(parsed->adts_buffer_fullness, 0x123);
+	field = aac_field_offsets_find(&offsets, AAC_FIELD_ID_GLOBAL_GAIN, 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(field);
+	aac_bs_cinit(&check, bs.data, bs.off);
+	ret = aac_bs_read_bits(&check, &v, field->bit_offset);
+	CU_ASSERT_EQUAL(ret, (int)field->bit_offset);
+	ret = aac_bs_read_bits(&check, &v, 8);
+	CU_ASSERT_EQUAL(v, 0x8c);
+	field = aac_field_offsets_find(&offsets, AAC_FIELD_ID_GLOBAL_GAIN, 1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(field);
+	aac_bs_cinit(&check, bs.data, bs.off);
+	ret = aac_bs_read_bits(&check, &v, field->bit_offset);
+	CU_ASSERT_EQUAL(ret, (int)field->bit_offset);
+	ret = aac_bs_read_bits(&check, &v, 8);
+	CU_ASSERT_EQUAL(v, 0x42);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+static void test_bit_stats(void)
+{
+	int ret;
+	size_t off = 0;
+	uint64_t sum = 0;
+	struct aac_ctx *ctx = NULL;
+	struct aac_adts adts;
+	struct aac_bitstream bs;
+	struct aac_reader *reader = NULL;
+	const struct aac_bit_stats *stats;
+	struct aac_ctx_cbs cbs;
+
+	/* Write 2 silent stereo ADTS frames with a fill element */
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_adts_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_adts,
+					&adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_ctx_set_adts(ctx, &adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < 2; i++) {
+		ret = aac_write_silent_frame(&bs, ctx, 2, 20);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	CU_ASSERT_EQUAL(bs.off, 40);
+
+	memset(&cbs, 0, sizeof(cbs));
+	ret = aac_reader_new(&cbs, NULL, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_parse(reader,
+			       AAC_READER_FLAGS_FRAME_DATA |
+				       AAC_READER_FLAGS_BIT_STATS,
+			       bs.data,
+			       bs.off,
+			       &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, 40);
+
+	stats = aac_ctx_get_bit_stats(aac_reader_get_ctx(reader));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(stats);
+	CU_ASSERT_EQUAL(stats->frame_count, 2);
+	CU_ASSERT_EQUAL(stats->frame[AAC_BIT_STATS_ID_HEADER], 56);
+	CU_ASSERT_EQUAL(stats->frame[AAC_BIT_STATS_ID_ICS_INFO], 11);
+	CU_ASSERT_EQUAL(stats->frame[AAC_BIT_STATS_ID_SECTION_DATA], 0);
+	CU_ASSERT_EQUAL(stats->frame[AAC_BIT_STATS_ID_SPECTRAL_DATA], 0);
+	/* Fill count and 6 bytes of fill data */
+	CU_ASSERT_EQUAL(stats->frame[AAC_BIT_STATS_ID_FILL], 52);
+	for (int i = 0; i < AAC_BIT_STATS_ID_MAX; i++) {
+		sum += stats->frame[i];
+		CU_ASSERT_EQUAL(stats->total[i], 2 * stats->frame[i]);
+	}
+	CU_ASSERT_EQUAL(sum, 20 * 8);
+	CU_ASSERT_STRING_EQUAL(
+		aac_bit_stats_id_to_str(AAC_BIT_STATS_ID_SPECTRAL_DATA),
+		"spectral_data");
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+static void test_trace(void)
+{
+	int ret;
+	size_t off = 0;
+	size_t count;
+	struct aac_ctx *ctx = NULL;
+	struct aac_adts adts;
+	struct aac_bitstream bs;
+	struct aac_reader *reader = NULL;
+	struct aac_ctx_cbs cbs;
+	struct aac_trace_event events[AAC_TRACE_MAX_EVENTS];
+
+	/* Write 2 silent stereo ADTS frames, the second one with a dynamic
+	 * range extension payload (unsupported) in the leading fill element */
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_adts_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_adts,
+					&adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_ctx_set_adts(ctx, &adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < 2; i++) {
+		ret = aac_write_silent_frame(&bs, ctx, 2, 20);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	CU_ASSERT_EQUAL_FATAL(bs.off, 40);
+	CU_ASSERT_EQUAL(bs.data[27] >> 5, AAC_SYN_ELE_ID_FIL);
+	CU_ASSERT_FATAL(((bs.data[27] >> 1) & 0xF) != 0);
+	/* extension_type straddles the 2 bytes after the fill count */
+	bs.data[27] |= AAC_EXT_DYNAMIC_RANGE >> 3;
+	bs.data[28] = (bs.data[28] & 0x1F) | ((AAC_EXT_DYNAMIC_RANGE & 7) << 5);
+
+	memset(&cbs, 0, sizeof(cbs));
+	ret = aac_reader_new(&cbs, NULL, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+	/* Without AAC_READER_FLAGS_TRACE only the errors are recorded */
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, bs.data, bs.off, &off);
+	CU_ASSERT_EQUAL(ret, -ENOSYS);
+	count = AAC_TRACE_MAX_EVENTS;
+	ret = aac_reader_get_trace(reader, events, &count);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_FATAL(count >= 2);
+	for (size_t i = 0; i < count; i++) {
+		CU_ASSERT_EQUAL(events[i].type, AAC_TRACE_TYPE_ERROR);
+		CU_ASSERT_EQUAL(events[i].err, ENOSYS);
+	}
+	/* Innermost first: the extension type is read after the 7-byte
+	 * header, the element id and the fill count */
+	CU_ASSERT_STRING_EQUAL(events[0].func, "_aac_read_extension_payload");
+	CU_ASSERT_EQUAL(events[0].bit_off, 67);
+	CU_ASSERT_STRING_EQUAL(events[count - 1].func,
+			       "_aac_read_adts_frame");
+	aac_reader_destroy(reader);
+
+	/* With AAC_READER_FLAGS_TRACE, the frames and elements are recorded */
+	ret = aac_reader_new(&cbs, NULL, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	off = 0;
+	ret = aac_reader_parse(reader,
+			       AAC_READER_FLAGS_FRAME_DATA |
+				       AAC_READER_FLAGS_TRACE,
+			       bs.data,
+			       bs.off,
+			       &off);
+	CU_ASSERT_EQUAL(ret, -ENOSYS);
+	count = AAC_TRACE_MAX_EVENTS;
+	ret = aac_reader_get_trace(reader, events, &count);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_FATAL(count >= 5);
+	CU_ASSERT_EQUAL(events[0].type, AAC_TRACE_TYPE_FRAME);
+	CU_ASSERT_EQUAL(events[1].type, AAC_TRACE_TYPE_ELEMENT);
+	CU_ASSERT_EQUAL(events[1].id, AAC_SYN_ELE_ID_FIL);
+	CU_ASSERT_EQUAL(events[1].bit_off, 59);
+	for (size_t i = 2; i < count; i++) {
+		if (events[i].type != AAC_TRACE_TYPE_FRAME)
+			continue;
+		/* Second frame */
+		CU_ASSERT_FATAL(i + 3 < count);
+		CU_ASSERT_EQUAL(events[i + 1].type, AAC_TRACE_TYPE_ELEMENT);
+		CU_ASSERT_EQUAL(events[i + 1].id, AAC_SYN_ELE_ID_FIL);
+		CU_ASSERT_EQUAL(events[i + 2].type, AAC_TRACE_TYPE_EXTENSION);
+		CU_ASSERT_EQUAL(events[i + 2].id, AAC_EXT_DYNAMIC_RANGE);
+		CU_ASSERT_EQUAL(events[i + 3].type, AAC_TRACE_TYPE_ERROR);
+		break;
+	}
+	CU_ASSERT_EQUAL(events[count - 1].type, AAC_TRACE_TYPE_ERROR);
+	CU_ASSERT_STRING_EQUAL(aac_trace_type_to_str(AAC_TRACE_TYPE_ELEMENT),
+			       "element");
+
+	/* Only the last events are kept */
+	count = 2;
+	ret = aac_reader_get_trace(reader, events, &count);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(count, 2);
+	CU_ASSERT_STRING_EQUAL(events[1].func, "_aac_read_adts_frame");
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+static void test_latency(void)
+{
+	int ret;
+	size_t off = 0;
+	struct aac_ctx *ctx = NULL;
+	struct aac_adts adts;
+	struct aac_bitstream bs;
+	struct aac_reader *reader = NULL;
+	struct aac_ctx_cbs cbs;
+	struct aac_latency_stats stats;
+
+	/* Write 8 silent stereo ADTS frames */
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_adts_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_adts,
+					&adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_ctx_set_adts(ctx, &adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < 8; i++) {
+		ret = aac_write_silent_frame(&bs, ctx, 2, 20);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+
+	memset(&cbs, 0, sizeof(cbs));
+	ret = aac_reader_new(&cbs, NULL, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+	/* Nothing is measured without AAC_READER_FLAGS_LATENCY */
+	ret = aac_reader_parse(reader, 0, bs.data, 40, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_reader_get_latency(
+		reader, ADEF_AAC_DATA_FORMAT_UNKNOWN, -1, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.count, 0);
+
+	/* 2 frames without frame data, 4 with */
+	off = 0;
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_LATENCY, bs.data + 40, 40, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	off = 0;
+	ret = aac_reader_parse(reader,
+			       AAC_READER_FLAGS_LATENCY |
+				       AAC_READER_FLAGS_FRAME_DATA,
+			       bs.data + 80,
+			       bs.off - 80,
+			       &off);
+	CU_ASSERT_EQUAL(ret, 0);
+
+	ret = aac_reader_get_latency(
+		reader, ADEF_AAC_DATA_FORMAT_UNKNOWN, -1, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.count, 6);
+	CU_ASSERT(stats.min <= stats.p50);
+	CU_ASSERT(stats.p50 <= stats.p90);
+	CU_ASSERT(stats.p90 <= stats.p99);
+	CU_ASSERT(stats.p99 <= stats.p999);
+	CU_ASSERT(stats.p999 <= stats.max);
+	CU_ASSERT(stats.mean >= stats.min);
+	CU_ASSERT(stats.mean <= stats.max);
+	ret = aac_reader_get_latency(
+		reader, ADEF_AAC_DATA_FORMAT_ADTS, 1, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.count, 4);
+	ret = aac_reader_get_latency(
+		reader, ADEF_AAC_DATA_FORMAT_ADTS, 0, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.count, 2);
+	ret = aac_reader_get_latency(
+		reader, ADEF_AAC_DATA_FORMAT_RAW, -1, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.count, 0);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+static void test_stats(void)
+{
+	int ret;
+	size_t off = 0;
+	struct aac_ctx *ctx = NULL;
+	struct aac_adts adts;
+	struct aac_asc asc;
+	struct aac_StreamMuxConfig smc;
+	struct aac_bitstream bs;
+	struct aac_reader *reader = NULL;
+	struct aac_ctx_cbs cbs;
+	struct aac_reader_stats stats;
+
+	/* Write 4 silent stereo ADTS frames */
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_adts_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_adts,
+					&adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_ctx_set_adts(ctx, &adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < 4; i++) {
+		ret = aac_write_silent_frame(&bs, ctx, 2, 20);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	CU_ASSERT_EQUAL_FATAL(bs.off, 80);
+
+	memset(&cbs, 0, sizeof(cbs));
+	ret = aac_reader_new(&cbs, NULL, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_get_stats(reader, NULL);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+
+	/* Parsed frames */
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, bs.data, 40, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_reader_get_stats(reader, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.frames, 2);
+	CU_ASSERT_EQUAL(stats.bytes, 40);
+	CU_ASSERT_EQUAL(stats.frames_skipped, 0);
+	CU_ASSERT_EQUAL(stats.bytes_skipped, 0);
+	CU_ASSERT_EQUAL(stats.errors_truncated, 0);
+	CU_ASSERT_EQUAL(stats.errors_invalid, 0);
+	CU_ASSERT_EQUAL(stats.errors_unsupported, 0);
+	CU_ASSERT_EQUAL(stats.errors_other, 0);
+
+	/* Truncated frame */
+	off = 0;
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, bs.data + 40, 15, &off);
+	CU_ASSERT_EQUAL(ret, -EIO);
+	ret = aac_reader_get_stats(reader, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.frames, 2);
+	CU_ASSERT_EQUAL(stats.errors_truncated, 1);
+
+	/* Unsupported syntax: dynamic range extension payload in the leading
+	 * fill element (see test_trace()) */
+	off = 0;
+	bs.data[47] |= AAC_EXT_DYNAMIC_RANGE >> 3;
+	bs.data[48] = (bs.data[48] & 0x1F) | ((AAC_EXT_DYNAMIC_RANGE & 7) << 5);
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, bs.data + 40, 20, &off);
+	CU_ASSERT_EQUAL(ret, -ENOSYS);
+	ret = aac_reader_get_stats(reader, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.errors_unsupported, 1);
+
+	/* Invalid syncword */
+	off = 0;
+	bs.data[60] = 0x00;
+	ret = aac_reader_parse(reader, 0, bs.data + 60, 20, &off);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	ret = aac_reader_get_stats(reader, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.frames, 2);
+	CU_ASSERT_EQUAL(stats.errors_invalid, 1);
+	CU_ASSERT_EQUAL(stats.errors_truncated, 1);
+	CU_ASSERT_EQUAL(stats.errors_unsupported, 1);
+	CU_ASSERT_EQUAL(stats.errors_other, 0);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+
+	/* LOAS frames without a previous StreamMuxConfig are skipped */
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	memset(&asc, 0, sizeof(asc));
+	ret = aac_asc_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_raw,
+				       &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	memset(&smc, 0, sizeof(smc));
+	smc.allStreamsSameTimeFraming = 1;
+	ret = aac_ctx_set_loas(ctx, &smc, &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < 3; i++) {
+		ret = aac_write_silent_frame(&bs, ctx, 2, 0);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	CU_ASSERT_EQUAL_FATAL(bs.off, 16 + 11 + 11);
+
+	ret = aac_reader_new(&cbs, NULL, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	off = 0;
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, bs.data + 16, 22, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, 22);
+	ret = aac_reader_get_stats(reader, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.frames, 0);
+	CU_ASSERT_EQUAL(stats.bytes, 0);
+	CU_ASSERT_EQUAL(stats.frames_skipped, 2);
+	CU_ASSERT_EQUAL(stats.bytes_skipped, 22);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+static void test_huffman(void)
+{
+	int ret;
+	int values[4];
+	struct aac_bitstream bs;
+	uint8_t buf[4];
+
+	/* Scale factors 60, 59 and 61 (differences 0, -1 and +1), then
+	 * codebook 1 index 13 (-1, 0, 0, 0) and codebook 5 index 31
+	 * (y = -1, z = 0) */
+	aac_bs_init(&bs, buf, sizeof(buf));
+	memset(buf, 0, sizeof(buf));
+	aac_bs_write_bits(&bs, 0x0, 1);
+	aac_bs_write_bits(&bs, 0x4, 3);
+	aac_bs_write_bits(&bs, 0xA, 4);
+	aac_bs_write_bits(&bs, 0x11, 5);
+	aac_bs_write_bits(&bs, 0x8, 4);
+	aac_bs_write_trailing_bits(&bs);
+
+	aac_bs_cinit(&bs, buf, sizeof(buf));
+	CU_ASSERT_EQUAL(aac_bs_read_huffman_sf(&bs), 60);
+	CU_ASSERT_EQUAL(aac_bs_read_huffman_sf(&bs), 59);
+	CU_ASSERT_EQUAL(aac_bs_read_huffman_sf(&bs), 61);
+	CU_ASSERT_EQUAL(aac_bs_read_bit_off(&bs), 8);
+	ret = aac_bs_read_huffman_spectral(&bs, 1, values);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(values[0], -1);
+	CU_ASSERT_EQUAL(values[1], 0);
+	CU_ASSERT_EQUAL(values[2], 0);
+	CU_ASSERT_EQUAL(values[3], 0);
+	ret = aac_bs_read_huffman_spectral(&bs, 5, values);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(values[0], 0);
+	CU_ASSERT_EQUAL(values[1], 0);
+	CU_ASSERT_EQUAL(values[2], -1);
+	CU_ASSERT_EQUAL(values[3], 0);
+	CU_ASSERT_EQUAL(aac_bs_read_bit_off(&bs), 17);
+	ret = aac_bs_read_huffman_spectral(&bs, 12, values);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+}
+
+
+CU_TestInfo g_aac_test_bitstream[] = {
+	{FN("patch-bits"), &test_patch_bits},
+	{FN("field-offsets"), &test_field_offsets},
+	{FN("bit-stats"), &test_bit_stats},
+	{FN("trace"), &test_trace},
+	{FN("latency"), &test_latency},
+	{FN("stats"), &test_stats},
+	{FN("huffman"), &test_huffman},
+
+	CU_TEST_INFO_NULL,
+};
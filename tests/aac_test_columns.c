@@ -0,0 +1,429 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "aac_test.h"
+
+#include <stdio.h>
+
+
+/* More than one block of rows */
+#define COLUMNS_FRAME_COUNT (AAC_COLUMNS_BLOCK_ROWS + 4)
+#define COLUMNS_FRAME_SIZE 20
+
+
+struct columns_test {
+	struct aac_columns *columns;
+	/* Offset of the next frame */
+	uint64_t offset;
+	unsigned int rows;
+};
+
+
+/* Columns file read back into memory */
+struct columns_file {
+	uint8_t *data;
+	size_t size;
+	const struct aac_columns_header *header;
+	const struct aac_columns_column *columns;
+	const uint8_t *blocks;
+};
+
+
+static void columns_add_frame(struct columns_test *test,
+			      struct aac_ctx *ctx,
+			      size_t len)
+{
+	int ret;
+
+	ret = aac_columns_add_frame(test->columns, ctx, test->offset, len);
+	CU_ASSERT_EQUAL(ret, 0);
+	test->offset += len;
+	test->rows++;
+}
+
+
+static void columns_adts_frame_end_cb(struct aac_ctx *ctx,
+				      const uint8_t *buf,
+				      size_t len,
+				      const struct aac_adts *adts,
+				      void *userdata)
+{
+	columns_add_frame(userdata, ctx, len);
+}
+
+
+static void columns_loas_frame_end_cb(struct aac_ctx *ctx,
+				      const uint8_t *buf,
+				      size_t len,
+				      const struct aac_StreamMuxConfig *smc,
+				      void *userdata)
+{
+	columns_add_frame(userdata, ctx, len);
+}
+
+
+static void columns_raw_data_block_cb(struct aac_ctx *ctx,
+				      const uint8_t *buf,
+				      size_t len,
+				      const struct aac_raw_data_block *block,
+				      void *userdata)
+{
+	columns_add_frame(userdata, ctx, len);
+}
+
+
+static const struct aac_ctx_cbs columns_cbs = {
+	.adts_frame_end = &columns_adts_frame_end_cb,
+	.loas_frame_end = &columns_loas_frame_end_cb,
+	.raw_data_block = &columns_raw_data_block_cb,
+};
+
+
+/* Parse a stream (raw data blocks if asc is not NULL) and export its frames
+ * into a temporary file, then read the file back */
+static void columns_export(const uint8_t *buf,
+			   size_t len,
+			   const struct aac_asc *asc,
+			   unsigned int frame_count,
+			   struct columns_file *cf)
+{
+	int ret;
+	size_t off = 0;
+	long size;
+	FILE *file;
+	struct aac_reader *reader = NULL;
+	struct columns_test test;
+
+	memset(cf, 0, sizeof(*cf));
+	memset(&test, 0, sizeof(test));
+	file = tmpfile();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+	ret = aac_columns_new(file, &test.columns);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_new(&columns_cbs, &test, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	if (asc != NULL) {
+		ret = aac_ctx_set_asc(aac_reader_get_ctx(reader), asc);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, buf, len, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, len);
+	CU_ASSERT_EQUAL(test.rows, frame_count);
+	CU_ASSERT_EQUAL(test.offset, len);
+	ret = aac_columns_destroy(test.columns);
+	CU_ASSERT_EQUAL(ret, 0);
+	aac_reader_destroy(reader);
+
+	size = ftell(file);
+	CU_ASSERT_FATAL(size > 0);
+	cf->size = size;
+	cf->data = malloc(cf->size);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(cf->data);
+	rewind(file);
+	ret = fread(cf->data, 1, cf->size, file);
+	CU_ASSERT_EQUAL_FATAL(ret, (int)cf->size);
+	fclose(file);
+
+	cf->header = (const struct aac_columns_header *)cf->data;
+	CU_ASSERT_EQUAL(cf->header->magic, AAC_COLUMNS_MAGIC);
+	CU_ASSERT_EQUAL(cf->header->version, AAC_COLUMNS_VERSION);
+	CU_ASSERT_EQUAL(cf->header->block_rows, AAC_COLUMNS_BLOCK_ROWS);
+	cf->columns = (const struct aac_columns_column *)(cf->header + 1);
+	cf->blocks = (const uint8_t *)(cf->columns + cf->header->column_count);
+	CU_ASSERT_EQUAL(cf->size,
+			(cf->blocks - cf->data) +
+				(frame_count + AAC_COLUMNS_BLOCK_ROWS - 1) /
+					AAC_COLUMNS_BLOCK_ROWS *
+					cf->header->block_size);
+}
+
+
+/* Value of a column in a row, the column must exist */
+static int64_t
+columns_value(const struct columns_file *cf, const char *name, uint64_t row)
+{
+	const struct aac_columns_column *column = NULL;
+	const struct aac_columns_block *block;
+	const uint8_t *values;
+
+	for (unsigned int i = 0; i < cf->header->column_count; i++) {
+		if (strcmp(cf->columns[i].name, name) == 0)
+			column = &cf->columns[i];
+	}
+	CU_ASSERT_PTR_NOT_NULL(column);
+	if (column == NULL)
+		return 0;
+	block = (const struct aac_columns_block *)(
+		cf->blocks +
+		row / AAC_COLUMNS_BLOCK_ROWS * cf->header->block_size);
+	row %= AAC_COLUMNS_BLOCK_ROWS;
+	CU_ASSERT(row < block->row_count);
+	if (row >= block->row_count)
+		return 0;
+	values = (const uint8_t *)block + column->offset;
+
+	switch (column->type) {
+	case AAC_COLUMNS_TYPE_U8:
+		return values[row];
+	case AAC_COLUMNS_TYPE_U16:
+		return ((const uint16_t *)values)[row];
+	case AAC_COLUMNS_TYPE_U32:
+		return ((const uint32_t *)values)[row];
+	case AAC_COLUMNS_TYPE_U64:
+		return ((const uint64_t *)values)[row];
+	case AAC_COLUMNS_TYPE_I16:
+		return ((const int16_t *)values)[row];
+	default:
+		CU_FAIL("unknown column type");
+		return 0;
+	}
+}
+
+
+static void test_columns_adts(void)
+{
+	int ret;
+	uint64_t row;
+	int64_t bits;
+	struct aac_ctx *ctx = NULL;
+	struct aac_adts adts;
+	struct aac_bitstream bs;
+	struct columns_file cf;
+	struct aac_columns *columns = NULL;
+	const struct aac_columns_block *block;
+
+	/* Silent stereo ADTS frames */
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_adts_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_adts,
+					&adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_ctx_set_adts(ctx, &adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < COLUMNS_FRAME_COUNT; i++) {
+		ret = aac_write_silent_frame(&bs, ctx, 2, COLUMNS_FRAME_SIZE);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+
+	ret = aac_columns_new(NULL, &columns);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	CU_ASSERT_PTR_NULL(columns);
+	columns_export(bs.data, bs.off, NULL, COLUMNS_FRAME_COUNT, &cf);
+
+	/* Second (partial) block */
+	block = (const struct aac_columns_block *)(cf.blocks +
+						   cf.header->block_size);
+	CU_ASSERT_EQUAL(block->first_row, AAC_COLUMNS_BLOCK_ROWS);
+	CU_ASSERT_EQUAL(block->row_count, 4);
+
+	row = AAC_COLUMNS_BLOCK_ROWS + 3;
+	CU_ASSERT_EQUAL(columns_value(&cf, "offset", row),
+			row * COLUMNS_FRAME_SIZE);
+	CU_ASSERT_EQUAL(columns_value(&cf, "length", row), COLUMNS_FRAME_SIZE);
+	CU_ASSERT_EQUAL(columns_value(&cf, "aot", row), AAC_AOT_AAC_LC);
+	CU_ASSERT_EQUAL(columns_value(&cf, "channel_configuration", row), 2);
+	CU_ASSERT_EQUAL(columns_value(&cf, "raw_data_blocks", row), 1);
+	CU_ASSERT_EQUAL(columns_value(&cf, "global_gain_0", row), 0x8C);
+	CU_ASSERT_EQUAL(columns_value(&cf, "global_gain_1", row), 0x8C);
+	CU_ASSERT_EQUAL(columns_value(&cf, "global_gain_2", row), -1);
+	CU_ASSERT_EQUAL(columns_value(&cf, "window_sequence_0", row),
+			ONLY_LONG_SEQUENCE);
+	CU_ASSERT_EQUAL(columns_value(&cf, "window_sequence_2", row),
+			UINT8_MAX);
+	CU_ASSERT_EQUAL(columns_value(&cf, "crc_present", row), 0);
+	CU_ASSERT_EQUAL(columns_value(&cf, "crc_check", row), UINT16_MAX);
+
+	/* All the payload bits but END and the byte alignment */
+	bits = columns_value(&cf, "bits_cpe", row);
+	CU_ASSERT(bits > 0);
+	bits += columns_value(&cf, "bits_fil", row);
+	CU_ASSERT(bits + 3 <= (COLUMNS_FRAME_SIZE - 7) * 8);
+	CU_ASSERT(bits + 3 + 8 > (COLUMNS_FRAME_SIZE - 7) * 8);
+	CU_ASSERT_EQUAL(columns_value(&cf, "bits_sce", row), 0);
+
+	free(cf.data);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+static void test_columns_adts_crc(void)
+{
+	int ret;
+	struct aac_ctx *ctx = NULL;
+	struct aac_adts adts;
+	struct aac_bitstream bs;
+	struct columns_file cf;
+
+	/* Silent stereo ADTS frames with a CRC; the library does not
+	 * compute it, set a different value in each frame */
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_adts_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_adts,
+					&adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	adts.protection_absent = 0;
+	ret = aac_ctx_set_adts(ctx, &adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < 4; i++) {
+		ret = aac_write_silent_frame(&bs, ctx, 2, COLUMNS_FRAME_SIZE);
+		CU_ASSERT_EQUAL(ret, 0);
+		CU_ASSERT_EQUAL_FATAL(bs.off, (i + 1) * COLUMNS_FRAME_SIZE);
+		bs.data[i * COLUMNS_FRAME_SIZE + 7] = 0x12;
+		bs.data[i * COLUMNS_FRAME_SIZE + 8] = 0x30 + i;
+	}
+
+	columns_export(bs.data, bs.off, NULL, 4, &cf);
+	for (int i = 0; i < 4; i++) {
+		CU_ASSERT_EQUAL(columns_value(&cf, "crc_present", i), 1);
+		CU_ASSERT_EQUAL(columns_value(&cf, "crc_check", i),
+				0x1230 + i);
+		CU_ASSERT_EQUAL(columns_value(&cf, "global_gain_1", i), 0x8C);
+	}
+
+	free(cf.data);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+static void test_columns_raw(void)
+{
+	int ret;
+	size_t len;
+	struct aac_ctx *ctx = NULL;
+	struct aac_asc asc;
+	struct aac_bitstream bs;
+	struct columns_file cf;
+
+	/* Silent mono raw data blocks; the SCE of the first one is turned
+	 * into an LFE (same syntax) */
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	memset(&asc, 0, sizeof(asc));
+	ret = aac_asc_from_adef_format(&adef_aac_lc_16b_48000hz_mono_raw, &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_ctx_set_asc(ctx, &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < 3; i++) {
+		ret = aac_write_silent_frame(&bs, ctx, 1, 0);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	len = bs.off / 3;
+	CU_ASSERT_EQUAL((bs.data[0] >> 5), AAC_SYN_ELE_ID_SCE);
+	bs.data[0] |= AAC_SYN_ELE_ID_LFE << 5;
+
+	columns_export(bs.data, bs.off, &asc, 3, &cf);
+	CU_ASSERT_EQUAL(columns_value(&cf, "offset", 2), 2 * len);
+	CU_ASSERT_EQUAL(columns_value(&cf, "length", 2), len);
+	CU_ASSERT_EQUAL(columns_value(&cf, "aot", 0), AAC_AOT_AAC_LC);
+	CU_ASSERT_EQUAL(columns_value(&cf, "sampling_frequency_index", 0), 3);
+	CU_ASSERT_EQUAL(columns_value(&cf, "raw_data_blocks", 0), 1);
+	CU_ASSERT_EQUAL(columns_value(&cf, "buffer_fullness", 0), UINT16_MAX);
+	CU_ASSERT_EQUAL(columns_value(&cf, "crc_present", 0), 0);
+	CU_ASSERT_EQUAL(columns_value(&cf, "crc_check", 0), UINT16_MAX);
+	for (int i = 0; i < 3; i++) {
+		CU_ASSERT_EQUAL(columns_value(&cf, "global_gain_0", i), 0x8C);
+		CU_ASSERT_EQUAL(columns_value(&cf, "global_gain_1", i), -1);
+	}
+	CU_ASSERT(columns_value(&cf, "bits_lfe", 0) > 0);
+	CU_ASSERT_EQUAL(columns_value(&cf, "bits_sce", 0), 0);
+	CU_ASSERT_EQUAL(columns_value(&cf, "bits_lfe", 1), 0);
+	CU_ASSERT_EQUAL(columns_value(&cf, "bits_sce", 1),
+			columns_value(&cf, "bits_lfe", 0));
+
+	free(cf.data);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+static void test_columns_loas(void)
+{
+	int ret;
+	struct aac_ctx *ctx = NULL;
+	struct aac_asc asc;
+	struct aac_StreamMuxConfig smc;
+	struct aac_bitstream bs;
+	struct columns_file cf;
+
+	/* Silent stereo LOAS frames, the first one with the StreamMuxConfig */
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	memset(&asc, 0, sizeof(asc));
+	ret = aac_asc_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_raw,
+				       &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	memset(&smc, 0, sizeof(smc));
+	smc.allStreamsSameTimeFraming = 1;
+	smc.latmBufferFullness = 0xFF;
+	ret = aac_ctx_set_loas(ctx, &smc, &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < 3; i++) {
+		ret = aac_write_silent_frame(&bs, ctx, 2, 0);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	CU_ASSERT_EQUAL(bs.off, 16 + 11 + 11);
+
+	columns_export(bs.data, bs.off, NULL, 3, &cf);
+	CU_ASSERT_EQUAL(columns_value(&cf, "offset", 0), 0);
+	CU_ASSERT_EQUAL(columns_value(&cf, "length", 0), 16);
+	CU_ASSERT_EQUAL(columns_value(&cf, "offset", 2), 16 + 11);
+	CU_ASSERT_EQUAL(columns_value(&cf, "length", 2), 11);
+	for (int i = 0; i < 3; i++) {
+		CU_ASSERT_EQUAL(columns_value(&cf, "aot", i), AAC_AOT_AAC_LC);
+		CU_ASSERT_EQUAL(
+			columns_value(&cf, "channel_configuration", i), 2);
+		CU_ASSERT_EQUAL(columns_value(&cf, "raw_data_blocks", i), 1);
+		CU_ASSERT_EQUAL(columns_value(&cf, "crc_present", i), 0);
+		CU_ASSERT_EQUAL(columns_value(&cf, "global_gain_0", i), 0x8C);
+		CU_ASSERT_EQUAL(columns_value(&cf, "global_gain_1", i), 0x8C);
+		CU_ASSERT_EQUAL(columns_value(&cf, "window_sequence_2", i),
+				UINT8_MAX);
+		CU_ASSERT(columns_value(&cf, "bits_cpe", i) > 0);
+	}
+
+	free(cf.data);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+CU_TestInfo g_aac_test_columns[] = {
+	{FN("adts"), &test_columns_adts},
+	{FN("adts-crc"), &test_columns_adts_crc},
+	{FN("raw"), &test_columns_raw},
+	{FN("loas"), &test_columns_loas},
+
+	CU_TEST_INFO_NULL,
+};
@@ -0,0 +1,843 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "aac_test.h"
+
+
+#define DUMP_FRAME_COUNT 16
+
+
+/* Without a tree dump, the streaming dump output is a file; with a CBOR
+ * dump, its conversion is compared to the streaming dump */
+struct dump_test_ctx {
+	struct aac_dump *tree;
+	struct aac_dump *stream;
+	struct aac_dump *cbor;
+	struct aac_dump *conv;
+	size_t cbor_len;
+	size_t json_len;
+	uint32_t flags;
+	unsigned int frame_count;
+	unsigned int cpe_count;
+};
+
+
+static unsigned int count_str(const char *str, const char *pattern)
+{
+	unsigned int count = 0;
+
+	while ((str = strstr(str, pattern)) != NULL) {
+		count++;
+		str++;
+	}
+	return count;
+}
+
+
+static void dump_cbor(struct dump_test_ctx *test, struct aac_ctx *ctx)
+{
+	int ret;
+	const uint8_t *data = NULL;
+	size_t len = 0, off = 0;
+	const char *conv_str = NULL, *stream_str = NULL;
+
+	ret = aac_dump_adts_frame(test->cbor, ctx, test->flags);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_dump_get_data(test->cbor, &data, &len);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(data);
+
+	/* Truncated frames are incomplete */
+	ret = aac_dump_from_cbor(test->conv, data, len - 1, &off);
+	CU_ASSERT_EQUAL(ret, -EAGAIN);
+	CU_ASSERT_EQUAL(off, 0);
+
+	ret = aac_dump_from_cbor(test->conv, data, len, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, len);
+	ret = aac_dump_get_json_str(test->conv, &conv_str);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_dump_get_json_str(test->stream, &stream_str);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(conv_str);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(stream_str);
+	CU_ASSERT_STRING_EQUAL(conv_str, stream_str);
+
+	test->cbor_len += len;
+	test->json_len += strlen(stream_str);
+}
+
+
+static void adts_frame_end_cb(struct aac_ctx *ctx,
+			      const uint8_t *buf,
+			      size_t len,
+			      const struct aac_adts *adts,
+			      void *userdata)
+{
+	int ret;
+	struct dump_test_ctx *test = userdata;
+	const char *tree_str = NULL, *stream_str = NULL;
+
+	test->frame_count++;
+	ret = aac_dump_adts_frame(test->stream, ctx, test->flags);
+	CU_ASSERT_EQUAL(ret, 0);
+	if (test->cbor != NULL)
+		dump_cbor(test, ctx);
+	if (test->tree == NULL)
+		return;
+
+	ret = aac_dump_adts_frame(test->tree, ctx, test->flags);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_dump_get_json_str(test->tree, &tree_str);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_dump_get_json_str(test->stream, &stream_str);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tree_str);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(stream_str);
+	if ((test->flags & AAC_DUMP_FLAGS_FRAME_DATA) == 0) {
+		CU_ASSERT_STRING_EQUAL(stream_str, tree_str);
+		return;
+	}
+
+	/* Repeated members are all kept, the tree only keeps the last one */
+	CU_ASSERT_EQUAL(count_str(stream_str, "\"channel_pair_element\": {"),
+			test->cpe_count);
+	CU_ASSERT_EQUAL(count_str(tree_str, "\"channel_pair_element\": {"),
+			1);
+	CU_ASSERT_EQUAL(count_str(stream_str, "{"),
+			count_str(stream_str, " }"));
+	CU_ASSERT_STRING_EQUAL(stream_str + strlen(stream_str) - 2, " }");
+}
+
+
+static const struct aac_ctx_cbs dump_cbs = {
+	.adts_frame_end = &adts_frame_end_cb,
+};
+
+
+static void dump_gen_parse(const struct aac_gen_cfg *cfg,
+			   struct dump_test_ctx *test)
+{
+	int ret;
+	size_t off = 0;
+	struct aac_gen *gen = NULL;
+	struct aac_bitstream bs;
+	struct aac_reader *reader = NULL;
+
+	ret = aac_gen_new(cfg, &gen);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < DUMP_FRAME_COUNT; i++) {
+		ret = aac_gen_write_frame(gen, &bs);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	aac_gen_destroy(gen);
+
+	ret = aac_reader_new(&dump_cbs, test, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, bs.data, bs.off, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, bs.off);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+}
+
+
+static void test_dump_stream(void)
+{
+	int ret;
+	struct aac_dump_cfg cfg;
+	struct aac_gen_cfg gen_cfg;
+	struct dump_test_ctx test;
+	struct json_object *jobj = NULL;
+
+	memset(&test, 0, sizeof(test));
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.type = AAC_DUMP_TYPE_JSON;
+	ret = aac_dump_new(&cfg, &test.tree);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	cfg.type = AAC_DUMP_TYPE_JSON_STREAM;
+	ret = aac_dump_new(&cfg, &test.stream);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+	/* No object tree in the streaming dump */
+	ret = aac_dump_get_json_object(test.stream, &jobj);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+
+	/* Same text as the json-c tree for the headers */
+	memset(&gen_cfg, 0, sizeof(gen_cfg));
+	gen_cfg.seed = 40;
+	gen_cfg.data_format = ADEF_AAC_DATA_FORMAT_ADTS;
+	gen_cfg.sampling_frequency_index = 4;
+	gen_cfg.sce_count = 1;
+	gen_cfg.cpe_count = 2;
+	gen_cfg.cce_count = 1;
+	gen_cfg.dse_count = 1;
+	gen_cfg.pce_count = 1;
+	gen_cfg.fil_count = 1;
+	gen_cfg.flags = AAC_GEN_FLAGS_WINDOWS | AAC_GEN_FLAGS_TNS |
+			AAC_GEN_FLAGS_PULSE | AAC_GEN_FLAGS_MS;
+	dump_gen_parse(&gen_cfg, &test);
+	CU_ASSERT_EQUAL(test.frame_count, DUMP_FRAME_COUNT);
+
+	/* Frame data */
+	test.flags = AAC_DUMP_FLAGS_FRAME_DATA;
+	test.cpe_count = gen_cfg.cpe_count;
+	dump_gen_parse(&gen_cfg, &test);
+	CU_ASSERT_EQUAL(test.frame_count, 2 * DUMP_FRAME_COUNT);
+
+	aac_dump_destroy(test.tree);
+	aac_dump_destroy(test.stream);
+}
+
+
+static void test_dump_stream_file(void)
+{
+	int ret;
+	long size;
+	char *buf;
+	const char *str = NULL;
+	struct aac_dump_cfg cfg;
+	struct aac_gen_cfg gen_cfg;
+	struct dump_test_ctx test;
+	FILE *file;
+
+	file = tmpfile();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+	memset(&test, 0, sizeof(test));
+	test.flags = AAC_DUMP_FLAGS_FRAME_DATA;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.type = AAC_DUMP_TYPE_JSON_STREAM;
+	cfg.file = file;
+	ret = aac_dump_new(&cfg, &test.stream);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+	/* The text goes to the file only */
+	ret = aac_dump_get_json_str(test.stream, &str);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+
+	memset(&gen_cfg, 0, sizeof(gen_cfg));
+	gen_cfg.seed = 41;
+	gen_cfg.data_format = ADEF_AAC_DATA_FORMAT_ADTS;
+	gen_cfg.sampling_frequency_index = 3;
+	gen_cfg.cpe_count = 1;
+	dump_gen_parse(&gen_cfg, &test);
+	CU_ASSERT_EQUAL(test.frame_count, DUMP_FRAME_COUNT);
+
+	/* One line per frame */
+	CU_ASSERT_EQUAL(fseek(file, 0, SEEK_END), 0);
+	size = ftell(file);
+	CU_ASSERT_TRUE_FATAL(size > 0);
+	rewind(file);
+	buf = malloc(size + 1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(buf);
+	CU_ASSERT_EQUAL(fread(buf, 1, size, file), (size_t)size);
+	buf[size] = '\0';
+	CU_ASSERT_EQUAL(buf[0], '{');
+	CU_ASSERT_EQUAL(buf[size - 1], '\n');
+	ret = 0;
+	for (long i = 0; i < size; i++)
+		ret += buf[i] == '\n';
+	CU_ASSERT_EQUAL(ret, DUMP_FRAME_COUNT);
+
+	free(buf);
+	fclose(file);
+	aac_dump_destroy(test.stream);
+}
+
+
+static void test_dump_cbor(void)
+{
+	int ret;
+	size_t off = 0;
+	struct aac_dump_cfg cfg;
+	struct aac_gen_cfg gen_cfg;
+	struct dump_test_ctx test;
+	static const uint8_t not_cbor[] = {0xbf, 0x61, 0x61, 0x01, 0xff};
+
+	memset(&test, 0, sizeof(test));
+	test.flags = AAC_DUMP_FLAGS_FRAME_DATA;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.type = AAC_DUMP_TYPE_JSON_STREAM;
+	ret = aac_dump_new(&cfg, &test.stream);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_dump_new(&cfg, &test.conv);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	cfg.type = AAC_DUMP_TYPE_CBOR;
+	ret = aac_dump_new(&cfg, &test.cbor);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+	/* Not a stringref namespace; no conversion to CBOR */
+	ret = aac_dump_from_cbor(test.conv, not_cbor, sizeof(not_cbor), &off);
+	CU_ASSERT_EQUAL(ret, -EPROTO);
+	ret = aac_dump_from_cbor(test.cbor, not_cbor, sizeof(not_cbor), &off);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+
+	memset(&gen_cfg, 0, sizeof(gen_cfg));
+	gen_cfg.seed = 42;
+	gen_cfg.data_format = ADEF_AAC_DATA_FORMAT_ADTS;
+	gen_cfg.sampling_frequency_index = 3;
+	gen_cfg.sce_count = 1;
+	gen_cfg.cpe_count = 1;
+	gen_cfg.cce_count = 1;
+	gen_cfg.dse_count = 1;
+	gen_cfg.pce_count = 1;
+	gen_cfg.fil_count = 1;
+	gen_cfg.flags = AAC_GEN_FLAGS_WINDOWS | AAC_GEN_FLAGS_TNS |
+			AAC_GEN_FLAGS_PULSE | AAC_GEN_FLAGS_ESCAPES;
+	dump_gen_parse(&gen_cfg, &test);
+	CU_ASSERT_EQUAL(test.frame_count, DUMP_FRAME_COUNT);
+	CU_ASSERT_TRUE(test.cbor_len < test.json_len / 2);
+
+	aac_dump_destroy(test.stream);
+	aac_dump_destroy(test.conv);
+	aac_dump_destroy(test.cbor);
+}
+
+
+struct visit_test_ctx {
+	struct aac_dump *dump;
+	unsigned int frame_count;
+	unsigned int depth;
+	unsigned int max_depth;
+	unsigned int struct_count;
+	unsigned int cpe_count;
+	unsigned int field_count;
+	unsigned int switch_count;
+	unsigned int gain_count;
+	int64_t aac_frame_length;
+	/* Stop the walk after this number of fields (if not 0) */
+	unsigned int abort_count;
+};
+
+
+static int visit_begin_cb(struct aac_dump *dump,
+			  const char *name,
+			  void *userdata)
+{
+	struct visit_test_ctx *test = userdata;
+
+	test->depth++;
+	if (test->depth > test->max_depth)
+		test->max_depth = test->depth;
+	test->struct_count++;
+	if (strcmp(name, "channel_pair_element") == 0)
+		test->cpe_count++;
+	return 0;
+}
+
+
+static int visit_end_cb(struct aac_dump *dump,
+			const char *name,
+			void *userdata)
+{
+	struct visit_test_ctx *test = userdata;
+
+	CU_ASSERT_TRUE(test->depth > 0);
+	test->depth--;
+	return 0;
+}
+
+
+static int visit_field_cb(struct aac_dump *dump,
+			  const char *key,
+			  size_t len,
+			  int64_t val,
+			  void *userdata)
+{
+	struct visit_test_ctx *test = userdata;
+
+	test->field_count++;
+	if (test->abort_count > 0 && test->field_count >= test->abort_count)
+		return -ECANCELED;
+	if (len == 16 && memcmp(key, "aac_frame_length", len) == 0)
+		test->aac_frame_length = val;
+	else if (len == 15 && memcmp(key, "window_sequence", len) == 0)
+		test->switch_count += (val != ONLY_LONG_SEQUENCE);
+	else if (len == 11 && memcmp(key, "global_gain", len) == 0)
+		test->gain_count++;
+	return 0;
+}
+
+
+/* Arrays are not counted as structures */
+static const struct aac_dump_visitor visitor = {
+	.begin_struct = &visit_begin_cb,
+	.end_struct = &visit_end_cb,
+	.field = &visit_field_cb,
+};
+
+
+static void visit_adts_frame_end_cb(struct aac_ctx *ctx,
+				    const uint8_t *buf,
+				    size_t len,
+				    const struct aac_adts *adts,
+				    void *userdata)
+{
+	int ret;
+	struct visit_test_ctx *test = userdata;
+
+	test->frame_count++;
+	ret = aac_dump_adts_frame(test->dump, ctx, AAC_DUMP_FLAGS_FRAME_DATA);
+	if (test->abort_count > 0) {
+		CU_ASSERT_EQUAL(ret, -ECANCELED);
+		return;
+	}
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(test->depth, 0);
+	CU_ASSERT_EQUAL(test->aac_frame_length, adts->aac_frame_length);
+}
+
+
+static const struct aac_ctx_cbs visit_cbs = {
+	.adts_frame_end = &visit_adts_frame_end_cb,
+};
+
+
+static void test_dump_visitor(void)
+{
+	int ret;
+	size_t off = 0;
+	struct aac_dump_cfg cfg;
+	struct aac_gen_cfg gen_cfg;
+	struct aac_gen *gen = NULL;
+	struct aac_bitstream bs;
+	struct aac_reader *reader = NULL;
+	struct visit_test_ctx test;
+	const uint8_t *data = NULL;
+	size_t len = 0;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.type = AAC_DUMP_TYPE_VISITOR;
+	ret = aac_dump_new(&cfg, &test.dump);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+
+	memset(&test, 0, sizeof(test));
+	cfg.visitor = &visitor;
+	cfg.userdata = &test;
+	ret = aac_dump_new(&cfg, &test.dump);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_dump_get_data(test.dump, &data, &len);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+
+	memset(&gen_cfg, 0, sizeof(gen_cfg));
+	gen_cfg.seed = 43;
+	gen_cfg.data_format = ADEF_AAC_DATA_FORMAT_ADTS;
+	gen_cfg.sampling_frequency_index = 3;
+	gen_cfg.sce_count = 1;
+	gen_cfg.cpe_count = 2;
+	gen_cfg.flags = AAC_GEN_FLAGS_WINDOWS | AAC_GEN_FLAGS_TNS;
+	ret = aac_gen_new(&gen_cfg, &gen);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < DUMP_FRAME_COUNT; i++) {
+		ret = aac_gen_write_frame(gen, &bs);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	aac_gen_destroy(gen);
+
+	/* Every element is visited, unlike in the tree dump */
+	ret = aac_reader_new(&visit_cbs, &test, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, bs.data, bs.off, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(test.frame_count, DUMP_FRAME_COUNT);
+	CU_ASSERT_EQUAL(test.cpe_count, 2 * DUMP_FRAME_COUNT);
+	CU_ASSERT_TRUE(test.switch_count > 0);
+	CU_ASSERT_TRUE(test.max_depth >= 3);
+	CU_ASSERT_TRUE(test.field_count > 100 * DUMP_FRAME_COUNT);
+
+	/* Stop the walk */
+	test.frame_count = 0;
+	test.field_count = 0;
+	test.abort_count = 10;
+	off = 0;
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, bs.data, bs.off, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(test.frame_count, DUMP_FRAME_COUNT);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_dump_destroy(test.dump);
+}
+
+
+static void raw_data_block_cb(struct aac_ctx *ctx,
+			      const uint8_t *buf,
+			      size_t len,
+			      const struct aac_raw_data_block *block,
+			      void *userdata)
+{
+	int ret;
+	struct dump_test_ctx *test = userdata;
+	const char *tree_str = NULL, *stream_str = NULL;
+
+	test->frame_count++;
+	ret = aac_dump_raw_data_block(test->tree, ctx, block);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_dump_raw_data_block(test->stream, ctx, block);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_dump_get_json_str(test->tree, &tree_str);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_dump_get_json_str(test->stream, &stream_str);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tree_str);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(stream_str);
+
+	CU_ASSERT_EQUAL(count_str(tree_str, "{ \"raw_data_block\": {"), 1);
+	CU_ASSERT_EQUAL(count_str(stream_str, "{ \"raw_data_block\": {"), 1);
+	CU_ASSERT_EQUAL(count_str(stream_str, "{"),
+			count_str(stream_str, " }"));
+	CU_ASSERT_EQUAL(count_str(stream_str, "\"channel_pair_element\": {"),
+			test->cpe_count);
+}
+
+
+static const struct aac_ctx_cbs raw_cbs = {
+	.raw_data_block = &raw_data_block_cb,
+};
+
+
+static void test_dump_raw(void)
+{
+	int ret;
+	size_t off = 0;
+	struct aac_dump_cfg cfg;
+	struct aac_gen_cfg gen_cfg;
+	struct aac_gen *gen = NULL;
+	struct aac_bitstream bs;
+	struct aac_reader *reader = NULL;
+	struct aac_asc asc;
+	struct dump_test_ctx test;
+	const char *str = NULL;
+
+	memset(&test, 0, sizeof(test));
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.type = AAC_DUMP_TYPE_JSON;
+	ret = aac_dump_new(&cfg, &test.tree);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	cfg.type = AAC_DUMP_TYPE_JSON_STREAM;
+	ret = aac_dump_new(&cfg, &test.stream);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+	memset(&gen_cfg, 0, sizeof(gen_cfg));
+	gen_cfg.seed = 45;
+	gen_cfg.data_format = ADEF_AAC_DATA_FORMAT_RAW;
+	gen_cfg.sampling_frequency_index = 4;
+	gen_cfg.sce_count = 1;
+	gen_cfg.cpe_count = 1;
+	gen_cfg.fil_count = 1;
+	gen_cfg.flags = AAC_GEN_FLAGS_WINDOWS | AAC_GEN_FLAGS_TNS;
+	ret = aac_gen_new(&gen_cfg, &gen);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_gen_get_asc(gen, &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < DUMP_FRAME_COUNT; i++) {
+		ret = aac_gen_write_frame(gen, &bs);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	aac_gen_destroy(gen);
+
+	/* AudioSpecificConfig */
+	ret = aac_dump_asc(test.tree, NULL);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	ret = aac_dump_asc(test.tree, &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_dump_get_json_str(test.tree, &str);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(str);
+	CU_ASSERT_EQUAL(count_str(str, "{ \"AudioSpecificConfig\": {"), 1);
+	CU_ASSERT_EQUAL(count_str(str, "\"audioObjectType\": 2,"), 1);
+	CU_ASSERT_EQUAL(count_str(str, "\"samplingFrequencyIndex\": 4,"), 1);
+
+	/* Access units of the raw stream */
+	test.cpe_count = gen_cfg.cpe_count;
+	ret = aac_reader_new(&raw_cbs, &test, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_ctx_set_asc(aac_reader_get_ctx(reader), &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, bs.data, bs.off, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, bs.off);
+	CU_ASSERT_EQUAL(test.frame_count, DUMP_FRAME_COUNT);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_dump_destroy(test.tree);
+	aac_dump_destroy(test.stream);
+}
+
+
+static void loas_frame_end_cb(struct aac_ctx *ctx,
+			      const uint8_t *buf,
+			      size_t len,
+			      const struct aac_StreamMuxConfig *smc,
+			      void *userdata)
+{
+	int ret;
+	struct dump_test_ctx *test = userdata;
+	const char *str = NULL;
+
+	ret = aac_dump_loas_frame(test->stream, ctx, test->flags);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_dump_get_json_str(test->stream, &str);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(str);
+
+	/* Only the first frame carries the StreamMuxConfig */
+	CU_ASSERT_EQUAL(count_str(str, "{ \"aac_loas\": {"), 1);
+	CU_ASSERT_EQUAL(count_str(str, "\"StreamMuxConfig\": {"),
+			test->frame_count == 0 ? 1 : 0);
+	CU_ASSERT_EQUAL(count_str(str, "\"raw_data_block\": {"), 1);
+	CU_ASSERT_EQUAL(count_str(str, "\"channel_pair_element\": {"),
+			test->cpe_count);
+	CU_ASSERT_EQUAL(count_str(str, "{"), count_str(str, " }"));
+	test->frame_count++;
+}
+
+
+static const struct aac_ctx_cbs loas_cbs = {
+	.loas_frame_end = &loas_frame_end_cb,
+};
+
+
+static void test_dump_loas(void)
+{
+	int ret;
+	size_t off = 0, start;
+	struct aac_dump_cfg cfg;
+	struct aac_gen_cfg gen_cfg;
+	struct aac_gen *gen = NULL;
+	struct aac_ctx *ctx = NULL;
+	struct aac_bitstream bs, loas_bs;
+	struct aac_reader *reader = NULL;
+	struct aac_asc asc;
+	struct aac_StreamMuxConfig smc;
+	struct dump_test_ctx test;
+
+	memset(&test, 0, sizeof(test));
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.type = AAC_DUMP_TYPE_JSON_STREAM;
+	ret = aac_dump_new(&cfg, &test.stream);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	test.flags = AAC_DUMP_FLAGS_FRAME_DATA;
+
+	/* Access units of a raw stream carried in LOAS frames */
+	memset(&gen_cfg, 0, sizeof(gen_cfg));
+	gen_cfg.seed = 46;
+	gen_cfg.data_format = ADEF_AAC_DATA_FORMAT_RAW;
+	gen_cfg.sampling_frequency_index = 3;
+	gen_cfg.sce_count = 1;
+	gen_cfg.cpe_count = 2;
+	gen_cfg.flags = AAC_GEN_FLAGS_WINDOWS | AAC_GEN_FLAGS_TNS;
+	ret = aac_gen_new(&gen_cfg, &gen);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_gen_get_asc(gen, &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	memset(&smc, 0, sizeof(smc));
+	smc.allStreamsSameTimeFraming = 1;
+	smc.latmBufferFullness = 0xFF;
+	ret = aac_ctx_set_loas(ctx, &smc, &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	aac_bs_init(&loas_bs, NULL, 0);
+	for (int i = 0; i < DUMP_FRAME_COUNT; i++) {
+		start = bs.off;
+		ret = aac_gen_write_frame(gen, &bs);
+		CU_ASSERT_EQUAL(ret, 0);
+		ret = aac_write_loas_frame(
+			&loas_bs, ctx, bs.data + start, bs.off - start);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	aac_gen_destroy(gen);
+	aac_ctx_destroy(ctx);
+
+	ret = aac_dump_loas_frame(test.stream, NULL, test.flags);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+
+	test.cpe_count = gen_cfg.cpe_count;
+	ret = aac_reader_new(&loas_cbs, &test, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_parse(reader,
+			       AAC_READER_FLAGS_FRAME_DATA,
+			       loas_bs.data,
+			       loas_bs.off,
+			       &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, loas_bs.off);
+	CU_ASSERT_EQUAL(test.frame_count, DUMP_FRAME_COUNT);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_bs_clear(&loas_bs);
+	aac_dump_destroy(test.stream);
+}
+
+
+/* Walk the generated frames with a filtered visitor dump */
+static void visit_filtered(const struct aac_bitstream *bs,
+			   const char *const *include,
+			   unsigned int include_count,
+			   const char *const *exclude,
+			   unsigned int exclude_count,
+			   struct visit_test_ctx *test)
+{
+	int ret;
+	size_t off = 0;
+	struct aac_dump_cfg cfg;
+	struct aac_reader *reader = NULL;
+
+	memset(test, 0, sizeof(*test));
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.type = AAC_DUMP_TYPE_VISITOR;
+	cfg.visitor = &visitor;
+	cfg.userdata = test;
+	cfg.include_paths = include;
+	cfg.include_count = include_count;
+	cfg.exclude_paths = exclude;
+	cfg.exclude_count = exclude_count;
+	ret = aac_dump_new(&cfg, &test->dump);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+	ret = aac_reader_new(&visit_cbs, test, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, bs->data, bs->off, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(test->frame_count, DUMP_FRAME_COUNT);
+
+	aac_reader_destroy(reader);
+	aac_dump_destroy(test->dump);
+}
+
+
+static void test_dump_filter(void)
+{
+	int ret;
+	struct aac_dump *dump = NULL;
+	struct aac_dump_cfg cfg;
+	struct aac_gen_cfg gen_cfg;
+	struct aac_gen *gen = NULL;
+	struct aac_bitstream bs;
+	struct visit_test_ctx test;
+	unsigned int adts_count;
+	static const char *const invalid[] = {"", "a..b", "a.", ".a", NULL};
+	static const char *const gains[] = {
+		"aac_adts.aac_frame_length",
+		"raw_data_block.*.individual_channel_stream.global_gain",
+	};
+	static const char *const adts[] = {"aac_adts"};
+	static const char *const adts_fields[] = {"aac_adts.*"};
+	static const char *const data[] = {"raw_data_block"};
+	static const char *const syncword[] = {"*.syncword"};
+
+	/* Invalid paths */
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.type = AAC_DUMP_TYPE_JSON_STREAM;
+	cfg.include_count = 1;
+	ret = aac_dump_new(&cfg, &dump);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	cfg.include_count = AAC_DUMP_MAX_FILTER_PATHS + 1;
+	cfg.include_paths = gains;
+	ret = aac_dump_new(&cfg, &dump);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	cfg.include_count = 0;
+	cfg.exclude_count = 1;
+	for (size_t i = 0; i < ARRAY_SIZE(invalid); i++) {
+		cfg.exclude_paths = &invalid[i];
+		ret = aac_dump_new(&cfg, &dump);
+		CU_ASSERT_EQUAL(ret, -EINVAL);
+		CU_ASSERT_PTR_NULL(dump);
+	}
+
+	memset(&gen_cfg, 0, sizeof(gen_cfg));
+	gen_cfg.seed = 44;
+	gen_cfg.data_format = ADEF_AAC_DATA_FORMAT_ADTS;
+	gen_cfg.sampling_frequency_index = 3;
+	gen_cfg.sce_count = 1;
+	gen_cfg.cpe_count = 2;
+	gen_cfg.dse_count = 1;
+	gen_cfg.flags = AAC_GEN_FLAGS_WINDOWS | AAC_GEN_FLAGS_TNS;
+	ret = aac_gen_new(&gen_cfg, &gen);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < DUMP_FRAME_COUNT; i++) {
+		ret = aac_gen_write_frame(gen, &bs);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	aac_gen_destroy(gen);
+
+	/* Wildcard: one gain per SCE and two per CPE */
+	visit_filtered(&bs, gains, ARRAY_SIZE(gains), NULL, 0, &test);
+	CU_ASSERT_EQUAL(test.gain_count, 5 * DUMP_FRAME_COUNT);
+	CU_ASSERT_EQUAL(test.field_count, 6 * DUMP_FRAME_COUNT);
+	CU_ASSERT_EQUAL(test.max_depth, 3);
+
+	/* A path selects all the contents of a structure */
+	visit_filtered(&bs, adts, ARRAY_SIZE(adts), NULL, 0, &test);
+	adts_count = test.field_count;
+	CU_ASSERT_TRUE(adts_count > 0);
+	CU_ASSERT_EQUAL(test.struct_count, DUMP_FRAME_COUNT);
+	visit_filtered(
+		&bs, adts_fields, ARRAY_SIZE(adts_fields), NULL, 0, &test);
+	CU_ASSERT_EQUAL(test.field_count, adts_count);
+
+	/* Exclusion */
+	visit_filtered(&bs, NULL, 0, data, ARRAY_SIZE(data), &test);
+	CU_ASSERT_EQUAL(test.field_count, adts_count);
+	CU_ASSERT_EQUAL(test.gain_count, 0);
+	visit_filtered(&bs,
+		       adts_fields,
+		       ARRAY_SIZE(adts_fields),
+		       syncword,
+		       ARRAY_SIZE(syncword),
+		       &test);
+	CU_ASSERT_EQUAL(test.field_count, adts_count - DUMP_FRAME_COUNT);
+
+	aac_bs_clear(&bs);
+}
+
+
+CU_TestInfo g_aac_test_dump[] = {
+	{FN("cbor"), &test_dump_cbor},
+	{FN("filter"), &test_dump_filter},
+	{FN("loas"), &test_dump_loas},
+	{FN("raw"), &test_dump_raw},
+	{FN("stream"), &test_dump_stream},
+	{FN("stream-file"), &test_dump_stream_file},
+	{FN("visitor"), &test_dump_visitor},
+
+	CU_TEST_INFO_NULL,
+};
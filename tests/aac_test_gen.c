@@ -0,0 +1,422 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "aac_test.h"
+
+
+#define GEN_FRAME_COUNT 64
+
+
+struct gen_test_ctx {
+	const struct aac_gen_cfg *cfg;
+	unsigned int frame_count;
+	unsigned int block_count;
+	unsigned int short_count;
+	unsigned int tns_count;
+	unsigned int pulse_count;
+	/* Sections with spectral data, and with the escape codebook */
+	unsigned int spectral_sections;
+	unsigned int escape_sections;
+};
+
+
+static void gen_test_ics(struct gen_test_ctx *test,
+			 const struct aac_individual_channel_stream *ics)
+{
+	int num_window_groups = 1;
+
+	if (ics->ics_info.window_sequence == EIGHT_SHORT_SEQUENCE)
+		test->short_count++;
+	test->tns_count += ics->tns_data_present;
+	test->pulse_count += ics->pulse_data_present;
+	/* A window group per scale_factor_grouping bit cleared */
+	if (ics->ics_info.window_sequence == EIGHT_SHORT_SEQUENCE) {
+		for (int i = 0; i < 7; i++) {
+			if ((ics->ics_info.scale_factor_grouping &
+			     (1 << i)) == 0)
+				num_window_groups++;
+		}
+	}
+	for (int g = 0; g < num_window_groups; g++) {
+		for (int i = 0; i < ics->section_data.num_sec[g]; i++) {
+			int cb = ics->section_data.sect_cb[g][i];
+			if (cb == ZERO_HCB || cb > ESC_HCB)
+				continue;
+			test->spectral_sections++;
+			test->escape_sections += (cb == ESC_HCB);
+		}
+	}
+}
+
+
+static void adts_frame_end_cb(struct aac_ctx *ctx,
+			      const uint8_t *buf,
+			      size_t len,
+			      const struct aac_adts *adts,
+			      void *userdata)
+{
+	struct gen_test_ctx *test = userdata;
+	test->frame_count++;
+}
+
+
+static void raw_data_block_cb(struct aac_ctx *ctx,
+			      const uint8_t *buf,
+			      size_t len,
+			      const struct aac_raw_data_block *block,
+			      void *userdata)
+{
+	struct gen_test_ctx *test = userdata;
+	const struct aac_gen_cfg *cfg = test->cfg;
+	size_t i = 0;
+
+	test->block_count++;
+	/* END is not counted */
+	CU_ASSERT_EQUAL(block->elements_count,
+			cfg->pce_count + cfg->sce_count + cfg->cpe_count +
+				cfg->cce_count + cfg->dse_count +
+				cfg->fil_count);
+	for (unsigned int n = 0; n < cfg->pce_count; n++, i++) {
+		CU_ASSERT_EQUAL(block->elements[i].id_syn_ele,
+				AAC_SYN_ELE_ID_PCE);
+	}
+	for (unsigned int n = 0; n < cfg->sce_count; n++, i++) {
+		CU_ASSERT_EQUAL(block->elements[i].id_syn_ele,
+				AAC_SYN_ELE_ID_SCE);
+		gen_test_ics(test, &block->elements[i].sce.ics);
+	}
+	for (unsigned int n = 0; n < cfg->cpe_count; n++, i++) {
+		CU_ASSERT_EQUAL(block->elements[i].id_syn_ele,
+				AAC_SYN_ELE_ID_CPE);
+		gen_test_ics(test, &block->elements[i].cpe.ics1);
+		gen_test_ics(test, &block->elements[i].cpe.ics2);
+	}
+	for (unsigned int n = 0; n < cfg->cce_count; n++, i++) {
+		CU_ASSERT_EQUAL(block->elements[i].id_syn_ele,
+				AAC_SYN_ELE_ID_CCE);
+	}
+	for (unsigned int n = 0; n < cfg->dse_count; n++, i++) {
+		CU_ASSERT_EQUAL(block->elements[i].id_syn_ele,
+				AAC_SYN_ELE_ID_DSE);
+	}
+	for (unsigned int n = 0; n < cfg->fil_count; n++, i++) {
+		CU_ASSERT_EQUAL(block->elements[i].id_syn_ele,
+				AAC_SYN_ELE_ID_FIL);
+	}
+}
+
+
+static const struct aac_ctx_cbs gen_cbs = {
+	.adts_frame_end = &adts_frame_end_cb,
+	.raw_data_block = &raw_data_block_cb,
+};
+
+
+static void gen_stream(const struct aac_gen_cfg *cfg, struct aac_bitstream *bs)
+{
+	int ret;
+	struct aac_gen *gen = NULL;
+
+	ret = aac_gen_new(cfg, &gen);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	aac_bs_init(bs, NULL, 0);
+	for (int i = 0; i < GEN_FRAME_COUNT; i++) {
+		ret = aac_gen_write_frame(gen, bs);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	aac_gen_destroy(gen);
+}
+
+
+static void gen_parse(const struct aac_gen_cfg *cfg,
+		      struct gen_test_ctx *test)
+{
+	int ret;
+	size_t off = 0;
+	struct aac_bitstream bs;
+	struct aac_gen *gen = NULL;
+	struct aac_reader *reader = NULL;
+	struct aac_reader_stats stats;
+	struct aac_asc asc;
+
+	gen_stream(cfg, &bs);
+
+	memset(test, 0, sizeof(*test));
+	test->cfg = cfg;
+	ret = aac_reader_new(&gen_cbs, test, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	if (cfg->data_format == ADEF_AAC_DATA_FORMAT_RAW) {
+		ret = aac_gen_new(cfg, &gen);
+		CU_ASSERT_EQUAL_FATAL(ret, 0);
+		ret = aac_gen_get_asc(gen, &asc);
+		CU_ASSERT_EQUAL(ret, 0);
+		ret = aac_ctx_set_asc(aac_reader_get_ctx(reader), &asc);
+		CU_ASSERT_EQUAL(ret, 0);
+		aac_gen_destroy(gen);
+	}
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, bs.data, bs.off, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, bs.off);
+	ret = aac_reader_get_stats(reader, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.frames, GEN_FRAME_COUNT);
+	CU_ASSERT_EQUAL(stats.errors_truncated + stats.errors_invalid +
+				stats.errors_unsupported + stats.errors_other,
+			0);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+}
+
+
+static void test_gen_adts(void)
+{
+	struct gen_test_ctx test;
+	struct aac_gen_cfg cfg = {
+		.seed = 1,
+		.data_format = ADEF_AAC_DATA_FORMAT_ADTS,
+		.sampling_frequency_index = 3,
+		.cpe_count = 1,
+	};
+
+	/* Default stereo stream */
+	gen_parse(&cfg, &test);
+	CU_ASSERT_EQUAL(test.frame_count, GEN_FRAME_COUNT);
+
+	/* Escape-heavy 5.0 stream with all the coding tools: the frames
+	 * are kept below the ADTS size limit */
+	cfg.seed = 2;
+	cfg.sce_count = 1;
+	cfg.cpe_count = 2;
+	cfg.flags = AAC_GEN_FLAGS_WINDOWS | AAC_GEN_FLAGS_TNS |
+		    AAC_GEN_FLAGS_PULSE | AAC_GEN_FLAGS_ESCAPES |
+		    AAC_GEN_FLAGS_MS;
+	gen_parse(&cfg, &test);
+	CU_ASSERT_EQUAL(test.frame_count, GEN_FRAME_COUNT);
+
+	/* Every element type, a section per band */
+	cfg.seed = 3;
+	cfg.sce_count = 2;
+	cfg.cpe_count = 2;
+	cfg.cce_count = 1;
+	cfg.dse_count = 1;
+	cfg.pce_count = 1;
+	cfg.fil_count = 2;
+	cfg.sections = AAC_GEN_SECTIONS_PER_BAND;
+	cfg.flags = AAC_GEN_FLAGS_WINDOWS | AAC_GEN_FLAGS_TNS;
+	gen_parse(&cfg, &test);
+	CU_ASSERT_EQUAL(test.frame_count, GEN_FRAME_COUNT);
+}
+
+
+static void test_gen_raw(void)
+{
+	struct gen_test_ctx test;
+	struct aac_gen_cfg cfg = {
+		.seed = 4,
+		.data_format = ADEF_AAC_DATA_FORMAT_RAW,
+		.sampling_frequency_index = 4,
+		.sce_count = 1,
+		.cpe_count = 1,
+		.cce_count = 1,
+		.dse_count = 1,
+		.pce_count = 1,
+		.fil_count = 1,
+		.flags = AAC_GEN_FLAGS_WINDOWS | AAC_GEN_FLAGS_TNS |
+			 AAC_GEN_FLAGS_PULSE | AAC_GEN_FLAGS_ESCAPES |
+			 AAC_GEN_FLAGS_MS,
+	};
+
+	gen_parse(&cfg, &test);
+	CU_ASSERT_EQUAL(test.block_count, GEN_FRAME_COUNT);
+	CU_ASSERT_NOT_EQUAL(test.short_count, 0);
+	CU_ASSERT_NOT_EQUAL(test.tns_count, 0);
+	CU_ASSERT_NOT_EQUAL(test.pulse_count, 0);
+	/* Escape sequences are parsed */
+	CU_ASSERT_NOT_EQUAL(test.escape_sections, 0);
+
+	/* Without spectral data */
+	cfg.sections = AAC_GEN_SECTIONS_ZERO;
+	cfg.flags = 0;
+	gen_parse(&cfg, &test);
+	CU_ASSERT_EQUAL(test.block_count, GEN_FRAME_COUNT);
+	CU_ASSERT_EQUAL(test.short_count, 0);
+	CU_ASSERT_EQUAL(test.tns_count, 0);
+	CU_ASSERT_EQUAL(test.spectral_sections, 0);
+}
+
+
+static void test_gen_seed(void)
+{
+	int ret;
+	struct aac_bitstream bs1, bs2;
+	struct aac_gen *gen = NULL;
+	struct aac_gen_cfg cfg = {
+		.seed = 42,
+		.data_format = ADEF_AAC_DATA_FORMAT_ADTS,
+		.sampling_frequency_index = 3,
+		.sce_count = 1,
+		.cpe_count = 1,
+		.flags = AAC_GEN_FLAGS_WINDOWS | AAC_GEN_FLAGS_TNS,
+	};
+
+	/* Same configuration and seed: same stream */
+	gen_stream(&cfg, &bs1);
+	gen_stream(&cfg, &bs2);
+	CU_ASSERT_EQUAL(bs1.off, bs2.off);
+	CU_ASSERT_EQUAL(memcmp(bs1.data, bs2.data, bs1.off), 0);
+	aac_bs_clear(&bs2);
+
+	/* Another seed: another stream */
+	cfg.seed = 43;
+	gen_stream(&cfg, &bs2);
+	CU_ASSERT(bs1.off != bs2.off ||
+		  memcmp(bs1.data, bs2.data, bs1.off) != 0);
+	aac_bs_clear(&bs2);
+	aac_bs_clear(&bs1);
+
+	/* Invalid configurations */
+	cfg.sce_count = 0;
+	cfg.cpe_count = 0;
+	ret = aac_gen_new(&cfg, &gen);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	cfg.cpe_count = AAC_MAX_SYN_ELE;
+	ret = aac_gen_new(&cfg, &gen);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	cfg.cpe_count = 1;
+	cfg.sampling_frequency_index = 12;
+	ret = aac_gen_new(&cfg, &gen);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+}
+
+
+/* Growing buffer: the stream is appended by chunks that split the frames,
+ * each frame is parsed once when complete */
+static void test_gen_partial(void)
+{
+	int ret;
+	size_t len = 0, pos = 0, off, size;
+	uint8_t hdr[7];
+	static const uint8_t loas_empty[] = {0x56, 0xE0, 0x00};
+	struct aac_bitstream bs;
+	struct gen_test_ctx test;
+	struct aac_reader *reader = NULL;
+	struct aac_reader_stats stats;
+	struct aac_gen_cfg cfg = {
+		.seed = 46,
+		.data_format = ADEF_AAC_DATA_FORMAT_ADTS,
+		.sampling_frequency_index = 3,
+		.sce_count = 1,
+		.cpe_count = 1,
+		.flags = AAC_GEN_FLAGS_WINDOWS,
+	};
+
+	gen_stream(&cfg, &bs);
+
+	/* Frame size from the header */
+	ret = aac_frame_size(bs.data, 6, &size);
+	CU_ASSERT_EQUAL(ret, -EAGAIN);
+	ret = aac_frame_size(bs.data, 7, &size);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT(size > 7 && size < bs.off);
+	ret = aac_frame_size(bs.data + 1, bs.off - 1, &size);
+	CU_ASSERT_EQUAL(ret, -EPROTO);
+
+	/* Syncword patterns that are not frame headers: reserved
+	 * sampling_frequency_index, frame shorter than the header and its
+	 * crc_check, empty LOAS frame */
+	memcpy(hdr, bs.data, 7);
+	hdr[2] |= 0xF << 2;
+	ret = aac_frame_size(hdr, 7, &size);
+	CU_ASSERT_EQUAL(ret, -EPROTO);
+	memcpy(hdr, bs.data, 7);
+	hdr[1] &= ~0x01;
+	hdr[3] &= ~0x03;
+	hdr[4] = 0x01;
+	hdr[5] &= 0x1F;
+	ret = aac_frame_size(hdr, 7, &size);
+	CU_ASSERT_EQUAL(ret, -EPROTO);
+	hdr[5] |= 0x20;
+	ret = aac_frame_size(hdr, 7, &size);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(size, 9);
+	ret = aac_frame_size(loas_empty, sizeof(loas_empty), &size);
+	CU_ASSERT_EQUAL(ret, -EPROTO);
+
+	memset(&test, 0, sizeof(test));
+	test.cfg = &cfg;
+	ret = aac_reader_new(&gen_cbs, &test, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	while (pos < bs.off) {
+		len = (len + 1000 < bs.off) ? len + 1000 : bs.off;
+		off = 0;
+		ret = aac_reader_parse(reader,
+				       AAC_READER_FLAGS_FRAME_DATA |
+					       AAC_READER_FLAGS_PARTIAL,
+				       bs.data + pos,
+				       len - pos,
+				       &off);
+		CU_ASSERT_EQUAL_FATAL(ret, 0);
+		pos += off;
+		if (len < bs.off)
+			CU_ASSERT(pos < len);
+	}
+	CU_ASSERT_EQUAL(test.frame_count, GEN_FRAME_COUNT);
+	ret = aac_reader_get_stats(reader, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.frames, GEN_FRAME_COUNT);
+	CU_ASSERT_EQUAL(stats.bytes, bs.off);
+	CU_ASSERT_EQUAL(stats.errors_truncated, 0);
+
+	/* Without the flag, an incomplete frame is a truncated frame */
+	ret = aac_frame_size(bs.data, bs.off, &size);
+	CU_ASSERT_EQUAL(ret, 0);
+	off = 0;
+	ret = aac_reader_parse(reader,
+			       AAC_READER_FLAGS_FRAME_DATA,
+			       bs.data,
+			       size - 1,
+			       &off);
+	CU_ASSERT(ret < 0);
+	ret = aac_reader_get_stats(reader, &stats);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(stats.errors_truncated, 1);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+}
+
+
+CU_TestInfo g_aac_test_gen[] = {
+	{FN("adts"), &test_gen_adts},
+	{FN("partial"), &test_gen_partial},
+	{FN("raw"), &test_gen_raw},
+	{FN("seed"), &test_gen_seed},
+
+	CU_TEST_INFO_NULL,
+};
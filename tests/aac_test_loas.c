@@ -0,0 +1,256 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "aac_test.h"
+
+
+struct loas_test_ctx {
+	unsigned int begin_count;
+	unsigned int end_count;
+	size_t total_len;
+	struct aac_StreamMuxConfig smc;
+};
+
+
+static void loas_frame_begin_cb(struct aac_ctx *ctx,
+				const uint8_t *buf,
+				size_t len,
+				const struct aac_StreamMuxConfig *smc,
+				void *userdata)
+{
+	struct loas_test_ctx *test = userdata;
+	test->begin_count++;
+	CU_ASSERT_PTR_NOT_NULL(buf);
+	CU_ASSERT_EQUAL(buf[0], 0x56);
+}
+
+
+static void loas_frame_end_cb(struct aac_ctx *ctx,
+			      const uint8_t *buf,
+			      size_t len,
+			      const struct aac_StreamMuxConfig *smc,
+			      void *userdata)
+{
+	struct loas_test_ctx *test = userdata;
+	test->end_count++;
+	test->total_len += len;
+	test->smc = *smc;
+}
+
+
+static const struct aac_ctx_cbs loas_cbs = {
+	.loas_frame_begin = &loas_frame_begin_cb,
+	.loas_frame_end = &loas_frame_end_cb,
+};
+
+
+static void setup_loas_ctx(struct aac_ctx *ctx, unsigned int version)
+{
+	int ret;
+	struct aac_asc asc;
+	struct aac_StreamMuxConfig smc;
+
+	memset(&asc, 0, sizeof(asc));
+	ret = aac_asc_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_raw,
+				       &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	memset(&smc, 0, sizeof(smc));
+	smc.audioMuxVersion = version;
+	smc.allStreamsSameTimeFraming = 1;
+	smc.latmBufferFullness = 0xFF;
+	if (version == 1) {
+		smc.taraBufferFullness = 0x1234;
+		smc.otherDataPresent = 1;
+		smc.otherDataLenBits = 300;
+		smc.crcCheckPresent = 1;
+		smc.crcCheckSum = 0xA5;
+	}
+	ret = aac_ctx_set_loas(ctx, &smc, &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+}
+
+
+static void test_loas_silent(void)
+{
+	int ret;
+	size_t off = 0;
+	struct aac_ctx *ctx = NULL;
+	struct aac_bitstream bs;
+	struct aac_reader *reader = NULL;
+	struct aac_ctx *rctx;
+	const struct aac_asc *asc;
+	struct loas_test_ctx test;
+
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	setup_loas_ctx(ctx, 0);
+	CU_ASSERT_EQUAL(aac_ctx_get_transport(ctx), AAC_TRANSPORT_LOAS);
+
+	/* First frame carries the StreamMuxConfig, the others reuse it */
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < 3; i++) {
+		ret = aac_write_silent_frame(&bs, ctx, 2, 0);
+		CU_ASSERT_EQUAL(ret, 0);
+		CU_ASSERT_EQUAL(bs.off, 16 + 11 * i);
+	}
+	CU_ASSERT_EQUAL(bs.data[0], 0x56);
+	CU_ASSERT_EQUAL(bs.data[1], 0xE0);
+	CU_ASSERT_EQUAL(bs.data[2], 13);
+	/* useSameStreamMux */
+	CU_ASSERT_EQUAL(bs.data[3] & 0x80, 0x00);
+	CU_ASSERT_EQUAL(bs.data[16 + 3] & 0x80, 0x80);
+
+	/* Format is detected and the frames are parsed */
+	memset(&test, 0, sizeof(test));
+	ret = aac_reader_new(&loas_cbs, &test, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, bs.data, bs.off, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, bs.off);
+	CU_ASSERT_EQUAL(test.begin_count, 3);
+	CU_ASSERT_EQUAL(test.end_count, 3);
+	CU_ASSERT_EQUAL(test.total_len, bs.off);
+	CU_ASSERT_EQUAL(test.smc.audioMuxVersion, 0);
+	CU_ASSERT_EQUAL(test.smc.numSubFrames, 0);
+	CU_ASSERT_EQUAL(test.smc.latmBufferFullness, 0xFF);
+
+	/* Invalid syncword */
+	off = 0;
+	bs.data[16] = 0x00;
+	ret = aac_reader_parse(reader, 0, bs.data + 16, bs.off - 16, &off);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	CU_ASSERT_EQUAL(test.end_count, 3);
+
+	rctx = aac_reader_get_ctx(reader);
+	CU_ASSERT_EQUAL(aac_ctx_get_transport(rctx), AAC_TRANSPORT_LOAS);
+	CU_ASSERT_PTR_NOT_NULL(aac_ctx_get_stream_mux_config(rctx));
+	asc = aac_ctx_get_asc(rctx);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(asc);
+	CU_ASSERT_EQUAL(asc->audioObjectType, AAC_AOT_AAC_LC);
+	CU_ASSERT_EQUAL(asc->samplingFrequencyIndex, 3);
+	CU_ASSERT_EQUAL(asc->channelConfiguration, 2);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+static void test_loas_version1(void)
+{
+	int ret;
+	size_t off = 0;
+	struct aac_ctx *ctx = NULL;
+	struct aac_bitstream bs;
+	struct aac_reader *reader = NULL;
+	struct loas_test_ctx test;
+	uint8_t payload[300];
+
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	setup_loas_ctx(ctx, 1);
+
+	/* Wrap an opaque payload longer than 255 bytes */
+	for (size_t i = 0; i < sizeof(payload); i++)
+		payload[i] = i;
+	aac_bs_init(&bs, NULL, 0);
+	ret = aac_write_loas_frame(&bs, ctx, payload, sizeof(payload));
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_write_loas_frame(&bs, ctx, payload, sizeof(payload));
+	CU_ASSERT_EQUAL(ret, 0);
+
+	/* Payload is not parsed without frame data */
+	memset(&test, 0, sizeof(test));
+	ret = aac_reader_new(&loas_cbs, &test, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_parse(reader, 0, bs.data, bs.off, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, bs.off);
+	CU_ASSERT_EQUAL(test.end_count, 2);
+	CU_ASSERT_EQUAL(test.smc.audioMuxVersion, 1);
+	CU_ASSERT_EQUAL(test.smc.taraBufferFullness, 0x1234);
+	CU_ASSERT_EQUAL(test.smc.ascLen, 16);
+	CU_ASSERT_EQUAL(test.smc.otherDataPresent, 1);
+	CU_ASSERT_EQUAL(test.smc.otherDataLenBits, 300);
+	CU_ASSERT_EQUAL(test.smc.crcCheckPresent, 1);
+	CU_ASSERT_EQUAL(test.smc.crcCheckSum, 0xA5);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+static void test_loas_no_config(void)
+{
+	int ret;
+	size_t off = 0;
+	size_t first_len;
+	struct aac_ctx *ctx = NULL;
+	struct aac_bitstream bs;
+	struct aac_reader *reader = NULL;
+	struct loas_test_ctx test;
+
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	setup_loas_ctx(ctx, 0);
+	aac_bs_init(&bs, NULL, 0);
+	ret = aac_write_silent_frame(&bs, ctx, 2, 0);
+	CU_ASSERT_EQUAL(ret, 0);
+	first_len = bs.off;
+	ret = aac_write_silent_frame(&bs, ctx, 2, 0);
+	CU_ASSERT_EQUAL(ret, 0);
+
+	/* Frames without a previous StreamMuxConfig are skipped */
+	memset(&test, 0, sizeof(test));
+	ret = aac_reader_new(&loas_cbs, &test, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_parse(reader,
+			       AAC_READER_FLAGS_FRAME_DATA,
+			       bs.data + first_len,
+			       bs.off - first_len,
+			       &off);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(off, bs.off - first_len);
+	CU_ASSERT_EQUAL(test.begin_count, 0);
+	CU_ASSERT_EQUAL(test.end_count, 0);
+	CU_ASSERT_PTR_NULL(
+		aac_ctx_get_stream_mux_config(aac_reader_get_ctx(reader)));
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+CU_TestInfo g_aac_test_loas[] = {
+	{FN("silent"), &test_loas_silent},
+	{FN("version1"), &test_loas_version1},
+	{FN("no-config"), &test_loas_no_config},
+
+	CU_TEST_INFO_NULL,
+};
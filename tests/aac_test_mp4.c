@@ -0,0 +1,571 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "aac_test.h"
+
+
+#define MP4_SAMPLE_COUNT 10
+#define MP4_CHUNK_COUNT 4
+
+
+/* MP4 file built in memory */
+struct mp4_file {
+	uint8_t data[4096];
+	size_t len;
+	/* Offsets of the sizes of the open boxes */
+	size_t boxes[16];
+	unsigned int depth;
+	/* Offsets of the entry counts of the sample tables */
+	size_t stsz_count;
+	size_t stsc_count;
+	size_t stco_count;
+};
+
+
+/* Variants of the MP4 file */
+struct mp4_opts {
+	/* 64-bit chunk offsets */
+	int co64;
+	/* 64-bit largesize of the mdat box */
+	int largesize;
+	/* QuickTime sound sample description version */
+	unsigned int sound_version;
+	/* esds box in a wave box (QuickTime) */
+	int wave;
+	/* Empty sample tables and an mvex box (fragmented file) */
+	int mvex;
+};
+
+
+/* Samples of the MP4 files: silent stereo raw data blocks of different
+ * sizes, in chunks of 3, 3, 2 and 2 samples */
+struct mp4_samples {
+	struct aac_ctx *ctx;
+	struct aac_bitstream bs;
+	uint8_t *asc;
+	size_t asc_len;
+	size_t sizes[MP4_SAMPLE_COUNT];
+	size_t chunk_offsets[MP4_CHUNK_COUNT];
+};
+
+
+static const unsigned int chunk_samples[MP4_CHUNK_COUNT] = {3, 3, 2, 2};
+
+
+static void put_u8(struct mp4_file *f, uint8_t val)
+{
+	f->data[f->len++] = val;
+}
+
+
+static void put_u16(struct mp4_file *f, uint16_t val)
+{
+	put_u8(f, val >> 8);
+	put_u8(f, val & 0xFF);
+}
+
+
+static void put_u32(struct mp4_file *f, uint32_t val)
+{
+	put_u16(f, val >> 16);
+	put_u16(f, val & 0xFFFF);
+}
+
+
+static void put_u64(struct mp4_file *f, uint64_t val)
+{
+	put_u32(f, val >> 32);
+	put_u32(f, val & 0xFFFFFFFF);
+}
+
+
+static void put_data(struct mp4_file *f, const void *data, size_t len)
+{
+	memcpy(f->data + f->len, data, len);
+	f->len += len;
+}
+
+
+static void begin_box(struct mp4_file *f, const char *type)
+{
+	f->boxes[f->depth++] = f->len;
+	put_u32(f, 0);
+	put_data(f, type, 4);
+}
+
+
+static void set_u32(struct mp4_file *f, size_t off, uint32_t val)
+{
+	f->data[off] = val >> 24;
+	f->data[off + 1] = (val >> 16) & 0xFF;
+	f->data[off + 2] = (val >> 8) & 0xFF;
+	f->data[off + 3] = val & 0xFF;
+}
+
+
+static void end_box(struct mp4_file *f)
+{
+	size_t off = f->boxes[--f->depth];
+
+	set_u32(f, off, f->len - off);
+}
+
+
+static void put_hdlr(struct mp4_file *f, const char *handler)
+{
+	begin_box(f, "hdlr");
+	put_u32(f, 0);
+	put_u32(f, 0);
+	put_data(f, handler, 4);
+	for (int i = 0; i < 3; i++)
+		put_u32(f, 0);
+	put_u8(f, 0);
+	end_box(f);
+}
+
+
+static void put_esds(struct mp4_file *f, const uint8_t *asc, size_t asc_len)
+{
+	begin_box(f, "esds");
+	put_u32(f, 0);
+	/* ES_Descriptor, with a 4-byte size */
+	put_u8(f, 0x03);
+	put_data(f, "\x80\x80\x80", 3);
+	put_u8(f, 3 + 2 + 13 + 2 + asc_len);
+	put_u16(f, 1);
+	put_u8(f, 0);
+	/* DecoderConfigDescriptor */
+	put_u8(f, 0x04);
+	put_u8(f, 13 + 2 + asc_len);
+	put_u8(f, 0x40);
+	put_u8(f, 0x15);
+	put_data(f, "\0\0\0\0\0\0\0\0\0\0\0", 11);
+	/* DecoderSpecificInfo */
+	put_u8(f, 0x05);
+	put_u8(f, asc_len);
+	put_data(f, asc, asc_len);
+	end_box(f);
+}
+
+
+static void mp4_samples_init(struct mp4_samples *samples)
+{
+	int ret;
+	size_t off;
+	struct aac_asc asc;
+
+	memset(samples, 0, sizeof(*samples));
+	ret = aac_ctx_new(&samples->ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	memset(&asc, 0, sizeof(asc));
+	ret = aac_asc_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_raw,
+				       &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_ctx_set_asc(samples->ctx, &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_write_asc(&asc, &samples->asc, &samples->asc_len);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	aac_bs_init(&samples->bs, NULL, 0);
+	for (unsigned int s = 0; s < MP4_SAMPLE_COUNT; s++) {
+		off = samples->bs.off;
+		ret = aac_write_silent_frame(
+			&samples->bs, samples->ctx, 2, 8 + s);
+		CU_ASSERT_EQUAL(ret, 0);
+		samples->sizes[s] = samples->bs.off - off;
+	}
+}
+
+
+static void mp4_samples_clear(struct mp4_samples *samples)
+{
+	free(samples->asc);
+	aac_bs_clear(&samples->bs);
+	aac_ctx_destroy(samples->ctx);
+}
+
+
+static void put_mp4a(struct mp4_file *f,
+		     const struct mp4_samples *samples,
+		     const struct mp4_opts *opts)
+{
+	begin_box(f, "mp4a");
+	put_data(f, "\0\0\0\0\0\0\0\1", 8);
+	put_u16(f, opts->sound_version);
+	put_data(f, "\0\0\0\0\0\0", 6);
+	put_u16(f, 2);
+	put_u16(f, 16);
+	put_u32(f, 0);
+	put_u32(f, 48000u << 16);
+	/* Version 1: samples per packet, bytes per packet, bytes per frame
+	 * and bytes per sample; version 2: more fields */
+	if (opts->sound_version == 1) {
+		for (int i = 0; i < 4; i++)
+			put_u32(f, 0);
+	} else if (opts->sound_version == 2) {
+		for (int i = 0; i < 9; i++)
+			put_u32(f, 0);
+	}
+	if (opts->wave) {
+		begin_box(f, "wave");
+		begin_box(f, "frma");
+		put_data(f, "mp4a", 4);
+		end_box(f);
+	}
+	put_esds(f, samples->asc, samples->asc_len);
+	if (opts->wave)
+		end_box(f);
+	end_box(f);
+}
+
+
+static void build_mp4(struct mp4_file *f,
+		      struct mp4_samples *samples,
+		      const struct mp4_opts *opts)
+{
+	unsigned int s = 0;
+	size_t off = 0, mdat;
+	unsigned int sample_count = opts->mvex ? 0 : MP4_SAMPLE_COUNT;
+	unsigned int chunk_count = opts->mvex ? 0 : MP4_CHUNK_COUNT;
+
+	memset(f, 0, sizeof(*f));
+
+	/* ftyp, then the chunks in an mdat box, separated by a byte */
+	begin_box(f, "ftyp");
+	put_data(f, "M4A \0\0\0\0M4A isom", 16);
+	end_box(f);
+	mdat = f->len;
+	if (opts->largesize) {
+		put_u32(f, 1);
+		put_data(f, "mdat", 4);
+		put_u64(f, 0);
+	} else {
+		begin_box(f, "mdat");
+	}
+	for (unsigned int c = 0; c < MP4_CHUNK_COUNT; c++) {
+		put_u8(f, 0xFF);
+		samples->chunk_offsets[c] = f->len;
+		for (unsigned int i = 0; i < chunk_samples[c]; i++, s++) {
+			put_data(f, samples->bs.data + off, samples->sizes[s]);
+			off += samples->sizes[s];
+		}
+	}
+	if (opts->largesize) {
+		set_u32(f, mdat + 8, 0);
+		set_u32(f, mdat + 12, f->len - mdat);
+	} else {
+		end_box(f);
+	}
+
+	/* A video track, then the audio track */
+	begin_box(f, "moov");
+	begin_box(f, "trak");
+	begin_box(f, "mdia");
+	put_hdlr(f, "vide");
+	end_box(f);
+	end_box(f);
+	begin_box(f, "trak");
+	begin_box(f, "mdia");
+	put_hdlr(f, "soun");
+	begin_box(f, "minf");
+	begin_box(f, "stbl");
+	begin_box(f, "stsd");
+	put_u32(f, 0);
+	put_u32(f, 1);
+	put_mp4a(f, samples, opts);
+	end_box(f);
+	begin_box(f, "stsz");
+	put_u32(f, 0);
+	put_u32(f, 0);
+	f->stsz_count = f->len;
+	put_u32(f, sample_count);
+	for (unsigned int i = 0; i < sample_count; i++)
+		put_u32(f, samples->sizes[i]);
+	end_box(f);
+	begin_box(f, "stsc");
+	put_u32(f, 0);
+	f->stsc_count = f->len;
+	put_u32(f, opts->mvex ? 0 : 2);
+	if (!opts->mvex) {
+		put_u32(f, 1);
+		put_u32(f, 3);
+		put_u32(f, 1);
+		put_u32(f, 3);
+		put_u32(f, 2);
+		put_u32(f, 1);
+	}
+	end_box(f);
+	begin_box(f, opts->co64 ? "co64" : "stco");
+	put_u32(f, 0);
+	f->stco_count = f->len;
+	put_u32(f, chunk_count);
+	for (unsigned int c = 0; c < chunk_count; c++) {
+		if (opts->co64)
+			put_u64(f, samples->chunk_offsets[c]);
+		else
+			put_u32(f, samples->chunk_offsets[c]);
+	}
+	end_box(f);
+	end_box(f);
+	end_box(f);
+	end_box(f);
+	end_box(f);
+	if (opts->mvex) {
+		begin_box(f, "mvex");
+		begin_box(f, "trex");
+		for (int i = 0; i < 6; i++)
+			put_u32(f, 0);
+		end_box(f);
+		end_box(f);
+	}
+	end_box(f);
+	CU_ASSERT_EQUAL(f->depth, 0);
+}
+
+
+/* Check the ASC and the location of all the samples */
+static void check_mp4(struct mp4_file *f, struct mp4_samples *samples)
+{
+	int ret;
+	size_t off, len;
+	unsigned int s = 0;
+	const uint8_t *asc;
+	struct aac_mp4 *mp4 = NULL;
+	struct aac_mp4_sample sample;
+
+	ret = aac_mp4_new(f->data, f->len, &mp4);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	CU_ASSERT_EQUAL(aac_mp4_get_sample_count(mp4), MP4_SAMPLE_COUNT);
+	ret = aac_mp4_get_asc(mp4, &asc, &len);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL_FATAL(len, samples->asc_len);
+	CU_ASSERT_EQUAL(memcmp(asc, samples->asc, len), 0);
+	for (unsigned int c = 0; c < MP4_CHUNK_COUNT; c++) {
+		off = samples->chunk_offsets[c];
+		for (unsigned int i = 0; i < chunk_samples[c]; i++, s++) {
+			ret = aac_mp4_next_sample(mp4, &sample);
+			CU_ASSERT_EQUAL_FATAL(ret, 0);
+			CU_ASSERT_EQUAL(sample.index, s);
+			CU_ASSERT_EQUAL(sample.offset, off);
+			CU_ASSERT_EQUAL(sample.size, samples->sizes[s]);
+			CU_ASSERT_EQUAL(sample.data, f->data + off);
+			off += sample.size;
+		}
+	}
+	ret = aac_mp4_next_sample(mp4, &sample);
+	CU_ASSERT_EQUAL(ret, -ENOENT);
+	aac_mp4_destroy(mp4);
+}
+
+
+static void raw_data_block_cb(struct aac_ctx *ctx,
+			      const uint8_t *buf,
+			      size_t len,
+			      const struct aac_raw_data_block *block,
+			      void *userdata)
+{
+	unsigned int *count = userdata;
+
+	(*count)++;
+}
+
+
+static const struct aac_ctx_cbs mp4_cbs = {
+	.raw_data_block = &raw_data_block_cb,
+};
+
+
+static void test_mp4_samples(void)
+{
+	int ret;
+	size_t off, parsed, len;
+	const uint8_t *asc_data;
+	unsigned int block_count = 0, s;
+	struct mp4_file *f;
+	struct mp4_samples samples;
+	struct mp4_opts opts;
+	struct aac_asc asc;
+	struct aac_reader *reader = NULL;
+	struct aac_mp4 *mp4 = NULL;
+	struct aac_mp4_sample sample;
+
+	f = calloc(1, sizeof(*f));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(f);
+	mp4_samples_init(&samples);
+	memset(&opts, 0, sizeof(opts));
+	build_mp4(f, &samples, &opts);
+
+	/* Not an MP4 file */
+	ret = aac_mp4_new(samples.bs.data, samples.bs.off, &mp4);
+	CU_ASSERT_EQUAL(ret, -EPROTO);
+
+	check_mp4(f, &samples);
+
+	/* Feed the samples to a raw reader */
+	ret = aac_mp4_new(f->data, f->len, &mp4);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_new(&mp4_cbs, &block_count, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_mp4_get_asc(mp4, &asc_data, &len);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_parse_asc(asc_data, len, &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_ctx_set_asc(aac_reader_get_ctx(reader), &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	while (aac_mp4_next_sample(mp4, &sample) == 0) {
+		parsed = 0;
+		ret = aac_reader_parse(
+			reader, 0, sample.data, sample.size, &parsed);
+		CU_ASSERT_EQUAL(ret, 0);
+		CU_ASSERT_EQUAL(parsed, sample.size);
+	}
+	CU_ASSERT_EQUAL(block_count, MP4_SAMPLE_COUNT);
+
+	/* Rewind */
+	ret = aac_mp4_rewind(mp4);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_mp4_next_sample(mp4, &sample);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(sample.index, 0);
+	CU_ASSERT_EQUAL(sample.offset, samples.chunk_offsets[0]);
+	aac_mp4_destroy(mp4);
+
+	/* Last chunk moved to the end of the file (the chunk offsets are the
+	 * last bytes of the file) */
+	off = f->len - 2;
+	set_u32(f, f->len - 4, off);
+	ret = aac_mp4_new(f->data, f->len, &mp4);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	for (s = 0; s < MP4_SAMPLE_COUNT - 2; s++) {
+		ret = aac_mp4_next_sample(mp4, &sample);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	ret = aac_mp4_next_sample(mp4, &sample);
+	CU_ASSERT_EQUAL(ret, -EPROTO);
+	aac_mp4_destroy(mp4);
+
+	aac_reader_destroy(reader);
+	mp4_samples_clear(&samples);
+	free(f);
+}
+
+
+static void test_mp4_variants(void)
+{
+	struct mp4_file *f;
+	struct mp4_samples samples;
+	struct mp4_opts opts;
+
+	f = calloc(1, sizeof(*f));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(f);
+	mp4_samples_init(&samples);
+
+	/* 64-bit chunk offsets and mdat size */
+	memset(&opts, 0, sizeof(opts));
+	opts.co64 = 1;
+	opts.largesize = 1;
+	build_mp4(f, &samples, &opts);
+	check_mp4(f, &samples);
+
+	/* QuickTime sound descriptions, with and without a wave box */
+	for (unsigned int v = 0; v <= 2; v++) {
+		memset(&opts, 0, sizeof(opts));
+		opts.sound_version = v;
+		opts.wave = (v > 0);
+		build_mp4(f, &samples, &opts);
+		check_mp4(f, &samples);
+	}
+
+	mp4_samples_clear(&samples);
+	free(f);
+}
+
+
+static void test_mp4_invalid(void)
+{
+	int ret;
+	size_t len;
+	struct mp4_file *f;
+	struct mp4_samples samples;
+	struct mp4_opts opts;
+	struct aac_mp4 *mp4 = NULL;
+
+	f = calloc(1, sizeof(*f));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(f);
+	mp4_samples_init(&samples);
+	memset(&opts, 0, sizeof(opts));
+
+	/* Sample tables with more entries than their box */
+	build_mp4(f, &samples, &opts);
+	set_u32(f, f->stsz_count, MP4_SAMPLE_COUNT + 1);
+	ret = aac_mp4_new(f->data, f->len, &mp4);
+	CU_ASSERT_EQUAL(ret, -EPROTO);
+	build_mp4(f, &samples, &opts);
+	set_u32(f, f->stsc_count, 3);
+	ret = aac_mp4_new(f->data, f->len, &mp4);
+	CU_ASSERT_EQUAL(ret, -EPROTO);
+	build_mp4(f, &samples, &opts);
+	set_u32(f, f->stco_count, MP4_CHUNK_COUNT + 1);
+	ret = aac_mp4_new(f->data, f->len, &mp4);
+	CU_ASSERT_EQUAL(ret, -EPROTO);
+
+	/* Truncated file: the moov box is past the end */
+	build_mp4(f, &samples, &opts);
+	ret = aac_mp4_new(f->data, f->len - 1, &mp4);
+	CU_ASSERT_EQUAL(ret, -EPROTO);
+
+	/* Fragmented file: mvex box in moov */
+	opts.mvex = 1;
+	build_mp4(f, &samples, &opts);
+	ret = aac_mp4_new(f->data, f->len, &mp4);
+	CU_ASSERT_EQUAL(ret, -ENOSYS);
+
+	/* Fragmented file: top-level moof box */
+	opts.mvex = 0;
+	build_mp4(f, &samples, &opts);
+	len = f->len;
+	begin_box(f, "moof");
+	begin_box(f, "mfhd");
+	put_u32(f, 0);
+	put_u32(f, 1);
+	end_box(f);
+	end_box(f);
+	CU_ASSERT(f->len > len);
+	ret = aac_mp4_new(f->data, f->len, &mp4);
+	CU_ASSERT_EQUAL(ret, -ENOSYS);
+
+	mp4_samples_clear(&samples);
+	free(f);
+}
+
+
+CU_TestInfo g_aac_test_mp4[] = {
+	{FN("samples"), &test_mp4_samples},
+	{FN("variants"), &test_mp4_variants},
+	{FN("invalid"), &test_mp4_invalid},
+
+	CU_TEST_INFO_NULL,
+};
@@ -0,0 +1,235 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "aac_test.h"
+
+
+static void write_silent_frames(struct aac_bitstream *bs,
+				enum aac_transport transport,
+				unsigned int count)
+{
+	int ret;
+	struct aac_ctx *ctx = NULL;
+	struct aac_asc asc;
+	struct aac_adts adts;
+	struct aac_StreamMuxConfig smc;
+
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	if (transport == AAC_TRANSPORT_LOAS) {
+		memset(&asc, 0, sizeof(asc));
+		ret = aac_asc_from_adef_format(
+			&adef_aac_lc_16b_48000hz_stereo_raw, &asc);
+		CU_ASSERT_EQUAL(ret, 0);
+		memset(&smc, 0, sizeof(smc));
+		smc.allStreamsSameTimeFraming = 1;
+		smc.latmBufferFullness = 0xFF;
+		ret = aac_ctx_set_loas(ctx, &smc, &asc);
+		CU_ASSERT_EQUAL(ret, 0);
+	} else {
+		memset(&adts, 0, sizeof(adts));
+		ret = aac_adts_from_adef_format(
+			&adef_aac_lc_16b_48000hz_stereo_adts, &adts);
+		CU_ASSERT_EQUAL(ret, 0);
+		ret = aac_ctx_set_adts(ctx, &adts);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	/* ADTS frames need an explicit length for aac_frame_length */
+	for (unsigned int i = 0; i < count; i++) {
+		ret = aac_write_silent_frame(
+			bs, ctx, 2, transport == AAC_TRANSPORT_LOAS ? 0 : 100);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	aac_ctx_destroy(ctx);
+}
+
+
+static void test_probe_adts(void)
+{
+	int ret;
+	struct aac_bitstream bs;
+	struct aac_probe_result result;
+	/* ID3v2.4 tag with a 20-byte body */
+	static const uint8_t id3[10] = {
+		'I', 'D', '3', 4, 0, 0, 0, 0, 0, 20};
+
+	aac_bs_init(&bs, NULL, 0);
+	ret = aac_bs_write_raw_bytes(&bs, id3, sizeof(id3));
+	CU_ASSERT_EQUAL(ret, 0);
+	for (int i = 0; i < 20; i++)
+		aac_bs_write_bits(&bs, 0, 8);
+	write_silent_frames(&bs, AAC_TRANSPORT_NONE, 6);
+
+	ret = aac_probe(bs.data, bs.off, &result);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(result.data_format, ADEF_AAC_DATA_FORMAT_ADTS);
+	CU_ASSERT_EQUAL(result.confidence, 100);
+	CU_ASSERT_EQUAL(result.offset, 30);
+	CU_ASSERT_EQUAL(result.adts.sampling_frequency_index, 3);
+	CU_ASSERT_EQUAL(result.adts.channel_configuration, 2);
+
+	/* A single header at the start gives a low confidence */
+	ret = aac_probe(bs.data + 30, 9, &result);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(result.data_format, ADEF_AAC_DATA_FORMAT_ADTS);
+	CU_ASSERT_EQUAL(result.frame_count, 1);
+	CU_ASSERT_EQUAL(result.confidence, 25);
+
+	/* Tags longer than the buffer */
+	ret = aac_probe(bs.data, 20, &result);
+	CU_ASSERT_EQUAL(ret, -EAGAIN);
+	CU_ASSERT_EQUAL(result.offset, 30);
+
+	aac_bs_clear(&bs);
+}
+
+
+static void test_probe_loas(void)
+{
+	int ret;
+	struct aac_bitstream bs;
+	struct aac_probe_result result;
+
+	/* Some garbage before the first frame */
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < 5; i++)
+		aac_bs_write_bits(&bs, 0x12, 8);
+	write_silent_frames(&bs, AAC_TRANSPORT_LOAS, 4);
+
+	ret = aac_probe(bs.data, bs.off, &result);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(result.data_format, ADEF_AAC_DATA_FORMAT_RAW);
+	CU_ASSERT_EQUAL(result.transport, AAC_TRANSPORT_LOAS);
+	CU_ASSERT_EQUAL(result.confidence, 100);
+	CU_ASSERT_EQUAL(result.offset, 5);
+	CU_ASSERT_EQUAL(result.asc_valid, 1);
+	CU_ASSERT_EQUAL(result.asc.audioObjectType, AAC_AOT_AAC_LC);
+	CU_ASSERT_EQUAL(result.asc.samplingFrequencyIndex, 3);
+	CU_ASSERT_EQUAL(result.asc.channelConfiguration, 2);
+
+	aac_bs_clear(&bs);
+}
+
+
+static void test_probe_adif(void)
+{
+	int ret;
+	struct aac_bitstream bs;
+	struct aac_probe_result result;
+
+	/* ADIF header with a single stereo AAC-LC 44.1kHz PCE */
+	aac_bs_init(&bs, NULL, 0);
+	aac_bs_write_bits(&bs, 0x41444946, 32); /* adif_id */
+	aac_bs_write_bits(&bs, 0, 4); /* copyright, original, home, type */
+	aac_bs_write_bits(&bs, 128000, 23); /* bitrate */
+	aac_bs_write_bits(&bs, 0, 4); /* num_program_config_elements */
+	aac_bs_write_bits(&bs, 0, 20); /* adif_buffer_fullness */
+	aac_bs_write_bits(&bs, 0, 4); /* element_instance_tag */
+	aac_bs_write_bits(&bs, 1, 2); /* object_type */
+	aac_bs_write_bits(&bs, 4, 4); /* sampling_frequency_index */
+	aac_bs_write_bits(&bs, 1, 4); /* num_front_channel_elements */
+	aac_bs_write_bits(&bs, 0, 20); /* other counts and mixdown flags */
+	aac_bs_write_bits(&bs, 1, 1); /* front_element_is_cpe */
+	aac_bs_write_bits(&bs, 0, 4); /* front_element_tag_select */
+	aac_bs_write_trailing_bits(&bs);
+	aac_bs_write_bits(&bs, 0, 8); /* comment_field_bytes */
+
+	ret = aac_probe(bs.data, bs.off, &result);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(result.data_format, ADEF_AAC_DATA_FORMAT_RAW);
+	CU_ASSERT_EQUAL(result.transport, AAC_TRANSPORT_ADIF);
+	CU_ASSERT_EQUAL(result.confidence, 100);
+	CU_ASSERT_EQUAL(result.asc_valid, 1);
+	CU_ASSERT_EQUAL(result.asc.audioObjectType, AAC_AOT_AAC_LC);
+	CU_ASSERT_EQUAL(result.asc.samplingFrequencyIndex, 4);
+
+	/* Truncated header */
+	ret = aac_probe(bs.data, 8, &result);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(result.transport, AAC_TRANSPORT_ADIF);
+	CU_ASSERT_EQUAL(result.confidence, 50);
+
+	aac_bs_clear(&bs);
+}
+
+
+static void test_probe_asc(void)
+{
+	int ret;
+	struct aac_asc asc;
+	uint8_t *buf = NULL;
+	size_t len = 0;
+	struct aac_probe_result result;
+
+	memset(&asc, 0, sizeof(asc));
+	ret = aac_asc_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_raw,
+				       &asc);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_write_asc(&asc, &buf, &len);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+	ret = aac_probe(buf, len, &result);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(result.data_format, ADEF_AAC_DATA_FORMAT_RAW);
+	CU_ASSERT_EQUAL(result.transport, AAC_TRANSPORT_NONE);
+	CU_ASSERT_EQUAL(result.confidence, 50);
+	CU_ASSERT_EQUAL(result.asc_valid, 1);
+	CU_ASSERT_EQUAL(result.asc.channelConfiguration, 2);
+
+	free(buf);
+}
+
+
+static void test_probe_unknown(void)
+{
+	int ret;
+	uint8_t buf[256];
+	struct aac_probe_result result;
+
+	for (size_t i = 0; i < sizeof(buf); i++)
+		buf[i] = (i * 7) & 0x7F;
+
+	ret = aac_probe(buf, sizeof(buf), &result);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(result.data_format, ADEF_AAC_DATA_FORMAT_UNKNOWN);
+	CU_ASSERT_EQUAL(result.confidence, 0);
+
+	ret = aac_probe(NULL, sizeof(buf), &result);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	ret = aac_probe(buf, 0, &result);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+}
+
+
+CU_TestInfo g_aac_test_probe[] = {
+	{FN("adts"), &test_probe_adts},
+	{FN("loas"), &test_probe_loas},
+	{FN("adif"), &test_probe_adif},
+	{FN("asc"), &test_probe_asc},
+	{FN("unknown"), &test_probe_unknown},
+
+	CU_TEST_INFO_NULL,
+};
@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "aac_test.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+
+static void test_shm_publish(void)
+{
+	int ret;
+	size_t off = 0;
+	char name[64];
+	struct aac_ctx *ctx = NULL;
+	struct aac_adts adts;
+	struct aac_bitstream bs;
+	struct aac_reader *reader = NULL;
+	struct aac_ctx_cbs cbs;
+	struct aac_shm *shm = NULL;
+	struct aac_shm *mon = NULL;
+	struct aac_shm_slot slot;
+
+	/* Parse 4 silent stereo ADTS frames */
+	ret = aac_ctx_new(&ctx);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_adts_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_adts,
+					&adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_ctx_set_adts(ctx, &adts);
+	CU_ASSERT_EQUAL(ret, 0);
+	aac_bs_init(&bs, NULL, 0);
+	for (int i = 0; i < 4; i++) {
+		ret = aac_write_silent_frame(&bs, ctx, 2, 13);
+		CU_ASSERT_EQUAL(ret, 0);
+	}
+	memset(&cbs, 0, sizeof(cbs));
+	ret = aac_reader_new(&cbs, NULL, &reader);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	ret = aac_reader_parse(reader, 0, bs.data, bs.off, &off);
+	CU_ASSERT_EQUAL(ret, 0);
+
+	/* Publish into the second slot */
+	snprintf(name, sizeof(name), "/aac-test-%d", (int)getpid());
+	ret = aac_shm_create(name, 2, &shm);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	CU_ASSERT_EQUAL(aac_shm_get_slot_count(shm), 2);
+	ret = aac_shm_publish(shm, 2, "out-of-range", reader);
+	CU_ASSERT_EQUAL(ret, -EINVAL);
+	ret = aac_shm_publish(shm, 1, "stream-1", reader);
+	CU_ASSERT_EQUAL(ret, 0);
+
+	/* Read it from another mapping */
+	ret = aac_shm_open(name, &mon);
+	CU_ASSERT_EQUAL_FATAL(ret, 0);
+	CU_ASSERT_EQUAL(aac_shm_get_slot_count(mon), 2);
+	ret = aac_shm_read(mon, 0, &slot);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(slot.used, 0);
+	ret = aac_shm_read(mon, 1, &slot);
+	CU_ASSERT_EQUAL(ret, 0);
+	CU_ASSERT_EQUAL(slot.used, 1);
+	CU_ASSERT_EQUAL(slot.seq, 2);
+	CU_ASSERT_STRING_EQUAL(slot.name, "stream-1");
+	CU_ASSERT_EQUAL(slot.stats.frames, 4);
+	CU_ASSERT_EQUAL(slot.stats.bytes, 4 * 13);
+	CU_ASSERT_EQUAL(slot.position, 4 * 1024);
+	CU_ASSERT_EQUAL(slot.data_format, ADEF_AAC_DATA_FORMAT_ADTS);
+	CU_ASSERT_EQUAL(slot.audio_object_type, AAC_AOT_AAC_LC);
+	CU_ASSERT_EQUAL(slot.sample_rate, 48000);
+	CU_ASSERT_EQUAL(slot.frame_length, 1024);
+	CU_ASSERT_EQUAL(slot.channel_configuration, 2);
+
+	/* Read-only mapping */
+	ret = aac_shm_publish(mon, 0, "stream-0", reader);
+	CU_ASSERT_EQUAL(ret, -EPERM);
+
+	aac_shm_destroy(mon);
+	aac_shm_destroy(shm);
+	ret = aac_shm_unlink(name);
+	CU_ASSERT_EQUAL(ret, 0);
+	ret = aac_shm_open(name, &mon);
+	CU_ASSERT_EQUAL(ret, -ENOENT);
+
+	aac_reader_destroy(reader);
+	aac_bs_clear(&bs);
+	aac_ctx_destroy(ctx);
+}
+
+
+CU_TestInfo g_aac_test_shm[] = {
+	{FN("publish"), &test_shm_publish},
+
+	CU_TEST_INFO_NULL,
+};
@@ -0,0 +1,772 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ULOG_TAG aac_bench
+#include <ulog.h>
+ULOG_DECLARE_TAG(aac_bench);
+
+#include <aac/aac.h>
+#include <audio-defs/adefs.h>
+
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+
+
+#define DEFAULT_ITERATIONS 10
+#define DEFAULT_SYNTHETIC_FRAMES 10000
+
+/* Version of the baseline file format (see aac-bench-cmp) */
+#define BASELINE_VERSION 1
+
+/* Synthetic stream: silent AAC-LC 48 kHz stereo ADTS frames at 128 kbit/s */
+#define SYNTHETIC_CHANNEL_COUNT 2
+#define SYNTHETIC_FRAME_SIZE 341
+
+
+struct input {
+	const char *name;
+	uint8_t *data;
+	size_t size;
+	/* Probed format; the dump benchmark needs ADTS */
+	struct aac_probe_result probe;
+	int synthetic;
+};
+
+
+struct result {
+	uint64_t frames;
+	uint64_t bytes;
+	uint64_t ns;
+};
+
+
+struct bench {
+	const char *name;
+	/* Generation benchmarks do not use the input data and only run on
+	 * the synthetic stream */
+	int synthetic_only;
+	int (*run)(struct input *input, struct result *result);
+};
+
+
+struct app {
+	unsigned int iterations;
+	unsigned int synthetic_frames;
+	int synthetic;
+	uint32_t bench_mask;
+	uint64_t *samples;
+	uint64_t *deviations;
+	/* Baseline output file and number of results written to it */
+	FILE *baseline;
+	unsigned int baseline_count;
+};
+
+
+/* Sink for the benchmark outputs, so that they are not optimized out */
+static volatile size_t sink;
+
+
+static uint64_t time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static int run_reader(struct input *input,
+		      uint32_t flags,
+		      const struct aac_ctx_cbs *cbs,
+		      void *userdata,
+		      struct result *result)
+{
+	int res;
+	size_t off = 0;
+	uint64_t start;
+	struct aac_reader *reader = NULL;
+	struct aac_reader_stats stats;
+
+	res = aac_reader_new(cbs, userdata, &reader);
+	if (res < 0) {
+		ULOG_ERRNO("aac_reader_new", -res);
+		return res;
+	}
+
+	start = time_ns();
+	res = aac_reader_parse(reader, flags, input->data, input->size, &off);
+	result->ns = time_ns() - start;
+	if (res < 0) {
+		ULOG_ERRNO("aac_reader_parse", -res);
+		goto out;
+	}
+
+	res = aac_reader_get_stats(reader, &stats);
+	if (res < 0) {
+		ULOG_ERRNO("aac_reader_get_stats", -res);
+		goto out;
+	}
+	result->frames = stats.frames;
+	result->bytes = off;
+
+out:
+	aac_reader_destroy(reader);
+	return res;
+}
+
+
+static int bench_scan(struct input *input, struct result *result)
+{
+	struct aac_ctx_cbs cbs;
+
+	memset(&cbs, 0, sizeof(cbs));
+	return run_reader(input, 0, &cbs, NULL, result);
+}
+
+
+static int bench_parse(struct input *input, struct result *result)
+{
+	struct aac_ctx_cbs cbs;
+
+	memset(&cbs, 0, sizeof(cbs));
+	return run_reader(
+		input, AAC_READER_FLAGS_FRAME_DATA, &cbs, NULL, result);
+}
+
+
+static void dump_adts_frame_end_cb(struct aac_ctx *ctx,
+				   const uint8_t *buf,
+				   size_t len,
+				   const struct aac_adts *adts,
+				   void *userdata)
+{
+	int res;
+	struct aac_dump *dump = userdata;
+	const char *str = NULL;
+
+	res = aac_dump_adts_frame(dump, ctx, AAC_DUMP_FLAGS_FRAME_DATA);
+	if (res < 0) {
+		ULOG_ERRNO("aac_dump_adts_frame", -res);
+		return;
+	}
+	res = aac_dump_get_json_str(dump, &str);
+	if (res < 0) {
+		ULOG_ERRNO("aac_dump_get_json_str", -res);
+		return;
+	}
+	sink += strlen(str);
+}
+
+
+static void dump_cbor_adts_frame_end_cb(struct aac_ctx *ctx,
+					const uint8_t *buf,
+					size_t len,
+					const struct aac_adts *adts,
+					void *userdata)
+{
+	int res;
+	struct aac_dump *dump = userdata;
+	const uint8_t *data = NULL;
+	size_t data_len = 0;
+
+	res = aac_dump_adts_frame(dump, ctx, AAC_DUMP_FLAGS_FRAME_DATA);
+	if (res < 0) {
+		ULOG_ERRNO("aac_dump_adts_frame", -res);
+		return;
+	}
+	res = aac_dump_get_data(dump, &data, &data_len);
+	if (res < 0) {
+		ULOG_ERRNO("aac_dump_get_data", -res);
+		return;
+	}
+	sink += data_len;
+}
+
+
+static int run_dump(struct input *input,
+		    enum aac_dump_type type,
+		    struct result *result)
+{
+	int res;
+	struct aac_ctx_cbs cbs;
+	struct aac_dump_cfg cfg;
+	struct aac_dump *dump = NULL;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.type = type;
+	res = aac_dump_new(&cfg, &dump);
+	if (res < 0) {
+		ULOG_ERRNO("aac_dump_new", -res);
+		return res;
+	}
+
+	memset(&cbs, 0, sizeof(cbs));
+	cbs.adts_frame_end = (type == AAC_DUMP_TYPE_CBOR)
+				     ? &dump_cbor_adts_frame_end_cb
+				     : &dump_adts_frame_end_cb;
+	res = run_reader(
+		input, AAC_READER_FLAGS_FRAME_DATA, &cbs, dump, result);
+
+	aac_dump_destroy(dump);
+	return res;
+}
+
+
+static int bench_dump(struct input *input, struct result *result)
+{
+	return run_dump(input, AAC_DUMP_TYPE_JSON, result);
+}
+
+
+static int bench_dump_stream(struct input *input, struct result *result)
+{
+	return run_dump(input, AAC_DUMP_TYPE_JSON_STREAM, result);
+}
+
+
+static int bench_dump_cbor(struct input *input, struct result *result)
+{
+	return run_dump(input, AAC_DUMP_TYPE_CBOR, result);
+}
+
+
+static int bench_write_adts(struct input *input, struct result *result)
+{
+	int res = 0;
+	uint64_t start;
+	uint8_t *buf;
+	size_t len;
+	struct aac_adts adts = input->probe.adts;
+
+	start = time_ns();
+	for (uint64_t i = 0; i < input->probe.frame_count; i++) {
+		buf = NULL;
+		len = 0;
+		res = aac_write_adts(&adts, &buf, &len);
+		if (res < 0) {
+			ULOG_ERRNO("aac_write_adts", -res);
+			return res;
+		}
+		free(buf);
+		result->bytes += len;
+	}
+	result->ns = time_ns() - start;
+	result->frames = input->probe.frame_count;
+	return 0;
+}
+
+
+static int bench_write_silent(struct input *input, struct result *result)
+{
+	int res;
+	uint64_t start;
+	struct aac_ctx *ctx = NULL;
+	struct aac_bitstream bs;
+	uint8_t *buf;
+
+	buf = malloc(input->size);
+	if (buf == NULL)
+		return -ENOMEM;
+	res = aac_ctx_new(&ctx);
+	if (res < 0) {
+		ULOG_ERRNO("aac_ctx_new", -res);
+		goto out;
+	}
+	res = aac_ctx_set_adts(ctx, &input->probe.adts);
+	if (res < 0) {
+		ULOG_ERRNO("aac_ctx_set_adts", -res);
+		goto out;
+	}
+
+	aac_bs_init(&bs, buf, input->size);
+	start = time_ns();
+	for (uint64_t i = 0; i < input->probe.frame_count; i++) {
+		res = aac_write_silent_frame(&bs,
+					     ctx,
+					     SYNTHETIC_CHANNEL_COUNT,
+					     SYNTHETIC_FRAME_SIZE);
+		if (res < 0) {
+			ULOG_ERRNO("aac_write_silent_frame", -res);
+			goto out;
+		}
+	}
+	result->ns = time_ns() - start;
+	result->frames = input->probe.frame_count;
+	result->bytes = bs.off;
+	sink += buf[bs.off - 1];
+
+out:
+	aac_ctx_destroy(ctx);
+	free(buf);
+	return res;
+}
+
+
+static const struct bench benches[] = {
+	{"scan", 0, &bench_scan},
+	{"parse", 0, &bench_parse},
+	{"dump", 0, &bench_dump},
+	{"dump-stream", 0, &bench_dump_stream},
+	{"dump-cbor", 0, &bench_dump_cbor},
+	{"write-adts", 1, &bench_write_adts},
+	{"write-silent", 1, &bench_write_silent},
+};
+
+
+static int load_file(struct input *input)
+{
+	int res = 0;
+	FILE *f;
+	long size;
+
+	f = fopen(input->name, "rb");
+	if (f == NULL) {
+		res = -errno;
+		ULOG_ERRNO("fopen('%s')", -res, input->name);
+		return res;
+	}
+	if (fseek(f, 0, SEEK_END) < 0 || (size = ftell(f)) < 0 ||
+	    fseek(f, 0, SEEK_SET) < 0) {
+		res = -errno;
+		ULOG_ERRNO("fseek('%s')", -res, input->name);
+		goto out;
+	}
+	input->size = size;
+	input->data = malloc(input->size > 0 ? input->size : 1);
+	if (input->data == NULL) {
+		res = -ENOMEM;
+		goto out;
+	}
+	if (fread(input->data, 1, input->size, f) != input->size) {
+		res = -EIO;
+		ULOG_ERRNO("fread('%s')", -res, input->name);
+		goto out;
+	}
+
+	/* Unknown formats are only benchmarked as far as the reader goes */
+	res = aac_probe(input->data, input->size, &input->probe);
+	if (res < 0 && res != -EAGAIN) {
+		ULOG_ERRNO("aac_probe('%s')", -res, input->name);
+		goto out;
+	}
+	res = 0;
+
+out:
+	fclose(f);
+	return res;
+}
+
+
+static int generate_synthetic(struct input *input, unsigned int frames)
+{
+	int res;
+	struct aac_ctx *ctx = NULL;
+	struct aac_bitstream bs;
+
+	input->name = "synthetic";
+	input->synthetic = 1;
+	res = aac_adts_from_adef_format(&adef_aac_lc_16b_48000hz_stereo_adts,
+					&input->probe.adts);
+	if (res < 0) {
+		ULOG_ERRNO("aac_adts_from_adef_format", -res);
+		return res;
+	}
+	input->probe.data_format = ADEF_AAC_DATA_FORMAT_ADTS;
+	input->probe.frame_count = frames;
+
+	res = aac_ctx_new(&ctx);
+	if (res < 0) {
+		ULOG_ERRNO("aac_ctx_new", -res);
+		return res;
+	}
+	res = aac_ctx_set_adts(ctx, &input->probe.adts);
+	if (res < 0) {
+		ULOG_ERRNO("aac_ctx_set_adts", -res);
+		goto out;
+	}
+
+	aac_bs_init(&bs, NULL, 0);
+	for (unsigned int i = 0; i < frames; i++) {
+		res = aac_write_silent_frame(&bs,
+					     ctx,
+					     SYNTHETIC_CHANNEL_COUNT,
+					     SYNTHETIC_FRAME_SIZE);
+		if (res < 0) {
+			ULOG_ERRNO("aac_write_silent_frame", -res);
+			aac_bs_clear(&bs);
+			goto out;
+		}
+	}
+	input->data = bs.data;
+	input->size = bs.off;
+
+out:
+	aac_ctx_destroy(ctx);
+	return res;
+}
+
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t va = *(const uint64_t *)a;
+	uint64_t vb = *(const uint64_t *)b;
+
+	return va < vb ? -1 : va > vb;
+}
+
+
+/* JSON string, escaping the quotes, backslashes and control characters */
+static void print_json_str(FILE *f, const char *str)
+{
+	fputc('"', f);
+	for (; *str != '\0'; str++) {
+		if (*str == '"' || *str == '\\')
+			fprintf(f, "\\%c", *str);
+		else if ((unsigned char)*str < 0x20)
+			fprintf(f, "\\u%04x", *str);
+		else
+			fputc(*str, f);
+	}
+	fputc('"', f);
+}
+
+
+static void print_result(FILE *f,
+			 struct app *app,
+			 struct input *input,
+			 const struct bench *bench,
+			 const struct result *result)
+{
+	uint64_t best = app->samples[0];
+	uint64_t median = app->samples[app->iterations / 2];
+	uint64_t mad = app->deviations[app->iterations / 2];
+	double fps = result->frames * 1e9 / best;
+	double mbps = result->bytes * 1e3 / best;
+
+	fprintf(f, "{\"input\": ");
+	print_json_str(f, input->name);
+	fprintf(f,
+		", \"bench\": \"%s\", \"frames\": %" PRIu64
+		", \"bytes\": %" PRIu64 ", \"iterations\": %u"
+		", \"best_ns\": %" PRIu64 ", \"median_ns\": %" PRIu64
+		", \"mad_ns\": %" PRIu64 ", \"fps\": %.1f, \"mbps\": %.3f}",
+		bench->name,
+		result->frames,
+		result->bytes,
+		app->iterations,
+		best,
+		median,
+		mad,
+		fps,
+		mbps);
+}
+
+
+static int run_bench(struct app *app,
+		     struct input *input,
+		     const struct bench *bench)
+{
+	int res;
+	struct result result;
+	uint64_t median;
+
+	for (unsigned int i = 0; i < app->iterations; i++) {
+		memset(&result, 0, sizeof(result));
+		res = (*bench->run)(input, &result);
+		if (res < 0)
+			return res;
+		app->samples[i] = result.ns > 0 ? result.ns : 1;
+	}
+	qsort(app->samples,
+	      app->iterations,
+	      sizeof(*app->samples),
+	      &compare_u64);
+
+	/* Median absolute deviation: the noise estimate of the comparisons */
+	median = app->samples[app->iterations / 2];
+	for (unsigned int i = 0; i < app->iterations; i++) {
+		app->deviations[i] = app->samples[i] > median
+					     ? app->samples[i] - median
+					     : median - app->samples[i];
+	}
+	qsort(app->deviations,
+	      app->iterations,
+	      sizeof(*app->deviations),
+	      &compare_u64);
+
+	print_result(stdout, app, input, bench, &result);
+	printf("\n");
+	fflush(stdout);
+
+	if (app->baseline != NULL) {
+		fprintf(app->baseline,
+			"%s\n    ",
+			app->baseline_count > 0 ? "," : "");
+		print_result(app->baseline, app, input, bench, &result);
+		app->baseline_count++;
+	}
+	return 0;
+}
+
+
+static int run_input(struct app *app, struct input *input)
+{
+	int res;
+	const struct bench *bench;
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(benches); i++) {
+		bench = &benches[i];
+		if ((app->bench_mask & (1u << i)) == 0)
+			continue;
+		if (bench->synthetic_only && !input->synthetic)
+			continue;
+		if ((bench->run == &bench_dump ||
+		     bench->run == &bench_dump_stream ||
+		     bench->run == &bench_dump_cbor) &&
+		    input->probe.data_format != ADEF_AAC_DATA_FORMAT_ADTS)
+			continue;
+		res = run_bench(app, input, bench);
+		if (res < 0) {
+			fprintf(stderr,
+				"%s: benchmark '%s' failed: %s\n",
+				input->name,
+				bench->name,
+				strerror(-res));
+			return res;
+		}
+	}
+	return 0;
+}
+
+
+static int bench_from_str(const char *str)
+{
+	for (unsigned int i = 0; i < ARRAY_SIZE(benches); i++) {
+		if (strcmp(str, benches[i].name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+
+enum args_id {
+	ARGS_ID_FRAMES = 256,
+};
+
+
+static const char short_options[] = "hb:n:so:";
+
+
+static const struct option long_options[] = {
+	{"help", no_argument, NULL, 'h'},
+	{"bench", required_argument, NULL, 'b'},
+	{"iterations", required_argument, NULL, 'n'},
+	{"synthetic", no_argument, NULL, 's'},
+	{"frames", required_argument, NULL, ARGS_ID_FRAMES},
+	{"output", required_argument, NULL, 'o'},
+	{0, 0, 0, 0},
+};
+
+
+static void welcome(char *prog_name)
+{
+	/* stdout is reserved for the results */
+	fprintf(stderr,
+		"\n%s - Parrot AAC benchmark tool\n"
+		"Copyright (c) 2023 Parrot Drones SAS\n\n",
+		prog_name);
+}
+
+
+static void usage(char *prog_name)
+{
+	printf("Usage: %s [options] [<input file>...]\n"
+	       "\n"
+	       "Run the benchmarks on each input file, or on a synthetic "
+	       "stream if no\n"
+	       "file is given; the results are printed as JSON objects, one "
+	       "per line.\n"
+	       "\n"
+	       "Options:\n"
+	       "-h | --help                        Print this message\n"
+	       "-b | --bench <name>                Run only this benchmark "
+	       "(can be\n"
+	       "                                   repeated): scan, parse, "
+	       "dump,\n"
+	       "                                   dump-stream, dump-cbor, "
+	       "write-adts,\n"
+	       "                                   write-silent\n"
+	       "-n | --iterations <n>              Number of runs of each "
+	       "benchmark\n"
+	       "                                   (default: %d)\n"
+	       "-s | --synthetic                   Also run on the synthetic "
+	       "stream\n"
+	       "     --frames <n>                  Number of frames of the "
+	       "synthetic\n"
+	       "                                   stream (default: %d)\n"
+	       "-o | --output <file>               Also save the results as "
+	       "a baseline\n"
+	       "                                   file for aac-bench-cmp\n"
+	       "\n",
+	       prog_name,
+	       DEFAULT_ITERATIONS,
+	       DEFAULT_SYNTHETIC_FRAMES);
+}
+
+
+int main(int argc, char *argv[])
+{
+	int res = 0;
+	int idx, c, bench;
+	struct app app;
+	struct input input;
+	const char *output = NULL;
+
+	memset(&app, 0, sizeof(app));
+	app.iterations = DEFAULT_ITERATIONS;
+	app.synthetic_frames = DEFAULT_SYNTHETIC_FRAMES;
+
+	welcome(argv[0]);
+
+	/* Command-line parameters */
+	while ((c = getopt_long(
+			argc, argv, short_options, long_options, &idx)) != -1) {
+		switch (c) {
+		case 0:
+			break;
+
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+			break;
+
+		case 'b':
+			bench = bench_from_str(optarg);
+			if (bench < 0) {
+				fprintf(stderr,
+					"Unknown benchmark '%s'\n",
+					optarg);
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			app.bench_mask |= 1u << bench;
+			break;
+
+		case 'n':
+			app.iterations = atoi(optarg);
+			break;
+
+		case 's':
+			app.synthetic = 1;
+			break;
+
+		case ARGS_ID_FRAMES:
+			app.synthetic_frames = atoi(optarg);
+			break;
+
+		case 'o':
+			output = optarg;
+			break;
+
+		default:
+			usage(argv[0]);
+			exit(EXIT_FAILURE);
+			break;
+		}
+	}
+	if (app.iterations == 0 || app.synthetic_frames == 0) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	if (app.bench_mask == 0)
+		app.bench_mask = (1u << ARRAY_SIZE(benches)) - 1;
+	if (optind == argc)
+		app.synthetic = 1;
+
+	app.samples = calloc(app.iterations, sizeof(*app.samples));
+	app.deviations = calloc(app.iterations, sizeof(*app.deviations));
+	if (app.samples == NULL || app.deviations == NULL) {
+		res = -ENOMEM;
+		goto out;
+	}
+
+	if (output != NULL) {
+		app.baseline = fopen(output, "w");
+		if (app.baseline == NULL) {
+			res = -errno;
+			ULOG_ERRNO("fopen('%s')", -res, output);
+			goto out;
+		}
+		fprintf(app.baseline,
+			"{\"version\": %d, \"results\": [",
+			BASELINE_VERSION);
+	}
+
+	if (app.synthetic) {
+		memset(&input, 0, sizeof(input));
+		res = generate_synthetic(&input, app.synthetic_frames);
+		if (res == 0)
+			res = run_input(&app, &input);
+		free(input.data);
+		if (res < 0)
+			goto out;
+	}
+
+	for (int i = optind; i < argc; i++) {
+		memset(&input, 0, sizeof(input));
+		input.name = argv[i];
+		res = load_file(&input);
+		if (res == 0)
+			res = run_input(&app, &input);
+		free(input.data);
+		if (res < 0)
+			goto out;
+	}
+
+out:
+	/* Cleanup */
+	if (app.baseline != NULL) {
+		/* Incomplete baselines are not valid JSON on purpose */
+		if (res >= 0)
+			fprintf(app.baseline, "\n]}\n");
+		if (fclose(app.baseline) != 0 && res >= 0) {
+			res = -errno;
+			ULOG_ERRNO("fclose('%s')", -res, output);
+		}
+	}
+	free(app.samples);
+	free(app.deviations);
+
+	return res >= 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
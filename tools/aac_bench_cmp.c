@@ -0,0 +1,358 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ULOG_TAG aac_bench_cmp
+#include <ulog.h>
+ULOG_DECLARE_TAG(aac_bench_cmp);
+
+#include <json-c/json.h>
+
+
+/* Version of the baseline file format (see aac-bench) */
+#define BASELINE_VERSION 1
+
+#define DEFAULT_THRESHOLD 5.0
+#define DEFAULT_MAD_FACTOR 3.0
+
+/* Scale of the median absolute deviation to a standard deviation for
+ * normally distributed samples */
+#define MAD_TO_SIGMA 1.4826
+
+
+struct entry {
+	const char *input;
+	const char *bench;
+	uint64_t median_ns;
+	uint64_t mad_ns;
+};
+
+
+struct app {
+	/* Minimum relative change (in percent) to report */
+	double threshold;
+	/* Minimum change to report, in standard deviations of the noise */
+	double mad_factor;
+	unsigned int cases;
+	unsigned int regressions;
+	unsigned int improvements;
+	unsigned int missing;
+	unsigned int added;
+};
+
+
+static int load_results(const char *path,
+			json_object **ret_root,
+			json_object **ret_results)
+{
+	json_object *jroot, *jversion, *jresults;
+
+	jroot = json_object_from_file(path);
+	if (jroot == NULL) {
+		fprintf(stderr, "%s: failed to load JSON file\n", path);
+		return -EINVAL;
+	}
+	if (!json_object_object_get_ex(jroot, "version", &jversion) ||
+	    json_object_get_int(jversion) != BASELINE_VERSION) {
+		fprintf(stderr,
+			"%s: unsupported baseline version (expected %d)\n",
+			path,
+			BASELINE_VERSION);
+		json_object_put(jroot);
+		return -EPROTO;
+	}
+	if (!json_object_object_get_ex(jroot, "results", &jresults) ||
+	    json_object_get_type(jresults) != json_type_array) {
+		fprintf(stderr, "%s: missing results\n", path);
+		json_object_put(jroot);
+		return -EPROTO;
+	}
+
+	*ret_root = jroot;
+	*ret_results = jresults;
+	return 0;
+}
+
+
+static int get_entry(json_object *jobj, struct entry *entry)
+{
+	json_object *jinput, *jbench, *jmedian, *jmad;
+
+	if (!json_object_object_get_ex(jobj, "input", &jinput) ||
+	    !json_object_object_get_ex(jobj, "bench", &jbench) ||
+	    !json_object_object_get_ex(jobj, "median_ns", &jmedian) ||
+	    !json_object_object_get_ex(jobj, "mad_ns", &jmad))
+		return -EPROTO;
+
+	entry->input = json_object_get_string(jinput);
+	entry->bench = json_object_get_string(jbench);
+	entry->median_ns = json_object_get_int64(jmedian);
+	entry->mad_ns = json_object_get_int64(jmad);
+	return 0;
+}
+
+
+static int find_entry(json_object *jresults,
+		      const struct entry *key,
+		      struct entry *entry)
+{
+	int res;
+	size_t count = json_object_array_length(jresults);
+
+	for (size_t i = 0; i < count; i++) {
+		res = get_entry(json_object_array_get_idx(jresults, i), entry);
+		if (res < 0)
+			return res;
+		if (strcmp(entry->input, key->input) == 0 &&
+		    strcmp(entry->bench, key->bench) == 0)
+			return 0;
+	}
+	return -ENOENT;
+}
+
+
+static void compare_entry(struct app *app,
+			  const struct entry *base,
+			  const struct entry *cur)
+{
+	double delta, tolerance, noise;
+	const char *verdict = "ok";
+
+	/* A change is significant when it is above both the relative
+	 * threshold and the noise of the noisiest run */
+	delta = (double)cur->median_ns - (double)base->median_ns;
+	tolerance = base->median_ns * app->threshold / 100.;
+	noise = app->mad_factor * MAD_TO_SIGMA *
+		(base->mad_ns > cur->mad_ns ? base->mad_ns : cur->mad_ns);
+	if (noise > tolerance)
+		tolerance = noise;
+
+	app->cases++;
+	if (delta > tolerance) {
+		verdict = "REGRESSION";
+		app->regressions++;
+	} else if (-delta > tolerance) {
+		verdict = "improvement";
+		app->improvements++;
+	}
+
+	printf("%-32s %-14s %12.3f %12.3f %+8.1f%%  %s\n",
+	       cur->input,
+	       cur->bench,
+	       base->median_ns / 1e6,
+	       cur->median_ns / 1e6,
+	       base->median_ns > 0 ? delta * 100. / base->median_ns : 0.,
+	       verdict);
+}
+
+
+static int compare(struct app *app, json_object *jbase, json_object *jcur)
+{
+	int res;
+	struct entry base, cur;
+	size_t count;
+
+	printf("%-32s %-14s %12s %12s %9s  %s\n",
+	       "input",
+	       "bench",
+	       "base (ms)",
+	       "new (ms)",
+	       "delta",
+	       "verdict");
+
+	count = json_object_array_length(jcur);
+	for (size_t i = 0; i < count; i++) {
+		res = get_entry(json_object_array_get_idx(jcur, i), &cur);
+		if (res < 0)
+			return res;
+		res = find_entry(jbase, &cur, &base);
+		if (res == -ENOENT) {
+			printf("%-32s %-14s %12s %12.3f %9s  new\n",
+			       cur.input,
+			       cur.bench,
+			       "-",
+			       cur.median_ns / 1e6,
+			       "-");
+			app->added++;
+			continue;
+		} else if (res < 0) {
+			return res;
+		}
+		compare_entry(app, &base, &cur);
+	}
+
+	/* Cases of the baseline that are no longer run */
+	count = json_object_array_length(jbase);
+	for (size_t i = 0; i < count; i++) {
+		res = get_entry(json_object_array_get_idx(jbase, i), &base);
+		if (res < 0)
+			return res;
+		res = find_entry(jcur, &base, &cur);
+		if (res == 0)
+			continue;
+		else if (res != -ENOENT)
+			return res;
+		printf("%-32s %-14s %12.3f %12s %9s  missing\n",
+		       base.input,
+		       base.bench,
+		       base.median_ns / 1e6,
+		       "-",
+		       "-");
+		app->missing++;
+	}
+
+	printf("\n%u cases compared: %u regressions, %u improvements, "
+	       "%u new, %u missing\n",
+	       app->cases,
+	       app->regressions,
+	       app->improvements,
+	       app->added,
+	       app->missing);
+	return 0;
+}
+
+
+static const char short_options[] = "ht:k:";
+
+
+static const struct option long_options[] = {
+	{"help", no_argument, NULL, 'h'},
+	{"threshold", required_argument, NULL, 't'},
+	{"mad-factor", required_argument, NULL, 'k'},
+	{0, 0, 0, 0},
+};
+
+
+static void welcome(char *prog_name)
+{
+	printf("\n%s - Parrot AAC benchmark comparison tool\n"
+	       "Copyright (c) 2023 Parrot Drones SAS\n\n",
+	       prog_name);
+}
+
+
+static void usage(char *prog_name)
+{
+	printf("Usage: %s [options] <baseline file> <results file>\n"
+	       "\n"
+	       "Compare the median run times of two aac-bench result files "
+	       "(saved with\n"
+	       "'aac-bench -o'); the exit status is non-zero if a benchmark "
+	       "regressed.\n"
+	       "A change is significant when it exceeds both the threshold "
+	       "and the noise\n"
+	       "(the median absolute deviation of the runs, use at least 5 "
+	       "iterations).\n"
+	       "\n"
+	       "Options:\n"
+	       "-h | --help                        Print this message\n"
+	       "-t | --threshold <percent>         Minimum significant change "
+	       "(default: %.0f%%)\n"
+	       "-k | --mad-factor <k>              Minimum significant change "
+	       "in standard\n"
+	       "                                   deviations of the noise "
+	       "(default: %.0f)\n"
+	       "\n",
+	       prog_name,
+	       DEFAULT_THRESHOLD,
+	       DEFAULT_MAD_FACTOR);
+}
+
+
+int main(int argc, char *argv[])
+{
+	int res = 0;
+	int idx, c;
+	struct app app;
+	json_object *jbase_root = NULL, *jcur_root = NULL;
+	json_object *jbase, *jcur;
+
+	memset(&app, 0, sizeof(app));
+	app.threshold = DEFAULT_THRESHOLD;
+	app.mad_factor = DEFAULT_MAD_FACTOR;
+
+	welcome(argv[0]);
+
+	/* Command-line parameters */
+	while ((c = getopt_long(
+			argc, argv, short_options, long_options, &idx)) != -1) {
+		switch (c) {
+		case 0:
+			break;
+
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+			break;
+
+		case 't':
+			app.threshold = atof(optarg);
+			break;
+
+		case 'k':
+			app.mad_factor = atof(optarg);
+			break;
+
+		default:
+			usage(argv[0]);
+			exit(EXIT_FAILURE);
+			break;
+		}
+	}
+	if (argc - optind != 2 || app.threshold < 0. || app.mad_factor < 0.) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	res = load_results(argv[optind], &jbase_root, &jbase);
+	if (res < 0)
+		goto out;
+	res = load_results(argv[optind + 1], &jcur_root, &jcur);
+	if (res < 0)
+		goto out;
+
+	res = compare(&app, jbase, jcur);
+	if (res < 0) {
+		fprintf(stderr, "invalid result entry: %s\n", strerror(-res));
+		goto out;
+	}
+	if (app.regressions > 0)
+		res = -EDOM;
+
+out:
+	/* Cleanup */
+	json_object_put(jbase_root);
+	json_object_put(jcur_root);
+
+	return res >= 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
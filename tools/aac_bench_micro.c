@@ -0,0 +1,540 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#	include <x86intrin.h>
+#	define HAVE_TSC 1
+#endif
+
+#define ULOG_TAG aac_bench_micro
+#include <ulog.h>
+ULOG_DECLARE_TAG(aac_bench_micro);
+
+#include <aac/aac.h>
+
+/* Internal functions (static build of the library) */
+#include <aac_huffman.h>
+
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+
+
+#define DEFAULT_ITERATIONS 5
+#define DEFAULT_SIZE_KB 1024
+#define DEFAULT_SEED 1
+
+/* Bits left at the end of the buffer for the longest Huffman codeword
+ * (19 bits) and its sign bits */
+#define HUFFMAN_MARGIN_BITS 32
+
+
+enum pattern {
+	PATTERN_ZEROS = 0,
+	PATTERN_ONES,
+	PATTERN_RANDOM,
+	PATTERN_COUNT,
+};
+
+
+static const char *const pattern_names[PATTERN_COUNT] = {
+	"zeros",
+	"ones",
+	"random",
+};
+
+
+struct result {
+	uint64_t ops;
+	uint64_t bits;
+	uint64_t ns;
+	uint64_t cycles;
+};
+
+
+struct bench {
+	const char *name;
+	/* Bit widths or codebooks */
+	const unsigned int *params;
+	unsigned int param_count;
+	int (*run)(const uint8_t *buf,
+		   size_t size,
+		   unsigned int param,
+		   struct result *result);
+};
+
+
+struct app {
+	unsigned int iterations;
+	size_t size;
+	uint64_t seed;
+	/* CPU frequency in MHz, to convert times to cycles without TSC */
+	double cpu_freq;
+	const char *bench_name;
+	uint8_t *buf;
+};
+
+
+/* Sink for the benchmark outputs, so that they are not optimized out */
+static volatile uint32_t sink;
+
+/* Output buffer of the write benchmarks */
+static uint8_t *out_buf;
+
+
+static uint64_t time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static inline uint64_t time_cycles(void)
+{
+#ifdef HAVE_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+
+static void result_start(struct result *result)
+{
+	result->ns = time_ns();
+	result->cycles = time_cycles();
+}
+
+
+static void result_stop(struct result *result)
+{
+	result->cycles = time_cycles() - result->cycles;
+	result->ns = time_ns() - result->ns;
+}
+
+
+static int bench_bs_read(const uint8_t *buf,
+			 size_t size,
+			 unsigned int n,
+			 struct result *result)
+{
+	struct aac_bitstream bs;
+	uint64_t ops = size * 8 / n;
+	uint32_t v, acc = 0;
+
+	aac_bs_cinit(&bs, buf, size);
+	result_start(result);
+	for (uint64_t i = 0; i < ops; i++) {
+		aac_bs_read_bits(&bs, &v, n);
+		acc ^= v;
+	}
+	result_stop(result);
+	sink = acc;
+	result->ops = ops;
+	result->bits = ops * n;
+	return 0;
+}
+
+
+static int bench_bs_write(const uint8_t *buf,
+			  size_t size,
+			  unsigned int n,
+			  struct result *result)
+{
+	int res;
+	struct aac_bitstream bs;
+	uint64_t ops = size * 8 / n;
+	const uint32_t *values = (const uint32_t *)buf;
+	size_t mask = size / sizeof(*values) - 1;
+
+	aac_bs_init(&bs, out_buf, size);
+	result_start(result);
+	for (uint64_t i = 0; i < ops; i++) {
+		res = aac_bs_write_bits(&bs, values[i & mask], n);
+		if (res < 0)
+			return res;
+	}
+	result_stop(result);
+	sink = out_buf[bs.off - 1];
+	result->ops = ops;
+	result->bits = ops * n;
+	return 0;
+}
+
+
+static int bench_bs_next(const uint8_t *buf,
+			 size_t size,
+			 unsigned int n,
+			 struct result *result)
+{
+	struct aac_bitstream bs;
+	uint64_t ops = size * 8 / n;
+	uint32_t v, acc = 0;
+
+	aac_bs_cinit(&bs, buf, size);
+	result_start(result);
+	for (uint64_t i = 0; i < ops; i++) {
+		aac_bs_next_bits(&bs, &v, n);
+		aac_bs_skip_bits(&bs, n);
+		acc ^= v;
+	}
+	result_stop(result);
+	sink = acc;
+	result->ops = ops;
+	result->bits = ops * n;
+	return 0;
+}
+
+
+static int bench_huffman_sf(const uint8_t *buf,
+			    size_t size,
+			    unsigned int param,
+			    struct result *result)
+{
+	int res;
+	struct aac_bitstream bs;
+	uint32_t acc = 0;
+
+	aac_bs_cinit(&bs, buf, size);
+	result_start(result);
+	while (aac_bs_rem_raw_bits(&bs) >= HUFFMAN_MARGIN_BITS) {
+		res = aac_bs_read_huffman_sf(&bs);
+		if (res < 0)
+			return res;
+		acc += res;
+		result->ops++;
+	}
+	result_stop(result);
+	sink = acc;
+	result->bits = aac_bs_read_bit_off(&bs);
+	return 0;
+}
+
+
+static int bench_huffman_spectral(const uint8_t *buf,
+				  size_t size,
+				  unsigned int cb,
+				  struct result *result)
+{
+	int res;
+	struct aac_bitstream bs;
+	int values[4];
+	uint32_t acc = 0;
+
+	aac_bs_cinit(&bs, buf, size);
+	result_start(result);
+	while (aac_bs_rem_raw_bits(&bs) >= HUFFMAN_MARGIN_BITS) {
+		res = aac_bs_read_huffman_spectral(&bs, cb, values);
+		if (res < 0)
+			return res;
+		acc += values[0] + values[1] + values[2] + values[3];
+		result->ops++;
+	}
+	result_stop(result);
+	sink = acc;
+	result->bits = aac_bs_read_bit_off(&bs);
+	return 0;
+}
+
+
+static const unsigned int bit_widths[] = {1, 4, 8, 13, 32};
+
+
+static const unsigned int no_params[] = {0};
+
+
+static const unsigned int codebooks[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+
+static const struct bench benches[] = {
+	{"bs-read", bit_widths, ARRAY_SIZE(bit_widths), &bench_bs_read},
+	{"bs-write", bit_widths, ARRAY_SIZE(bit_widths), &bench_bs_write},
+	{"bs-next", bit_widths, ARRAY_SIZE(bit_widths), &bench_bs_next},
+	{"huffman-sf", no_params, ARRAY_SIZE(no_params), &bench_huffman_sf},
+	{"huffman-spectral",
+	 codebooks,
+	 ARRAY_SIZE(codebooks),
+	 &bench_huffman_spectral},
+};
+
+
+static void fill_pattern(uint8_t *buf,
+			 size_t size,
+			 enum pattern pattern,
+			 uint64_t seed)
+{
+	/* xorshift64 */
+	uint64_t x = seed != 0 ? seed : 1;
+
+	switch (pattern) {
+	case PATTERN_ZEROS:
+		memset(buf, 0, size);
+		break;
+	case PATTERN_ONES:
+		memset(buf, 0xFF, size);
+		break;
+	case PATTERN_RANDOM:
+	default:
+		for (size_t i = 0; i < size; i++) {
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+			buf[i] = x >> 56;
+		}
+		break;
+	}
+}
+
+
+static int compare_result(const void *a, const void *b)
+{
+	const struct result *ra = a;
+	const struct result *rb = b;
+
+	return ra->ns < rb->ns ? -1 : ra->ns > rb->ns;
+}
+
+
+static int run_bench(struct app *app,
+		     const struct bench *bench,
+		     unsigned int param,
+		     enum pattern pattern,
+		     struct result *results)
+{
+	int res;
+	const struct result *best;
+	double cycles;
+
+	for (unsigned int i = 0; i < app->iterations; i++) {
+		memset(&results[i], 0, sizeof(results[i]));
+		res = (*bench->run)(app->buf, app->size, param, &results[i]);
+		if (res < 0)
+			return res;
+	}
+	qsort(results, app->iterations, sizeof(*results), &compare_result);
+	best = &results[0];
+
+	printf("{\"bench\": \"%s\", \"param\": %u, \"pattern\": \"%s\""
+	       ", \"ops\": %" PRIu64 ", \"bits\": %" PRIu64
+	       ", \"best_ns\": %" PRIu64 ", \"ns_per_op\": %.3f",
+	       bench->name,
+	       param,
+	       pattern_names[pattern],
+	       best->ops,
+	       best->bits,
+	       best->ns,
+	       best->ops > 0 ? (double)best->ns / best->ops : 0.);
+	if (app->cpu_freq > 0.)
+		cycles = best->ns * app->cpu_freq / 1000.;
+	else
+		cycles = best->cycles;
+	if (cycles > 0. && best->bits > 0)
+		printf(", \"cycles_per_bit\": %.3f}\n", cycles / best->bits);
+	else
+		printf(", \"cycles_per_bit\": null}\n");
+	fflush(stdout);
+	return 0;
+}
+
+
+static const char short_options[] = "hb:n:s:";
+
+
+enum args_id {
+	ARGS_ID_SEED = 256,
+	ARGS_ID_CPU_FREQ,
+};
+
+
+static const struct option long_options[] = {
+	{"help", no_argument, NULL, 'h'},
+	{"bench", required_argument, NULL, 'b'},
+	{"iterations", required_argument, NULL, 'n'},
+	{"size", required_argument, NULL, 's'},
+	{"seed", required_argument, NULL, ARGS_ID_SEED},
+	{"cpu-freq", required_argument, NULL, ARGS_ID_CPU_FREQ},
+	{0, 0, 0, 0},
+};
+
+
+static void welcome(char *prog_name)
+{
+	/* stdout is reserved for the results */
+	fprintf(stderr,
+		"\n%s - Parrot AAC micro-benchmark tool\n"
+		"Copyright (c) 2023 Parrot Drones SAS\n\n",
+		prog_name);
+}
+
+
+static void usage(char *prog_name)
+{
+	printf("Usage: %s [options]\n"
+	       "\n"
+	       "Run the bitstream and Huffman decoding micro-benchmarks on "
+	       "all-zeros,\n"
+	       "all-ones and random bit patterns; the results are printed "
+	       "as JSON\n"
+	       "objects, one per line. Cycles are TSC cycles on x86, "
+	       "otherwise they\n"
+	       "are derived from the --cpu-freq option.\n"
+	       "\n"
+	       "Options:\n"
+	       "-h | --help                        Print this message\n"
+	       "-b | --bench <name>                Run only this benchmark: "
+	       "bs-read,\n"
+	       "                                   bs-write, bs-next, "
+	       "huffman-sf,\n"
+	       "                                   huffman-spectral\n"
+	       "-n | --iterations <n>              Number of runs of each "
+	       "benchmark\n"
+	       "                                   (default: %d)\n"
+	       "-s | --size <KiB>                  Size of the bit patterns, "
+	       "a power\n"
+	       "                                   of 2 (default: %d)\n"
+	       "     --seed <n>                    Seed of the random "
+	       "pattern\n"
+	       "                                   (default: %d)\n"
+	       "     --cpu-freq <MHz>              CPU frequency, to convert "
+	       "times to\n"
+	       "                                   cycles\n"
+	       "\n",
+	       prog_name,
+	       DEFAULT_ITERATIONS,
+	       DEFAULT_SIZE_KB,
+	       DEFAULT_SEED);
+}
+
+
+int main(int argc, char *argv[])
+{
+	int res = 0;
+	int idx, c;
+	struct app app;
+	struct result *results = NULL;
+	const struct bench *bench;
+	unsigned int size_kb = DEFAULT_SIZE_KB;
+
+	memset(&app, 0, sizeof(app));
+	app.iterations = DEFAULT_ITERATIONS;
+	app.seed = DEFAULT_SEED;
+
+	welcome(argv[0]);
+
+	/* Command-line parameters */
+	while ((c = getopt_long(
+			argc, argv, short_options, long_options, &idx)) != -1) {
+		switch (c) {
+		case 0:
+			break;
+
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+			break;
+
+		case 'b':
+			app.bench_name = optarg;
+			break;
+
+		case 'n':
+			app.iterations = atoi(optarg);
+			break;
+
+		case 's':
+			size_kb = atoi(optarg);
+			break;
+
+		case ARGS_ID_SEED:
+			app.seed = strtoull(optarg, NULL, 0);
+			break;
+
+		case ARGS_ID_CPU_FREQ:
+			app.cpu_freq = atof(optarg);
+			break;
+
+		default:
+			usage(argv[0]);
+			exit(EXIT_FAILURE);
+			break;
+		}
+	}
+	if (app.iterations == 0 || size_kb == 0 ||
+	    (size_kb & (size_kb - 1)) != 0) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	app.size = (size_t)size_kb * 1024;
+
+	app.buf = malloc(app.size);
+	out_buf = malloc(app.size);
+	results = calloc(app.iterations, sizeof(*results));
+	if (app.buf == NULL || out_buf == NULL || results == NULL) {
+		res = -ENOMEM;
+		goto out;
+	}
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(benches); i++) {
+		bench = &benches[i];
+		if (app.bench_name != NULL &&
+		    strcmp(app.bench_name, bench->name) != 0)
+			continue;
+		for (int p = 0; p < PATTERN_COUNT; p++) {
+			fill_pattern(app.buf, app.size, p, app.seed);
+			for (unsigned int j = 0; j < bench->param_count; j++) {
+				res = run_bench(&app,
+						bench,
+						bench->params[j],
+						p,
+						results);
+				if (res < 0) {
+					ULOG_ERRNO("%s(%u)",
+						   -res,
+						   bench->name,
+						   bench->params[j]);
+					goto out;
+				}
+			}
+		}
+	}
+
+out:
+	/* Cleanup */
+	free(results);
+	free(out_buf);
+	free(app.buf);
+
+	return res >= 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -27,10 +27,18 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <inttypes.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#	include <poll.h>
+#	include <sys/inotify.h>
+#endif
 
 #ifdef _WIN32
 #	include "windows.h"
@@ -46,6 +54,52 @@ ULOG_DECLARE_TAG(aac_dump);
 #include <json-c/json.h>
 
 
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+
+
+/* Streaming input: size of the read chunks and of the input buffer, which
+ * must hold the largest access unit (an ADTS frame is at most 8191 bytes,
+ * a LOAS frame 8194 bytes) */
+#define STREAM_CHUNK_SIZE 16384
+#define STREAM_BUF_SIZE 65536
+
+/* Follow mode: maximum wait for the input file to grow before checking it
+ * again (the only wake-up without inotify) */
+#define FOLLOW_POLL_MS 200
+
+
+/* Frame sizes (bytes) and bitrates (kbit/s) above are clamped */
+#define SUMMARY_MAX_FRAME_SIZE 8192
+#define SUMMARY_MAX_BITRATE 2048
+#define SUMMARY_MAX_SFB 64
+#define SUMMARY_CODEBOOKS 16
+#define SUMMARY_ELEMENTS 8
+#define SUMMARY_WINDOW_SEQUENCES 4
+
+
+/* Whole file statistics; the syntax values are collected by a visitor dump
+ * restricted to the summary paths */
+struct summary {
+	uint64_t frames;
+	uint64_t bytes;
+	uint64_t duration;
+	uint32_t sample_rate;
+	uint64_t frame_sizes[SUMMARY_MAX_FRAME_SIZE + 1];
+	uint64_t bitrates[SUMMARY_MAX_BITRATE + 1];
+	uint64_t elements[SUMMARY_ELEMENTS];
+	uint64_t element_bits[SUMMARY_ELEMENTS];
+	uint64_t window_sequences[SUMMARY_WINDOW_SEQUENCES];
+	uint64_t ics_count;
+	uint64_t max_sfb[SUMMARY_MAX_SFB];
+	/* Scalefactor bands per codebook */
+	uint64_t codebooks[SUMMARY_CODEBOOKS];
+	/* Codebook and escaped length of the current section */
+	unsigned int sect_cb;
+	unsigned int sect_len;
+	struct aac_trace_event events[AAC_TRACE_MAX_EVENTS];
+};
+
+
 struct app {
 	const char *inpath;
 	const char *outpath;
@@ -61,11 +115,82 @@ struct app {
 	struct aac_dump *dump;
 	FILE *fout;
 	uint32_t json_flags;
+	int cbor;
+	int from_cbor;
+	const char *include[AAC_DUMP_MAX_FILTER_PATHS];
+	unsigned int include_count;
+	const char *exclude[AAC_DUMP_MAX_FILTER_PATHS];
+	unsigned int exclude_count;
+	/* Raw input: AudioSpecificConfig (hexadecimal string) and path of
+	 * the file of the access unit sizes (if any) */
+	const char *asc;
+	const char *sizes_path;
+	/* Streaming input (stdin, FIFOs and growing files): read in chunks
+	 * into a bounded buffer instead of mapping the whole file */
+	int stream;
+	int stream_fd;
+	uint8_t *stream_buf;
+	size_t stream_len;
+	uint64_t stream_off;
+	/* Follow mode: wait for more data at the end of the input; inotify
+	 * is used when available, polling otherwise */
+	int follow;
+	int inotify_fd;
+	/* Summary statistics mode (see print_summary()) */
+	struct summary *summary;
+	uint32_t reader_flags;
+	/* Columnar metrics mode: one row per frame instead of the frame
+	 * dumps (see aac_columns.h) */
+	struct aac_columns *columns;
 };
 
 
 #define READER_FLAGS AAC_READER_FLAGS_FRAME_DATA
 #define DUMP_FLAGS AAC_DUMP_FLAGS_FRAME_DATA
+#define SUMMARY_READER_FLAGS                                                   \
+	(AAC_READER_FLAGS_FRAME_DATA | AAC_READER_FLAGS_BIT_STATS |            \
+	 AAC_READER_FLAGS_TRACE)
+
+
+static const char *const summary_paths[] = {
+	"raw_data_block.id_syn_ele",
+	"raw_data_block.*.window_sequence",
+	"raw_data_block.*.max_sfb",
+	"raw_data_block.*.individual_channel_stream.window_sequence",
+	"raw_data_block.*.individual_channel_stream.max_sfb",
+	"raw_data_block.*.individual_channel_stream.sect_cb[g]",
+	"raw_data_block.*.individual_channel_stream.sect_esc_val",
+	"raw_data_block.*.individual_channel_stream.sect_len_incr",
+};
+
+
+static const char *const element_names[SUMMARY_ELEMENTS] = {
+	"SCE",
+	"CPE",
+	"CCE",
+	"LFE",
+	"DSE",
+	"PCE",
+	"FIL",
+	"END",
+};
+
+
+static const char *const window_sequence_names[SUMMARY_WINDOW_SEQUENCES] = {
+	"ONLY_LONG",
+	"LONG_START",
+	"EIGHT_SHORT",
+	"LONG_STOP",
+};
+
+
+static volatile sig_atomic_t s_stopped;
+
+
+static void sighandler(int signum)
+{
+	s_stopped = 1;
+}
 
 
 static void unmap_file(struct app *app)
@@ -183,21 +308,12 @@ static void dump_buf(FILE *fout, const uint8_t *buf, size_t len)
 }
 
 
-static void adts_frame_begin_cb(struct aac_ctx *ctx,
-				const uint8_t *buf,
-				size_t len,
-				const struct aac_adts *adts,
-				void *userdata)
+static void print_json(struct app *app)
 {
-	int res = 0;
-	struct app *app = userdata;
+	int res;
 	json_object *jobj = NULL;
 	const char *jstr = NULL;
 
-	res = aac_dump_adts_frame(app->dump, ctx, DUMP_FLAGS);
-	if (res < 0)
-		ULOG_ERRNO("aac_dump_adts_frame", -res);
-
 	res = aac_dump_get_json_object(app->dump, &jobj);
 	if (res < 0)
 		ULOG_ERRNO("aac_dump_get_json_object", -res);
@@ -217,44 +333,991 @@ static void adts_frame_begin_cb(struct aac_ctx *ctx,
 }
 
 
+static int key_is(const char *key, size_t len, const char *name)
+{
+	return strlen(name) == len && memcmp(key, name, len) == 0;
+}
+
+
+static int summary_field_cb(struct aac_dump *dump,
+			    const char *key,
+			    size_t len,
+			    int64_t val,
+			    void *userdata)
+{
+	struct summary *summary = userdata;
+
+	if (key_is(key, len, "id_syn_ele")) {
+		summary->elements[val % SUMMARY_ELEMENTS]++;
+	} else if (key_is(key, len, "window_sequence")) {
+		summary->window_sequences[val % SUMMARY_WINDOW_SEQUENCES]++;
+		summary->ics_count++;
+	} else if (key_is(key, len, "max_sfb")) {
+		summary->max_sfb[val % SUMMARY_MAX_SFB]++;
+	} else if (key_is(key, len, "sect_cb[g]")) {
+		summary->sect_cb = val % SUMMARY_CODEBOOKS;
+		summary->sect_len = 0;
+	} else if (key_is(key, len, "sect_esc_val")) {
+		summary->sect_len += val;
+	} else if (key_is(key, len, "sect_len_incr")) {
+		summary->codebooks[summary->sect_cb] += summary->sect_len + val;
+	}
+	return 0;
+}
+
+
+static const struct aac_dump_visitor summary_visitor = {
+	.field = &summary_field_cb,
+};
+
+
+/* Bits of each element of the last frame: from the trace event of the
+ * element to the next one (the id of the next element is included) */
+static void summary_element_bits(struct app *app)
+{
+	int res;
+	struct summary *summary = app->summary;
+	size_t count = AAC_TRACE_MAX_EVENTS;
+	size_t start = 0;
+	const struct aac_trace_event *prev = NULL, *event;
+
+	res = aac_reader_get_trace(app->reader, summary->events, &count);
+	if (res < 0) {
+		ULOG_ERRNO("aac_reader_get_trace", -res);
+		return;
+	}
+	for (size_t i = count; i > 0; i--) {
+		if (summary->events[i - 1].type == AAC_TRACE_TYPE_FRAME) {
+			start = i;
+			break;
+		}
+	}
+	for (size_t i = start; i < count; i++) {
+		event = &summary->events[i];
+		if (event->type != AAC_TRACE_TYPE_ELEMENT)
+			continue;
+		if (prev != NULL && prev->id != AAC_SYN_ELE_ID_END) {
+			summary->element_bits[prev->id % SUMMARY_ELEMENTS] +=
+				event->bit_off - prev->bit_off;
+		}
+		prev = event;
+	}
+}
+
+
+static void summary_frame(struct app *app, struct aac_ctx *ctx, size_t len)
+{
+	int res;
+	struct summary *summary = app->summary;
+	struct aac_timing timing;
+	uint64_t bitrate;
+
+	summary->frames++;
+	summary->bytes += len;
+	summary->frame_sizes[len < SUMMARY_MAX_FRAME_SIZE
+				     ? len
+				     : SUMMARY_MAX_FRAME_SIZE]++;
+
+	res = aac_ctx_get_timing(ctx, &timing);
+	if (res == 0 && timing.frame_duration > 0) {
+		summary->sample_rate = timing.sample_rate;
+		summary->duration += timing.frame_duration;
+		bitrate = ((uint64_t)len * 8 * timing.sample_rate +
+			   timing.frame_duration * 500) /
+			  (timing.frame_duration * 1000);
+		summary->bitrates[bitrate < SUMMARY_MAX_BITRATE
+					  ? bitrate
+					  : SUMMARY_MAX_BITRATE]++;
+	}
+
+	summary_element_bits(app);
+}
+
+
+/* Value of the histogram at a percentile (0-100) */
+static size_t
+histogram_percentile(const uint64_t *hist, size_t size, double percentile)
+{
+	uint64_t total = 0, count = 0, rank;
+
+	for (size_t i = 0; i < size; i++)
+		total += hist[i];
+	rank = (uint64_t)(percentile * total / 100.);
+	for (size_t i = 0; i < size; i++) {
+		count += hist[i];
+		if (count > rank)
+			return i;
+	}
+	return size - 1;
+}
+
+
+static void print_distribution(FILE *fout,
+			       const char *name,
+			       const uint64_t *hist,
+			       size_t size)
+{
+	uint64_t total = 0, sum = 0;
+	size_t min = size, max = 0;
+
+	for (size_t i = 0; i < size; i++) {
+		if (hist[i] == 0)
+			continue;
+		total += hist[i];
+		sum += hist[i] * i;
+		min = (i < min) ? i : min;
+		max = i;
+	}
+	if (total == 0) {
+		fprintf(fout, "%s: -\n", name);
+		return;
+	}
+	fprintf(fout,
+		"%s: min %zu, avg %.1f, max %zu, "
+		"p50 %zu, p90 %zu, p99 %zu\n",
+		name,
+		min,
+		(double)sum / total,
+		max,
+		histogram_percentile(hist, size, 50.),
+		histogram_percentile(hist, size, 90.),
+		histogram_percentile(hist, size, 99.));
+}
+
+
+static void print_percent(FILE *fout,
+			  const char *name,
+			  uint64_t val,
+			  uint64_t total,
+			  int first)
+{
+	fprintf(fout,
+		"%s%s %" PRIu64 " (%.1f%%)",
+		first ? " " : ", ",
+		name,
+		val,
+		total > 0 ? 100. * val / total : 0.);
+}
+
+
+static void print_summary(struct app *app)
+{
+	struct summary *summary = app->summary;
+	FILE *fout = app->fout;
+	const struct aac_bit_stats *bit_stats;
+	uint64_t total;
+	int first;
+
+	fprintf(fout, "frames: %" PRIu64 ", bytes: %" PRIu64, summary->frames,
+		summary->bytes);
+	if (summary->sample_rate > 0) {
+		fprintf(fout,
+			", duration: %.3f s, average bitrate: %.1f kbit/s",
+			(double)summary->duration / summary->sample_rate,
+			summary->duration > 0
+				? summary->bytes * 8. * summary->sample_rate /
+					  summary->duration / 1000.
+				: 0.);
+	}
+	fprintf(fout, "\n");
+	print_distribution(fout,
+			   "frame size (bytes)",
+			   summary->frame_sizes,
+			   SUMMARY_MAX_FRAME_SIZE + 1);
+	print_distribution(fout,
+			   "bitrate (kbit/s)",
+			   summary->bitrates,
+			   SUMMARY_MAX_BITRATE + 1);
+
+	/* END elements are not counted */
+	total = 0;
+	for (int i = 0; i < SUMMARY_ELEMENTS - 1; i++)
+		total += summary->element_bits[i];
+	fprintf(fout, "elements (count, bits):");
+	first = 1;
+	for (int i = 0; i < SUMMARY_ELEMENTS - 1; i++) {
+		if (summary->elements[i] == 0)
+			continue;
+		fprintf(fout,
+			"%s%s %" PRIu64 " / %" PRIu64 " (%.1f%%)",
+			first ? " " : ", ",
+			element_names[i],
+			summary->elements[i],
+			summary->element_bits[i],
+			total > 0 ? 100. * summary->element_bits[i] / total
+				  : 0.);
+		first = 0;
+	}
+	fprintf(fout, "\n");
+
+	fprintf(fout, "window sequences:");
+	for (int i = 0; i < SUMMARY_WINDOW_SEQUENCES; i++) {
+		print_percent(fout,
+			      window_sequence_names[i],
+			      summary->window_sequences[i],
+			      summary->ics_count,
+			      i == 0);
+	}
+	fprintf(fout, "\n");
+
+	fprintf(fout, "max_sfb:");
+	first = 1;
+	for (int i = 0; i < SUMMARY_MAX_SFB; i++) {
+		if (summary->max_sfb[i] == 0)
+			continue;
+		fprintf(fout,
+			"%s%d: %" PRIu64,
+			first ? " " : ", ",
+			i,
+			summary->max_sfb[i]);
+		first = 0;
+	}
+	fprintf(fout, "\n");
+
+	total = 0;
+	for (int i = 0; i < SUMMARY_CODEBOOKS; i++)
+		total += summary->codebooks[i];
+	fprintf(fout, "codebooks (bands):");
+	first = 1;
+	for (int i = 0; i < SUMMARY_CODEBOOKS; i++) {
+		char name[8];
+		if (summary->codebooks[i] == 0)
+			continue;
+		snprintf(name, sizeof(name), "%d:", i);
+		print_percent(fout, name, summary->codebooks[i], total, first);
+		first = 0;
+	}
+	fprintf(fout, "\n");
+
+	bit_stats = aac_ctx_get_bit_stats(aac_reader_get_ctx(app->reader));
+	if (bit_stats == NULL)
+		return;
+	total = 0;
+	for (int i = 0; i < AAC_BIT_STATS_ID_MAX; i++)
+		total += bit_stats->total[i];
+	fprintf(fout, "bits:");
+	for (int i = 0; i < AAC_BIT_STATS_ID_MAX; i++) {
+		print_percent(fout,
+			      aac_bit_stats_id_to_str(i),
+			      bit_stats->total[i],
+			      total,
+			      i == 0);
+	}
+	fprintf(fout, "\n");
+}
+
+
+static void columns_frame(struct app *app,
+			  struct aac_ctx *ctx,
+			  const uint8_t *buf,
+			  size_t len)
+{
+	int res;
+	uint64_t offset;
+
+	if (app->stream) {
+		offset = app->stream_off - app->stream_len +
+			 (buf - app->stream_buf);
+	} else {
+		offset = buf - (const uint8_t *)app->data;
+	}
+	res = aac_columns_add_frame(app->columns, ctx, offset, len);
+	if (res < 0)
+		ULOG_ERRNO("aac_columns_add_frame", -res);
+}
+
+
+/* The frame data is only known at the end of the frame */
+static void adts_frame_end_cb(struct aac_ctx *ctx,
+			      const uint8_t *buf,
+			      size_t len,
+			      const struct aac_adts *adts,
+			      void *userdata)
+{
+	int res = 0;
+	struct app *app = userdata;
+
+	if (app->columns != NULL) {
+		columns_frame(app, ctx, buf, adts->aac_frame_length);
+		return;
+	}
+
+	res = aac_dump_adts_frame(app->dump, ctx, DUMP_FLAGS);
+	if (res < 0)
+		ULOG_ERRNO("aac_dump_adts_frame", -res);
+
+	if (app->summary != NULL) {
+		summary_frame(app, ctx, adts->aac_frame_length);
+		return;
+	}
+
+	/* The streaming dump has already been written to the output file */
+	if (app->json_flags == 0)
+		return;
+
+	print_json(app);
+}
+
+
+static void loas_frame_end_cb(struct aac_ctx *ctx,
+			      const uint8_t *buf,
+			      size_t len,
+			      const struct aac_StreamMuxConfig *smc,
+			      void *userdata)
+{
+	int res = 0;
+	struct app *app = userdata;
+
+	if (app->columns != NULL) {
+		columns_frame(app, ctx, buf, len);
+		return;
+	}
+
+	res = aac_dump_loas_frame(app->dump, ctx, DUMP_FLAGS);
+	if (res < 0)
+		ULOG_ERRNO("aac_dump_loas_frame", -res);
+
+	if (app->summary != NULL) {
+		summary_frame(app, ctx, len);
+		return;
+	}
+
+	/* The streaming dump has already been written to the output file */
+	if (app->json_flags == 0)
+		return;
+
+	print_json(app);
+}
+
+
+static void raw_data_block_cb(struct aac_ctx *ctx,
+			      const uint8_t *buf,
+			      size_t len,
+			      const struct aac_raw_data_block *block,
+			      void *userdata)
+{
+	int res = 0;
+	struct app *app = userdata;
+
+	if (app->columns != NULL) {
+		columns_frame(app, ctx, buf, len);
+		return;
+	}
+
+	res = aac_dump_raw_data_block(app->dump, ctx, block);
+	if (res < 0)
+		ULOG_ERRNO("aac_dump_raw_data_block", -res);
+
+	if (app->summary != NULL) {
+		summary_frame(app, ctx, len);
+		return;
+	}
+
+	/* The streaming dump has already been written to the output file */
+	if (app->json_flags == 0)
+		return;
+
+	print_json(app);
+}
+
+
+/* Parse the AudioSpecificConfig of a raw input and dump it */
+static int set_asc(struct app *app, const uint8_t *buf, size_t len)
+{
+	int res;
+	struct aac_asc asc;
+
+	res = aac_parse_asc(buf, len, &asc);
+	if (res < 0) {
+		ULOG_ERRNO("aac_parse_asc", -res);
+		return res;
+	}
+	res = aac_ctx_set_asc(aac_reader_get_ctx(app->reader), &asc);
+	if (res < 0) {
+		ULOG_ERRNO("aac_ctx_set_asc", -res);
+		return res;
+	}
+
+	if (app->dump == NULL)
+		return 0;
+	res = aac_dump_asc(app->dump, &asc);
+	if (res < 0) {
+		ULOG_ERRNO("aac_dump_asc", -res);
+		return res;
+	}
+	if (app->json_flags != 0)
+		print_json(app);
+	return 0;
+}
+
+
+/* AudioSpecificConfig of a raw input given as a hexadecimal string */
+static int setup_raw(struct app *app)
+{
+	uint8_t buf[64];
+	size_t len = strlen(app->asc) / 2;
+	unsigned int byte;
+
+	if (strlen(app->asc) % 2 != 0 || len > sizeof(buf))
+		goto invalid;
+	for (size_t i = 0; i < len; i++) {
+		if (sscanf(&app->asc[2 * i], "%2x", &byte) != 1)
+			goto invalid;
+		buf[i] = byte;
+	}
+
+	return set_asc(app, buf, len);
+
+invalid:
+	fprintf(stderr, "Invalid AudioSpecificConfig: '%s'\n", app->asc);
+	return -EINVAL;
+}
+
+
+/* Parse a single access unit (or frame) */
+static int
+parse_unit(struct app *app, const uint8_t *buf, size_t size, unsigned int count)
+{
+	int res;
+	size_t off = 0;
+
+	res = aac_reader_parse(app->reader, app->reader_flags, buf, size, &off);
+	if (res < 0) {
+		ULOG_ERRNO("aac_reader_parse(access unit #%u)", -res, count);
+		return res;
+	}
+	if (off != size) {
+		ULOGW("access unit #%u: %zu bytes not parsed",
+		      count,
+		      size - off);
+	}
+	return 0;
+}
+
+
+/* Parse a raw input made of the access units of the sizes file (one size
+ * in bytes per line) */
+static int parse_raw_sizes(struct app *app)
+{
+	int res = 0;
+	FILE *file;
+	size_t pos = 0, size;
+	unsigned int count = 0;
+
+	file = fopen(app->sizes_path, "r");
+	if (file == NULL) {
+		res = -errno;
+		ULOG_ERRNO("fopen('%s')", -res, app->sizes_path);
+		return res;
+	}
+
+	while (fscanf(file, "%zu", &size) == 1) {
+		if (size > app->size - pos) {
+			res = -EPROTO;
+			ULOG_ERRNO("access unit #%u: %zu bytes, past the input",
+				   -res,
+				   count,
+				   size);
+			goto out;
+		}
+		res = parse_unit(app, (uint8_t *)app->data + pos, size, count);
+		if (res < 0)
+			goto out;
+		pos += size;
+		count++;
+	}
+	if (!feof(file)) {
+		res = -EPROTO;
+		ULOG_ERRNO("invalid sizes file '%s'", -res, app->sizes_path);
+		goto out;
+	}
+	if (pos != app->size) {
+		ULOGW("%zu bytes after the last access unit",
+		      app->size - pos);
+	}
+
+out:
+	fclose(file);
+	return res;
+}
+
+
+/* Parse a mapped ADTS or LOAS input one frame at a time, starting at the
+ * first frame found by aac_probe(); a frame that fails to parse is skipped
+ * and counted */
+static int parse_frames(struct app *app, size_t pos)
+{
+	int res;
+	const uint8_t *data = app->data;
+	size_t size, skipped = 0;
+	unsigned int count = 0, failed = 0;
+
+	while (pos < app->size) {
+		res = aac_frame_size(data + pos, app->size - pos, &size);
+		if (res == -EPROTO) {
+			/* Not synchronized, skip a byte */
+			pos++;
+			skipped++;
+			continue;
+		}
+		if (res < 0 || size > app->size - pos)
+			break;
+		if (skipped > 0) {
+			ULOGW("%zu bytes skipped before frame #%u",
+			      skipped,
+			      count);
+			skipped = 0;
+		}
+		res = parse_unit(app, data + pos, size, count);
+		if (res < 0)
+			failed++;
+		pos += size;
+		count++;
+	}
+
+	if (skipped + app->size - pos > 0) {
+		ULOGW("%zu bytes after the last frame",
+		      skipped + app->size - pos);
+	}
+	if (failed > 0) {
+		res = -EPROTO;
+		ULOG_ERRNO("%u of %u frames failed to parse",
+			   -res,
+			   failed,
+			   count);
+		return res;
+	}
+	return 0;
+}
+
+
+/* MP4 input: the raw access units are the samples of the first AAC audio
+ * track, the AudioSpecificConfig is in its sample description */
+static int is_mp4(struct app *app)
+{
+	return app->size >= 8 &&
+	       memcmp((const uint8_t *)app->data + 4, "ftyp", 4) == 0;
+}
+
+
+static int parse_mp4(struct app *app)
+{
+	int res;
+	const uint8_t *asc;
+	size_t asc_len;
+	struct aac_mp4 *mp4 = NULL;
+	struct aac_mp4_sample sample;
+
+	res = aac_mp4_new(app->data, app->size, &mp4);
+	if (res < 0) {
+		ULOG_ERRNO("aac_mp4_new", -res);
+		return res;
+	}
+	res = aac_mp4_get_asc(mp4, &asc, &asc_len);
+	if (res < 0) {
+		ULOG_ERRNO("aac_mp4_get_asc", -res);
+		goto out;
+	}
+	res = set_asc(app, asc, asc_len);
+	if (res < 0)
+		goto out;
+
+	while ((res = aac_mp4_next_sample(mp4, &sample)) == 0) {
+		res = parse_unit(app, sample.data, sample.size, sample.index);
+		if (res < 0)
+			goto out;
+	}
+	if (res == -ENOENT)
+		res = 0;
+
+out:
+	aac_mp4_destroy(mp4);
+	return res;
+}
+
+
+static int open_stream(struct app *app)
+{
+	int res;
+
+	app->stream_buf = malloc(STREAM_BUF_SIZE);
+	if (app->stream_buf == NULL) {
+		res = -ENOMEM;
+		ULOG_ERRNO("malloc", -res);
+		return res;
+	}
+
+	if (strcmp(app->inpath, "-") == 0) {
+		app->stream_fd = STDIN_FILENO;
+		return 0;
+	}
+	app->stream_fd = open(app->inpath, O_RDONLY);
+	if (app->stream_fd < 0) {
+		res = -errno;
+		ULOG_ERRNO("open('%s')", -res, app->inpath);
+		return res;
+	}
+
+#ifdef __linux__
+	if (!app->follow)
+		return 0;
+	app->inotify_fd = inotify_init1(IN_CLOEXEC);
+	if (app->inotify_fd < 0) {
+		ULOG_ERRNO("inotify_init1", errno);
+		return 0;
+	}
+	res = inotify_add_watch(app->inotify_fd,
+				app->inpath,
+				IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB);
+	if (res < 0) {
+		ULOG_ERRNO("inotify_add_watch('%s')", errno, app->inpath);
+		close(app->inotify_fd);
+		app->inotify_fd = -1;
+	}
+#endif
+
+	return 0;
+}
+
+
+static void close_stream(struct app *app)
+{
+	if (app->stream_fd > STDIN_FILENO)
+		close(app->stream_fd);
+	app->stream_fd = -1;
+	if (app->inotify_fd >= 0)
+		close(app->inotify_fd);
+	app->inotify_fd = -1;
+	free(app->stream_buf);
+	app->stream_buf = NULL;
+}
+
+
+/* Read the next chunk into the stream buffer; returns 0 at the end of the
+ * input, the number of bytes read otherwise */
+static ssize_t read_stream(struct app *app)
+{
+	ssize_t res;
+	int err;
+	uint8_t *buf = app->stream_buf + app->stream_len;
+	size_t len = STREAM_BUF_SIZE - app->stream_len;
+
+	if (len > STREAM_CHUNK_SIZE)
+		len = STREAM_CHUNK_SIZE;
+	do {
+		res = read(app->stream_fd, buf, len);
+	} while (res < 0 && errno == EINTR && !s_stopped);
+	if (res < 0 && errno == EINTR)
+		return 0;
+	if (res < 0) {
+		err = errno;
+		ULOG_ERRNO("read('%s')", err, app->inpath);
+		return -err;
+	}
+	app->stream_len += res;
+	app->stream_off += res;
+	return res;
+}
+
+
+/* Follow mode: wait for the input file to grow; returns -EPIPE if it has
+ * been truncated (eg. rewritten from the start) */
+static int wait_stream(struct app *app)
+{
+	struct stat st;
+#ifdef __linux__
+	int res;
+	char events[4096];
+	struct pollfd pfd = {
+		.fd = app->inotify_fd,
+		.events = POLLIN,
+	};
+
+	if (app->inotify_fd >= 0) {
+		res = poll(&pfd, 1, FOLLOW_POLL_MS);
+		/* The events only wake up, drain them */
+		if (res > 0 &&
+		    read(app->inotify_fd, events, sizeof(events)) < 0)
+			ULOG_ERRNO("read(inotify)", errno);
+	} else {
+		usleep(FOLLOW_POLL_MS * 1000);
+	}
+#else
+	usleep(FOLLOW_POLL_MS * 1000);
+#endif
+
+	if (fstat(app->stream_fd, &st) == 0 && S_ISREG(st.st_mode) &&
+	    (uint64_t)st.st_size < app->stream_off) {
+		ULOGW("'%s' truncated to %jd bytes after %" PRIu64 " bytes",
+		      app->inpath,
+		      (intmax_t)st.st_size,
+		      app->stream_off);
+		return -EPIPE;
+	}
+	return 0;
+}
+
+
+/* Parse the input stream one frame at a time (or one access unit of the
+ * sizes file at a time for raw streams) with a bounded memory usage; a
+ * frame that fails to parse is skipped and counted */
+static int parse_stream(struct app *app)
+{
+	int res = 0;
+	ssize_t size = 0, ret;
+	size_t pos = 0, skipped = 0, sz;
+	unsigned int count = 0, reported = 0, failed = 0;
+	int eos = 0;
+	FILE *sizes = NULL;
+
+	if (app->sizes_path != NULL) {
+		sizes = fopen(app->sizes_path, "r");
+		if (sizes == NULL) {
+			res = -errno;
+			ULOG_ERRNO("fopen('%s')", -res, app->sizes_path);
+			return res;
+		}
+	} else if (app->asc != NULL) {
+		/* The length of a raw_data_block is only known once parsed */
+		res = -ENOSYS;
+		ULOG_ERRNO("raw streaming input requires a sizes file", -res);
+		return res;
+	}
+
+	while (1) {
+		/* Size of the next unit */
+		if (sizes == NULL) {
+			res = aac_frame_size(app->stream_buf + pos,
+					     app->stream_len - pos,
+					     &sz);
+			if (res == -EPROTO) {
+				/* Not synchronized, skip a byte */
+				pos++;
+				skipped++;
+				continue;
+			}
+			size = (res == 0) ? (ssize_t)sz : 0;
+			res = 0;
+		} else if (size == 0) {
+			if (fscanf(sizes, "%zu", &sz) != 1)
+				break;
+			if (sz > STREAM_BUF_SIZE) {
+				res = -E2BIG;
+				ULOG_ERRNO("access unit #%u: %zu bytes",
+					   -res,
+					   count,
+					   sz);
+				goto out;
+			}
+			size = sz;
+		}
+
+		if (size > 0 && (size_t)size <= app->stream_len - pos) {
+			if (skipped > 0) {
+				ULOGW("%zu bytes skipped before frame #%u",
+				      skipped,
+				      count);
+				skipped = 0;
+			}
+			res = parse_unit(
+				app, app->stream_buf + pos, size, count);
+			if (res < 0)
+				failed++;
+			res = 0;
+			pos += size;
+			size = 0;
+			count++;
+			continue;
+		}
+
+		/* More data is needed */
+		if (eos && (!app->follow || s_stopped))
+			break;
+		if (eos) {
+			/* Follow mode: report and wait for the file to grow;
+			 * an incomplete last frame stays in the buffer */
+			if (app->summary != NULL && count > reported) {
+				print_summary(app);
+				fprintf(app->fout, "\n");
+				reported = count;
+			}
+			fflush(app->fout);
+			res = wait_stream(app);
+			if (res < 0)
+				goto out;
+			if (s_stopped)
+				break;
+		}
+		memmove(app->stream_buf,
+			app->stream_buf + pos,
+			app->stream_len - pos);
+		app->stream_len -= pos;
+		pos = 0;
+		ret = read_stream(app);
+		if (ret < 0) {
+			res = ret;
+			goto out;
+		}
+		eos = (ret == 0);
+	}
+
+	if (sizes != NULL && size > 0) {
+		res = -EPROTO;
+		ULOG_ERRNO("access unit #%u: %zd bytes, past the input",
+			   -res,
+			   count,
+			   size);
+		goto out;
+	}
+	if (sizes != NULL && !feof(sizes)) {
+		res = -EPROTO;
+		ULOG_ERRNO("invalid sizes file '%s'", -res, app->sizes_path);
+		goto out;
+	}
+	if (skipped + app->stream_len - pos > 0) {
+		ULOGW("%zu bytes after the last access unit",
+		      skipped + app->stream_len - pos);
+	}
+	if (failed > 0) {
+		res = -EPROTO;
+		ULOG_ERRNO("%u of %u frames failed to parse",
+			   -res,
+			   failed,
+			   count);
+	}
+
+out:
+	if (sizes != NULL)
+		fclose(sizes);
+	return res;
+}
+
+
+static int convert_cbor(struct app *app)
+{
+	int res;
+	size_t off = 0;
+
+	while (off < app->size) {
+		res = aac_dump_from_cbor(app->dump, app->data, app->size, &off);
+		if (res < 0) {
+			ULOG_ERRNO("aac_dump_from_cbor(offset %zu)", -res, off);
+			return res;
+		}
+		if (app->json_flags != 0)
+			print_json(app);
+	}
+	return 0;
+}
+
+
 static const struct aac_ctx_cbs cbs = {
-	.adts_frame_begin = &adts_frame_begin_cb,
+	.adts_frame_end = &adts_frame_end_cb,
+	.loas_frame_end = &loas_frame_end_cb,
+	.raw_data_block = &raw_data_block_cb,
 };
 
 
 enum args_id {
 	ARGS_ID_JSON_PRETTY = 256,
+	ARGS_ID_CBOR,
+	ARGS_ID_FROM_CBOR,
+	ARGS_ID_INCLUDE,
+	ARGS_ID_EXCLUDE,
+	ARGS_ID_ASC,
+	ARGS_ID_SIZES,
+	ARGS_ID_SUMMARY,
+	ARGS_ID_STREAM,
+	ARGS_ID_COLUMNS,
 };
 
 
-static const char short_options[] = "ho:";
+static const char short_options[] = "hfo:";
 
 
 static const struct option long_options[] = {
 	{"help", no_argument, NULL, 'h'},
 	{"output", required_argument, NULL, 'o'},
+	{"follow", no_argument, NULL, 'f'},
 	{"pretty", no_argument, NULL, ARGS_ID_JSON_PRETTY},
+	{"cbor", no_argument, NULL, ARGS_ID_CBOR},
+	{"from-cbor", no_argument, NULL, ARGS_ID_FROM_CBOR},
+	{"include", required_argument, NULL, ARGS_ID_INCLUDE},
+	{"exclude", required_argument, NULL, ARGS_ID_EXCLUDE},
+	{"asc", required_argument, NULL, ARGS_ID_ASC},
+	{"sizes", required_argument, NULL, ARGS_ID_SIZES},
+	{"summary", no_argument, NULL, ARGS_ID_SUMMARY},
+	{"stream", no_argument, NULL, ARGS_ID_STREAM},
+	{"columns", no_argument, NULL, ARGS_ID_COLUMNS},
 	{0, 0, 0, 0},
 };
 
 
 static void welcome(char *prog_name)
 {
-	printf("\n%s - Parrot AAC bitstream dump tool\n"
-	       "Copyright (c) 2023 Parrot Drones SAS\n\n",
-	       prog_name);
+	/* stdout can be the (binary) output */
+	fprintf(stderr,
+		"\n%s - Parrot AAC bitstream dump tool\n"
+		"Copyright (c) 2023 Parrot Drones SAS\n\n",
+		prog_name);
 }
 
 
 static void usage(char *prog_name)
 {
 	printf("Usage: %s [options] <input file>\n"
+	       "\n"
+	       "The input file can be '-' for stdin; stdin, FIFOs and other "
+	       "non-regular\n"
+	       "files are read in chunks with a bounded memory usage.\n"
+	       "MP4 files are read with the sample tables of their first AAC "
+	       "audio track\n"
+	       "(not in streaming mode).\n"
 	       "\n"
 	       "Options:\n"
 	       "-h | --help                        Print this message\n"
 	       "-o | --output <file>               Output file\n"
+	       "-f | --follow                      Keep reading the input "
+	       "file while it is\n"
+	       "                                   being written, until "
+	       "interrupted\n"
+	       "                                   (ADTS and LOAS, implies "
+	       "--stream)\n"
 	       "     --pretty                      Pretty output for "
 	       "JSON file\n"
+	       "     --cbor                        Binary output (CBOR) "
+	       "instead of JSON\n"
+	       "     --from-cbor                   The input file is a CBOR "
+	       "dump to convert\n"
+	       "                                   to JSON\n"
+	       "     --include <path>              Only dump the fields of "
+	       "the path (e.g.\n"
+	       "                                   'aac_adts.*'), can be "
+	       "repeated\n"
+	       "     --exclude <path>              Do not dump the fields of "
+	       "the path, can\n"
+	       "                                   be repeated\n"
+	       "     --asc <hex>                   The input file is a raw "
+	       "stream with the\n"
+	       "                                   given AudioSpecificConfig "
+	       "(hexadecimal)\n"
+	       "     --sizes <file>                Raw stream access unit "
+	       "sizes in bytes,\n"
+	       "                                   one per line (default: "
+	       "consecutive\n"
+	       "                                   raw_data_blocks)\n"
+	       "     --summary                     Print whole file "
+	       "statistics instead of\n"
+	       "                                   the frame dumps\n"
+	       "     --stream                      Read a regular input file "
+	       "in chunks\n"
+	       "                                   instead of mapping it\n"
+	       "     --columns                     Binary output of per-frame "
+	       "metrics in\n"
+	       "                                   fixed-width columns "
+	       "(see aac_columns.h)\n"
+	       "                                   instead of the frame "
+	       "dumps\n"
 	       "\n",
 	       prog_name);
 }
@@ -262,10 +1325,13 @@ static void usage(char *prog_name)
 
 int main(int argc, char *argv[])
 {
-	int res = 0;
+	int res = 0, err;
 	int idx, c;
+	int summary = 0, columns = 0;
 	size_t off = 0;
+	struct stat st;
 	struct aac_dump_cfg dump_cfg;
+	struct aac_probe_result probe;
 	struct app app;
 
 	memset(&app, 0, sizeof(app));
@@ -275,6 +1341,8 @@ int main(int argc, char *argv[])
 #else
 	app.fd = -1;
 #endif
+	app.stream_fd = -1;
+	app.inotify_fd = -1;
 
 	welcome(argv[0]);
 
@@ -299,6 +1367,11 @@ int main(int argc, char *argv[])
 			app.outpath = optarg;
 			break;
 
+		case 'f':
+			app.follow = 1;
+			app.stream = 1;
+			break;
+
 		case ARGS_ID_JSON_PRETTY:
 #ifdef JSON_C_TO_STRING_PRETTY
 			app.json_flags = JSON_C_TO_STRING_PRETTY;
@@ -310,13 +1383,66 @@ int main(int argc, char *argv[])
 #endif
 			break;
 
+		case ARGS_ID_CBOR:
+			app.cbor = 1;
+			break;
+
+		case ARGS_ID_FROM_CBOR:
+			app.from_cbor = 1;
+			break;
+
+		case ARGS_ID_INCLUDE:
+			if (app.include_count >= AAC_DUMP_MAX_FILTER_PATHS) {
+				fprintf(stderr, "Too many include paths\n");
+				exit(EXIT_FAILURE);
+			}
+			app.include[app.include_count++] = optarg;
+			break;
+
+		case ARGS_ID_EXCLUDE:
+			if (app.exclude_count >= AAC_DUMP_MAX_FILTER_PATHS) {
+				fprintf(stderr, "Too many exclude paths\n");
+				exit(EXIT_FAILURE);
+			}
+			app.exclude[app.exclude_count++] = optarg;
+			break;
+
+		case ARGS_ID_ASC:
+			app.asc = optarg;
+			break;
+
+		case ARGS_ID_SIZES:
+			app.sizes_path = optarg;
+			break;
+
+		case ARGS_ID_SUMMARY:
+			summary = 1;
+			break;
+
+		case ARGS_ID_STREAM:
+			app.stream = 1;
+			break;
+
+		case ARGS_ID_COLUMNS:
+			columns = 1;
+			break;
+
 		default:
 			usage(argv[0]);
 			exit(EXIT_FAILURE);
 			break;
 		}
 	}
-	if (argc - optind < 1) {
+	if (argc - optind < 1 ||
+	    (app.cbor && (app.json_flags != 0 || app.from_cbor)) ||
+	    (app.asc != NULL && app.from_cbor) ||
+	    (app.sizes_path != NULL && app.asc == NULL) ||
+	    (app.follow && app.asc != NULL) ||
+	    (summary && (app.cbor || app.json_flags != 0 || app.from_cbor ||
+			 app.include_count > 0 || app.exclude_count > 0)) ||
+	    (columns && (summary || app.cbor || app.json_flags != 0 ||
+			 app.from_cbor || app.include_count > 0 ||
+			 app.exclude_count > 0))) {
 		usage(argv[0]);
 		exit(EXIT_FAILURE);
 	}
@@ -327,8 +1453,41 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
-	/* Map the input file */
-	res = map_file(&app);
+	app.reader_flags = READER_FLAGS;
+	if (summary) {
+		app.summary = calloc(1, sizeof(*app.summary));
+		if (app.summary == NULL) {
+			res = -ENOMEM;
+			ULOG_ERRNO("calloc", -res);
+			goto out;
+		}
+		app.reader_flags = SUMMARY_READER_FLAGS;
+	}
+
+	if (strcmp(app.inpath, "-") == 0 ||
+	    (stat(app.inpath, &st) == 0 && !S_ISREG(st.st_mode)))
+		app.stream = 1;
+	if (app.stream && app.from_cbor) {
+		fprintf(stderr, "CBOR conversion needs a regular file\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (app.follow) {
+#ifdef _WIN32
+		signal(SIGINT, &sighandler);
+		signal(SIGTERM, &sighandler);
+#else
+		/* No SA_RESTART: a blocking read is interrupted */
+		struct sigaction sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = &sighandler;
+		sigaction(SIGINT, &sa, NULL);
+		sigaction(SIGTERM, &sa, NULL);
+#endif
+	}
+
+	/* Open the input stream or map the input file */
+	res = app.stream ? open_stream(&app) : map_file(&app);
 	if (res < 0)
 		goto out;
 
@@ -339,18 +1498,10 @@ int main(int argc, char *argv[])
 		goto out;
 	}
 
-	/* Create json dump object */
-	memset(&dump_cfg, 0, sizeof(dump_cfg));
-	dump_cfg.type = AAC_DUMP_TYPE_JSON;
-	res = aac_dump_new(&dump_cfg, &app.dump);
-	if (res < 0) {
-		ULOG_ERRNO("aac_dump_new", -res);
-		goto out;
-	}
-
 	/* Create output file */
 	if (app.outpath != NULL) {
-		app.fout = fopen(app.outpath, "w");
+		app.fout = fopen(app.outpath,
+				 (app.cbor || columns) ? "wb" : "w");
 		if (app.fout == NULL) {
 			res = -errno;
 			ULOG_ERRNO("fopen('%s')", -res, app.outpath);
@@ -361,29 +1512,104 @@ int main(int argc, char *argv[])
 		app.fout = stdout;
 	}
 
-	/* Parse stream */
-	res = aac_reader_parse(
-		app.reader, READER_FLAGS, app.data, app.size, &off);
+	if (columns) {
+		res = aac_columns_new(app.fout, &app.columns);
+		if (res < 0) {
+			ULOG_ERRNO("aac_columns_new", -res);
+			goto out;
+		}
+		goto parse;
+	}
+
+	/* Create json dump object; the pretty output needs the json-c object
+	 * tree, otherwise the JSON text is streamed to the output file */
+	memset(&dump_cfg, 0, sizeof(dump_cfg));
+	if (app.summary != NULL) {
+		/* Only the fields of the statistics are visited */
+		dump_cfg.type = AAC_DUMP_TYPE_VISITOR;
+		dump_cfg.visitor = &summary_visitor;
+		dump_cfg.userdata = app.summary;
+		dump_cfg.include_paths = summary_paths;
+		dump_cfg.include_count = ARRAY_SIZE(summary_paths);
+	} else if (app.json_flags != 0) {
+		dump_cfg.type = AAC_DUMP_TYPE_JSON;
+	} else {
+		dump_cfg.type = app.cbor ? AAC_DUMP_TYPE_CBOR
+					 : AAC_DUMP_TYPE_JSON_STREAM;
+		dump_cfg.file = app.fout;
+	}
+	if (app.summary == NULL) {
+		dump_cfg.include_paths = app.include;
+		dump_cfg.include_count = app.include_count;
+		dump_cfg.exclude_paths = app.exclude;
+		dump_cfg.exclude_count = app.exclude_count;
+	}
+	res = aac_dump_new(&dump_cfg, &app.dump);
 	if (res < 0) {
-		ULOG_ERRNO("aac_reader_parse", -res);
+		ULOG_ERRNO("aac_dump_new", -res);
 		goto out;
 	}
 
+	if (app.from_cbor) {
+		res = convert_cbor(&app);
+		goto out;
+	}
+
+parse:
+	if (app.asc != NULL) {
+		res = setup_raw(&app);
+		if (res < 0)
+			goto out;
+	}
+	if (!app.stream && app.asc == NULL && is_mp4(&app)) {
+		res = parse_mp4(&app);
+	} else if (app.stream) {
+		res = parse_stream(&app);
+	} else if (app.sizes_path != NULL) {
+		res = parse_raw_sizes(&app);
+	} else if (app.asc == NULL &&
+		   aac_probe(app.data, app.size, &probe) == 0 &&
+		   (probe.data_format == ADEF_AAC_DATA_FORMAT_ADTS ||
+		    probe.transport == AAC_TRANSPORT_LOAS)) {
+		res = parse_frames(&app, probe.offset);
+	} else {
+		/* Parse stream */
+		res = aac_reader_parse(
+			app.reader, app.reader_flags, app.data, app.size, &off);
+		if (res < 0)
+			ULOG_ERRNO("aac_reader_parse", -res);
+	}
+
+	/* The summary of a damaged input covers what could be parsed, the
+	 * error is reported by the exit status */
+	if (app.summary != NULL)
+		print_summary(&app);
+
 out:
-	/* Cleanup */
+	/* Cleanup; the first error is kept for the exit status */
 	if (app.reader != NULL) {
-		res = aac_reader_destroy(app.reader);
-		if (res < 0)
-			ULOG_ERRNO("aac_reader_destroy", -res);
+		err = aac_reader_destroy(app.reader);
+		if (err < 0)
+			ULOG_ERRNO("aac_reader_destroy", -err);
+		res = (res < 0) ? res : err;
+	}
+	if (app.columns != NULL) {
+		err = aac_columns_destroy(app.columns);
+		if (err < 0)
+			ULOG_ERRNO("aac_columns_destroy", -err);
+		res = (res < 0) ? res : err;
 	}
 	if (app.dump != NULL) {
-		res = aac_dump_destroy(app.dump);
-		if (res < 0)
-			ULOG_ERRNO("aac_dump_destroy", -res);
+		err = aac_dump_destroy(app.dump);
+		if (err < 0)
+			ULOG_ERRNO("aac_dump_destroy", -err);
+		res = (res < 0) ? res : err;
 	}
 	if (app.fout != NULL && app.fout != stderr)
 		fclose(app.fout);
 	unmap_file(&app);
+	close_stream(&app);
+	free(app.summary);
 
 	return res >= 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,327 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ULOG_TAG aac_gen
+#include <ulog.h>
+ULOG_DECLARE_TAG(aac_gen);
+
+#include <aac/aac.h>
+
+
+#define DEFAULT_FRAMES 100
+#define DEFAULT_SEED 1
+#define DEFAULT_SAMPLING_FREQUENCY_INDEX 3 /* 48000 Hz */
+
+
+static const char *const sections_names[] = {
+	[AAC_GEN_SECTIONS_RANDOM] = "random",
+	[AAC_GEN_SECTIONS_SINGLE] = "single",
+	[AAC_GEN_SECTIONS_PER_BAND] = "per-band",
+	[AAC_GEN_SECTIONS_ZERO] = "zero",
+};
+
+
+enum long_option {
+	OPT_SCE = 256,
+	OPT_CPE,
+	OPT_CCE,
+	OPT_DSE,
+	OPT_PCE,
+	OPT_FIL,
+};
+
+
+static const char short_options[] = "hn:s:rf:S:wtpxm";
+
+
+static const struct option long_options[] = {
+	{"help", no_argument, NULL, 'h'},
+	{"frames", required_argument, NULL, 'n'},
+	{"seed", required_argument, NULL, 's'},
+	{"raw", no_argument, NULL, 'r'},
+	{"frequency-index", required_argument, NULL, 'f'},
+	{"sections", required_argument, NULL, 'S'},
+	{"windows", no_argument, NULL, 'w'},
+	{"tns", no_argument, NULL, 't'},
+	{"pulse", no_argument, NULL, 'p'},
+	{"escapes", no_argument, NULL, 'x'},
+	{"ms", no_argument, NULL, 'm'},
+	{"sce", required_argument, NULL, OPT_SCE},
+	{"cpe", required_argument, NULL, OPT_CPE},
+	{"cce", required_argument, NULL, OPT_CCE},
+	{"dse", required_argument, NULL, OPT_DSE},
+	{"pce", required_argument, NULL, OPT_PCE},
+	{"fil", required_argument, NULL, OPT_FIL},
+	{0, 0, 0, 0},
+};
+
+
+static void welcome(char *prog_name)
+{
+	printf("\n%s - Parrot AAC synthetic stream generator\n"
+	       "Copyright (c) 2023 Parrot Drones SAS\n\n",
+	       prog_name);
+}
+
+
+static void usage(char *prog_name)
+{
+	printf("Usage: %s [options] <output file>\n"
+	       "\n"
+	       "Options:\n"
+	       "-h | --help                        Print this message\n"
+	       "-n | --frames <n>                  Number of frames "
+	       "(default: %d)\n"
+	       "-s | --seed <n>                    Pseudo-random generator "
+	       "seed (default: %d)\n"
+	       "-r | --raw                         Write raw data blocks "
+	       "instead of ADTS\n"
+	       "                                   frames (the "
+	       "AudioSpecificConfig is printed)\n"
+	       "-f | --frequency-index <n>         Sampling frequency index "
+	       "(default: %d)\n"
+	       "-S | --sections <layout>           Section layout: random, "
+	       "single, per-band\n"
+	       "                                   or zero "
+	       "(default: random)\n"
+	       "-w | --windows                     Switch window sequences\n"
+	       "-t | --tns                         Add TNS data\n"
+	       "-p | --pulse                       Add pulse data\n"
+	       "-x | --escapes                     Escape-heavy spectra\n"
+	       "-m | --ms                          M/S stereo in the CPEs\n"
+	       "     --sce <n>                     Number of SCE per frame\n"
+	       "     --cpe <n>                     Number of CPE per frame "
+	       "(default: 1 if\n"
+	       "                                   no SCE)\n"
+	       "     --cce <n>                     Number of CCE per frame\n"
+	       "     --dse <n>                     Number of DSE per frame\n"
+	       "     --pce <n>                     Number of PCE per frame\n"
+	       "     --fil <n>                     Number of FIL per frame\n"
+	       "\n",
+	       prog_name,
+	       DEFAULT_FRAMES,
+	       DEFAULT_SEED,
+	       DEFAULT_SAMPLING_FREQUENCY_INDEX);
+}
+
+
+static int print_asc(struct aac_gen *gen)
+{
+	int res;
+	struct aac_asc asc;
+	uint8_t *buf = NULL;
+	size_t len = 0;
+
+	res = aac_gen_get_asc(gen, &asc);
+	if (res < 0) {
+		ULOG_ERRNO("aac_gen_get_asc", -res);
+		return res;
+	}
+	res = aac_write_asc(&asc, &buf, &len);
+	if (res < 0) {
+		ULOG_ERRNO("aac_write_asc", -res);
+		return res;
+	}
+	printf("AudioSpecificConfig: ");
+	for (size_t i = 0; i < len; i++)
+		printf("%02x", buf[i]);
+	printf("\n");
+	free(buf);
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int res = 0;
+	int idx, c;
+	unsigned int frames = DEFAULT_FRAMES;
+	const char *path;
+	FILE *file = NULL;
+	struct aac_gen *gen = NULL;
+	struct aac_bitstream bs;
+	struct aac_gen_cfg cfg;
+	size_t total = 0;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.seed = DEFAULT_SEED;
+	cfg.data_format = ADEF_AAC_DATA_FORMAT_ADTS;
+	cfg.sampling_frequency_index = DEFAULT_SAMPLING_FREQUENCY_INDEX;
+
+	welcome(argv[0]);
+
+	if (argc < 2) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	/* Command-line parameters */
+	while ((c = getopt_long(
+			argc, argv, short_options, long_options, &idx)) != -1) {
+		switch (c) {
+		case 0:
+			break;
+
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+			break;
+
+		case 'n':
+			frames = atoi(optarg);
+			break;
+
+		case 's':
+			cfg.seed = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'r':
+			cfg.data_format = ADEF_AAC_DATA_FORMAT_RAW;
+			break;
+
+		case 'f':
+			cfg.sampling_frequency_index = atoi(optarg);
+			break;
+
+		case 'S':
+			for (c = 0; c <= AAC_GEN_SECTIONS_ZERO; c++) {
+				if (strcmp(optarg, sections_names[c]) == 0)
+					break;
+			}
+			if (c > AAC_GEN_SECTIONS_ZERO) {
+				fprintf(stderr,
+					"Unknown section layout '%s'\n",
+					optarg);
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			cfg.sections = c;
+			break;
+
+		case 'w':
+			cfg.flags |= AAC_GEN_FLAGS_WINDOWS;
+			break;
+
+		case 't':
+			cfg.flags |= AAC_GEN_FLAGS_TNS;
+			break;
+
+		case 'p':
+			cfg.flags |= AAC_GEN_FLAGS_PULSE;
+			break;
+
+		case 'x':
+			cfg.flags |= AAC_GEN_FLAGS_ESCAPES;
+			break;
+
+		case 'm':
+			cfg.flags |= AAC_GEN_FLAGS_MS;
+			break;
+
+		case OPT_SCE:
+			cfg.sce_count = atoi(optarg);
+			break;
+
+		case OPT_CPE:
+			cfg.cpe_count = atoi(optarg);
+			break;
+
+		case OPT_CCE:
+			cfg.cce_count = atoi(optarg);
+			break;
+
+		case OPT_DSE:
+			cfg.dse_count = atoi(optarg);
+			break;
+
+		case OPT_PCE:
+			cfg.pce_count = atoi(optarg);
+			break;
+
+		case OPT_FIL:
+			cfg.fil_count = atoi(optarg);
+			break;
+
+		default:
+			usage(argv[0]);
+			exit(EXIT_FAILURE);
+			break;
+		}
+	}
+	if (argc - optind < 1) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	path = argv[optind];
+	if (cfg.sce_count == 0 && cfg.cpe_count == 0)
+		cfg.cpe_count = 1;
+
+	res = aac_gen_new(&cfg, &gen);
+	if (res < 0) {
+		ULOG_ERRNO("aac_gen_new", -res);
+		goto out;
+	}
+	if (cfg.data_format == ADEF_AAC_DATA_FORMAT_RAW) {
+		res = print_asc(gen);
+		if (res < 0)
+			goto out;
+	}
+
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		res = -errno;
+		ULOG_ERRNO("fopen('%s')", -res, path);
+		goto out;
+	}
+
+	for (unsigned int i = 0; i < frames; i++) {
+		aac_bs_init(&bs, NULL, 0);
+		res = aac_gen_write_frame(gen, &bs);
+		if (res == 0 && fwrite(bs.data, bs.off, 1, file) != 1) {
+			res = -EIO;
+			ULOG_ERRNO("fwrite", -res);
+		}
+		total += bs.off;
+		aac_bs_clear(&bs);
+		if (res < 0)
+			goto out;
+	}
+
+	printf("%u frames, %zu bytes written to '%s'\n", frames, total, path);
+
+out:
+	if (file != NULL)
+		fclose(file);
+	aac_gen_destroy(gen);
+	exit((res == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
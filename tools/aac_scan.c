@@ -0,0 +1,780 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define ULOG_TAG aac_scan
+#include <ulog.h>
+ULOG_DECLARE_TAG(aac_scan);
+
+#include <aac/aac.h>
+
+
+#define DEFAULT_JOBS 4
+#define MAX_JOBS 256
+#define MAX_EXTENSIONS 16
+
+/* Per job input buffer: frames are parsed from a bounded buffer whatever
+ * the file size (an ADTS frame is at most 8191 bytes, a LOAS frame 8194
+ * bytes); the first read also holds the probed data */
+#define SCAN_BUF_SIZE 65536
+
+
+enum output_format {
+	OUTPUT_FORMAT_CSV = 0,
+	OUTPUT_FORMAT_JSONL,
+};
+
+
+struct scan_result {
+	char *path;
+	/* 0 on success, negative errno value if the file could not be
+	 * scanned (the other fields are then partial) */
+	int status;
+	int done;
+	struct aac_probe_result probe;
+	enum aac_audioObjectType aot;
+	uint32_t sample_rate;
+	uint32_t channel_configuration;
+	uint64_t size;
+	uint64_t frames;
+	/* Duration in samples at sample_rate */
+	uint64_t duration;
+	uint64_t frame_bytes;
+	/* Per-frame bitrates in bit/s */
+	uint64_t bitrate_min;
+	uint64_t bitrate_max;
+	/* Parsing errors, from the reader statistics */
+	uint64_t errors;
+	/* Losses of synchronization and the bytes skipped to find the next
+	 * frame header */
+	uint64_t resyncs;
+	uint64_t bytes_skipped;
+};
+
+
+struct app {
+	struct scan_result *results;
+	unsigned int count;
+	unsigned int capacity;
+	const char *extensions[MAX_EXTENSIONS];
+	unsigned int extension_count;
+	enum output_format format;
+	FILE *fout;
+	int failed;
+	/* Shared between the jobs, protected by the mutex: next file to
+	 * scan and next result to print (results are printed in the order
+	 * of the inputs) */
+	pthread_mutex_t mutex;
+	unsigned int next_scan;
+	unsigned int next_print;
+};
+
+
+static const char *format_to_str(const struct aac_probe_result *probe)
+{
+	switch (probe->data_format) {
+	case ADEF_AAC_DATA_FORMAT_ADTS:
+		return "adts";
+	case ADEF_AAC_DATA_FORMAT_RAW:
+		switch (probe->transport) {
+		case AAC_TRANSPORT_LOAS:
+			return "loas";
+		case AAC_TRANSPORT_ADIF:
+			return "adif";
+		default:
+			return "raw";
+		}
+	default:
+		return "unknown";
+	}
+}
+
+
+static int has_extension(struct app *app, const char *path)
+{
+	const char *ext = strrchr(path, '.');
+
+	if (app->extension_count == 0)
+		return 1;
+	if (ext == NULL || strchr(ext, '/') != NULL)
+		return 0;
+	for (unsigned int i = 0; i < app->extension_count; i++) {
+		if (strcasecmp(ext + 1, app->extensions[i]) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+
+static int add_file(struct app *app, const char *path)
+{
+	struct scan_result *results;
+	unsigned int capacity;
+
+	if (app->count == app->capacity) {
+		capacity = app->capacity > 0 ? 2 * app->capacity : 64;
+		results = realloc(app->results, capacity * sizeof(*results));
+		if (results == NULL)
+			return -ENOMEM;
+		app->results = results;
+		app->capacity = capacity;
+	}
+	memset(&app->results[app->count], 0, sizeof(*app->results));
+	app->results[app->count].path = strdup(path);
+	if (app->results[app->count].path == NULL)
+		return -ENOMEM;
+	app->count++;
+	return 0;
+}
+
+
+static int compare_results(const void *a, const void *b)
+{
+	const struct scan_result *ra = a;
+	const struct scan_result *rb = b;
+
+	return strcmp(ra->path, rb->path);
+}
+
+
+/* Add a file, or the files of a directory tree with the selected
+ * extensions (sorted by path in each directory) */
+static int add_path(struct app *app, const char *path, int explicit)
+{
+	int res = 0;
+	struct stat st;
+	DIR *dir;
+	struct dirent *entry;
+	char *child;
+	unsigned int first = app->count;
+
+	/* Symbolic links are followed for the paths given on the command
+	 * line and for files, not for the directories of a tree (they
+	 * could make a loop) */
+	if ((explicit ? stat(path, &st) : lstat(path, &st)) < 0) {
+		res = -errno;
+		ULOG_ERRNO("stat('%s')", -res, path);
+		/* Reported as a failed file */
+		return explicit ? add_file(app, path) : 0;
+	}
+	if (S_ISLNK(st.st_mode) &&
+	    (stat(path, &st) < 0 || S_ISDIR(st.st_mode)))
+		return 0;
+	if (!S_ISDIR(st.st_mode)) {
+		if (explicit ||
+		    (S_ISREG(st.st_mode) && has_extension(app, path)))
+			res = add_file(app, path);
+		return res;
+	}
+
+	dir = opendir(path);
+	if (dir == NULL) {
+		res = -errno;
+		ULOG_ERRNO("opendir('%s')", -res, path);
+		return 0;
+	}
+	while ((entry = readdir(dir)) != NULL) {
+		if (strcmp(entry->d_name, ".") == 0 ||
+		    strcmp(entry->d_name, "..") == 0)
+			continue;
+		res = asprintf(&child, "%s/%s", path, entry->d_name);
+		if (res < 0) {
+			res = -ENOMEM;
+			break;
+		}
+		res = add_path(app, child, 0);
+		free(child);
+		if (res < 0)
+			break;
+	}
+	closedir(dir);
+	if (res == 0 && app->count > first) {
+		qsort(&app->results[first],
+		      app->count - first,
+		      sizeof(*app->results),
+		      &compare_results);
+	}
+	return res;
+}
+
+
+/* Fill the buffer from the file; returns 0 at the end of the file */
+static ssize_t read_buf(int fd, uint8_t *buf, size_t *len, size_t *pos)
+{
+	ssize_t res;
+
+	memmove(buf, buf + *pos, *len - *pos);
+	*len -= *pos;
+	*pos = 0;
+	do {
+		res = read(fd, buf + *len, SCAN_BUF_SIZE - *len);
+	} while (res < 0 && errno == EINTR);
+	if (res < 0)
+		return -errno;
+	*len += res;
+	return res;
+}
+
+
+/* Parse a frame and update the bitrate statistics */
+static void scan_frame(struct aac_reader *reader,
+		       struct scan_result *result,
+		       const uint8_t *buf,
+		       size_t size)
+{
+	int res;
+	size_t off = 0;
+	uint64_t bitrate;
+	struct aac_timing timing;
+
+	res = aac_reader_parse(
+		reader, AAC_READER_FLAGS_FRAME_DATA, buf, size, &off);
+	if (res < 0)
+		return;
+	res = aac_ctx_get_timing(aac_reader_get_ctx(reader), &timing);
+	if (res < 0 || timing.frame_duration == 0)
+		return;
+
+	result->sample_rate = timing.sample_rate;
+	result->duration += timing.frame_duration;
+	result->frame_bytes += size;
+	bitrate = (uint64_t)size * 8 * timing.sample_rate /
+		  timing.frame_duration;
+	if (result->frames == 0 || bitrate < result->bitrate_min)
+		result->bitrate_min = bitrate;
+	if (bitrate > result->bitrate_max)
+		result->bitrate_max = bitrate;
+	result->frames++;
+}
+
+
+/* Check that a frame header found after invalid data is followed by
+ * another one, or by the end of the file; returns 0 if it is, -EPROTO if
+ * it is not, -EAGAIN if more data is needed */
+static int check_resync(const uint8_t *buf, size_t len, size_t size, int eof)
+{
+	int res;
+	size_t next;
+
+	if (size == len && eof)
+		return 0;
+	res = aac_frame_size(buf + size, len - size, &next);
+	if (res == -EAGAIN && eof)
+		return -EPROTO;
+	return res;
+}
+
+
+/* Scan the ADTS or LOAS frames of a file, resynchronizing on the next
+ * frame header after invalid data */
+static int scan_frames(struct aac_reader *reader,
+		       struct scan_result *result,
+		       int fd,
+		       uint8_t *buf,
+		       size_t len,
+		       size_t pos)
+{
+	int res;
+	ssize_t ret;
+	size_t size;
+	int eof = 0, synced = 1;
+
+	while (1) {
+		res = aac_frame_size(buf + pos, len - pos, &size);
+		if (res == -EPROTO) {
+			if (synced)
+				result->resyncs++;
+			synced = 0;
+			result->bytes_skipped++;
+			pos++;
+			continue;
+		} else if (res == 0 && size <= len - pos) {
+			if (!synced)
+				res = check_resync(
+					buf + pos, len - pos, size, eof);
+			if (res == -EPROTO) {
+				/* Syncword pattern in the invalid data */
+				result->bytes_skipped++;
+				pos++;
+				continue;
+			} else if (res == 0) {
+				synced = 1;
+				scan_frame(reader, result, buf + pos, size);
+				pos += size;
+				continue;
+			}
+		}
+
+		/* More data is needed */
+		if (eof)
+			break;
+		ret = read_buf(fd, buf, &len, &pos);
+		if (ret < 0)
+			return ret;
+		eof = (ret == 0);
+	}
+
+	/* Truncated last frame: counted as a parsing error */
+	if (len > pos)
+		scan_frame(reader, result, buf + pos, len - pos);
+	return 0;
+}
+
+
+static void scan_file(struct scan_result *result, uint8_t *buf)
+{
+	int res;
+	int fd;
+	ssize_t ret;
+	size_t len = 0, pos = 0;
+	struct stat st;
+	struct aac_ctx_cbs cbs;
+	struct aac_reader *reader = NULL;
+	struct aac_reader_stats stats;
+	struct aac_ctx *ctx;
+	const struct aac_adts *adts;
+	const struct aac_asc *asc;
+
+	fd = open(result->path, O_RDONLY);
+	if (fd < 0) {
+		result->status = -errno;
+		return;
+	}
+	if (fstat(fd, &st) == 0)
+		result->size = st.st_size;
+
+	/* Probe the format on a full buffer; tags larger than the buffer
+	 * are skipped in the file */
+	while (1) {
+		do {
+			ret = read_buf(fd, buf, &len, &pos);
+		} while (ret > 0 && len < SCAN_BUF_SIZE);
+		if (ret < 0) {
+			res = ret;
+			goto out;
+		}
+		res = aac_probe(buf, len, &result->probe);
+		if (res != -EAGAIN || ret == 0)
+			break;
+		if (lseek(fd, result->probe.offset - len, SEEK_CUR) < 0) {
+			res = -errno;
+			goto out;
+		}
+		len = 0;
+	}
+	if (res < 0)
+		goto out;
+	pos = result->probe.offset;
+
+	/* Only the framed formats are scanned */
+	if (result->probe.data_format != ADEF_AAC_DATA_FORMAT_ADTS &&
+	    result->probe.transport != AAC_TRANSPORT_LOAS) {
+		res = -ENOTSUP;
+		goto out;
+	}
+
+	memset(&cbs, 0, sizeof(cbs));
+	res = aac_reader_new(&cbs, NULL, &reader);
+	if (res < 0)
+		goto out;
+	res = scan_frames(reader, result, fd, buf, len, pos);
+	if (res < 0)
+		goto out;
+
+	res = aac_reader_get_stats(reader, &stats);
+	if (res < 0)
+		goto out;
+	result->errors = stats.errors_truncated + stats.errors_invalid +
+			 stats.errors_unsupported + stats.errors_other;
+	ctx = aac_reader_get_ctx(reader);
+	if (result->probe.data_format == ADEF_AAC_DATA_FORMAT_ADTS) {
+		adts = aac_ctx_get_adts(ctx);
+		result->aot = adts->profile_ObjectType + 1;
+		result->channel_configuration = adts->channel_configuration;
+	} else {
+		asc = aac_ctx_get_asc(ctx);
+		result->aot = asc->audioObjectType;
+		result->channel_configuration = asc->channelConfiguration;
+	}
+
+out:
+	if (reader != NULL)
+		aac_reader_destroy(reader);
+	close(fd);
+	result->status = res;
+}
+
+
+static void print_csv_str(FILE *f, const char *str)
+{
+	if (strpbrk(str, ",\"\r\n") == NULL) {
+		fputs(str, f);
+		return;
+	}
+	fputc('"', f);
+	for (; *str != '\0'; str++) {
+		if (*str == '"')
+			fputc('"', f);
+		fputc(*str, f);
+	}
+	fputc('"', f);
+}
+
+
+/* JSON string, escaping the quotes, backslashes and control characters */
+static void print_json_str(FILE *f, const char *str)
+{
+	fputc('"', f);
+	for (; *str != '\0'; str++) {
+		if (*str == '"' || *str == '\\')
+			fprintf(f, "\\%c", *str);
+		else if ((unsigned char)*str < 0x20)
+			fprintf(f, "\\u%04x", *str);
+		else
+			fputc(*str, f);
+	}
+	fputc('"', f);
+}
+
+
+static const char csv_header[] =
+	"path,format,aot,sample_rate,channel_configuration,size,frames,"
+	"duration,bitrate_avg,bitrate_min,bitrate_max,errors,resyncs,"
+	"bytes_skipped,status\n";
+
+
+static void print_result(struct app *app, const struct scan_result *result)
+{
+	FILE *f = app->fout;
+	double duration = 0.;
+	uint64_t bitrate = 0;
+	const char *status = result->status < 0 ? strerror(-result->status)
+						: "ok";
+
+	if (result->sample_rate > 0) {
+		duration = (double)result->duration / result->sample_rate;
+		bitrate = result->frame_bytes * 8 * result->sample_rate /
+			  result->duration;
+	}
+
+	if (app->format == OUTPUT_FORMAT_CSV) {
+		print_csv_str(f, result->path);
+		fprintf(f,
+			",%s,%s,%" PRIu32 ",%" PRIu32 ",%" PRIu64
+			",%" PRIu64 ",%.3f,%" PRIu64 ",%" PRIu64 ",%" PRIu64
+			",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",",
+			format_to_str(&result->probe),
+			aac_aot_to_str(result->aot),
+			result->sample_rate,
+			result->channel_configuration,
+			result->size,
+			result->frames,
+			duration,
+			bitrate,
+			result->bitrate_min,
+			result->bitrate_max,
+			result->errors,
+			result->resyncs,
+			result->bytes_skipped);
+		print_csv_str(f, status);
+		fputc('\n', f);
+		return;
+	}
+
+	fprintf(f, "{\"path\": ");
+	print_json_str(f, result->path);
+	fprintf(f,
+		", \"format\": \"%s\", \"aot\": \"%s\", "
+		"\"sample_rate\": %" PRIu32 ", "
+		"\"channel_configuration\": %" PRIu32 ", "
+		"\"size\": %" PRIu64 ", \"frames\": %" PRIu64 ", "
+		"\"duration\": %.3f, \"bitrate_avg\": %" PRIu64 ", "
+		"\"bitrate_min\": %" PRIu64 ", \"bitrate_max\": %" PRIu64 ", "
+		"\"errors\": %" PRIu64 ", \"resyncs\": %" PRIu64 ", "
+		"\"bytes_skipped\": %" PRIu64 ", \"status\": ",
+		format_to_str(&result->probe),
+		aac_aot_to_str(result->aot),
+		result->sample_rate,
+		result->channel_configuration,
+		result->size,
+		result->frames,
+		duration,
+		bitrate,
+		result->bitrate_min,
+		result->bitrate_max,
+		result->errors,
+		result->resyncs,
+		result->bytes_skipped);
+	print_json_str(f, status);
+	fprintf(f, "}\n");
+}
+
+
+static void *job_thread(void *userdata)
+{
+	struct app *app = userdata;
+	struct scan_result *result;
+	uint8_t *buf;
+
+	buf = malloc(SCAN_BUF_SIZE);
+	if (buf == NULL) {
+		ULOG_ERRNO("malloc", ENOMEM);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&app->mutex);
+	while (app->next_scan < app->count) {
+		result = &app->results[app->next_scan++];
+		pthread_mutex_unlock(&app->mutex);
+
+		scan_file(result, buf);
+
+		pthread_mutex_lock(&app->mutex);
+		result->done = 1;
+		if (result->status < 0 || result->errors > 0 ||
+		    result->resyncs > 0)
+			app->failed = 1;
+		/* Print the results of the inputs done so far, in order */
+		while (app->next_print < app->count &&
+		       app->results[app->next_print].done) {
+			print_result(app, &app->results[app->next_print]);
+			app->next_print++;
+		}
+	}
+	pthread_mutex_unlock(&app->mutex);
+
+	free(buf);
+	return NULL;
+}
+
+
+static const char short_options[] = "hj:e:f:o:";
+
+
+static const struct option long_options[] = {
+	{"help", no_argument, NULL, 'h'},
+	{"jobs", required_argument, NULL, 'j'},
+	{"ext", required_argument, NULL, 'e'},
+	{"format", required_argument, NULL, 'f'},
+	{"output", required_argument, NULL, 'o'},
+	{0, 0, 0, 0},
+};
+
+
+static void welcome(char *prog_name)
+{
+	/* stdout is reserved for the results */
+	fprintf(stderr,
+		"\n%s - Parrot AAC batch integrity scanner\n"
+		"Copyright (c) 2023 Parrot Drones SAS\n\n",
+		prog_name);
+}
+
+
+static void usage(char *prog_name)
+{
+	printf("Usage: %s [options] <file or directory>...\n"
+	       "\n"
+	       "Scan the ADTS and LOAS frames of each file (directories are "
+	       "walked\n"
+	       "recursively, without following the symbolic links to "
+	       "directories) on a\n"
+	       "pool of jobs and print one line per file, in the order of "
+	       "the inputs.\n"
+	       "The exit status is non-zero if a file could "
+	       "not be scanned\n"
+	       "or has errors or losses of synchronization.\n"
+	       "\n"
+	       "Options:\n"
+	       "-h | --help                        Print this message\n"
+	       "-j | --jobs <n>                    Number of concurrent scans "
+	       "(default:\n"
+	       "                                   number of CPUs)\n"
+	       "-e | --ext <extension>             Only scan the files of the "
+	       "directories\n"
+	       "                                   with this extension (e.g. "
+	       "'aac'), can\n"
+	       "                                   be repeated\n"
+	       "-f | --format <csv|jsonl>          Output format (default: "
+	       "csv)\n"
+	       "-o | --output <file>               Output file (default: "
+	       "stdout)\n"
+	       "\n",
+	       prog_name);
+}
+
+
+int main(int argc, char *argv[])
+{
+	int res = 0;
+	int idx, c;
+	long jobs = 0;
+	unsigned int thread_count = 0;
+	pthread_t threads[MAX_JOBS];
+	const char *output = NULL;
+	struct app app;
+
+	memset(&app, 0, sizeof(app));
+	app.fout = stdout;
+
+	welcome(argv[0]);
+
+	/* Command-line parameters */
+	while ((c = getopt_long(
+			argc, argv, short_options, long_options, &idx)) != -1) {
+		switch (c) {
+		case 0:
+			break;
+
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+			break;
+
+		case 'j':
+			jobs = atol(optarg);
+			if (jobs <= 0 || jobs > MAX_JOBS) {
+				fprintf(stderr, "Invalid jobs count\n");
+				exit(EXIT_FAILURE);
+			}
+			break;
+
+		case 'e':
+			if (app.extension_count >= MAX_EXTENSIONS) {
+				fprintf(stderr, "Too many extensions\n");
+				exit(EXIT_FAILURE);
+			}
+			app.extensions[app.extension_count++] =
+				optarg[0] == '.' ? optarg + 1 : optarg;
+			break;
+
+		case 'f':
+			if (strcmp(optarg, "csv") == 0) {
+				app.format = OUTPUT_FORMAT_CSV;
+			} else if (strcmp(optarg, "jsonl") == 0) {
+				app.format = OUTPUT_FORMAT_JSONL;
+			} else {
+				fprintf(stderr,
+					"Unknown format '%s'\n",
+					optarg);
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			break;
+
+		case 'o':
+			output = optarg;
+			break;
+
+		default:
+			usage(argv[0]);
+			exit(EXIT_FAILURE);
+			break;
+		}
+	}
+	if (optind == argc) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	if (jobs == 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+		if (jobs <= 0)
+			jobs = DEFAULT_JOBS;
+		if (jobs > MAX_JOBS)
+			jobs = MAX_JOBS;
+	}
+
+	/* List the files */
+	for (int i = optind; i < argc; i++) {
+		res = add_path(&app, argv[i], 1);
+		if (res < 0) {
+			ULOG_ERRNO("add_path('%s')", -res, argv[i]);
+			goto out;
+		}
+	}
+
+	if (output != NULL) {
+		app.fout = fopen(output, "w");
+		if (app.fout == NULL) {
+			res = -errno;
+			ULOG_ERRNO("fopen('%s')", -res, output);
+			goto out;
+		}
+	}
+	if (app.format == OUTPUT_FORMAT_CSV)
+		fputs(csv_header, app.fout);
+
+	/* Scan the files on the jobs */
+	pthread_mutex_init(&app.mutex, NULL);
+	if ((unsigned long)jobs > app.count)
+		jobs = app.count > 0 ? app.count : 1;
+	for (long i = 0; i < jobs; i++) {
+		res = pthread_create(
+			&threads[thread_count], NULL, &job_thread, &app);
+		if (res != 0) {
+			ULOG_ERRNO("pthread_create", res);
+			res = -res;
+			break;
+		}
+		thread_count++;
+	}
+	for (unsigned int i = 0; i < thread_count; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&app.mutex);
+	if (thread_count == 0)
+		goto out;
+	res = 0;
+
+	/* Files left unscanned (job allocation failures) */
+	if (app.next_print < app.count) {
+		res = -ENOMEM;
+		ULOG_ERRNO("%u files not scanned",
+			   -res,
+			   app.count - app.next_print);
+	}
+
+out:
+	if (app.fout != NULL && app.fout != stdout)
+		fclose(app.fout);
+	for (unsigned int i = 0; i < app.count; i++)
+		free(app.results[i].path);
+	free(app.results);
+
+	return (res < 0 || app.failed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,255 @@
+/**
+ * Copyright (c) 2023 Parrot Drones SAS
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Parrot Drones SAS Company nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE PARROT DRONES SAS COMPANY BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ULOG_TAG aac_stat
+#include <ulog.h>
+ULOG_DECLARE_TAG(aac_stat);
+
+#include <aac/aac.h>
+
+
+#define DEFAULT_INTERVAL_MS 1000
+
+
+struct app {
+	const char *name;
+	unsigned int interval_ms;
+	unsigned int count;
+	struct aac_shm *shm;
+	/* Previous samples, to compute the rates */
+	struct aac_shm_slot *prev;
+};
+
+
+static const char *format_to_str(const struct aac_shm_slot *slot)
+{
+	switch (slot->data_format) {
+	case ADEF_AAC_DATA_FORMAT_ADTS:
+		return "adts";
+	case ADEF_AAC_DATA_FORMAT_RAW:
+		switch (slot->transport) {
+		case AAC_TRANSPORT_LOAS:
+			return "loas";
+		case AAC_TRANSPORT_ADIF:
+			return "adif";
+		default:
+			return "raw";
+		}
+	default:
+		return "unknown";
+	}
+}
+
+
+static void print_slot(struct app *app,
+		       unsigned int idx,
+		       const struct aac_shm_slot *slot)
+{
+	const struct aac_shm_slot *prev = &app->prev[idx];
+	double fps = 0., kbps = 0., dt;
+	uint64_t errors;
+
+	/* Rates since the previous sample of the slot */
+	if (prev->used && slot->timestamp > prev->timestamp) {
+		dt = (slot->timestamp - prev->timestamp) / 1000000.;
+		fps = (slot->stats.frames - prev->stats.frames) / dt;
+		kbps = (slot->stats.bytes - prev->stats.bytes) * 8 / dt / 1000.;
+	}
+	errors = slot->stats.errors_truncated + slot->stats.errors_invalid +
+		 slot->stats.errors_unsupported + slot->stats.errors_other;
+
+	printf("%-3u %-20s %-7s %-10s %6u %2u %10" PRIu64 " %8.2f %9.2f "
+	       "%8" PRIu64 " %8" PRIu64 "\n",
+	       idx,
+	       slot->name,
+	       format_to_str(slot),
+	       aac_aot_to_str(slot->audio_object_type),
+	       slot->sample_rate,
+	       slot->channel_configuration,
+	       slot->stats.frames,
+	       fps,
+	       kbps,
+	       slot->stats.frames_skipped,
+	       errors);
+}
+
+
+static int poll_slots(struct app *app)
+{
+	int res;
+	unsigned int count = aac_shm_get_slot_count(app->shm);
+	struct aac_shm_slot slot;
+
+	for (unsigned int i = 0; i < count; i++) {
+		res = aac_shm_read(app->shm, i, &slot);
+		if (res == -EAGAIN)
+			continue;
+		else if (res < 0)
+			return res;
+		if (!slot.used)
+			continue;
+		print_slot(app, i, &slot);
+		app->prev[i] = slot;
+	}
+	fflush(stdout);
+
+	return 0;
+}
+
+
+static const char short_options[] = "hi:n:";
+
+
+static const struct option long_options[] = {
+	{"help", no_argument, NULL, 'h'},
+	{"interval", required_argument, NULL, 'i'},
+	{"count", required_argument, NULL, 'n'},
+	{0, 0, 0, 0},
+};
+
+
+static void welcome(char *prog_name)
+{
+	printf("\n%s - Parrot AAC stream health monitoring tool\n"
+	       "Copyright (c) 2023 Parrot Drones SAS\n\n",
+	       prog_name);
+}
+
+
+static void usage(char *prog_name)
+{
+	printf("Usage: %s [options] <shared memory name>\n"
+	       "\n"
+	       "Options:\n"
+	       "-h | --help                        Print this message\n"
+	       "-i | --interval <ms>               Polling interval "
+	       "(default: %d ms)\n"
+	       "-n | --count <n>                   Number of polls "
+	       "(default: 0, infinite)\n"
+	       "\n",
+	       prog_name,
+	       DEFAULT_INTERVAL_MS);
+}
+
+
+int main(int argc, char *argv[])
+{
+	int res = 0;
+	int idx, c;
+	struct app app;
+
+	memset(&app, 0, sizeof(app));
+	app.interval_ms = DEFAULT_INTERVAL_MS;
+
+	welcome(argv[0]);
+
+	if (argc < 2) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	/* Command-line parameters */
+	while ((c = getopt_long(
+			argc, argv, short_options, long_options, &idx)) != -1) {
+		switch (c) {
+		case 0:
+			break;
+
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+			break;
+
+		case 'i':
+			app.interval_ms = atoi(optarg);
+			break;
+
+		case 'n':
+			app.count = atoi(optarg);
+			break;
+
+		default:
+			usage(argv[0]);
+			exit(EXIT_FAILURE);
+			break;
+		}
+	}
+	if (argc - optind < 1) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	app.name = argv[optind];
+
+	/* Open the shared memory segment */
+	res = aac_shm_open(app.name, &app.shm);
+	if (res < 0) {
+		ULOG_ERRNO("aac_shm_open('%s')", -res, app.name);
+		goto out;
+	}
+	app.prev = calloc(aac_shm_get_slot_count(app.shm), sizeof(*app.prev));
+	if (app.prev == NULL) {
+		res = -ENOMEM;
+		goto out;
+	}
+
+	printf("%-3s %-20s %-7s %-10s %6s %2s %10s %8s %9s %8s %8s\n",
+	       "#",
+	       "name",
+	       "format",
+	       "aot",
+	       "rate",
+	       "ch",
+	       "frames",
+	       "fps",
+	       "kbps",
+	       "skipped",
+	       "errors");
+	for (unsigned int i = 0; app.count == 0 || i < app.count; i++) {
+		if (i > 0)
+			usleep(app.interval_ms * 1000);
+		res = poll_slots(&app);
+		if (res < 0) {
+			ULOG_ERRNO("poll_slots", -res);
+			goto out;
+		}
+	}
+
+out:
+	/* Cleanup */
+	free(app.prev);
+	if (app.shm != NULL)
+		aac_shm_destroy(app.shm);
+
+	return res >= 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}